@@ -36,12 +36,14 @@ int g_api_version = 0;
  *   FDBFuture -> ThreadSingleAssignmentVarBase
  *   FDBDatabase -> IDatabase
  *   FDBTransaction -> ITransaction
+ *   FDBRangeStream -> IRangeStream
  */
 #define TSAVB(f) ((ThreadSingleAssignmentVarBase*)(f))
 #define TSAV(T, f) ((ThreadSingleAssignmentVar<T>*)(f))
 
 #define DB(d) ((IDatabase*)d)
 #define TXN(t) ((ITransaction*)t)
+#define RANGE_STREAM(s) ((IRangeStream*)s)
 
 // Legacy (pre API version 610)
 #define CLUSTER(c) ((char*)c)
@@ -656,6 +658,36 @@ extern "C" DLLEXPORT FDBFuture* fdb_transaction_get_range_split_points(FDBTransa
 	return (FDBFuture*)(TXN(tr)->getRangeSplitPoints(range, chunk_size).extractPtr());
 }
 
+extern "C" DLLEXPORT fdb_error_t fdb_transaction_get_range_stream(FDBTransaction* tr,
+                                                                 uint8_t const* begin_key_name,
+                                                                 int begin_key_name_length,
+                                                                 fdb_bool_t begin_or_equal,
+                                                                 int begin_offset,
+                                                                 uint8_t const* end_key_name,
+                                                                 int end_key_name_length,
+                                                                 fdb_bool_t end_or_equal,
+                                                                 int end_offset,
+                                                                 fdb_bool_t snapshot,
+                                                                 int64_t max_buffered_bytes,
+                                                                 FDBRangeStream** out_stream) {
+	CATCH_AND_RETURN(
+	    KeySelectorRef begin(KeyRef(begin_key_name, begin_key_name_length), begin_or_equal, begin_offset);
+	    KeySelectorRef end(KeyRef(end_key_name, end_key_name_length), end_or_equal, end_offset);
+	    *out_stream =
+	        (FDBRangeStream*)(TXN(tr)->getRangeStream(begin, end, snapshot, max_buffered_bytes).extractPtr()););
+}
+
+extern "C" DLLEXPORT FDBFuture* fdb_range_stream_next(FDBRangeStream* s) {
+	return (FDBFuture*)(RANGE_STREAM(s)->next().extractPtr());
+}
+
+extern "C" DLLEXPORT void fdb_range_stream_destroy(FDBRangeStream* s) {
+	try {
+		RANGE_STREAM(s)->delref();
+	} catch (...) {
+	}
+}
+
 #include "fdb_c_function_pointers.g.h"
 
 #define FDB_API_CHANGED(func, ver)                                                                                     \
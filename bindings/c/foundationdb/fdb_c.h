@@ -67,6 +67,7 @@ extern "C" {
 typedef struct FDB_future FDBFuture;
 typedef struct FDB_database FDBDatabase;
 typedef struct FDB_transaction FDBTransaction;
+typedef struct FDB_range_stream FDBRangeStream;
 
 typedef int fdb_error_t;
 typedef int fdb_bool_t;
@@ -309,6 +310,25 @@ DLLEXPORT WARN_UNUSED_RESULT FDBFuture* fdb_transaction_get_range_split_points(F
                                                                                int end_key_name_length,
                                                                                int64_t chunk_size);
 
+/* Streams the range from the storage servers in parallel, in batches returned in key order by
+   fdb_range_stream_next(). A positive max_buffered_bytes bounds how much is read ahead of the caller. */
+DLLEXPORT WARN_UNUSED_RESULT fdb_error_t fdb_transaction_get_range_stream(FDBTransaction* tr,
+                                                                         uint8_t const* begin_key_name,
+                                                                         int begin_key_name_length,
+                                                                         fdb_bool_t begin_or_equal,
+                                                                         int begin_offset,
+                                                                         uint8_t const* end_key_name,
+                                                                         int end_key_name_length,
+                                                                         fdb_bool_t end_or_equal,
+                                                                         int end_offset,
+                                                                         fdb_bool_t snapshot,
+                                                                         int64_t max_buffered_bytes,
+                                                                         FDBRangeStream** out_stream);
+
+DLLEXPORT WARN_UNUSED_RESULT FDBFuture* fdb_range_stream_next(FDBRangeStream* s);
+
+DLLEXPORT void fdb_range_stream_destroy(FDBRangeStream* s);
+
 #define FDB_KEYSEL_LAST_LESS_THAN(k, l) k, l, 0, 0
 #define FDB_KEYSEL_LAST_LESS_OR_EQUAL(k, l) k, l, 1, 0
 #define FDB_KEYSEL_FIRST_GREATER_THAN(k, l) k, l, 1, 1
@@ -484,6 +484,69 @@ struct RunResult getRange(struct ResultSet* rs, FDBTransaction* tr) {
 	return RES(GET_RANGE_COUNT / (end - start), 0);
 }
 
+const char* GET_RANGE_STREAM_KPI = "C get range stream throughput (local client)";
+struct RunResult getRangeStream(struct ResultSet* rs, FDBTransaction* tr) {
+	fdb_error_t e = maybeLogError(setRetryLimit(rs, tr, 5), "setting retry limit", rs);
+	if (e)
+		return RES(0, e);
+
+	uint32_t startKey = ((uint64_t)rand()) % (numKeys - GET_RANGE_COUNT - 1);
+
+	double start = getTime();
+
+	const FDBKeyValue* outKv;
+	int outCount;
+	fdb_bool_t outMore = 1;
+	int totalOut = 0;
+
+	FDBRangeStream* stream;
+	e = maybeLogError(fdb_transaction_get_range_stream(tr,
+	                                                   keys[startKey],
+	                                                   keySize,
+	                                                   1,
+	                                                   0,
+	                                                   keys[startKey + GET_RANGE_COUNT],
+	                                                   keySize,
+	                                                   1,
+	                                                   0,
+	                                                   0,
+	                                                   0,
+	                                                   &stream),
+	                  "starting range stream",
+	                  rs);
+	if (e)
+		return RES(0, e);
+
+	while (outMore) {
+		FDBFuture* f = fdb_range_stream_next(stream);
+		e = maybeLogError(fdb_future_block_until_ready(f), "getting range stream batch", rs);
+		if (!e) {
+			e = maybeLogError(
+			    fdb_future_get_keyvalue_array(f, &outKv, &outCount, &outMore), "reading range stream array", rs);
+		}
+		fdb_future_destroy(f);
+		if (e) {
+			fdb_range_stream_destroy(stream);
+			return RES(0, e);
+		}
+
+		totalOut += outCount;
+	}
+	fdb_range_stream_destroy(stream);
+
+	if (totalOut != GET_RANGE_COUNT) {
+		char* msg = (char*)malloc((sizeof(char)) * 200);
+		sprintf(msg, "verifying out count (%d != %d)", totalOut, GET_RANGE_COUNT);
+		logError(4100, msg, rs);
+		free(msg);
+		return RES(0, 4100);
+	}
+
+	double end = getTime();
+
+	return RES(GET_RANGE_COUNT / (end - start), 0);
+}
+
 uint32_t GET_KEY_COUNT = 2000;
 const char* GET_KEY_KPI = "C get key throughput (local client)";
 struct RunResult getKey(struct ResultSet* rs, FDBTransaction* tr) {
@@ -625,6 +688,9 @@ void runTests(struct ResultSet* rs) {
 	printf("get_range\n");
 	runTest(&getRange, db, rs, GET_RANGE_KPI);
 
+	printf("get_range_stream\n");
+	runTest(&getRangeStream, db, rs, GET_RANGE_STREAM_KPI);
+
 	printf("get_key\n");
 	runTest(&getKey, db, rs, GET_KEY_KPI);
 
@@ -84,6 +84,18 @@ void Future::cancel() {
 	return fdb_future_get_keyvalue_array(future_, out_kv, out_count, out_more);
 }
 
+// RangeStream
+
+RangeStream::~RangeStream() {
+	if (stream_) {
+		fdb_range_stream_destroy(stream_);
+	}
+}
+
+KeyValueArrayFuture RangeStream::next() {
+	return KeyValueArrayFuture(fdb_range_stream_next(stream_));
+}
+
 // Database
 Int64Future Database::reboot_worker(FDBDatabase* db,
                                     const uint8_t* address,
@@ -193,6 +205,35 @@ KeyValueArrayFuture Transaction::get_range(const uint8_t* begin_key_name,
 	                                                     reverse));
 }
 
+[[nodiscard]] fdb_error_t Transaction::get_range_stream(const uint8_t* begin_key_name,
+                                                       int begin_key_name_length,
+                                                       fdb_bool_t begin_or_equal,
+                                                       int begin_offset,
+                                                       const uint8_t* end_key_name,
+                                                       int end_key_name_length,
+                                                       fdb_bool_t end_or_equal,
+                                                       int end_offset,
+                                                       fdb_bool_t snapshot,
+                                                       int64_t max_buffered_bytes,
+                                                       RangeStream* out_stream) {
+	if (out_stream->stream_) {
+		fdb_range_stream_destroy(out_stream->stream_);
+		out_stream->stream_ = nullptr;
+	}
+	return fdb_transaction_get_range_stream(tr_,
+	                                        begin_key_name,
+	                                        begin_key_name_length,
+	                                        begin_or_equal,
+	                                        begin_offset,
+	                                        end_key_name,
+	                                        end_key_name_length,
+	                                        end_or_equal,
+	                                        end_offset,
+	                                        snapshot,
+	                                        max_buffered_bytes,
+	                                        &out_stream->stream_);
+}
+
 EmptyFuture Transaction::watch(std::string_view key) {
 	return EmptyFuture(fdb_transaction_watch(tr_, (const uint8_t*)key.data(), key.size()));
 }
@@ -132,6 +132,7 @@ public:
 
 private:
 	friend class Transaction;
+	friend class RangeStream;
 	KeyValueArrayFuture(FDBFuture* f) : Future(f) {}
 };
 
@@ -158,6 +159,24 @@ public:
 	                                   int snap_command_length);
 };
 
+// Wrapper around FDBRangeStream. Handles cleanup of memory, removing the need
+// to call fdb_range_stream_destroy.
+class RangeStream final {
+public:
+	RangeStream() : stream_(nullptr) {}
+	RangeStream(const RangeStream&) = delete;
+	RangeStream& operator=(const RangeStream&) = delete;
+	~RangeStream();
+
+	// Returns a future which will be set to the next FDBKeyValue array of the
+	// stream.
+	KeyValueArrayFuture next();
+
+private:
+	friend class Transaction;
+	FDBRangeStream* stream_;
+};
+
 // Wrapper around FDBTransaction, providing the same set of calls as the C API.
 // Handles cleanup of memory, removing the need to call
 // fdb_transaction_destroy.
@@ -219,6 +238,20 @@ public:
 	                              fdb_bool_t snapshot,
 	                              fdb_bool_t reverse);
 
+	// Wrapper around fdb_transaction_get_range_stream. On success, `out_stream`
+	// is set to the new stream.
+	fdb_error_t get_range_stream(const uint8_t* begin_key_name,
+	                             int begin_key_name_length,
+	                             fdb_bool_t begin_or_equal,
+	                             int begin_offset,
+	                             const uint8_t* end_key_name,
+	                             int end_key_name_length,
+	                             fdb_bool_t end_or_equal,
+	                             int end_offset,
+	                             fdb_bool_t snapshot,
+	                             int64_t max_buffered_bytes,
+	                             RangeStream* out_stream);
+
 	// Wrapper around fdb_transaction_watch. Returns a future representing an
 	// empty value.
 	EmptyFuture watch(std::string_view key);
@@ -929,6 +929,64 @@ TEST_CASE("fdb_transaction_get_range FDB_STREAMING_MODE_EXACT") {
 	}
 }
 
+TEST_CASE("fdb_transaction_get_range_stream") {
+	std::map<std::string, std::string> data;
+	for (int i = 0; i < 1000; ++i) {
+		data[key(std::to_string(100000 + i))] = std::string(100, 'x');
+	}
+	insert_data(db, data);
+
+	fdb::Transaction tr(db);
+	while (1) {
+		std::string begin = key("");
+		std::string end = strinc(begin);
+		fdb::RangeStream stream;
+		fdb_check(tr.get_range_stream(
+		    FDB_KEYSEL_FIRST_GREATER_OR_EQUAL((const uint8_t*)begin.c_str(), begin.size()),
+		    FDB_KEYSEL_FIRST_GREATER_OR_EQUAL((const uint8_t*)end.c_str(), end.size()),
+		    /* snapshot */ false,
+		    /* max_buffered_bytes */ 10000,
+		    &stream));
+
+		std::vector<std::pair<std::string, std::string>> results;
+		fdb_bool_t out_more = 1;
+		fdb_error_t err = 0;
+		while (out_more) {
+			fdb::KeyValueArrayFuture f1 = stream.next();
+			err = wait_future(f1);
+			if (err) {
+				break;
+			}
+
+			const FDBKeyValue* out_kv;
+			int out_count;
+			fdb_check(f1.get(&out_kv, &out_count, &out_more));
+			if (!out_more) {
+				CHECK(out_count == 0);
+			}
+			for (int i = 0; i < out_count; ++i) {
+				results.emplace_back(std::string((const char*)out_kv[i].key, out_kv[i].key_length),
+				                     std::string((const char*)out_kv[i].value, out_kv[i].value_length));
+			}
+		}
+
+		if (err) {
+			fdb::EmptyFuture f2 = tr.on_error(err);
+			fdb_check(wait_future(f2));
+			continue;
+		}
+
+		CHECK(results.size() == data.size());
+		auto it = data.begin();
+		for (const auto& [key, value] : results) {
+			CHECK(it->first.compare(key) == 0);
+			CHECK(it->second.compare(value) == 0);
+			++it;
+		}
+		break;
+	}
+}
+
 TEST_CASE("fdb_transaction_clear") {
 	insert_data(db, create_data({ { "foo", "bar" } }));
 
@@ -0,0 +1,760 @@
+/*
+ * BTreeVersionedMap.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2021 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FDBCLIENT_BTREEVERSIONEDMAP_H
+#define FDBCLIENT_BTREEVERSIONEDMAP_H
+#pragma once
+
+#include <algorithm>
+#include <deque>
+
+#include "flow/flow.h"
+#include "fdbclient/FDBTypes.h"
+#include "fdbclient/VersionedMap.h"
+
+// BTreeVersionedMap has the same interface as VersionedMap, but is built on a partially persistent B+tree instead of a
+// PTree.
+//
+// Leaves hold a small sorted array of entries and interior nodes a sorted array of child pointers, each sized to a few
+// cache lines.  A lookup therefore visits O(log_B n) nodes instead of O(log n) treap nodes, and iterating over a range
+// mostly walks contiguous arrays.
+//
+// Nodes are copied on write.  A node created at the latest version is only reachable from the latest root, so it is
+// modified in place.  All of the mutations applied to a version share the nodes copied by the first mutation that
+// touched them, and the cost per mutation falls as the number of mutations per version grows.
+//
+// Interior nodes route on the first key of each child, and that key is always equal to the smallest key present in the
+// child.  Every key referenced by a node reachable at a version is therefore an entry of the map at that version, so,
+// as with VersionedMap, a map of KeyRefs never refers to memory that is older than its entries.
+namespace BTreeVersionedMapImpl {
+
+// Target size of a node, in bytes.  Leaves and interior nodes are allocated from the same FastAllocator size class.
+static constexpr int NODE_BYTES = 512;
+
+// Iterators store the path from the root, so this bounds the height of the tree.  Every non-root node keeps at least
+// two children or entries, so this is far above any reachable height.
+static constexpr int MAX_HEIGHT = 32;
+
+template <class K, class T>
+struct Leaf;
+template <class K, class T>
+struct Interior;
+
+template <class K, class T>
+struct Node : NonCopyable {
+	mutable int32_t referenceCount;
+	uint16_t count; // Number of entries in a leaf or of children in an interior node
+	uint8_t height; // 0 for leaves
+	Version version; // Version at which the node was created; only nodes created at the latest version are mutable
+
+	Node(uint8_t height, Version version) : referenceCount(1), count(0), height(height), version(version) {}
+
+	bool isLeaf() const { return height == 0; }
+	void addref() const { ++referenceCount; }
+	void delref() const;
+	bool isSoleOwner() const { return referenceCount == 1; }
+
+	K const& firstKey() const;
+};
+
+template <class K, class T>
+struct Leaf : Node<K, T>, FastAllocated<Leaf<K, T>> {
+	static constexpr int capacity =
+	    std::max<int>(4, (NODE_BYTES - sizeof(Node<K, T>)) / (sizeof(K) + sizeof(T) + sizeof(Version)));
+
+	// Keys are stored apart from values so that searching a leaf only touches the keys
+	K keys[capacity];
+	T values[capacity];
+	Version insertVersions[capacity];
+
+	explicit Leaf(Version version) : Node<K, T>(0, version) {}
+};
+
+template <class K, class T>
+struct Interior : Node<K, T>, FastAllocated<Interior<K, T>> {
+	static constexpr int capacity =
+	    std::max<int>(4, (NODE_BYTES - sizeof(Node<K, T>)) / (sizeof(K) + sizeof(Reference<Node<K, T>>)));
+
+	K keys[capacity]; // keys[i] is the smallest key in children[i]
+	Reference<Node<K, T>> children[capacity];
+
+	Interior(uint8_t height, Version version) : Node<K, T>(height, version) {}
+};
+
+template <class K, class T>
+Leaf<K, T>* asLeaf(Node<K, T>* n) {
+	return static_cast<Leaf<K, T>*>(n);
+}
+template <class K, class T>
+Leaf<K, T> const* asLeaf(Node<K, T> const* n) {
+	return static_cast<Leaf<K, T> const*>(n);
+}
+template <class K, class T>
+Interior<K, T>* asInterior(Node<K, T>* n) {
+	return static_cast<Interior<K, T>*>(n);
+}
+template <class K, class T>
+Interior<K, T> const* asInterior(Node<K, T> const* n) {
+	return static_cast<Interior<K, T> const*>(n);
+}
+
+template <class K, class T>
+void Node<K, T>::delref() const {
+	if (!--referenceCount) {
+		if (isLeaf())
+			delete asLeaf(const_cast<Node*>(this));
+		else
+			delete asInterior(const_cast<Node*>(this));
+	}
+}
+
+template <class K, class T>
+K const& Node<K, T>::firstKey() const {
+	ASSERT(count > 0);
+	return isLeaf() ? asLeaf(this)->keys[0] : asInterior(this)->keys[0];
+}
+
+// Moves a node's child references onto toFree if this is their last reference, so that the caller can destroy a large
+// tree incrementally (see deferredCleanupActor)
+template <class K, class T>
+void releaseChildren(Reference<Node<K, T>>& n, std::vector<Reference<Node<K, T>>>& toFree) {
+	if (n->isLeaf())
+		return;
+	Interior<K, T>* in = asInterior(n.getPtr());
+	for (int i = 0; i < in->count; i++) {
+		if (in->children[i]->isSoleOwner())
+			toFree.push_back(std::move(in->children[i]));
+	}
+}
+
+template <class K, class T>
+Reference<Node<K, T>> clone(Node<K, T> const* n, Version at) {
+	if (n->isLeaf()) {
+		Leaf<K, T> const* l = asLeaf(n);
+		Leaf<K, T>* r = new Leaf<K, T>(at);
+		r->count = l->count;
+		std::copy(l->keys, l->keys + l->count, r->keys);
+		std::copy(l->values, l->values + l->count, r->values);
+		std::copy(l->insertVersions, l->insertVersions + l->count, r->insertVersions);
+		return Reference<Node<K, T>>(r);
+	}
+	Interior<K, T> const* in = asInterior(n);
+	Interior<K, T>* r = new Interior<K, T>(in->height, at);
+	r->count = in->count;
+	std::copy(in->keys, in->keys + in->count, r->keys);
+	std::copy(in->children, in->children + in->count, r->children);
+	return Reference<Node<K, T>>(r);
+}
+
+// Makes the node referenced by p modifiable at version at, copying it if it belongs to an older version
+template <class K, class T>
+Node<K, T>* makeMutable(Reference<Node<K, T>>& p, Version at) {
+	if (p->version != at)
+		p = clone(p.getPtr(), at);
+	return p.getPtr();
+}
+
+// Returns the index of the child whose subtree would contain x
+template <class K, class T, class X>
+int childIndex(Interior<K, T> const* in, X const& x) {
+	int i = std::upper_bound(in->keys, in->keys + in->count, x) - in->keys;
+	return i > 0 ? i - 1 : 0;
+}
+
+template <class K, class T>
+void leafInsertAt(Leaf<K, T>* l, int i, K const& k, T const& t, Version insertVersion) {
+	ASSERT((l->count < Leaf<K, T>::capacity));
+	std::move_backward(l->keys + i, l->keys + l->count, l->keys + l->count + 1);
+	std::move_backward(l->values + i, l->values + l->count, l->values + l->count + 1);
+	std::move_backward(l->insertVersions + i, l->insertVersions + l->count, l->insertVersions + l->count + 1);
+	l->keys[i] = k;
+	l->values[i] = t;
+	l->insertVersions[i] = insertVersion;
+	++l->count;
+}
+
+template <class K, class T>
+void interiorInsertAt(Interior<K, T>* in, int i, Reference<Node<K, T>>&& child) {
+	ASSERT((in->count < Interior<K, T>::capacity));
+	std::move_backward(in->keys + i, in->keys + in->count, in->keys + in->count + 1);
+	std::move_backward(in->children + i, in->children + in->count, in->children + in->count + 1);
+	in->keys[i] = child->firstKey();
+	in->children[i] = std::move(child);
+	++in->count;
+}
+
+// Moves the entries or children [from, n->count) of n to the end of the node dest, which must have the same height
+template <class K, class T>
+void moveTail(Node<K, T>* n, int from, Node<K, T>* dest) {
+	int moved = n->count - from;
+	if (n->isLeaf()) {
+		Leaf<K, T>* l = asLeaf(n);
+		Leaf<K, T>* d = asLeaf(dest);
+		std::copy(l->keys + from, l->keys + l->count, d->keys + d->count);
+		std::copy(l->values + from, l->values + l->count, d->values + d->count);
+		std::copy(l->insertVersions + from, l->insertVersions + l->count, d->insertVersions + d->count);
+	} else {
+		Interior<K, T>* in = asInterior(n);
+		Interior<K, T>* d = asInterior(dest);
+		std::copy(in->keys + from, in->keys + in->count, d->keys + d->count);
+		std::move(in->children + from, in->children + in->count, d->children + d->count);
+	}
+	dest->count += moved;
+	n->count = from;
+}
+
+// Inserts or replaces k in the subtree rooted at n, which must be mutable at version at.  If n has to be split, n keeps
+// the lower half and the upper half is returned.
+template <class K, class T>
+Reference<Node<K, T>> insert(Node<K, T>* n, Version at, K const& k, T const& t, Version insertVersion) {
+	if (n->isLeaf()) {
+		Leaf<K, T>* l = asLeaf(n);
+		int i = std::lower_bound(l->keys, l->keys + l->count, k) - l->keys;
+		if (i < l->count && !(k < l->keys[i])) {
+			l->values[i] = t;
+			l->insertVersions[i] = insertVersion;
+			return Reference<Node<K, T>>();
+		}
+		if (l->count < Leaf<K, T>::capacity) {
+			leafInsertAt(l, i, k, t, insertVersion);
+			return Reference<Node<K, T>>();
+		}
+		Leaf<K, T>* r = new Leaf<K, T>(at);
+		Reference<Node<K, T>> split(r);
+		if (i == l->count) {
+			// Appending past the end of a full leaf, as sorted bulk inserts (e.g. fetchKeys) do.  Leave this leaf full.
+			leafInsertAt(r, 0, k, t, insertVersion);
+		} else {
+			int half = l->count / 2;
+			moveTail<K, T>(l, half, r);
+			if (i <= half)
+				leafInsertAt(l, i, k, t, insertVersion);
+			else
+				leafInsertAt(r, i - half, k, t, insertVersion);
+		}
+		return split;
+	}
+
+	Interior<K, T>* in = asInterior(n);
+	int i = childIndex(in, k);
+	Node<K, T>* child = makeMutable(in->children[i], at);
+	Reference<Node<K, T>> childSplit = insert(child, at, k, t, insertVersion);
+	in->keys[i] = child->firstKey();
+	if (!childSplit)
+		return Reference<Node<K, T>>();
+
+	if (in->count < Interior<K, T>::capacity) {
+		interiorInsertAt(in, i + 1, std::move(childSplit));
+		return Reference<Node<K, T>>();
+	}
+	Interior<K, T>* r = new Interior<K, T>(in->height, at);
+	Reference<Node<K, T>> split(r);
+	if (i + 1 == in->count) {
+		interiorInsertAt(r, 0, std::move(childSplit));
+	} else {
+		int half = in->count / 2;
+		moveTail<K, T>(in, half, r);
+		if (i + 1 <= half)
+			interiorInsertAt(in, i + 1, std::move(childSplit));
+		else
+			interiorInsertAt(r, i + 1 - half, std::move(childSplit));
+	}
+	return split;
+}
+
+// Removes children [begin, end) of in
+template <class K, class T>
+void removeChildren(Interior<K, T>* in, int begin, int end) {
+	if (begin == end)
+		return;
+	std::move(in->keys + end, in->keys + in->count, in->keys + begin);
+	std::move(in->children + end, in->children + in->count, in->children + begin);
+	for (int i = in->count - (end - begin); i < in->count; i++)
+		in->children[i].clear();
+	in->count -= end - begin;
+}
+
+// If child i of in has become small, merges it into a neighbor when the two fit in one node.  Returns true if a child
+// was removed.
+template <class K, class T>
+bool mergeChild(Interior<K, T>* in, int i, Version at) {
+	if (i < 0 || i >= in->count)
+		return false;
+	Node<K, T> const* child = in->children[i].getPtr();
+	int capacity = child->isLeaf() ? Leaf<K, T>::capacity : Interior<K, T>::capacity;
+	if (child->count >= capacity / 4)
+		return false;
+	int left;
+	if (i + 1 < in->count && child->count + in->children[i + 1]->count <= capacity)
+		left = i;
+	else if (i > 0 && child->count + in->children[i - 1]->count <= capacity)
+		left = i - 1;
+	else
+		return false;
+
+	Node<K, T>* dest = makeMutable(in->children[left], at);
+	Node<K, T>* src = in->children[left + 1].getPtr();
+	if (src->version == at) {
+		moveTail<K, T>(src, 0, dest);
+	} else {
+		// src is shared with older versions and must not be modified, so copy from it instead
+		Reference<Node<K, T>> copy = clone(src, at);
+		moveTail<K, T>(copy.getPtr(), 0, dest);
+	}
+	removeChildren(in, left + 1, left + 2);
+	return true;
+}
+
+// Removes the entries in [begin, end) from the subtree rooted at n, which must be mutable at version at.  All keys in
+// the subtree are less than *upper, or upper is null.
+template <class K, class T, class X>
+void eraseRange(Node<K, T>* n, Version at, X const& begin, X const& end, K const* upper) {
+	if (n->isLeaf()) {
+		Leaf<K, T>* l = asLeaf(n);
+		int b = std::lower_bound(l->keys, l->keys + l->count, begin) - l->keys;
+		int e = std::lower_bound(l->keys + b, l->keys + l->count, end) - l->keys;
+		if (b == e)
+			return;
+		std::move(l->keys + e, l->keys + l->count, l->keys + b);
+		std::move(l->values + e, l->values + l->count, l->values + b);
+		std::move(l->insertVersions + e, l->insertVersions + l->count, l->insertVersions + b);
+		l->count -= e - b;
+		return;
+	}
+
+	Interior<K, T>* in = asInterior(n);
+	int first = childIndex(in, begin);
+	int last = int(std::lower_bound(in->keys, in->keys + in->count, end) - in->keys) - 1;
+	if (last < first)
+		return;
+
+	// Children entirely within [begin, end) are dropped without visiting them, and at most the first and last children
+	// are partially cleared.
+	int out = first;
+	for (int i = first; i <= last; i++) {
+		K const* childUpper = i + 1 < in->count ? &in->keys[i + 1] : upper;
+		bool covered = !(in->keys[i] < begin) && childUpper && !(end < *childUpper);
+		if (!covered) {
+			Node<K, T>* child = makeMutable(in->children[i], at);
+			eraseRange(child, at, begin, end, childUpper);
+			if (child->count) {
+				in->keys[i] = child->firstKey();
+				if (out != i) {
+					in->keys[out] = in->keys[i];
+					in->children[out] = std::move(in->children[i]);
+				}
+				++out;
+			}
+		}
+	}
+	removeChildren(in, out, last + 1);
+
+	// The partially cleared children are now adjacent at first and out-1
+	if (out - 1 > first)
+		mergeChild(in, out - 1, at);
+	mergeChild(in, first, at);
+}
+
+// Removes empty roots and roots with a single child
+template <class K, class T>
+void normalizeRoot(Reference<Node<K, T>>& root) {
+	while (root && !root->isLeaf() && root->count == 1) {
+		Reference<Node<K, T>> child = asInterior(root.getPtr())->children[0];
+		root = std::move(child);
+	}
+	if (root && root->count == 0)
+		root.clear();
+}
+
+template <class K, class T>
+int64_t validate(Node<K, T> const* n, K const* lower, K const* upper) {
+	ASSERT(n->count > 0);
+	int64_t count = 0;
+	if (n->isLeaf()) {
+		Leaf<K, T> const* l = asLeaf(n);
+		for (int i = 0; i < l->count; i++) {
+			ASSERT(i == 0 || l->keys[i - 1] < l->keys[i]);
+			ASSERT(!lower || !(l->keys[i] < *lower));
+			ASSERT(!upper || l->keys[i] < *upper);
+		}
+		return l->count;
+	}
+	Interior<K, T> const* in = asInterior(n);
+	for (int i = 0; i < in->count; i++) {
+		Node<K, T> const* child = in->children[i].getPtr();
+		ASSERT(child->height + 1 == in->height);
+		ASSERT(i == 0 || in->keys[i - 1] < in->keys[i]);
+		ASSERT(!(in->keys[i] < child->firstKey()) && !(child->firstKey() < in->keys[i]));
+		count += validate(child, &in->keys[i], i + 1 < in->count ? &in->keys[i + 1] : upper);
+	}
+	return count;
+}
+
+} // namespace BTreeVersionedMapImpl
+
+template <class K, class T>
+class BTreeVersionedMap : NonCopyable {
+public:
+	typedef BTreeVersionedMapImpl::Node<K, T> NodeT;
+	typedef BTreeVersionedMapImpl::Leaf<K, T> LeafT;
+	typedef BTreeVersionedMapImpl::Interior<K, T> InteriorT;
+	typedef Reference<NodeT> Tree;
+
+	Version oldestVersion, latestVersion;
+
+	// Roots of the tree at each version, in increasing version order (see VersionedMap::roots)
+	std::deque<std::pair<Version, Tree>> roots;
+
+	struct rootsComparator {
+		bool operator()(const std::pair<Version, Tree>& value, const Version& key) { return (value.first < key); }
+		bool operator()(const Version& key, const std::pair<Version, Tree>& value) { return (key < value.first); }
+	};
+
+	Tree const& getRoot(Version v) const {
+		auto r = upper_bound(roots.begin(), roots.end(), v, rootsComparator());
+		--r;
+		return r->second;
+	}
+
+	// A mutation may copy a full leaf, plus part of an interior node that the other mutations at its version share
+	static const int overheadPerItem =
+	    nextFastAllocatedSize(sizeof(LeafT)) + nextFastAllocatedSize(sizeof(InteriorT)) / 4;
+	struct iterator;
+
+	BTreeVersionedMap() : oldestVersion(0), latestVersion(0) { roots.emplace_back(0, Tree()); }
+	BTreeVersionedMap(BTreeVersionedMap&& v) noexcept
+	  : oldestVersion(v.oldestVersion), latestVersion(v.latestVersion), roots(std::move(v.roots)) {}
+	void operator=(BTreeVersionedMap&& v) noexcept {
+		oldestVersion = v.oldestVersion;
+		latestVersion = v.latestVersion;
+		roots = std::move(v.roots);
+	}
+
+	Version getLatestVersion() const { return latestVersion; }
+	Version getOldestVersion() const { return oldestVersion; }
+
+	void forgetVersionsBefore(Version newOldestVersion) {
+		ASSERT(newOldestVersion <= latestVersion);
+		auto r = upper_bound(roots.begin(), roots.end(), newOldestVersion, rootsComparator());
+		auto upper = r;
+		--r;
+		if (r->first != newOldestVersion) {
+			r = roots.emplace(upper, newOldestVersion, getRoot(newOldestVersion));
+		}
+
+		UNSTOPPABLE_ASSERT(r->first == newOldestVersion);
+		roots.erase(roots.begin(), r);
+		oldestVersion = newOldestVersion;
+	}
+
+	Future<Void> forgetVersionsBeforeAsync(Version newOldestVersion, TaskPriority taskID = TaskPriority::DefaultYield) {
+		ASSERT(newOldestVersion <= latestVersion);
+		auto r = upper_bound(roots.begin(), roots.end(), newOldestVersion, rootsComparator());
+		auto upper = r;
+		--r;
+		if (r->first != newOldestVersion) {
+			r = roots.emplace(upper, newOldestVersion, getRoot(newOldestVersion));
+		}
+
+		UNSTOPPABLE_ASSERT(r->first == newOldestVersion);
+
+		std::vector<Tree> toFree;
+		toFree.reserve(10000);
+		auto newBegin = r;
+		Tree* lastRoot = nullptr;
+		for (auto root = roots.begin(); root != newBegin; ++root) {
+			if (root->second) {
+				if (lastRoot != nullptr && root->second == *lastRoot) {
+					(*lastRoot).clear();
+				}
+				if (root->second->isSoleOwner()) {
+					toFree.push_back(root->second);
+				}
+				lastRoot = &root->second;
+			}
+		}
+
+		roots.erase(roots.begin(), newBegin);
+		oldestVersion = newOldestVersion;
+		return deferredCleanupActor(toFree, taskID);
+	}
+
+	// Following sets and erases are into the given version, which may now be passed to at().  Must be called in
+	// monotonically increasing order.
+	void createNewVersion(Version version) {
+		if (version > latestVersion) {
+			latestVersion = version;
+			Tree r = getRoot(version);
+			roots.emplace_back(version, r);
+		} else
+			ASSERT(version == latestVersion);
+	}
+
+	// insert() and erase() invalidate atLatest() and all iterators into it
+	void insert(const K& k, const T& t) { insert(k, t, latestVersion); }
+	void insert(const K& k, const T& t, Version insertAt) {
+		Tree& root = roots.back().second;
+		if (!root) {
+			root = Tree(new LeafT(latestVersion));
+		}
+		BTreeVersionedMapImpl::makeMutable(root, latestVersion);
+		Tree split = BTreeVersionedMapImpl::insert(root.getPtr(), latestVersion, k, t, insertAt);
+		if (split) {
+			InteriorT* newRoot = new InteriorT(root->height + 1, latestVersion);
+			BTreeVersionedMapImpl::interiorInsertAt(newRoot, 0, std::move(root));
+			BTreeVersionedMapImpl::interiorInsertAt(newRoot, 1, std::move(split));
+			root = Tree(newRoot);
+		}
+	}
+	void erase(const K& begin, const K& end) {
+		Tree& root = roots.back().second;
+		if (!root || !(begin < end))
+			return;
+		BTreeVersionedMapImpl::makeMutable(root, latestVersion);
+		BTreeVersionedMapImpl::eraseRange(root.getPtr(), latestVersion, begin, end, (K const*)nullptr);
+		BTreeVersionedMapImpl::normalizeRoot(root);
+	}
+	void erase(const K& key) { // key must be present
+		Tree& root = roots.back().second;
+		ASSERT(root);
+		BTreeVersionedMapImpl::makeMutable(root, latestVersion);
+		eraseKey(root.getPtr(), key);
+		BTreeVersionedMapImpl::normalizeRoot(root);
+	}
+	void erase(iterator const& item) { // iterator must be in latest version!
+		K key = item.key();
+		erase(key);
+	}
+
+	// for(auto i = vm.at(version).lower_bound(range.begin); i < range.end; ++i)
+	struct iterator {
+		explicit iterator(Tree const& root) : root(root), depth(0) {}
+
+		K const& key() const { return leaf()->keys[path[depth - 1].index]; }
+		Version insertVersion() const {
+			return leaf()->insertVersions[path[depth - 1].index];
+		} // Returns the version at which the current item was inserted
+		operator bool() const { return depth != 0; }
+		bool operator<(const K& key) const { return this->key() < key; }
+
+		T const& operator*() { return leaf()->values[path[depth - 1].index]; }
+		T const* operator->() { return &leaf()->values[path[depth - 1].index]; }
+		void operator++() {
+			if (!depth) {
+				descend<false>(root.getPtr());
+			} else if (++path[depth - 1].index == leaf()->count) {
+				nextLeaf();
+			}
+		}
+		void operator--() {
+			if (!depth) {
+				descend<true>(root.getPtr());
+			} else if (path[depth - 1].index-- == 0) {
+				previousLeaf();
+			}
+		}
+		bool operator==(const iterator& r) const {
+			if (depth && r.depth)
+				return path[depth - 1].node == r.path[r.depth - 1].node &&
+				       path[depth - 1].index == r.path[r.depth - 1].index;
+			else
+				return depth == r.depth;
+		}
+		bool operator!=(const iterator& r) const { return !(*this == r); }
+
+	private:
+		friend class BTreeVersionedMap<K, T>;
+
+		struct PathEntry {
+			NodeT const* node;
+			int index;
+		};
+
+		Tree root;
+		int depth;
+		PathEntry path[BTreeVersionedMapImpl::MAX_HEIGHT];
+
+		LeafT const* leaf() const { return BTreeVersionedMapImpl::asLeaf(path[depth - 1].node); }
+
+		void push(NodeT const* node, int index) {
+			ASSERT(depth < BTreeVersionedMapImpl::MAX_HEIGHT);
+			path[depth++] = PathEntry{ node, index };
+		}
+
+		// Extends the path through n to its first (or last) entry
+		template <bool last>
+		void descend(NodeT const* n) {
+			if (!n)
+				return;
+			while (!n->isLeaf()) {
+				int i = last ? n->count - 1 : 0;
+				push(n, i);
+				n = BTreeVersionedMapImpl::asInterior(n)->children[i].getPtr();
+			}
+			push(n, last ? n->count - 1 : 0);
+		}
+
+		// Moves from the end of the current leaf to the first entry of the next one, or to end()
+		void nextLeaf() {
+			--depth;
+			while (depth) {
+				PathEntry& p = path[depth - 1];
+				if (++p.index < p.node->count) {
+					descend<false>(BTreeVersionedMapImpl::asInterior(p.node)->children[p.index].getPtr());
+					return;
+				}
+				--depth;
+			}
+		}
+
+		// Moves from before the start of the current leaf to the last entry of the previous one, or to end()
+		void previousLeaf() {
+			--depth;
+			while (depth) {
+				PathEntry& p = path[depth - 1];
+				if (p.index-- > 0) {
+					descend<true>(BTreeVersionedMapImpl::asInterior(p.node)->children[p.index].getPtr());
+					return;
+				}
+				--depth;
+			}
+		}
+
+		// Positions the iterator on the first entry >= x (or > x if upper), or end()
+		template <bool upper, class X>
+		void seek(X const& x) {
+			depth = 0;
+			NodeT const* n = root.getPtr();
+			if (!n)
+				return;
+			while (!n->isLeaf()) {
+				auto in = BTreeVersionedMapImpl::asInterior(n);
+				int i = BTreeVersionedMapImpl::childIndex(in, x);
+				push(n, i);
+				n = in->children[i].getPtr();
+			}
+			auto l = BTreeVersionedMapImpl::asLeaf(n);
+			int i = (upper ? std::upper_bound(l->keys, l->keys + l->count, x)
+			               : std::lower_bound(l->keys, l->keys + l->count, x)) -
+			        l->keys;
+			push(n, i);
+			if (i == l->count)
+				nextLeaf();
+		}
+	};
+
+	class ViewAtVersion {
+	public:
+		ViewAtVersion(Tree const& root, Version at) : root(root), at(at) {}
+
+		iterator begin() const {
+			iterator i(root);
+			++i;
+			return i;
+		}
+		iterator end() const { return iterator(root); }
+
+		// Returns x such that key==*x, or end()
+		template <class X>
+		iterator find(const X& key) const {
+			iterator i = lower_bound(key);
+			if (i && i.key() == key)
+				return i;
+			else
+				return end();
+		}
+
+		// Returns the smallest x such that *x>=key, or end()
+		template <class X>
+		iterator lower_bound(const X& key) const {
+			iterator i(root);
+			i.template seek<false>(key);
+			return i;
+		}
+
+		// Returns the smallest x such that *x>key, or end()
+		template <class X>
+		iterator upper_bound(const X& key) const {
+			iterator i(root);
+			i.template seek<true>(key);
+			return i;
+		}
+
+		// Returns the largest x such that *x<=key, or end()
+		template <class X>
+		iterator lastLessOrEqual(const X& key) const {
+			iterator i = upper_bound(key);
+			--i;
+			return i;
+		}
+
+		// Returns the largest x such that *x<key, or end()
+		template <class X>
+		iterator lastLess(const X& key) const {
+			iterator i = lower_bound(key);
+			--i;
+			return i;
+		}
+
+		// Checks the structure of the tree and returns the number of entries
+		int64_t validate() const {
+			return root ? BTreeVersionedMapImpl::validate<K, T>(root.getPtr(), nullptr, nullptr) : 0;
+		}
+
+	private:
+		Tree root;
+		Version at;
+	};
+
+	ViewAtVersion at(Version v) const { return ViewAtVersion(getRoot(v), v); }
+	ViewAtVersion atLatest() const { return ViewAtVersion(roots.back().second, latestVersion); }
+
+	bool isClearContaining(ViewAtVersion const& view, KeyRef key) {
+		auto i = view.lastLessOrEqual(key);
+		return i && i->isClearTo() && i->getEndKey() > key;
+	}
+
+private:
+	// Removes key, which must be present, from the subtree rooted at n, which must be mutable at the latest version
+	void eraseKey(NodeT* n, const K& key) {
+		if (n->isLeaf()) {
+			LeafT* l = BTreeVersionedMapImpl::asLeaf(n);
+			int i = std::lower_bound(l->keys, l->keys + l->count, key) - l->keys;
+			ASSERT(i < l->count && !(key < l->keys[i])); // attempt to remove item not present in BTreeVersionedMap
+			std::move(l->keys + i + 1, l->keys + l->count, l->keys + i);
+			std::move(l->values + i + 1, l->values + l->count, l->values + i);
+			std::move(l->insertVersions + i + 1, l->insertVersions + l->count, l->insertVersions + i);
+			--l->count;
+			return;
+		}
+		InteriorT* in = BTreeVersionedMapImpl::asInterior(n);
+		int i = BTreeVersionedMapImpl::childIndex(in, key);
+		NodeT* child = BTreeVersionedMapImpl::makeMutable(in->children[i], latestVersion);
+		eraseKey(child, key);
+		if (child->count) {
+			in->keys[i] = child->firstKey();
+			BTreeVersionedMapImpl::mergeChild(in, i, latestVersion);
+		} else {
+			BTreeVersionedMapImpl::removeChildren(in, i, i + 1);
+		}
+	}
+};
+
+#endif
@@ -66,6 +66,9 @@ void ClientKnobs::initialize(Randomize randomize) {
 	init( BACKOFF_GROWTH_RATE,                     2.0 );
 	init( RESOURCE_CONSTRAINED_MAX_BACKOFF,       30.0 );
 	init( PROXY_COMMIT_OVERHEAD_BYTES,              23 ); //The size of serializing 7 tags (3 primary, 3 remote, 1 log router) + 2 for the tag length
+	init( COMMIT_COALESCING_WINDOW,              0.001 ); if( randomize && BUGGIFY ) COMMIT_COALESCING_WINDOW = deterministicRandom()->random01() * 0.01;
+	init( COMMIT_COALESCING_MAX_TRANSACTIONS,      100 ); if( randomize && BUGGIFY ) COMMIT_COALESCING_MAX_TRANSACTIONS = 2;
+	init( COMMIT_COALESCING_MAX_BYTES,             1e6 ); if( randomize && BUGGIFY ) COMMIT_COALESCING_MAX_BYTES = 1;
 	init( SHARD_STAT_SMOOTH_AMOUNT,                5.0 );
 	init( INIT_MID_SHARD_BYTES,                 200000 ); if( randomize && BUGGIFY ) INIT_MID_SHARD_BYTES = 40000; // The same value as SERVER_KNOBS->MIN_SHARD_BYTES
 
@@ -83,9 +86,11 @@ void ClientKnobs::initialize(Randomize randomize) {
 
 	init( LOCATION_CACHE_EVICTION_SIZE,         600000 );
 	init( LOCATION_CACHE_EVICTION_SIZE_SIM,         10 ); if( randomize && BUGGIFY ) LOCATION_CACHE_EVICTION_SIZE_SIM = 3;
+	init( KEY_SERVERS_CHANGES_RETRY_DELAY,         1.0 );
 
 	init( GET_RANGE_SHARD_LIMIT,                     2 );
 	init( WARM_RANGE_SHARD_LIMIT,                  100 );
+	init( RANGE_AGGREGATE_SHARD_LIMIT,             100 ); if( randomize && BUGGIFY ) RANGE_AGGREGATE_SHARD_LIMIT = 1;
 	init( STORAGE_METRICS_SHARD_LIMIT,             100 ); if( randomize && BUGGIFY ) STORAGE_METRICS_SHARD_LIMIT = 3;
 	init( SHARD_COUNT_LIMIT,                        80 ); if( randomize && BUGGIFY ) SHARD_COUNT_LIMIT = 3;
 	init( STORAGE_METRICS_UNFAIR_SPLIT_LIMIT,  2.0/3.0 );
@@ -96,6 +101,7 @@ void ClientKnobs::initialize(Randomize randomize) {
 	init( TAG_ENCODE_KEY_SERVERS,                false ); if( randomize && BUGGIFY ) TAG_ENCODE_KEY_SERVERS = true;
 	init( RANGESTREAM_FRAGMENT_SIZE,               1e6 );
 	init( RANGESTREAM_BUFFERED_FRAGMENTS_LIMIT,     20 );
+	init( RETAINED_SNAPSHOT_INTERVAL_VERSIONS,     1e6 ); // Shared by storage servers, which only retain snapshots at multiples of it
 	init( QUARANTINE_TSS_ON_MISMATCH,             true ); if( randomize && BUGGIFY ) QUARANTINE_TSS_ON_MISMATCH = false; // if true, a tss mismatch will put the offending tss in quarantine. If false, it will just be killed
 
 	//KeyRangeMap
@@ -65,6 +65,9 @@ public:
 	double BACKOFF_GROWTH_RATE;
 	double RESOURCE_CONSTRAINED_MAX_BACKOFF;
 	int PROXY_COMMIT_OVERHEAD_BYTES;
+	double COMMIT_COALESCING_WINDOW; // How long a coalesced commit waits for other transactions to be sent with it
+	int COMMIT_COALESCING_MAX_TRANSACTIONS;
+	int COMMIT_COALESCING_MAX_BYTES;
 	double SHARD_STAT_SMOOTH_AMOUNT;
 	int INIT_MID_SHARD_BYTES;
 
@@ -83,9 +86,11 @@ public:
 	// When locationCache in DatabaseContext gets to be this size, items will be evicted
 	int LOCATION_CACHE_EVICTION_SIZE;
 	int LOCATION_CACHE_EVICTION_SIZE_SIM;
+	double KEY_SERVERS_CHANGES_RETRY_DELAY; // Delay before resubscribing to shard location changes after an error
 
 	int GET_RANGE_SHARD_LIMIT;
 	int WARM_RANGE_SHARD_LIMIT;
+	int RANGE_AGGREGATE_SHARD_LIMIT; // Shards a range aggregate reads from in parallel
 	int STORAGE_METRICS_SHARD_LIMIT;
 	int SHARD_COUNT_LIMIT;
 	double STORAGE_METRICS_UNFAIR_SPLIT_LIMIT;
@@ -96,6 +101,7 @@ public:
 	bool TAG_ENCODE_KEY_SERVERS;
 	int64_t RANGESTREAM_FRAGMENT_SIZE;
 	int RANGESTREAM_BUFFERED_FRAGMENTS_LIMIT;
+	int64_t RETAINED_SNAPSHOT_INTERVAL_VERSIONS;
 	bool QUARANTINE_TSS_ON_MISMATCH;
 
 	// KeyRangeMap
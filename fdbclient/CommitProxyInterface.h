@@ -58,6 +58,8 @@ struct CommitProxyInterface {
 	RequestStream<struct ProxySnapRequest> proxySnapReq;
 	RequestStream<struct ExclusionSafetyCheckRequest> exclusionSafetyCheckReq;
 	RequestStream<struct GetDDMetricsRequest> getDDMetrics;
+	RequestStream<struct KeyServersChangesRequest> getKeyServersChanges;
+	RequestStream<struct CommitTransactionBatchRequest> commitBatch;
 
 	UID id() const { return commit.getEndpoint().token; }
 	std::string toString() const { return id().shortString(); }
@@ -84,6 +86,10 @@ struct CommitProxyInterface {
 			exclusionSafetyCheckReq =
 			    RequestStream<struct ExclusionSafetyCheckRequest>(commit.getEndpoint().getAdjustedEndpoint(8));
 			getDDMetrics = RequestStream<struct GetDDMetricsRequest>(commit.getEndpoint().getAdjustedEndpoint(9));
+			getKeyServersChanges =
+			    RequestStream<struct KeyServersChangesRequest>(commit.getEndpoint().getAdjustedEndpoint(10));
+			commitBatch =
+			    RequestStream<struct CommitTransactionBatchRequest>(commit.getEndpoint().getAdjustedEndpoint(11));
 		}
 	}
 
@@ -100,6 +106,8 @@ struct CommitProxyInterface {
 		streams.push_back(proxySnapReq.getReceiver());
 		streams.push_back(exclusionSafetyCheckReq.getReceiver());
 		streams.push_back(getDDMetrics.getReceiver());
+		streams.push_back(getKeyServersChanges.getReceiver());
+		streams.push_back(commitBatch.getReceiver(TaskPriority::ReadSocket));
 		FlowTransport::transport().addEndpoints(streams);
 	}
 };
@@ -176,6 +184,18 @@ struct CommitTransactionRequest : TimedRequest {
 	}
 };
 
+// Several independent transactions sent to a commit proxy in one message by a client that coalesces commits. Each is
+// committed exactly as if it had been sent on its own, and is replied to through its own reply promise.
+struct CommitTransactionBatchRequest {
+	constexpr static FileIdentifier file_identifier = 5117323;
+	std::vector<CommitTransactionRequest> transactions;
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, transactions);
+	}
+};
+
 static inline int getBytes(CommitTransactionRequest const& r) {
 	// SOMEDAY: Optimize
 	// return r.arena.getSize(); // NOT correct because arena can be shared!
@@ -321,6 +341,39 @@ struct GetKeyServerLocationsRequest {
 	}
 };
 
+struct KeyServersChangesReply {
+	constexpr static FileIdentifier file_identifier = 4281763;
+	UID changeLogId;
+	int64_t position; // Position in the proxy's change log after the changes in this reply
+	bool reset; // The requested position is no longer (or was never) in the change log; nothing was returned
+	GetKeyServerLocationsReply locations; // Current locations of the key ranges that changed
+
+	KeyServersChangesReply() : position(0), reset(false) {}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, changeLogId, position, reset, locations);
+	}
+};
+
+// Waits until the keyServers mappings known to a commit proxy change after the given position of its change log, and
+// returns the new locations of the changed ranges. A client that starts with an empty changeLogId gets a reset reply
+// carrying the proxy's current position.
+struct KeyServersChangesRequest {
+	constexpr static FileIdentifier file_identifier = 7915412;
+	UID changeLogId;
+	int64_t position;
+	ReplyPromise<KeyServersChangesReply> reply;
+
+	KeyServersChangesRequest() : position(0) {}
+	KeyServersChangesRequest(UID changeLogId, int64_t position) : changeLogId(changeLogId), position(position) {}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, changeLogId, position, reply);
+	}
+};
+
 struct GetRawCommittedVersionReply {
 	constexpr static FileIdentifier file_identifier = 1314732;
 	Optional<UID> debugID;
@@ -191,6 +191,7 @@ bool DatabaseConfiguration::isValid() const {
 	      tLogVersion <= TLogVersion::MAX_SUPPORTED && tLogDataStoreType != KeyValueStoreType::END &&
 	      tLogSpillType != TLogSpillType::UNSET &&
 	      !(tLogSpillType == TLogSpillType::REFERENCE && tLogVersion < TLogVersion::V3) &&
+	      !(tLogSpillType == TLogSpillType::SEGMENT && tLogVersion < TLogVersion::V7) &&
 	      storageServerStoreType != KeyValueStoreType::END && autoCommitProxyCount >= 1 && autoGrvProxyCount >= 1 &&
 	      autoResolverCount >= 1 && autoDesiredTLogCount >= 1 && storagePolicy && tLogPolicy &&
 	      getDesiredRemoteLogs() >= 1 && remoteTLogReplicationFactor >= 0 && repopulateRegionAntiQuorum >= 0 &&
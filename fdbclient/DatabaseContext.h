@@ -301,6 +301,14 @@ public:
 	};
 	std::map<uint32_t, VersionBatcher> versionBatcher;
 
+	// Commits of transactions without reads, sent to a commit proxy together when commit coalescing is enabled
+	struct CoalescedCommit {
+		CommitTransactionRequest req;
+		Promise<CommitProxyInterface> sentTo;
+	};
+	PromiseStream<CoalescedCommit> coalescedCommits;
+	Future<Void> commitCoalescer; // Set once commit coalescing is enabled
+
 	AsyncTrigger connectionFileChangedTrigger;
 
 	// Disallow any reads at a read version lower than minAcceptableReadVersion.  This way the client does not have to
@@ -320,6 +328,8 @@ public:
 	// Cache of location information
 	int locationCacheSize;
 	CoalescedKeyRangeMap<Reference<LocationInfo>> locationCache;
+	Future<Void> locationCachePrefetch;
+	Future<Void> keyServersChangesMonitor; // Set once the location cache subscribes to shard location changes
 
 	std::map<UID, StorageServerInfo*> server_interf;
 
@@ -364,8 +374,10 @@ public:
 	Counter transactionAtomicMutations;
 	Counter transactionsCommitStarted;
 	Counter transactionsCommitCompleted;
+	Counter transactionsCommitCoalesced;
 	Counter transactionKeyServerLocationRequests;
 	Counter transactionKeyServerLocationRequestsCompleted;
+	Counter locationCacheUpdatesPushed;
 	Counter transactionStatusRequests;
 	Counter transactionsTooOld;
 	Counter transactionsFutureVersions;
@@ -740,14 +740,16 @@ struct TLogVersion {
 		// V4 changed how data gets written to satellite TLogs so that we can peek from them;
 		// V5 merged reference and value spilling
 		// V6 added span context to list of serialized mutations sent from proxy to tlogs
+		// V7 added spilling to segments
 		// V1 = 1,  // 4.6 is dispatched to via 6.0
 		V2 = 2, // 6.0
 		V3 = 3, // 6.1
 		V4 = 4, // 6.2
 		V5 = 5, // 6.3
 		V6 = 6, // 7.0
+		V7 = 7, // 7.1
 		MIN_SUPPORTED = V2,
-		MAX_SUPPORTED = V6,
+		MAX_SUPPORTED = V7,
 		MIN_RECRUITABLE = V5,
 		DEFAULT = V5,
 	} version;
@@ -775,6 +777,8 @@ struct TLogVersion {
 			return V5;
 		if (s == LiteralStringRef("6"))
 			return V6;
+		if (s == LiteralStringRef("7"))
+			return V7;
 		return default_error_or();
 	}
 };
@@ -792,7 +796,8 @@ struct TLogSpillType {
 		DEFAULT = 2,
 		VALUE = 1,
 		REFERENCE = 2,
-		END = 3,
+		SEGMENT = 3, // Spilled messages are copied into per-tag segments, requires TLogVersion::V7
+		END = 4,
 	};
 
 	TLogSpillType() : type(DEFAULT) {}
@@ -814,6 +819,8 @@ struct TLogSpillType {
 			return "value";
 		case REFERENCE:
 			return "reference";
+		case SEGMENT:
+			return "segment";
 		case UNSET:
 			return "unset";
 		default:
@@ -827,6 +834,8 @@ struct TLogSpillType {
 			return VALUE;
 		if (s == LiteralStringRef("2"))
 			return REFERENCE;
+		if (s == LiteralStringRef("3"))
+			return SEGMENT;
 		return default_error_or();
 	}
 
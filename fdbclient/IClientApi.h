@@ -27,6 +27,19 @@
 
 #include "flow/ThreadHelper.actor.h"
 
+// An interface that represents a range being streamed by a transaction created by a client. Batches of the range are
+// returned in key order by successive calls to next(), and the end of the range is reported as an empty batch whose
+// more flag is false. Only one batch may be outstanding at a time.
+class IRangeStream {
+public:
+	virtual ~IRangeStream() {}
+
+	virtual ThreadFuture<RangeResult> next() = 0;
+
+	virtual void addref() = 0;
+	virtual void delref() = 0;
+};
+
 // An interface that represents a transaction created by a client
 class ITransaction {
 public:
@@ -59,6 +72,12 @@ public:
 	                                           GetRangeLimits limits,
 	                                           bool snapshot = false,
 	                                           bool reverse = false) = 0;
+	// Streams the range from the storage servers in parallel, without seeing the transaction's own writes. A positive
+	// bufferBytes bounds how much data is read ahead of the caller.
+	virtual Reference<IRangeStream> getRangeStream(const KeySelectorRef& begin,
+	                                               const KeySelectorRef& end,
+	                                               bool snapshot,
+	                                               int64_t bufferBytes) = 0;
 	virtual ThreadFuture<Standalone<VectorRef<const char*>>> getAddressesForKey(const KeyRef& key) = 0;
 	virtual ThreadFuture<Standalone<StringRef>> getVersionstamp() = 0;
 
@@ -46,6 +46,13 @@ public:
 	Future<Key> getKey(KeySelector const& key, Snapshot snapshot = Snapshot::False) override {
 		throw client_invalid_operation();
 	}
+	Future<Void> getRangeStream(const PromiseStream<Standalone<RangeResultRef>>& results,
+	                            KeySelector begin,
+	                            KeySelector end,
+	                            Snapshot snapshot,
+	                            int64_t bufferBytes) override {
+		throw client_invalid_operation();
+	}
 	Future<Standalone<VectorRef<const char*>>> getAddressesForKey(Key const& key) override {
 		throw client_invalid_operation();
 	}
@@ -62,6 +62,12 @@ public:
 	                                                    GetRangeLimits limits,
 	                                                    Snapshot = Snapshot::False,
 	                                                    Reverse = Reverse::False) = 0;
+	// Streams the range into results in key order, without seeing the transaction's own writes
+	virtual Future<Void> getRangeStream(const PromiseStream<Standalone<RangeResultRef>>& results,
+	                                    KeySelector begin,
+	                                    KeySelector end,
+	                                    Snapshot snapshot,
+	                                    int64_t bufferBytes) = 0;
 	virtual Future<Standalone<VectorRef<const char*>>> getAddressesForKey(Key const& key) = 0;
 	virtual Future<Standalone<VectorRef<KeyRef>>> getRangeSplitPoints(KeyRange const& range, int64_t chunkSize) = 0;
 	virtual Future<int64_t> getEstimatedRangeSizeBytes(KeyRange const& keys) = 0;
@@ -78,6 +78,30 @@ public:
 	void rawInsert(const std::vector<std::pair<MapPair<Key, Val>, Metric>>& pairs) {
 		RangeMap<Key, Val, KeyRangeRef, Metric, MetricFunc>::map.insert(pairs);
 	}
+
+	// Sets values[i] to the value of the range containing keys[i] for each index i in order, which must list the
+	// indices of keys in increasing key order.  The map is swept forward from one key's range to the next, so a sorted
+	// batch of keys costs about one step per range instead of one search per key.  The pointers are valid until the map
+	// is next modified.
+	void lookupSorted(std::vector<KeyRef> const& keys, std::vector<int> const& order, std::vector<Val*>& values) {
+		values.resize(keys.size());
+		if (order.empty())
+			return;
+		auto r = RangeMap<Key, Val, KeyRangeRef, Metric, MetricFunc>::rangeContaining(keys[order[0]]);
+		for (int i : order) {
+			if (keys[i] >= mapEnd) {
+				values[i] = &RangeMap<Key, Val, KeyRangeRef, Metric, MetricFunc>::rangeContaining(keys[i]).value();
+				continue;
+			}
+			if (keys[i] >= r.end()) {
+				++r;
+				if (keys[i] >= r.end())
+					r = RangeMap<Key, Val, KeyRangeRef, Metric, MetricFunc>::rangeContaining(keys[i]);
+			}
+			values[i] = &r.value();
+		}
+	}
+
 	Key mapEnd;
 };
 
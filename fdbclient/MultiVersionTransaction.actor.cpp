@@ -36,6 +36,25 @@ void throwIfError(FdbCApi::fdb_error_t e) {
 	}
 }
 
+// DLRangeStream
+ThreadFuture<RangeResult> DLRangeStream::next() {
+	if (!stream) {
+		return error;
+	}
+
+	FdbCApi::FDBFuture* f = api->rangeStreamNext(stream);
+	return toThreadFuture<RangeResult>(api, f, [](FdbCApi::FDBFuture* f, FdbCApi* api) {
+		const FdbCApi::FDBKeyValue* kvs;
+		int count;
+		FdbCApi::fdb_bool_t more;
+		FdbCApi::fdb_error_t error = api->futureGetKeyValueArray(f, &kvs, &count, &more);
+		ASSERT(!error);
+
+		// The memory for this is stored in the FDBFuture and is released when the future gets destroyed
+		return RangeResult(RangeResultRef(VectorRef<KeyValueRef>((KeyValueRef*)kvs, count), more), Arena());
+	});
+}
+
 // DLTransaction
 void DLTransaction::cancel() {
 	api->transactionCancel(tr);
@@ -141,6 +160,33 @@ ThreadFuture<RangeResult> DLTransaction::getRange(const KeyRangeRef& keys,
 	return getRange(firstGreaterOrEqual(keys.begin), firstGreaterOrEqual(keys.end), limits, snapshot, reverse);
 }
 
+Reference<IRangeStream> DLTransaction::getRangeStream(const KeySelectorRef& begin,
+                                                      const KeySelectorRef& end,
+                                                      bool snapshot,
+                                                      int64_t bufferBytes) {
+	if (!api->transactionGetRangeStream) {
+		return makeReference<DLRangeStream>(api, unsupported_operation());
+	}
+
+	FdbCApi::FDBRangeStream* stream;
+	FdbCApi::fdb_error_t error = api->transactionGetRangeStream(tr,
+	                                                            begin.getKey().begin(),
+	                                                            begin.getKey().size(),
+	                                                            begin.orEqual,
+	                                                            begin.offset,
+	                                                            end.getKey().begin(),
+	                                                            end.getKey().size(),
+	                                                            end.orEqual,
+	                                                            end.offset,
+	                                                            snapshot,
+	                                                            bufferBytes,
+	                                                            &stream);
+	if (error) {
+		return makeReference<DLRangeStream>(api, Error(error));
+	}
+	return makeReference<DLRangeStream>(api, stream);
+}
+
 ThreadFuture<Standalone<VectorRef<const char*>>> DLTransaction::getAddressesForKey(const KeyRef& key) {
 	FdbCApi::FDBFuture* f = api->transactionGetAddressesForKey(tr, key.begin(), key.size());
 
@@ -480,6 +526,13 @@ void DLApi::init() {
 	                   fdbCPath,
 	                   "fdb_transaction_get_range_split_points",
 	                   headerVersion >= 700);
+	loadClientFunction(&api->transactionGetRangeStream,
+	                   lib,
+	                   fdbCPath,
+	                   "fdb_transaction_get_range_stream",
+	                   headerVersion >= 710);
+	loadClientFunction(&api->rangeStreamNext, lib, fdbCPath, "fdb_range_stream_next", headerVersion >= 710);
+	loadClientFunction(&api->rangeStreamDestroy, lib, fdbCPath, "fdb_range_stream_destroy", headerVersion >= 710);
 
 	loadClientFunction(
 	    &api->futureGetInt64, lib, fdbCPath, headerVersion >= 620 ? "fdb_future_get_int64" : "fdb_future_get_version");
@@ -603,6 +656,12 @@ void DLApi::addNetworkThreadCompletionHook(void (*hook)(void*), void* hookParame
 	threadCompletionHooks.emplace_back(hook, hookParameter);
 }
 
+// MultiVersionRangeStream
+ThreadFuture<RangeResult> MultiVersionRangeStream::next() {
+	auto f = stream ? stream->next() : ThreadFuture<RangeResult>(Never());
+	return abortableFuture(f, onChange);
+}
+
 // MultiVersionTransaction
 MultiVersionTransaction::MultiVersionTransaction(Reference<MultiVersionDatabase> db,
                                                  UniqueOrderedOptionList<FDBTransactionOptions> defaultOptions)
@@ -734,6 +793,16 @@ ThreadFuture<Standalone<StringRef>> MultiVersionTransaction::getVersionstamp() {
 	return abortableFuture(f, tr.onChange);
 }
 
+Reference<IRangeStream> MultiVersionTransaction::getRangeStream(const KeySelectorRef& begin,
+                                                                const KeySelectorRef& end,
+                                                                bool snapshot,
+                                                                int64_t bufferBytes) {
+	auto tr = getTransaction();
+	auto stream = tr.transaction ? tr.transaction->getRangeStream(begin, end, snapshot, bufferBytes)
+	                             : Reference<IRangeStream>();
+	return makeReference<MultiVersionRangeStream>(stream, tr.onChange);
+}
+
 ThreadFuture<Standalone<VectorRef<const char*>>> MultiVersionTransaction::getAddressesForKey(const KeyRef& key) {
 	auto tr = getTransaction();
 	auto f = tr.transaction ? tr.transaction->getAddressesForKey(key)
@@ -36,6 +36,7 @@ struct FdbCApi : public ThreadSafeReferenceCounted<FdbCApi> {
 	typedef struct FDB_cluster FDBCluster;
 	typedef struct FDB_database FDBDatabase;
 	typedef struct FDB_transaction FDBTransaction;
+	typedef struct FDB_range_stream FDBRangeStream;
 
 #pragma pack(push, 4)
 	typedef struct key {
@@ -151,6 +152,19 @@ struct FdbCApi : public ThreadSafeReferenceCounted<FdbCApi> {
 	                                             int end_key_name_length,
 	                                             int64_t chunkSize);
 
+	fdb_error_t (*transactionGetRangeStream)(FDBTransaction* tr,
+	                                         uint8_t const* beginKeyName,
+	                                         int beginKeyNameLength,
+	                                         fdb_bool_t beginOrEqual,
+	                                         int beginOffset,
+	                                         uint8_t const* endKeyName,
+	                                         int endKeyNameLength,
+	                                         fdb_bool_t endOrEqual,
+	                                         int endOffset,
+	                                         fdb_bool_t snapshot,
+	                                         int64_t maxBufferedBytes,
+	                                         FDBRangeStream** outStream);
+
 	FDBFuture* (*transactionCommit)(FDBTransaction* tr);
 	fdb_error_t (*transactionGetCommittedVersion)(FDBTransaction* tr, int64_t* outVersion);
 	FDBFuture* (*transactionGetApproximateSize)(FDBTransaction* tr);
@@ -181,6 +195,10 @@ struct FdbCApi : public ThreadSafeReferenceCounted<FdbCApi> {
 	void (*futureCancel)(FDBFuture* f);
 	void (*futureDestroy)(FDBFuture* f);
 
+	// Range stream
+	FDBFuture* (*rangeStreamNext)(FDBRangeStream* stream);
+	void (*rangeStreamDestroy)(FDBRangeStream* stream);
+
 	// Legacy Support
 	FDBFuture* (*createCluster)(const char* clusterFilePath);
 	FDBFuture* (*clusterCreateDatabase)(FDBCluster* cluster, uint8_t* dbName, int dbNameLength);
@@ -188,6 +206,29 @@ struct FdbCApi : public ThreadSafeReferenceCounted<FdbCApi> {
 	fdb_error_t (*futureGetCluster)(FDBFuture* f, FDBCluster** outCluster);
 };
 
+// An implementation of IRangeStream that wraps a range stream created on an externally loaded client library.
+class DLRangeStream : public IRangeStream, ThreadSafeReferenceCounted<DLRangeStream> {
+public:
+	DLRangeStream(Reference<FdbCApi> api, FdbCApi::FDBRangeStream* stream) : api(api), stream(stream) {}
+	// A stream that could not be created, whose batches all fail with the given error
+	DLRangeStream(Reference<FdbCApi> api, Error error) : api(api), stream(nullptr), error(error) {}
+	~DLRangeStream() override {
+		if (stream) {
+			api->rangeStreamDestroy(stream);
+		}
+	}
+
+	ThreadFuture<RangeResult> next() override;
+
+	void addref() override { ThreadSafeReferenceCounted<DLRangeStream>::addref(); }
+	void delref() override { ThreadSafeReferenceCounted<DLRangeStream>::delref(); }
+
+private:
+	const Reference<FdbCApi> api;
+	FdbCApi::FDBRangeStream* const stream;
+	Error error;
+};
+
 // An implementation of ITransaction that wraps a transaction object created on an externally loaded client library.
 // All API calls to that transaction are routed through the external library.
 class DLTransaction : public ITransaction, ThreadSafeReferenceCounted<DLTransaction> {
@@ -219,6 +260,10 @@ public:
 	                                   GetRangeLimits limits,
 	                                   bool snapshot = false,
 	                                   bool reverse = false) override;
+	Reference<IRangeStream> getRangeStream(const KeySelectorRef& begin,
+	                                       const KeySelectorRef& end,
+	                                       bool snapshot,
+	                                       int64_t bufferBytes) override;
 	ThreadFuture<Standalone<VectorRef<const char*>>> getAddressesForKey(const KeyRef& key) override;
 	ThreadFuture<Standalone<StringRef>> getVersionstamp() override;
 	ThreadFuture<int64_t> getEstimatedRangeSizeBytes(const KeyRangeRef& keys) override;
@@ -326,6 +371,23 @@ private:
 
 class MultiVersionDatabase;
 
+// An implementation of IRangeStream that wraps the range stream of a MultiVersionTransaction's current transaction.
+// Its batches fail with cluster_version_changed once that transaction is replaced.
+class MultiVersionRangeStream : public IRangeStream, ThreadSafeReferenceCounted<MultiVersionRangeStream> {
+public:
+	MultiVersionRangeStream(Reference<IRangeStream> stream, ThreadFuture<Void> onChange)
+	  : stream(stream), onChange(onChange) {}
+
+	ThreadFuture<RangeResult> next() override;
+
+	void addref() override { ThreadSafeReferenceCounted<MultiVersionRangeStream>::addref(); }
+	void delref() override { ThreadSafeReferenceCounted<MultiVersionRangeStream>::delref(); }
+
+private:
+	const Reference<IRangeStream> stream;
+	const ThreadFuture<Void> onChange;
+};
+
 // An implementation of ITransaction that wraps a transaction created either locally or through a dynamically loaded
 // external client. When needed (e.g on cluster version change), the MultiVersionTransaction can automatically replace
 // its wrapped transaction with one from another client.
@@ -358,6 +420,10 @@ public:
 	                                   GetRangeLimits limits,
 	                                   bool snapshot = false,
 	                                   bool reverse = false) override;
+	Reference<IRangeStream> getRangeStream(const KeySelectorRef& begin,
+	                                       const KeySelectorRef& end,
+	                                       bool snapshot,
+	                                       int64_t bufferBytes) override;
 	ThreadFuture<Standalone<VectorRef<const char*>>> getAddressesForKey(const KeyRef& key) override;
 	ThreadFuture<Standalone<StringRef>> getVersionstamp() override;
 
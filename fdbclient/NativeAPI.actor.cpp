@@ -157,6 +157,8 @@ void DatabaseContext::addTssMapping(StorageServerInterface const& ssi, StorageSe
 		                             TSSEndpointData(tssi.id(), tssi.watchValue.getEndpoint(), metrics));
 		queueModel.updateTssEndpoint(ssi.getKeyValuesStream.getEndpoint().token.first(),
 		                             TSSEndpointData(tssi.id(), tssi.getKeyValuesStream.getEndpoint(), metrics));
+		queueModel.updateTssEndpoint(ssi.getRangeAggregate.getEndpoint().token.first(),
+		                             TSSEndpointData(tssi.id(), tssi.getRangeAggregate.getEndpoint(), metrics));
 	}
 }
 
@@ -170,6 +172,7 @@ void DatabaseContext::removeTssMapping(StorageServerInterface const& ssi) {
 		queueModel.removeTssEndpoint(ssi.getKeyValues.getEndpoint().token.first());
 		queueModel.removeTssEndpoint(ssi.watchValue.getEndpoint().token.first());
 		queueModel.removeTssEndpoint(ssi.getKeyValuesStream.getEndpoint().token.first());
+		queueModel.removeTssEndpoint(ssi.getRangeAggregate.getEndpoint().token.first());
 	}
 }
 
@@ -1118,8 +1121,10 @@ DatabaseContext::DatabaseContext(Reference<AsyncVar<Reference<ClusterConnectionF
     transactionCommittedMutationBytes("CommittedMutationBytes", cc), transactionSetMutations("SetMutations", cc),
     transactionClearMutations("ClearMutations", cc), transactionAtomicMutations("AtomicMutations", cc),
     transactionsCommitStarted("CommitStarted", cc), transactionsCommitCompleted("CommitCompleted", cc),
+    transactionsCommitCoalesced("CommitCoalesced", cc),
     transactionKeyServerLocationRequests("KeyServerLocationRequests", cc),
     transactionKeyServerLocationRequestsCompleted("KeyServerLocationRequestsCompleted", cc),
+    locationCacheUpdatesPushed("LocationCacheUpdatesPushed", cc),
     transactionStatusRequests("StatusRequests", cc), transactionsTooOld("TooOld", cc),
     transactionsFutureVersions("FutureVersions", cc), transactionsNotCommitted("NotCommitted", cc),
     transactionsMaybeCommitted("MaybeCommitted", cc), transactionsResourceConstrained("ResourceConstrained", cc),
@@ -1361,8 +1366,10 @@ DatabaseContext::DatabaseContext(const Error& err)
     transactionCommittedMutationBytes("CommittedMutationBytes", cc), transactionSetMutations("SetMutations", cc),
     transactionClearMutations("ClearMutations", cc), transactionAtomicMutations("AtomicMutations", cc),
     transactionsCommitStarted("CommitStarted", cc), transactionsCommitCompleted("CommitCompleted", cc),
+    transactionsCommitCoalesced("CommitCoalesced", cc),
     transactionKeyServerLocationRequests("KeyServerLocationRequests", cc),
     transactionKeyServerLocationRequestsCompleted("KeyServerLocationRequestsCompleted", cc),
+    locationCacheUpdatesPushed("LocationCacheUpdatesPushed", cc),
     transactionStatusRequests("StatusRequests", cc), transactionsTooOld("TooOld", cc),
     transactionsFutureVersions("FutureVersions", cc), transactionsNotCommitted("NotCommitted", cc),
     transactionsMaybeCommitted("MaybeCommitted", cc), transactionsResourceConstrained("ResourceConstrained", cc),
@@ -1521,6 +1528,10 @@ uint64_t extractHexOption(StringRef value) {
 	return id;
 }
 
+ACTOR Future<Void> prefetchLocations(DatabaseContext* self, KeyRange keys);
+ACTOR Future<Void> monitorKeyServersChanges(DatabaseContext* self);
+ACTOR Future<Void> commitCoalescer(DatabaseContext* self);
+
 void DatabaseContext::setOption(FDBDatabaseOptions::Option option, Optional<StringRef> value) {
 	int defaultFor = FDBDatabaseOptions::optionInfo.getMustExist(option).defaultFor;
 	if (defaultFor >= 0) {
@@ -1532,6 +1543,17 @@ void DatabaseContext::setOption(FDBDatabaseOptions::Option option, Optional<Stri
 		case FDBDatabaseOptions::LOCATION_CACHE_SIZE:
 			locationCacheSize = (int)extractIntOption(value, 0, std::numeric_limits<int>::max());
 			break;
+		case FDBDatabaseOptions::LOCATION_CACHE_SUBSCRIBE:
+			validateOptionValueNotPresent(value);
+			if (!keyServersChangesMonitor.isValid()) {
+				keyServersChangesMonitor = monitorKeyServersChanges(this);
+			}
+			break;
+		case FDBDatabaseOptions::LOCATION_CACHE_PREFETCH:
+			validateOptionValuePresent(value);
+			locationCachePrefetch =
+			    prefetchLocations(this, value.get().size() ? prefixRange(value.get()) : KeyRange(normalKeys));
+			break;
 		case FDBDatabaseOptions::MACHINE_ID:
 			clientLocality =
 			    LocalityData(clientLocality.processId(),
@@ -1569,6 +1591,12 @@ void DatabaseContext::setOption(FDBDatabaseOptions::Option option, Optional<Stri
 			validateOptionValueNotPresent(value);
 			snapshotRywEnabled--;
 			break;
+		case FDBDatabaseOptions::COMMIT_COALESCING_ENABLE:
+			validateOptionValueNotPresent(value);
+			if (!commitCoalescer.isValid()) {
+				commitCoalescer = ::commitCoalescer(this);
+			}
+			break;
 		case FDBDatabaseOptions::DISTRIBUTED_TRANSACTION_TRACE_ENABLE:
 			validateOptionValueNotPresent(value);
 			transactionTracingEnabled++;
@@ -2391,12 +2419,12 @@ Future<vector<pair<KeyRange, Reference<LocationInfo>>>> getKeyRangeLocations(Dat
 	return locations;
 }
 
-ACTOR Future<Void> warmRange_impl(Transaction* self, Database cx, KeyRange keys) {
+ACTOR Future<Void> warmRange_impl(Database cx, KeyRange keys, TransactionInfo info) {
 	state int totalRanges = 0;
 	state int totalRequests = 0;
 	loop {
 		vector<pair<KeyRange, Reference<LocationInfo>>> locations = wait(
-		    getKeyRangeLocations_internal(cx, keys, CLIENT_KNOBS->WARM_RANGE_SHARD_LIMIT, Reverse::False, self->info));
+		    getKeyRangeLocations_internal(cx, keys, CLIENT_KNOBS->WARM_RANGE_SHARD_LIMIT, Reverse::False, info));
 		totalRanges += CLIENT_KNOBS->WARM_RANGE_SHARD_LIMIT;
 		totalRequests++;
 		if (locations.size() == 0 || totalRanges >= cx->locationCacheSize ||
@@ -2425,7 +2453,81 @@ ACTOR Future<Void> warmRange_impl(Transaction* self, Database cx, KeyRange keys)
 }
 
 Future<Void> Transaction::warmRange(Database cx, KeyRange keys) {
-	return warmRange_impl(this, cx, keys);
+	return warmRange_impl(cx, keys, info);
+}
+
+// Holds a reference to the database only while prefetching, which is bounded by the size of the location cache
+ACTOR Future<Void> prefetchLocations(DatabaseContext* self, KeyRange keys) {
+	state Span span("NAPI:prefetchLocations"_loc);
+	try {
+		wait(warmRange_impl(Database(Reference<DatabaseContext>::addRef(self)),
+		                    keys,
+		                    TransactionInfo(TaskPriority::DefaultEndpoint, span.context)));
+		TraceEvent("LocationCachePrefetched").detail("Begin", keys.begin).detail("End", keys.end);
+	} catch (Error& e) {
+		if (e.code() == error_code_actor_cancelled) {
+			throw;
+		}
+		TraceEvent(SevWarn, "LocationCachePrefetchFailed").error(e);
+	}
+	return Void();
+}
+
+// Follows the keyServers change log of one commit proxy and updates the cached locations of shards that data
+// distribution moved, so that requests are not first sent to the old location and fail with wrong_shard_server.
+// Like monitorCacheList, takes a DatabaseContext pointer to avoid a cyclic reference.
+ACTOR Future<Void> monitorKeyServersChanges(DatabaseContext* self) {
+	state Optional<CommitProxyInterface> proxy;
+	state UID changeLogId;
+	state int64_t position = 0;
+	loop {
+		if (!proxy.present()) {
+			if (self->clientInfo->get().commitProxies.empty()) {
+				wait(self->onProxiesChanged());
+				continue;
+			}
+			// Spread subscribers over the proxies. Positions are only meaningful for one proxy, so start over.
+			proxy = deterministicRandom()->randomChoice(self->clientInfo->get().commitProxies);
+			changeLogId = UID();
+		}
+		try {
+			choose {
+				when(wait(self->onProxiesChanged())) { proxy.reset(); }
+				when(KeyServersChangesReply _rep =
+				         wait(proxy.get().getKeyServersChanges.getReply(KeyServersChangesRequest(changeLogId, position),
+				                                                        TaskPriority::DefaultPromiseEndpoint))) {
+					state KeyServersChangesReply rep = _rep;
+					// After a reset, changes that happened while not subscribed are found lazily, as without a
+					// subscription
+					changeLogId = rep.changeLogId;
+					position = rep.position;
+					state int shard = 0;
+					for (; shard < rep.locations.results.size(); shard++) {
+						{
+							auto const& [range, servers] = rep.locations.results[shard];
+							for (auto r : self->locationCache.intersectingRanges(range)) {
+								if (r.value()) {
+									TEST(true); // Location cache updated from a pushed shard location change
+									self->setCachedLocation(range, servers);
+									++self->locationCacheUpdatesPushed;
+									break;
+								}
+							}
+						}
+						wait(yield());
+					}
+					updateTssMappings(Database(Reference<DatabaseContext>::addRef(self)), rep.locations);
+				}
+			}
+		} catch (Error& e) {
+			if (e.code() == error_code_actor_cancelled) {
+				throw;
+			}
+			TraceEvent(SevDebug, "KeyServersChangesError").error(e);
+			proxy.reset();
+			wait(delay(CLIENT_KNOBS->KEY_SERVERS_CHANGES_RETRY_DELAY));
+		}
+	}
 }
 
 ACTOR Future<Optional<Value>> getValue(Future<Version> version,
@@ -3946,7 +4048,8 @@ static KeyRange intersect(KeyRangeRef lhs, KeyRangeRef rhs) {
 }
 
 // Divides the requested key range into 1MB fragments, create range streams for each fragment, and merges the results so
-// the client get them in order
+// the client get them in order. Since each fragment holds about RANGESTREAM_FRAGMENT_SIZE bytes, bufferBytes bounds the
+// data read ahead of the client by limiting the number of fragments read at once.
 ACTOR Future<Void> getRangeStream(PromiseStream<RangeResult> _results,
                                   Database cx,
                                   Reference<TransactionLogInfo> trLogInfo,
@@ -3958,9 +4061,13 @@ ACTOR Future<Void> getRangeStream(PromiseStream<RangeResult> _results,
                                   Snapshot snapshot,
                                   Reverse reverse,
                                   TransactionInfo info,
-                                  TagSet tags) {
+                                  TagSet tags,
+                                  int64_t bufferBytes) {
 
-	state ParallelStream<RangeResult> results(_results, CLIENT_KNOBS->RANGESTREAM_BUFFERED_FRAGMENTS_LIMIT);
+	state ParallelStream<RangeResult> results(
+	    _results,
+	    bufferBytes > 0 ? std::max<int64_t>(bufferBytes / CLIENT_KNOBS->RANGESTREAM_FRAGMENT_SIZE, 1)
+	                    : CLIENT_KNOBS->RANGESTREAM_BUFFERED_FRAGMENTS_LIMIT);
 
 	// FIXME: better handling to disable row limits
 	ASSERT(!limits.hasRowLimit());
@@ -4399,7 +4506,8 @@ Future<Void> Transaction::getRangeStream(const PromiseStream<RangeResult>& resul
                                          const KeySelector& end,
                                          GetRangeLimits limits,
                                          Snapshot snapshot,
-                                         Reverse reverse) {
+                                         Reverse reverse,
+                                         int64_t bufferBytes) {
 	++cx->transactionLogicalReads;
 	++cx->transactionGetRangeStreamRequests;
 
@@ -4440,7 +4548,8 @@ Future<Void> Transaction::getRangeStream(const PromiseStream<RangeResult>& resul
 	                                      snapshot,
 	                                      reverse,
 	                                      info,
-	                                      options.readTags),
+	                                      options.readTags,
+	                                      bufferBytes),
 	                     results);
 }
 
@@ -4682,6 +4791,7 @@ void TransactionOptions::clear() {
 	readTags = TagSet{};
 	priority = TransactionPriority::DEFAULT;
 	expensiveClearCostEstimation = false;
+	readRetainedSnapshot = false;
 }
 
 TransactionOptions::TransactionOptions() {
@@ -4968,6 +5078,79 @@ ACTOR Future<Optional<ClientTrCommitCostEstimation>> estimateCommitCosts(Transac
 	return trCommitCosts;
 }
 
+// Sends the coalesced commits to a commit proxy in one message, skipping those whose transaction has given up on them
+static void sendCoalescedCommits(DatabaseContext* cx,
+                                 Reference<CommitProxyInfo> proxies,
+                                 std::vector<DatabaseContext::CoalescedCommit> const& commits) {
+	CommitTransactionBatchRequest req;
+	for (auto const& c : commits) {
+		if (c.sentTo.getFutureReferenceCount()) {
+			req.transactions.push_back(c.req);
+		}
+	}
+	if (req.transactions.empty()) {
+		return;
+	}
+
+	int alt = proxies->getBest();
+	for (int i = 0; i < proxies->size(); i++) {
+		int next = (alt + i) % proxies->size();
+		if (!IFailureMonitor::failureMonitor()
+		         .getState(proxies->get(next, &CommitProxyInterface::commitBatch).getEndpoint())
+		         .failed) {
+			alt = next;
+			break;
+		}
+	}
+	CommitProxyInterface proxy = proxies->getInterface(alt);
+	proxy.commitBatch.send(req);
+	cx->transactionsCommitCoalesced += req.transactions.size();
+	for (auto const& c : commits) {
+		c.sentTo.send(proxy);
+	}
+}
+
+ACTOR Future<Void> commitCoalescer(DatabaseContext* self) {
+	loop {
+		state std::vector<DatabaseContext::CoalescedCommit> commits;
+		state int bytes = 0;
+		state Future<Void> timeout = Never();
+		while (commits.empty() ||
+		       (!timeout.isReady() && commits.size() < CLIENT_KNOBS->COMMIT_COALESCING_MAX_TRANSACTIONS &&
+		        bytes < CLIENT_KNOBS->COMMIT_COALESCING_MAX_BYTES)) {
+			choose {
+				when(DatabaseContext::CoalescedCommit c = waitNext(self->coalescedCommits.getFuture())) {
+					if (commits.empty()) {
+						timeout = delay(CLIENT_KNOBS->COMMIT_COALESCING_WINDOW);
+					}
+					bytes += getBytes(c.req);
+					commits.push_back(std::move(c));
+				}
+				when(wait(timeout)) {}
+			}
+		}
+		while (!self->getCommitProxies(false)) {
+			wait(self->onProxiesChanged());
+		}
+		sendCoalescedCommits(self, self->getCommitProxies(false), commits);
+	}
+}
+
+// Commits a transaction through the database's commit coalescer. Once the coalesced commits have been sent, this waits
+// for the transaction's own reply as tryGetReply would, so each transaction gets its own result and versionstamp.
+ACTOR static Future<CommitID> commitCoalesced(Database cx, CommitTransactionRequest req) {
+	state Promise<CommitProxyInterface> sentTo;
+	setReplyPriority(req, TaskPriority::DefaultPromiseEndpoint);
+	cx->coalescedCommits.send(DatabaseContext::CoalescedCommit{ req, sentTo });
+	state CommitProxyInterface proxy = wait(sentTo.getFuture());
+	choose {
+		when(CommitID ci = wait(brokenPromiseToMaybeDelivered(req.reply.getFuture()))) { return ci; }
+		when(wait(IFailureMonitor::failureMonitor().onDisconnectOrFailure(proxy.commitBatch.getEndpoint()))) {
+			throw request_maybe_delivered();
+		}
+	}
+}
+
 ACTOR static Future<Void> tryCommit(Database cx,
                                     Reference<TransactionLogInfo> trLogInfo,
                                     CommitTransactionRequest req,
@@ -4975,7 +5158,8 @@ ACTOR static Future<Void> tryCommit(Database cx,
                                     TransactionInfo info,
                                     Version* pCommittedVersion,
                                     Transaction* tr,
-                                    TransactionOptions options) {
+                                    TransactionOptions options,
+                                    bool coalesce) {
 	state TraceInterval interval("TransactionCommit");
 	state double startTime = now();
 	state Span span("NAPI:tryCommit"_loc, info.spanID);
@@ -5014,6 +5198,8 @@ ACTOR static Future<Void> tryCommit(Database cx,
 				reply = proxies.size() ? throwErrorOr(brokenPromiseToMaybeDelivered(proxies[0].commit.tryGetReply(req)))
 				                       : Never();
 			}
+		} else if (coalesce) {
+			reply = commitCoalesced(cx, req);
 		} else {
 			reply = basicLoadBalance(cx->getCommitProxies(info.useProvisionalProxies),
 			                         &CommitProxyInterface::commit,
@@ -5181,6 +5367,10 @@ Future<Void> Transaction::commitMutations() {
 			                                                    // need for (expensive) full causal consistency.
 
 		bool isCheckingWrites = options.checkWritesEnabled && deterministicRandom()->random01() < 0.01;
+		// Only transactions without reads are coalesced, as they are the ones paying for a commit request per write
+		bool coalesce = cx->commitCoalescer.isValid() && tr.transaction.read_conflict_ranges.empty() &&
+		                extraConflictRanges.empty() && !isCheckingWrites && !options.commitOnFirstProxy &&
+		                !options.firstInBatch && !info.useProvisionalProxies;
 		for (int i = 0; i < extraConflictRanges.size(); i++)
 			if (extraConflictRanges[i].isReady() &&
 			    extraConflictRanges[i].get().first < extraConflictRanges[i].get().second)
@@ -5218,7 +5408,7 @@ Future<Void> Transaction::commitMutations() {
 		}
 
 		Future<Void> commitResult =
-		    tryCommit(cx, trLogInfo, tr, readVersion, info, &this->committedVersion, this, options);
+		    tryCommit(cx, trLogInfo, tr, readVersion, info, &this->committedVersion, this, options, coalesce);
 
 		if (isCheckingWrites) {
 			Promise<Void> committed;
@@ -5407,6 +5597,12 @@ void Transaction::setOption(FDBTransactionOptions::Option option, Optional<Strin
 		options.firstInBatch = true;
 		break;
 
+	case FDBTransactionOptions::READ_RETAINED_SNAPSHOT:
+		validateOptionValueNotPresent(value);
+		options.readRetainedSnapshot = true;
+		options.readOnly = true;
+		break;
+
 	case FDBTransactionOptions::USE_PROVISIONAL_PROXIES:
 		validateOptionValueNotPresent(value);
 		options.getReadVersionFlags |= GetReadVersionRequest::FLAG_USE_PROVISIONAL_PROXIES;
@@ -5726,6 +5922,13 @@ Future<Version> Transaction::getReadVersion(uint32_t flags) {
 		                                 startTime,
 		                                 metadataVersion,
 		                                 options.tags);
+		if (options.readRetainedSnapshot) {
+			// Storage servers only retain snapshots at multiples of the interval
+			readVersion = map(readVersion, [](Version v) {
+				Version interval = CLIENT_KNOBS->RETAINED_SNAPSHOT_INTERVAL_VERSIONS;
+				return v >= interval ? v - v % interval : v;
+			});
+		}
 	}
 	return readVersion;
 }
@@ -6122,6 +6325,99 @@ ACTOR Future<std::pair<Optional<StorageMetrics>, int>> waitStorageMetrics(Databa
 	}
 }
 
+ACTOR Future<WaitMetricsBatchReply> waitStorageMetricsBatch(Database cx,
+                                                            Standalone<VectorRef<KeyRangeRef>> keys,
+                                                            std::vector<StorageMetrics> min,
+                                                            std::vector<StorageMetrics> max) {
+	state Span span("NAPI:WaitStorageMetricsBatch"_loc);
+	loop {
+		state std::vector<Future<vector<pair<KeyRange, Reference<LocationInfo>>>>> fLocations;
+		fLocations.clear();
+		for (auto const& range : keys) {
+			fLocations.push_back(getKeyRangeLocations(cx,
+			                                          range,
+			                                          2,
+			                                          Reverse::False,
+			                                          &StorageServerInterface::waitMetricsBatch,
+			                                          TransactionInfo(TaskPriority::DataDistribution, span.context)));
+		}
+		wait(waitForAll(fLocations));
+
+		// One request for the ranges on each set of storage servers
+		state WaitMetricsBatchReply result;
+		state std::vector<std::vector<int>> groupRanges;
+		state std::vector<Future<WaitMetricsBatchReply>> replies;
+		std::map<std::vector<UID>, int> groupIndex;
+		std::vector<Reference<LocationInfo>> groupLocations;
+		std::vector<WaitMetricsBatchRequest> requests;
+		result = WaitMetricsBatchReply();
+		groupRanges.clear();
+		replies.clear();
+		for (int i = 0; i < keys.size(); i++) {
+			auto const& locations = fLocations[i].get();
+			if (locations.size() != 1) {
+				result.notReadable.push_back(i);
+				continue;
+			}
+			std::vector<UID> servers;
+			for (int s = 0; s < locations[0].second->size(); s++) {
+				servers.push_back(locations[0].second->getId(s));
+			}
+			std::sort(servers.begin(), servers.end());
+			auto group = groupIndex.emplace(servers, groupRanges.size());
+			if (group.second) {
+				groupRanges.emplace_back();
+				groupLocations.push_back(locations[0].second);
+				requests.emplace_back();
+			}
+			groupRanges[group.first->second].push_back(i);
+			requests[group.first->second].addRange(keys[i], min[i], max[i]);
+		}
+		if (!result.notReadable.empty()) {
+			return result;
+		}
+
+		for (int g = 0; g < requests.size(); g++) {
+			replies.push_back(loadBalance(groupLocations[g]->locations(),
+			                              &StorageServerInterface::waitMetricsBatch,
+			                              requests[g],
+			                              TaskPriority::DataDistribution));
+		}
+		try {
+			wait(quorum(replies, 1));
+			for (int g = 0; g < replies.size(); g++) {
+				if (!replies[g].isReady()) {
+					continue;
+				}
+				WaitMetricsBatchReply const& reply = replies[g].get();
+				for (int j = 0; j < reply.changed.size(); j++) {
+					result.changed.push_back(groupRanges[g][reply.changed[j]]);
+					result.metrics.push_back(reply.metrics[j]);
+				}
+				for (int r : reply.notReadable) {
+					result.notReadable.push_back(groupRanges[g][r]);
+				}
+			}
+			return result;
+		} catch (Error& e) {
+			if (e.code() != error_code_wrong_shard_server && e.code() != error_code_all_alternatives_failed) {
+				TraceEvent(SevError, "WaitStorageMetricsBatchError").error(e);
+				throw;
+			}
+			for (auto const& range : keys) {
+				cx->invalidateCache(range);
+			}
+			wait(delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, TaskPriority::DataDistribution));
+		}
+	}
+}
+
+Future<WaitMetricsBatchReply> Transaction::waitStorageMetricsBatch(Standalone<VectorRef<KeyRangeRef>> const& keys,
+                                                                   std::vector<StorageMetrics> const& min,
+                                                                   std::vector<StorageMetrics> const& max) {
+	return ::waitStorageMetricsBatch(cx, keys, min, max);
+}
+
 Future<std::pair<Optional<StorageMetrics>, int>> Transaction::waitStorageMetrics(KeyRange const& keys,
                                                                                  StorageMetrics const& min,
                                                                                  StorageMetrics const& max,
@@ -6222,6 +6518,122 @@ Future<Standalone<VectorRef<KeyRef>>> Transaction::getRangeSplitPoints(KeyRange
 	return ::getRangeSplitPoints(cx, keys, chunkSize);
 }
 
+// Appends groups to aggregates, merging a group that continues the last one
+static void appendRangeAggregates(Standalone<VectorRef<RangeAggregateRef>>& aggregates,
+                                  VectorRef<RangeAggregateRef> const& groups) {
+	for (auto const& group : groups) {
+		if (!aggregates.empty() && aggregates.back().group == group.group) {
+			aggregates.back().merge(group);
+		} else {
+			aggregates.push_back_deep(aggregates.arena(), group);
+		}
+	}
+}
+
+// Aggregates the part of a range within one shard, continuing where the storage server stopped early
+ACTOR Future<Standalone<VectorRef<RangeAggregateRef>>> getShardRangeAggregate(Database cx,
+                                                                              Reference<LocationInfo> locations,
+                                                                              KeyRange keys,
+                                                                              Version version,
+                                                                              int groupPrefixLength,
+                                                                              int groupTupleElements,
+                                                                              TransactionInfo info,
+                                                                              TagSet tags) {
+	state Standalone<VectorRef<RangeAggregateRef>> result;
+	loop {
+		++cx->transactionPhysicalReads;
+		state GetRangeAggregateReply rep;
+		choose {
+			when(wait(cx->connectionFileChanged())) { throw transaction_too_old(); }
+			when(GetRangeAggregateReply _rep =
+			         wait(loadBalance(cx.getPtr(),
+			                          locations,
+			                          &StorageServerInterface::getRangeAggregate,
+			                          GetRangeAggregateRequest(info.spanID,
+			                                                   keys,
+			                                                   version,
+			                                                   groupPrefixLength,
+			                                                   groupTupleElements,
+			                                                   cx->sampleReadTags() ? tags : Optional<TagSet>(),
+			                                                   info.debugID),
+			                          TaskPriority::DefaultPromiseEndpoint,
+			                          AtMostOnce::False,
+			                          cx->enableLocalityLoadBalance ? &cx->queueModel : nullptr))) {
+				rep = _rep;
+			}
+		}
+		++cx->transactionPhysicalReadsCompleted;
+		appendRangeAggregates(result, rep.groups);
+		if (!rep.more) {
+			return result;
+		}
+		keys = KeyRangeRef(rep.readThrough, keys.end);
+	}
+}
+
+ACTOR Future<Standalone<VectorRef<RangeAggregateRef>>> getRangeAggregate(Database cx,
+                                                                         Future<Version> fVersion,
+                                                                         KeyRange keys,
+                                                                         int groupPrefixLength,
+                                                                         int groupTupleElements,
+                                                                         TransactionInfo info,
+                                                                         TagSet tags) {
+	state Span span("NAPI:getRangeAggregate"_loc, info.spanID);
+	state Version version = wait(fVersion);
+	state Standalone<VectorRef<RangeAggregateRef>> result;
+	cx->validateVersion(version);
+
+	while (!keys.empty()) {
+		state vector<pair<KeyRange, Reference<LocationInfo>>> locations =
+		    wait(getKeyRangeLocations(cx,
+		                              keys,
+		                              CLIENT_KNOBS->RANGE_AGGREGATE_SHARD_LIMIT,
+		                              Reverse::False,
+		                              &StorageServerInterface::getRangeAggregate,
+		                              info));
+		state vector<Future<Standalone<VectorRef<RangeAggregateRef>>>> fReplies;
+		for (auto const& [range, locationInfo] : locations) {
+			fReplies.push_back(getShardRangeAggregate(
+			    cx, locationInfo, range & keys, version, groupPrefixLength, groupTupleElements, info, tags));
+		}
+		try {
+			wait(waitForAll(fReplies));
+		} catch (Error& e) {
+			if (e.code() != error_code_wrong_shard_server && e.code() != error_code_all_alternatives_failed) {
+				throw;
+			}
+			cx->invalidateCache(KeyRangeRef(locations.front().first.begin, locations.back().first.end) & keys);
+			wait(delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, info.taskID));
+			continue;
+		}
+
+		for (auto const& reply : fReplies) {
+			appendRangeAggregates(result, reply.get());
+		}
+		if (locations.back().first.end >= keys.end) {
+			break;
+		}
+		keys = KeyRangeRef(locations.back().first.end, keys.end);
+	}
+
+	if (groupTupleElements <= 0 && result.empty()) {
+		result.push_back(result.arena(), RangeAggregateRef());
+	}
+	return result;
+}
+
+Future<Standalone<VectorRef<RangeAggregateRef>>> Transaction::getRangeAggregate(KeyRange const& keys,
+                                                                                int groupPrefixLength,
+                                                                                int groupTupleElements,
+                                                                                Snapshot snapshot) {
+	++cx->transactionLogicalReads;
+	if (!snapshot && !keys.empty()) {
+		addReadConflictRange(keys);
+	}
+	return ::getRangeAggregate(
+	    cx, getReadVersion(), keys, groupPrefixLength, groupTupleElements, info, options.readTags);
+}
+
 ACTOR Future<Standalone<VectorRef<KeyRef>>> splitStorageMetrics(Database cx,
                                                                 KeyRange keys,
                                                                 StorageMetrics limit,
@@ -151,6 +151,7 @@ struct TransactionOptions {
 	bool includePort : 1;
 	bool reportConflictingKeys : 1;
 	bool expensiveClearCostEstimation : 1;
+	bool readRetainedSnapshot : 1;
 
 	TransactionPriority priority;
 
@@ -285,7 +286,7 @@ public:
 	}
 
 	// A method for streaming data from the storage server that is more efficient than getRange when reading large
-	// amounts of data
+	// amounts of data. A positive bufferBytes bounds how much data is read ahead of the consumer of results.
 	[[nodiscard]] Future<Void> getRangeStream(const PromiseStream<Standalone<RangeResultRef>>& results,
 	                                          const KeySelector& begin,
 	                                          const KeySelector& end,
@@ -297,7 +298,8 @@ public:
 	                                          const KeySelector& end,
 	                                          GetRangeLimits limits,
 	                                          Snapshot = Snapshot::False,
-	                                          Reverse = Reverse::False);
+	                                          Reverse = Reverse::False,
+	                                          int64_t bufferBytes = 0);
 	[[nodiscard]] Future<Void> getRangeStream(const PromiseStream<Standalone<RangeResultRef>>& results,
 	                                          const KeyRange& keys,
 	                                          int limit,
@@ -338,6 +340,12 @@ public:
 	                                                                    StorageMetrics const& permittedError,
 	                                                                    int shardLimit,
 	                                                                    int expectedShardCount);
+	// Like waitStorageMetrics() with an expectedShardCount of 1 for each of the given ranges, with one request for all
+	// the ranges on the same storage servers. Returns the indices and metrics of the ranges out of their bounds in
+	// `changed` and `metrics`, or the indices of the ranges which are no longer single shards in `notReadable`.
+	Future<WaitMetricsBatchReply> waitStorageMetricsBatch(Standalone<VectorRef<KeyRangeRef>> const& keys,
+	                                                      std::vector<StorageMetrics> const& min,
+	                                                      std::vector<StorageMetrics> const& max);
 	// Pass a negative value for `shardLimit` to indicate no limit on the shard number.
 	Future<StorageMetrics> getStorageMetrics(KeyRange const& keys, int shardLimit);
 	Future<Standalone<VectorRef<KeyRef>>> splitStorageMetrics(KeyRange const& keys,
@@ -348,6 +356,15 @@ public:
 	// Try to split the given range into equally sized chunks based on estimated size.
 	// The returned list would still be in form of [keys.begin, splitPoint1, splitPoint2, ... , keys.end]
 	Future<Standalone<VectorRef<KeyRef>>> getRangeSplitPoints(KeyRange const& keys, int64_t chunkSize);
+
+	// Counts and sums the key-value pairs in keys on the storage servers, without returning them (see
+	// RangeAggregateRef). If groupTupleElements is positive, there is one aggregate per distinct prefix of the keys
+	// made of their first groupPrefixLength bytes and the following groupTupleElements tuple elements; otherwise there
+	// is a single aggregate.
+	Future<Standalone<VectorRef<RangeAggregateRef>>> getRangeAggregate(KeyRange const& keys,
+	                                                                   int groupPrefixLength = 0,
+	                                                                   int groupTupleElements = 0,
+	                                                                   Snapshot = Snapshot::False);
 	// If checkWriteConflictRanges is true, existing write conflict ranges will be searched for this key
 	void set(const KeyRef& key, const ValueRef& value, AddConflictRange = AddConflictRange::True);
 	void atomicOp(const KeyRef& key,
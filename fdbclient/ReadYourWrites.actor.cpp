@@ -1509,6 +1509,27 @@ Future<RangeResult> ReadYourWritesTransaction::getRange(const KeySelector& begin
 	return getRange(begin, end, GetRangeLimits(limit), snapshot, reverse);
 }
 
+Future<Void> ReadYourWritesTransaction::getRangeStream(const PromiseStream<RangeResult>& results,
+                                                      KeySelector begin,
+                                                      KeySelector end,
+                                                      Snapshot snapshot,
+                                                      int64_t bufferBytes) {
+	if (checkUsedDuringCommit()) {
+		return used_during_commit();
+	}
+
+	if (resetPromise.isSet())
+		return resetPromise.getFuture().getError();
+
+	KeyRef maxKey = getMaxReadKey();
+	if (begin.getKey() > maxKey || end.getKey() > maxKey)
+		return key_outside_legal_range();
+
+	return waitOrError(
+	    tr.getRangeStream(results, begin, end, GetRangeLimits(), snapshot, Reverse::False, bufferBytes),
+	    resetPromise.getFuture());
+}
+
 Future<Standalone<VectorRef<const char*>>> ReadYourWritesTransaction::getAddressesForKey(const Key& key) {
 	if (checkUsedDuringCommit()) {
 		return used_during_commit();
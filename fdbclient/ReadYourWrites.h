@@ -105,6 +105,13 @@ public:
 		                reverse);
 	}
 
+	// Streams from the storage servers through the underlying transaction, so the transaction's own writes are not seen
+	[[nodiscard]] Future<Void> getRangeStream(const PromiseStream<Standalone<RangeResultRef>>& results,
+	                                          KeySelector begin,
+	                                          KeySelector end,
+	                                          Snapshot snapshot,
+	                                          int64_t bufferBytes) override;
+
 	[[nodiscard]] Future<Standalone<VectorRef<const char*>>> getAddressesForKey(const Key& key) override;
 	Future<Standalone<VectorRef<KeyRef>>> getRangeSplitPoints(const KeyRange& range, int64_t chunkSize) override;
 	Future<int64_t> getEstimatedRangeSizeBytes(const KeyRange& keys) override;
@@ -74,6 +74,10 @@ const KeyRef JSONSchemas::statusSchema = LiteralStringRef(R"statusSchema(
                   "kvstore_total_size":12341234,
                   "kvstore_total_nodes":12341234,
                   "kvstore_inline_keys":12341234,
+                  "kvstore_pending_compaction_bytes":12341234,
+                  "kvstore_block_cache_hit_rate":0.0,
+                  "kvstore_stall_micros":12341234,
+                  "kvstore_l0_files":12341234,
                   "durable_bytes":{
                      "hz":0.0,
                      "counter":0,
@@ -365,7 +369,8 @@ const KeyRef JSONSchemas::statusSchema = LiteralStringRef(R"statusSchema(
                   "log_server_min_free_space",
                   "log_server_min_free_space_ratio",
                   "storage_server_durability_lag",
-                  "storage_server_list_fetch_failed"
+                  "storage_server_list_fetch_failed",
+                  "storage_server_pending_compaction"
                ]
             },
             "description":"The database is not being saturated by the workload."
@@ -386,7 +391,8 @@ const KeyRef JSONSchemas::statusSchema = LiteralStringRef(R"statusSchema(
                   "log_server_min_free_space",
                   "log_server_min_free_space_ratio",
                   "storage_server_durability_lag",
-                  "storage_server_list_fetch_failed"
+                  "storage_server_list_fetch_failed",
+                  "storage_server_pending_compaction"
                ]
             },
             "description":"The database is not being saturated by the workload."
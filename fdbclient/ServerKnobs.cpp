@@ -36,6 +36,8 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( MAX_WRITE_TRANSACTION_LIFE_VERSIONS,     5 * VERSIONS_PER_SECOND ); if (randomize && BUGGIFY) MAX_WRITE_TRANSACTION_LIFE_VERSIONS=std::max<int>(1, 1 * VERSIONS_PER_SECOND);
 	init( MAX_COMMIT_BATCH_INTERVAL,                             2.0 ); if( randomize && BUGGIFY ) MAX_COMMIT_BATCH_INTERVAL = 0.5; // Each commit proxy generates a CommitTransactionBatchRequest at least this often, so that versions always advance smoothly
 	MAX_COMMIT_BATCH_INTERVAL = std::min(MAX_COMMIT_BATCH_INTERVAL, MAX_READ_TRANSACTION_LIFE_VERSIONS/double(2*VERSIONS_PER_SECOND)); // Ensure that the proxy commits 2 times every MAX_READ_TRANSACTION_LIFE_VERSIONS, otherwise the master will not give out versions fast enough
+	init( COMMIT_VERSION_LEASE_VERSIONS,                           0 ); if( randomize && BUGGIFY ) COMMIT_VERSION_LEASE_VERSIONS = deterministicRandom()->randomInt(1, 0.05 * VERSIONS_PER_SECOND); // If positive, the master leases this many versions to a commit proxy at a time, which the proxy assigns to its commit batches without asking the master
+	COMMIT_VERSION_LEASE_VERSIONS = std::min<int64_t>(COMMIT_VERSION_LEASE_VERSIONS, MAX_READ_TRANSACTION_LIFE_VERSIONS / 2);
 
 	// TLogs
 	init( TLOG_TIMEOUT,                                          0.4 ); //cannot buggify because of availability
@@ -76,6 +78,7 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES,            2e9 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES = 2e6;
 	init( TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK,           100 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK = 1;
 	init( TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH,           16<<10 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH = 500;
+	init( TLOG_SPILL_SEGMENT_BYTES,                         256<<10 ); if ( randomize && BUGGIFY ) TLOG_SPILL_SEGMENT_BYTES = 1000;
 	init( DISK_QUEUE_FILE_EXTENSION_BYTES,                    10<<20 ); // BUGGIFYd per file within the DiskQueue
 	init( DISK_QUEUE_FILE_SHRINK_BYTES,                      100<<20 ); // BUGGIFYd per file within the DiskQueue
 	init( DISK_QUEUE_MAX_TRUNCATE_BYTES,                     2LL<<30 ); if ( randomize && BUGGIFY ) DISK_QUEUE_MAX_TRUNCATE_BYTES = 0;
@@ -126,6 +129,14 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( INFLIGHT_PENALTY_UNHEALTHY,                          500.0 );
 	init( INFLIGHT_PENALTY_ONE_LEFT,                          1000.0 );
 	init( USE_OLD_NEEDED_SERVERS,                              false );
+	init( DD_STORAGE_READ_BYTES_CAPACITY,                      100e6 ); if( randomize && BUGGIFY ) DD_STORAGE_READ_BYTES_CAPACITY = 100e3; // Bytes read per second that saturate a storage server, for load aware balancing
+	init( DD_STORAGE_WRITE_BYTES_CAPACITY,                      20e6 ); if( randomize && BUGGIFY ) DD_STORAGE_WRITE_BYTES_CAPACITY = 20e3;
+	init( DD_STORAGE_QUERY_CAPACITY,                          100000 ); if( randomize && BUGGIFY ) DD_STORAGE_QUERY_CAPACITY = 100;
+	init( DD_LOAD_SCORE_WEIGHT,                                  1.0 ); if( randomize && BUGGIFY ) DD_LOAD_SCORE_WEIGHT = deterministicRandom()->coinflip() ? 0.0 : 10.0; // Destination teams' bytes are weighted by 1 + DD_LOAD_SCORE_WEIGHT * their load score
+	init( DD_LOAD_REBALANCE,                                   false ); if( randomize && BUGGIFY ) DD_LOAD_REBALANCE = true;
+	init( DD_LOAD_REBALANCE_INTERVAL,                           30.0 ); if( randomize && BUGGIFY ) DD_LOAD_REBALANCE_INTERVAL = 5.0;
+	init( DD_HOT_TEAM_LOAD_SCORE,                                0.5 ); // Teams less loaded than this are not rebalanced for load
+	init( DD_LOAD_SCORE_HYSTERESIS,                              0.2 ); // Load rebalancing moves a shard only if the source stays at least this much more loaded than the destination
 
 	init( PRIORITY_RECOVER_MOVE,                                 110 );
 	init( PRIORITY_REBALANCE_UNDERUTILIZED_TEAM,                 120 );
@@ -166,6 +177,7 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 		Shard with a read bandwidth smaller than this value will never be too busy to handle the reads.
 	*/
 	init( SHARD_MAX_BYTES_READ_PER_KSEC_JITTER,     0.1 );
+	init( DD_SPLIT_READ_HOT_SHARDS,               false ); if( randomize && BUGGIFY ) DD_SPLIT_READ_HOT_SHARDS = true; // Split read hot shards by read bandwidth, so that their hot parts can be moved separately
 	bool buggifySmallBandwidthSplit = randomize && BUGGIFY;
 	init( SHARD_MAX_BYTES_PER_KSEC,                 1LL*1000000*1000 ); if( buggifySmallBandwidthSplit ) SHARD_MAX_BYTES_PER_KSEC = 10LL*1000*1000;
 	/* 1*1MB/sec * 1000sec/ksec
@@ -237,6 +249,7 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( DD_FETCH_SOURCE_PARALLELISM,                          1000 ); if( randomize && BUGGIFY ) DD_FETCH_SOURCE_PARALLELISM = 1;
 	init( DD_MERGE_LIMIT,                                       2000 ); if( randomize && BUGGIFY ) DD_MERGE_LIMIT = 2;
 	init( DD_SHARD_METRICS_TIMEOUT,                             60.0 ); if( randomize && BUGGIFY ) DD_SHARD_METRICS_TIMEOUT = 0.1;
+	init( DD_SHARD_METRICS_BATCH_SIZE,                           100 ); if( randomize && BUGGIFY ) DD_SHARD_METRICS_BATCH_SIZE = deterministicRandom()->coinflip() ? 1 : 2; // The metrics of up to this many shards on the same team are tracked with one request
 	init( DD_LOCATION_CACHE_SIZE,                            2000000 ); if( randomize && BUGGIFY ) DD_LOCATION_CACHE_SIZE = 3;
 	init( MOVEKEYS_LOCK_POLLING_DELAY,                           5.0 );
 	init( DEBOUNCE_RECRUITING_DELAY,                             5.0 );
@@ -293,6 +306,10 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 		// Set window limit to opsPerSecond scaled down to window size
 		SQLITE_WRITE_WINDOW_LIMIT = opsPerSecond * SQLITE_WRITE_WINDOW_SECONDS;
 	}
+	init( SQLITE_READ_AHEAD_MIN_SEQUENTIAL_READS,                  4 ); if( randomize && BUGGIFY ) SQLITE_READ_AHEAD_MIN_SEQUENTIAL_READS = deterministicRandom()->randomInt(1, 4);
+	init( SQLITE_READ_AHEAD_INITIAL_BYTES,                     32768 ); if( randomize && BUGGIFY ) SQLITE_READ_AHEAD_INITIAL_BYTES = 4096;
+	init( SQLITE_READ_AHEAD_MAX_BYTES,                       1048576 ); if( randomize && BUGGIFY ) SQLITE_READ_AHEAD_MAX_BYTES = deterministicRandom()->randomInt(0, 16) * 4096;
+	init( SQLITE_READ_AHEAD_BUDGET_BYTES,                       64e6 ); if( randomize && BUGGIFY ) SQLITE_READ_AHEAD_BUDGET_BYTES = 65536;
 
 	// Maximum and minimum cell payload bytes allowed on primary page as calculated in SQLite.
 	// These formulas are copied from SQLite, using its hardcoded constants, so if you are
@@ -331,6 +348,10 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 
 	// KeyValueStoreMemory
 	init( REPLACE_CONTENTS_BYTES,                                1e5 );
+	init( MEMORY_CHECKPOINT_INTERVAL,                              0 ); if( randomize && BUGGIFY ) MEMORY_CHECKPOINT_INTERVAL = deterministicRandom()->random01() * 20.0 + 0.1;
+	init( MEMORY_CHECKPOINT_BLOCK_BYTES,                         1e6 ); if( randomize && BUGGIFY ) MEMORY_CHECKPOINT_BLOCK_BYTES = deterministicRandom()->randomInt(1, 1e4);
+	init( MEMORY_CHECKPOINT_READ_AHEAD_BLOCKS,                     8 ); if( randomize && BUGGIFY ) MEMORY_CHECKPOINT_READ_AHEAD_BLOCKS = deterministicRandom()->randomInt(1, 4);
+	init( MEMORY_PACKED_CONTAINER,                             false ); if( randomize && BUGGIFY ) MEMORY_PACKED_CONTAINER = deterministicRandom()->coinflip();
 
 	// KeyValueStoreRocksDB
 	init( ROCKSDB_BACKGROUND_PARALLELISM,                          0 );
@@ -342,6 +363,9 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( ROCKSDB_PERIODIC_COMPACTION_SECONDS,                     0 );
 	init( ROCKSDB_PREFIX_LEN,                                      0 );
 	init( ROCKSDB_BLOCK_CACHE_SIZE,                                0 );
+	init( ROCKSDB_READ_RANGE_REUSE_ITERATORS,                   true ); if( randomize && BUGGIFY ) ROCKSDB_READ_RANGE_REUSE_ITERATORS = false;
+	init( ROCKSDB_MULTIGET_MAX_BATCH,                             64 ); if( randomize && BUGGIFY ) ROCKSDB_MULTIGET_MAX_BATCH = deterministicRandom()->randomInt(1, 8);
+	init( ROCKSDB_METRICS_DELAY,                                60.0 );
 
 	// Leader election
 	bool longLeaderElection = randomize && BUGGIFY;
@@ -365,13 +389,23 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( START_TRANSACTION_RATE_WINDOW,                         2.0 );
 	init( START_TRANSACTION_MAX_EMPTY_QUEUE_BUDGET,             10.0 );
 	init( START_TRANSACTION_MAX_QUEUE_SIZE,                      1e6 );
+	init( GRV_TAG_QUEUE_QUANTUM,                                  10 ); if( randomize && BUGGIFY ) GRV_TAG_QUEUE_QUANTUM = 1; // Transactions each transaction tag's queue may start in its turn on the GRV proxy
+	init( GRV_UNTAGGED_QUEUE_WEIGHT,                             1.0 ); // Turns taken by requests without tags relative to each tag
 	init( KEY_LOCATION_MAX_QUEUE_SIZE,                           1e6 );
+	init( KEY_SERVERS_CHANGE_LOG_SIZE,                         10000 ); if( randomize && BUGGIFY ) KEY_SERVERS_CHANGE_LOG_SIZE = 2;
+	init( KEY_SERVERS_CHANGES_TIMEOUT,                          30.0 ); if( randomize && BUGGIFY ) KEY_SERVERS_CHANGES_TIMEOUT = 1.0;
+	init( KEY_SERVERS_CHANGES_REPLY_LIMIT,                      1000 ); if( randomize && BUGGIFY ) KEY_SERVERS_CHANGES_REPLY_LIMIT = 1;
 
 	init( COMMIT_TRANSACTION_BATCH_INTERVAL_FROM_IDLE,         0.0005 ); if( randomize && BUGGIFY ) COMMIT_TRANSACTION_BATCH_INTERVAL_FROM_IDLE = 0.005;
 	init( COMMIT_TRANSACTION_BATCH_INTERVAL_MIN,                0.001 ); if( randomize && BUGGIFY ) COMMIT_TRANSACTION_BATCH_INTERVAL_MIN = 0.1;
 	init( COMMIT_TRANSACTION_BATCH_INTERVAL_MAX,                0.020 );
 	init( COMMIT_TRANSACTION_BATCH_INTERVAL_LATENCY_FRACTION,     0.1 );
 	init( COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA,       0.1 );
+	init( COMMIT_TRANSACTION_BATCH_TARGET_LATENCY,                0.0 ); if( randomize && BUGGIFY ) COMMIT_TRANSACTION_BATCH_TARGET_LATENCY = deterministicRandom()->random01() * 0.1; // If nonzero, the commit latency for which commit proxies choose their batching interval and batch size
+	init( COMMIT_TRANSACTION_BATCH_MIN_SIZE_FRACTION,            0.05 );
+	init( COMMIT_TRANSACTION_BATCH_SIZE_DECREASE_RATE,            0.9 );
+	init( COMMIT_TRANSACTION_BATCH_SIZE_INCREASE_RATE,           1.05 );
+	init( COMMIT_TRANSACTION_BATCH_SIZE_HYSTERESIS,               0.1 ); // Batches grow only while the commit latency is this fraction below the target
 	init( COMMIT_TRANSACTION_BATCH_COUNT_MAX,                   32768 ); if( randomize && BUGGIFY ) COMMIT_TRANSACTION_BATCH_COUNT_MAX = 1000; // Do NOT increase this number beyond 32768, as CommitIds only budget 2 bytes for storing transaction id within each batch
 	init( COMMIT_BATCHES_MEM_BYTES_HARD_LIMIT,              8LL << 30 ); if (randomize && BUGGIFY) COMMIT_BATCHES_MEM_BYTES_HARD_LIMIT = deterministicRandom()->randomInt64(100LL << 20,  8LL << 30);
 	init( COMMIT_BATCHES_MEM_FRACTION_OF_TOTAL,                   0.5 );
@@ -524,6 +558,8 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( STORAGE_HARD_LIMIT_BYTES,                           1500e6 ); if( smallStorageTarget ) STORAGE_HARD_LIMIT_BYTES = 4500e3;
 	init( STORAGE_DURABILITY_LAG_HARD_MAX,                    2000e6 ); if( smallStorageTarget ) STORAGE_DURABILITY_LAG_HARD_MAX = 100e6;
 	init( STORAGE_DURABILITY_LAG_SOFT_MAX,                     250e6 ); if( smallStorageTarget ) STORAGE_DURABILITY_LAG_SOFT_MAX = 10e6;
+	init( STORAGE_PENDING_COMPACTION_LIMIT_BYTES,               64e9 ); // RocksDB's soft_pending_compaction_bytes_limit
+	init( STORAGE_PENDING_COMPACTION_SPRING_BYTES,              16e9 );
 
 	//FIXME: Low priority reads are disabled by assigning very high knob values, reduce knobs for 7.0
 	init( LOW_PRIORITY_STORAGE_QUEUE_BYTES,                    775e8 ); if( smallStorageTarget ) LOW_PRIORITY_STORAGE_QUEUE_BYTES = 1750e3;
@@ -572,6 +608,8 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( AUTO_TAG_THROTTLE_UPDATE_FREQUENCY,                   10.0 ); if(randomize && BUGGIFY) AUTO_TAG_THROTTLE_UPDATE_FREQUENCY = 0.5;
 	init( TAG_THROTTLE_EXPIRED_CLEANUP_INTERVAL,                30.0 ); if(randomize && BUGGIFY) TAG_THROTTLE_EXPIRED_CLEANUP_INTERVAL = 1.0;
 	init( AUTO_TAG_THROTTLING_ENABLED,                          true ); if(randomize && BUGGIFY) AUTO_TAG_THROTTLING_ENABLED = false;
+	init( GRV_TAG_QUEUE_LOGGING_INTERVAL,                        5.0 );
+	init( GRV_TAG_QUEUE_LOGGING_TAGS,                             10 );
 
 	//Storage Metrics
 	init( STORAGE_METRICS_AVERAGE_INTERVAL,                    120.0 );
@@ -595,12 +633,15 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( FETCH_KEYS_PARALLELISM_BYTES,                          4e6 ); if( randomize && BUGGIFY ) FETCH_KEYS_PARALLELISM_BYTES = 3e6;
 	init( FETCH_KEYS_PARALLELISM,                                  2 );
 	init( FETCH_KEYS_LOWER_PRIORITY,                               0 );
+	init( RANGE_AGGREGATE_SCAN_BYTES,                            1e8 ); if( randomize && BUGGIFY ) RANGE_AGGREGATE_SCAN_BYTES = 1;
+	init( RANGE_AGGREGATE_GROUP_LIMIT,                         10000 ); if( randomize && BUGGIFY ) RANGE_AGGREGATE_GROUP_LIMIT = 1;
 	init( BUGGIFY_BLOCK_BYTES,                                 10000 );
 	init( STORAGE_COMMIT_BYTES,                             10000000 ); if( randomize && BUGGIFY ) STORAGE_COMMIT_BYTES = 2000000;
 	init( STORAGE_FETCH_BYTES,                               2500000 ); if( randomize && BUGGIFY ) STORAGE_FETCH_BYTES =  500000;
 	init( STORAGE_DURABILITY_LAG_REJECT_THRESHOLD,              0.25 );
 	init( STORAGE_DURABILITY_LAG_MIN_RATE,                       0.1 );
 	init( STORAGE_COMMIT_INTERVAL,                               0.5 ); if( randomize && BUGGIFY ) STORAGE_COMMIT_INTERVAL = 2.0;
+	init( STORAGE_SNAPSHOT_RETENTION_VERSIONS,                     0 ); if( randomize && BUGGIFY ) STORAGE_SNAPSHOT_RETENTION_VERSIONS = 20 * VERSIONS_PER_SECOND;
 	init( UPDATE_SHARD_VERSION_INTERVAL,                        0.25 ); if( randomize && BUGGIFY ) UPDATE_SHARD_VERSION_INTERVAL = 1.0;
 	init( BYTE_SAMPLING_FACTOR,                                  250 ); //cannot buggify because of differences in restarting tests
 	init( BYTE_SAMPLING_OVERHEAD,                                100 );
@@ -615,6 +656,7 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( BEHIND_CHECK_COUNT,                                      2 );
 	init( BEHIND_CHECK_VERSIONS,             5 * VERSIONS_PER_SECOND );
 	init( WAIT_METRICS_WRONG_SHARD_CHANCE,   isSimulated ? 1.0 : 0.1 );
+	init( WAIT_METRICS_BATCH_DELAY,                              0.1 ); if( randomize && BUGGIFY ) WAIT_METRICS_BATCH_DELAY = 0.0;
 	init( MIN_TAG_READ_PAGES_RATE,                             1.0e4 ); if( randomize && BUGGIFY ) MIN_TAG_READ_PAGES_RATE = 0;
 	init( MIN_TAG_WRITE_PAGES_RATE,                             3200 ); if( randomize && BUGGIFY ) MIN_TAG_WRITE_PAGES_RATE = 0;
 	init( TAG_MEASUREMENT_INTERVAL,                        30.0 ); if( randomize && BUGGIFY ) TAG_MEASUREMENT_INTERVAL = 1.0;
@@ -625,6 +667,7 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( FETCH_KEYS_TOO_LONG_TIME_CRITERIA,                   300.0 );
 	init( MAX_STORAGE_COMMIT_TIME,                             120.0 ); //The max fsync stall time on the storage server and tlog before marking a disk as failed
 	init( RANGESTREAM_LIMIT_BYTES,                               2e6 ); if( randomize && BUGGIFY ) RANGESTREAM_LIMIT_BYTES = 1;
+	init( STORAGE_EAGER_READS_BATCH_SIZE,                        500 ); if( randomize && BUGGIFY ) STORAGE_EAGER_READS_BATCH_SIZE = deterministicRandom()->randomInt(1, 10);
 
 	//Wait Failure
 	init( MAX_OUTSTANDING_WAIT_FAILURE_REQUESTS,                 250 ); if( randomize && BUGGIFY ) MAX_OUTSTANDING_WAIT_FAILURE_REQUESTS = 2;
@@ -739,6 +782,8 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( REDWOOD_REMAP_CLEANUP_WINDOW,                           50 );
 	init( REDWOOD_REMAP_CLEANUP_LAG,                             0.1 );
 	init( REDWOOD_LOGGING_INTERVAL,                              5.0 );
+	init( REDWOOD_PAGE_BUILD_THREADS,                              0 ); if( randomize && BUGGIFY ) REDWOOD_PAGE_BUILD_THREADS = deterministicRandom()->randomInt(1, 5);
+	init( REDWOOD_VALUE_SEPARATION_THRESHOLD,                      0 ); if( randomize && BUGGIFY ) REDWOOD_VALUE_SEPARATION_THRESHOLD = deterministicRandom()->randomInt(100, 10000);
 
 	// Server request latency measurement
 	init( LATENCY_SAMPLE_SIZE,                                100000 );
@@ -39,6 +39,7 @@ public:
 	int64_t MAX_WRITE_TRANSACTION_LIFE_VERSIONS;
 	double MAX_COMMIT_BATCH_INTERVAL; // Each commit proxy generates a CommitTransactionBatchRequest at least this
 	                                  // often, so that versions always advance smoothly
+	int64_t COMMIT_VERSION_LEASE_VERSIONS;
 
 	// TLogs
 	double TLOG_TIMEOUT; // tlog OR commit proxy failure - master's reaction time
@@ -84,6 +85,7 @@ public:
 	int64_t TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES;
 	int64_t TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK;
 	int64_t TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH;
+	int64_t TLOG_SPILL_SEGMENT_BYTES;
 	int64_t DISK_QUEUE_FILE_EXTENSION_BYTES; // When we grow the disk queue, by how many bytes should it grow?
 	int64_t DISK_QUEUE_FILE_SHRINK_BYTES; // When we shrink the disk queue, by how many bytes should it shrink?
 	int64_t DISK_QUEUE_MAX_TRUNCATE_BYTES; // A truncate larger than this will cause the file to be replaced instead.
@@ -126,6 +128,14 @@ public:
 	double INFLIGHT_PENALTY_UNHEALTHY;
 	double INFLIGHT_PENALTY_ONE_LEFT;
 	bool USE_OLD_NEEDED_SERVERS;
+	double DD_STORAGE_READ_BYTES_CAPACITY;
+	double DD_STORAGE_WRITE_BYTES_CAPACITY;
+	double DD_STORAGE_QUERY_CAPACITY;
+	double DD_LOAD_SCORE_WEIGHT;
+	bool DD_LOAD_REBALANCE;
+	double DD_LOAD_REBALANCE_INTERVAL;
+	double DD_HOT_TEAM_LOAD_SCORE;
+	double DD_LOAD_SCORE_HYSTERESIS;
 
 	// Higher priorities are executed first
 	// Priority/100 is the "priority group"/"superpriority".  Priority inversion
@@ -158,6 +168,7 @@ public:
 	double SHARD_MAX_READ_DENSITY_RATIO;
 	int64_t SHARD_READ_HOT_BANDWITH_MIN_PER_KSECONDS;
 	double SHARD_MAX_BYTES_READ_PER_KSEC_JITTER;
+	bool DD_SPLIT_READ_HOT_SHARDS;
 	double STORAGE_METRIC_TIMEOUT;
 	double METRIC_DELAY;
 	double ALL_DATA_REMOVED_DELAY;
@@ -190,6 +201,7 @@ public:
 	int DD_FETCH_SOURCE_PARALLELISM;
 	int DD_MERGE_LIMIT;
 	double DD_SHARD_METRICS_TIMEOUT;
+	int DD_SHARD_METRICS_BATCH_SIZE;
 	int64_t DD_LOCATION_CACHE_SIZE;
 	double MOVEKEYS_LOCK_POLLING_DELAY;
 	double DEBOUNCE_RECRUITING_DELAY;
@@ -249,6 +261,10 @@ public:
 	int SQLITE_READER_THREADS;
 	int SQLITE_WRITE_WINDOW_LIMIT;
 	double SQLITE_WRITE_WINDOW_SECONDS;
+	int SQLITE_READ_AHEAD_MIN_SEQUENTIAL_READS; // Reads moving forward through a file before it is read ahead
+	int SQLITE_READ_AHEAD_INITIAL_BYTES; // Of the first read ahead of a scan
+	int SQLITE_READ_AHEAD_MAX_BYTES; // Of any read ahead of a scan; 0 disables reading ahead
+	int64_t SQLITE_READ_AHEAD_BUDGET_BYTES; // Of all reads ahead in progress in the process
 
 	// KeyValueStoreSqlite spring cleaning
 	double SPRING_CLEANING_NO_ACTION_INTERVAL;
@@ -265,6 +281,10 @@ public:
 
 	// KeyValueStoreMemory
 	int64_t REPLACE_CONTENTS_BYTES;
+	double MEMORY_CHECKPOINT_INTERVAL; // Seconds between checkpoints of a memory storage engine's data, or 0 for none
+	int MEMORY_CHECKPOINT_BLOCK_BYTES;
+	int MEMORY_CHECKPOINT_READ_AHEAD_BLOCKS; // Number of checkpoint blocks read ahead of the one being loaded
+	bool MEMORY_PACKED_CONTAINER; // Memory storage engines of type MEMORY keep their data in a PackedKeyValueContainer
 
 	// KeyValueStoreRocksDB
 	int ROCKSDB_BACKGROUND_PARALLELISM;
@@ -274,6 +294,9 @@ public:
 	int64_t ROCKSDB_PERIODIC_COMPACTION_SECONDS;
 	int ROCKSDB_PREFIX_LEN;
 	int64_t ROCKSDB_BLOCK_CACHE_SIZE;
+	bool ROCKSDB_READ_RANGE_REUSE_ITERATORS; // Range reads reuse iterators until the next commit
+	int ROCKSDB_MULTIGET_MAX_BATCH; // Point reads issued together are read by one MultiGet of at most this many keys
+	double ROCKSDB_METRICS_DELAY; // Between RocksDBMetrics trace events
 
 	// Leader election
 	int MAX_NOTIFICATIONS;
@@ -296,13 +319,23 @@ public:
 	double START_TRANSACTION_RATE_WINDOW;
 	double START_TRANSACTION_MAX_EMPTY_QUEUE_BUDGET;
 	int START_TRANSACTION_MAX_QUEUE_SIZE;
+	int GRV_TAG_QUEUE_QUANTUM;
+	double GRV_UNTAGGED_QUEUE_WEIGHT;
 	int KEY_LOCATION_MAX_QUEUE_SIZE;
+	int KEY_SERVERS_CHANGE_LOG_SIZE; // Number of keyServers changes a commit proxy remembers for subscribed clients
+	double KEY_SERVERS_CHANGES_TIMEOUT; // Longest time a keyServers changes request waits for a change
+	int KEY_SERVERS_CHANGES_REPLY_LIMIT; // Most shard locations returned by one keyServers changes request
 
 	double COMMIT_TRANSACTION_BATCH_INTERVAL_FROM_IDLE;
 	double COMMIT_TRANSACTION_BATCH_INTERVAL_MIN;
 	double COMMIT_TRANSACTION_BATCH_INTERVAL_MAX;
 	double COMMIT_TRANSACTION_BATCH_INTERVAL_LATENCY_FRACTION;
 	double COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA;
+	double COMMIT_TRANSACTION_BATCH_TARGET_LATENCY;
+	double COMMIT_TRANSACTION_BATCH_MIN_SIZE_FRACTION; // Smallest fraction of the batch count and bytes limits used
+	double COMMIT_TRANSACTION_BATCH_SIZE_DECREASE_RATE;
+	double COMMIT_TRANSACTION_BATCH_SIZE_INCREASE_RATE;
+	double COMMIT_TRANSACTION_BATCH_SIZE_HYSTERESIS;
 	int COMMIT_TRANSACTION_BATCH_COUNT_MAX;
 	int COMMIT_TRANSACTION_BATCH_BYTES_MIN;
 	int COMMIT_TRANSACTION_BATCH_BYTES_MAX;
@@ -456,6 +489,9 @@ public:
 	int64_t STORAGE_HARD_LIMIT_BYTES;
 	int64_t STORAGE_DURABILITY_LAG_HARD_MAX;
 	int64_t STORAGE_DURABILITY_LAG_SOFT_MAX;
+	int64_t STORAGE_PENDING_COMPACTION_LIMIT_BYTES; // Ratekeeper stops a storage server's writes at this much pending
+	                                                // compaction, reported by its storage engine
+	int64_t STORAGE_PENDING_COMPACTION_SPRING_BYTES; // And starts slowing them down this much before it
 
 	int64_t LOW_PRIORITY_STORAGE_QUEUE_BYTES;
 	int64_t LOW_PRIORITY_DURABILITY_LAG;
@@ -481,6 +517,8 @@ public:
 	double AUTO_TAG_THROTTLE_UPDATE_FREQUENCY;
 	double TAG_THROTTLE_EXPIRED_CLEANUP_INTERVAL;
 	bool AUTO_TAG_THROTTLING_ENABLED;
+	double GRV_TAG_QUEUE_LOGGING_INTERVAL;
+	int GRV_TAG_QUEUE_LOGGING_TAGS; // Ratekeeper logs the GRV queues of this many of the tags with the longest queues
 
 	double MAX_TRANSACTIONS_PER_BYTE;
 
@@ -531,12 +569,16 @@ public:
 	int FETCH_KEYS_PARALLELISM_BYTES;
 	int FETCH_KEYS_PARALLELISM;
 	int FETCH_KEYS_LOWER_PRIORITY;
+	int64_t RANGE_AGGREGATE_SCAN_BYTES; // Bytes a range aggregate request reads before replying with a partial result
+	int RANGE_AGGREGATE_GROUP_LIMIT; // Groups a range aggregate request returns before replying with a partial result
 	int BUGGIFY_BLOCK_BYTES;
 	double STORAGE_DURABILITY_LAG_REJECT_THRESHOLD;
 	double STORAGE_DURABILITY_LAG_MIN_RATE;
 	int STORAGE_COMMIT_BYTES;
 	int STORAGE_FETCH_BYTES;
 	double STORAGE_COMMIT_INTERVAL;
+	int64_t STORAGE_SNAPSHOT_RETENTION_VERSIONS; // Versions for which storage engines that can (Redwood) keep durable
+	                                             // snapshots readable past the MVCC window; 0 disables retention
 	double UPDATE_SHARD_VERSION_INTERVAL;
 	int BYTE_SAMPLING_FACTOR;
 	int BYTE_SAMPLING_OVERHEAD;
@@ -551,6 +593,7 @@ public:
 	int BEHIND_CHECK_COUNT;
 	int64_t BEHIND_CHECK_VERSIONS;
 	double WAIT_METRICS_WRONG_SHARD_CHANCE;
+	double WAIT_METRICS_BATCH_DELAY; // Changes to the ranges of a WaitMetricsBatchRequest are coalesced for this long
 	int64_t MIN_TAG_READ_PAGES_RATE;
 	int64_t MIN_TAG_WRITE_PAGES_RATE;
 	double TAG_MEASUREMENT_INTERVAL;
@@ -561,6 +604,7 @@ public:
 	double FETCH_KEYS_TOO_LONG_TIME_CRITERIA;
 	double MAX_STORAGE_COMMIT_TIME;
 	int64_t RANGESTREAM_LIMIT_BYTES;
+	int STORAGE_EAGER_READS_BATCH_SIZE; // Keys an update reads from the storage engine with one batched read
 
 	// Wait Failure
 	int MAX_OUTSTANDING_WAIT_FAILURE_REQUESTS;
@@ -687,6 +731,10 @@ public:
 	double REDWOOD_REMAP_CLEANUP_LAG; // Maximum allowed remap remover lag behind the cleanup window as a multiple of
 	                                  // the window size
 	double REDWOOD_LOGGING_INTERVAL;
+	int REDWOOD_PAGE_BUILD_THREADS; // Number of threads encoding new BTree pages during commit, or 0 to encode them on
+	                                // the network thread
+	int REDWOOD_VALUE_SEPARATION_THRESHOLD; // Values of at least this many bytes are stored outside of BTree leaves in
+	                                        // pages of their own, or 0 to keep all values in leaves
 
 	// Server request latency measurement
 	int LATENCY_SAMPLE_SIZE;
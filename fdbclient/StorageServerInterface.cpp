@@ -19,6 +19,7 @@
  */
 
 #include "fdbclient/StorageServerInterface.h"
+#include "fdbclient/Tuple.h"
 #include "flow/crc32c.h" // for crc32c_append, to checksum values in tss trace events
 
 // Includes template specializations for all tss operations on storage server types.
@@ -233,6 +234,27 @@ void TSS_traceMismatch(TraceEvent& event,
 	ASSERT(false);
 }
 
+// batched storage metrics
+template <>
+bool TSS_doCompare(const WaitMetricsBatchReply& src, const WaitMetricsBatchReply& tss) {
+	ASSERT(false);
+	return true;
+}
+
+template <>
+const char* TSS_mismatchTraceName(const WaitMetricsBatchRequest& req) {
+	ASSERT(false);
+	return "";
+}
+
+template <>
+void TSS_traceMismatch(TraceEvent& event,
+                       const WaitMetricsBatchRequest& req,
+                       const WaitMetricsBatchReply& src,
+                       const WaitMetricsBatchReply& tss) {
+	ASSERT(false);
+}
+
 // split metrics
 template <>
 bool TSS_doCompare(const SplitMetricsReply& src, const SplitMetricsReply& tss) {
@@ -296,6 +318,41 @@ void TSS_traceMismatch(TraceEvent& event,
 	ASSERT(false);
 }
 
+// range aggregates
+template <>
+bool TSS_doCompare(const GetRangeAggregateReply& src, const GetRangeAggregateReply& tss) {
+	return src.more == tss.more && src.readThrough == tss.readThrough && src.groups == tss.groups;
+}
+
+template <>
+const char* TSS_mismatchTraceName(const GetRangeAggregateRequest& req) {
+	return "TSSMismatchGetRangeAggregate";
+}
+
+template <>
+void TSS_traceMismatch(TraceEvent& event,
+                       const GetRangeAggregateRequest& req,
+                       const GetRangeAggregateReply& src,
+                       const GetRangeAggregateReply& tss) {
+	std::string ssResultsString = format("(%d)%s:\n", src.groups.size(), src.more ? "+" : "");
+	for (auto& it : src.groups) {
+		ssResultsString += "\n" + it.toString();
+	}
+
+	std::string tssResultsString = format("(%d)%s:\n", tss.groups.size(), tss.more ? "+" : "");
+	for (auto& it : tss.groups) {
+		tssResultsString += "\n" + it.toString();
+	}
+	event.detail("Begin", req.keys.begin)
+	    .detail("End", req.keys.end)
+	    .detail("Version", req.version)
+	    .detail("GroupPrefixLength", req.groupPrefixLength)
+	    .detail("GroupTupleElements", req.groupTupleElements)
+	    .setMaxFieldLength(FLOW_KNOBS->TSS_LARGE_TRACE_SIZE * 4 / 10)
+	    .detail("SSReply", ssResultsString)
+	    .detail("TSSReply", tssResultsString);
+}
+
 // only record metrics for data reads
 
 template <>
@@ -322,6 +379,9 @@ void TSSMetrics::recordLatency(const WatchValueRequest& req, double ssLatency, d
 template <>
 void TSSMetrics::recordLatency(const WaitMetricsRequest& req, double ssLatency, double tssLatency) {}
 
+template <>
+void TSSMetrics::recordLatency(const WaitMetricsBatchRequest& req, double ssLatency, double tssLatency) {}
+
 template <>
 void TSSMetrics::recordLatency(const SplitMetricsRequest& req, double ssLatency, double tssLatency) {}
 
@@ -334,6 +394,27 @@ void TSSMetrics::recordLatency(const SplitRangeRequest& req, double ssLatency, d
 template <>
 void TSSMetrics::recordLatency(const GetKeyValuesStreamRequest& req, double ssLatency, double tssLatency) {}
 
+template <>
+void TSSMetrics::recordLatency(const GetRangeAggregateRequest& req, double ssLatency, double tssLatency) {}
+
+KeyRef rangeAggregateGroup(KeyRef key, int prefixLength, int tupleElements) {
+	if (key.size() <= prefixLength) {
+		return key;
+	}
+	try {
+		Tuple t = Tuple::unpack(key.substr(prefixLength));
+		if (t.size() <= tupleElements) {
+			return key;
+		}
+		return key.substr(0, prefixLength + t.subTuple(0, tupleElements).pack().size());
+	} catch (Error& e) {
+		if (e.code() != error_code_invalid_tuple_data_type) {
+			throw;
+		}
+		return key;
+	}
+}
+
 // -------------------
 
 TEST_CASE("/StorageServerInterface/TSSCompare/TestComparison") {
@@ -444,4 +525,33 @@ TEST_CASE("/StorageServerInterface/TSSCompare/TestComparison") {
 	ASSERT(s12 == traceChecksumValue(StringRef(s12)));
 	ASSERT(checksumStart13 == traceChecksumValue(StringRef(s13)).substr(0, 4));
 	return Void();
-}
\ No newline at end of file
+}
+TEST_CASE("/StorageServerInterface/RangeAggregate") {
+	Arena arena;
+	RangeAggregateRef agg;
+	agg.add(KeyValueRef("a"_sr, StringRef(arena, Tuple().append(1).pack())));
+	int64_t v = -5;
+	agg.add(KeyValueRef("b"_sr, StringRef((const uint8_t*)&v, sizeof(v))));
+	agg.add(KeyValueRef("c"_sr, "\x07"_sr));
+	agg.add(KeyValueRef("d"_sr, "a value that is not an integer"_sr));
+	ASSERT(agg.count == 4 && agg.integerCount == 3);
+	ASSERT(agg.min == -5 && agg.max == 0x0115);
+	ASSERT(agg.sum == 0x0115 - 5 + 7);
+
+	RangeAggregateRef other;
+	other.add(KeyValueRef("e"_sr, "\xff\xff\xff\xff\xff\xff\xff\x7f"_sr));
+	agg.merge(other);
+	ASSERT(agg.count == 5 && agg.max == std::numeric_limits<int64_t>::max());
+	ASSERT(agg.sum == std::numeric_limits<int64_t>::min() + 0x0115 + 1);
+	ASSERT(agg.bytes == 5 + 2 + 8 + 1 + 30 + 8);
+
+	Key prefix = "prefix/"_sr;
+	Key key = prefix.withSuffix(Tuple().append("user"_sr).append(42).append("field"_sr).pack());
+	ASSERT(rangeAggregateGroup(key, prefix.size(), 1) == prefix.withSuffix(Tuple().append("user"_sr).pack()));
+	ASSERT(rangeAggregateGroup(key, prefix.size(), 2) ==
+	       prefix.withSuffix(Tuple().append("user"_sr).append(42).pack()));
+	ASSERT(rangeAggregateGroup(key, prefix.size(), 3) == key);
+	ASSERT(rangeAggregateGroup(prefix, prefix.size(), 1) == prefix);
+	ASSERT(rangeAggregateGroup("prefix/\x7f"_sr, prefix.size(), 1) == "prefix/\x7f"_sr);
+	return Void();
+}
@@ -77,6 +77,8 @@ struct StorageServerInterface {
 	RequestStream<struct ReadHotSubRangeRequest> getReadHotRanges;
 	RequestStream<struct SplitRangeRequest> getRangeSplitPoints;
 	RequestStream<struct GetKeyValuesStreamRequest> getKeyValuesStream;
+	RequestStream<struct GetRangeAggregateRequest> getRangeAggregate;
+	RequestStream<struct WaitMetricsBatchRequest> waitMetricsBatch;
 
 	explicit StorageServerInterface(UID uid) : uniqueID(uid) {}
 	StorageServerInterface() : uniqueID(deterministicRandom()->randomUniqueID()) {}
@@ -119,6 +121,10 @@ struct StorageServerInterface {
 				    RequestStream<struct SplitRangeRequest>(getValue.getEndpoint().getAdjustedEndpoint(12));
 				getKeyValuesStream =
 				    RequestStream<struct GetKeyValuesStreamRequest>(getValue.getEndpoint().getAdjustedEndpoint(13));
+				getRangeAggregate =
+				    RequestStream<struct GetRangeAggregateRequest>(getValue.getEndpoint().getAdjustedEndpoint(14));
+				waitMetricsBatch =
+				    RequestStream<struct WaitMetricsBatchRequest>(getValue.getEndpoint().getAdjustedEndpoint(15));
 			}
 		} else {
 			ASSERT(Ar::isDeserializing);
@@ -161,6 +167,8 @@ struct StorageServerInterface {
 		streams.push_back(getReadHotRanges.getReceiver());
 		streams.push_back(getRangeSplitPoints.getReceiver());
 		streams.push_back(getKeyValuesStream.getReceiver(TaskPriority::LoadBalancedEndpoint));
+		streams.push_back(getRangeAggregate.getReceiver(TaskPriority::LoadBalancedEndpoint));
+		streams.push_back(waitMetricsBatch.getReceiver());
 		FlowTransport::transport().addEndpoints(streams);
 	}
 };
@@ -336,6 +344,133 @@ struct GetKeyValuesStreamRequest {
 	}
 };
 
+// Aggregates of the key-value pairs in a range, or in one group of it. Values of at most 8 bytes are read as
+// little-endian integers, as atomic ADD encodes them, and summed with the same wrap-around.
+struct RangeAggregateRef {
+	KeyRef group; // Common prefix of the aggregated keys when grouping by tuple elements, otherwise empty
+	int64_t count = 0; // Number of keys
+	int64_t bytes = 0; // Total size of the keys and values
+	int64_t integerCount = 0; // Number of values read as integers, which sum, min and max are computed over
+	int64_t sum = 0;
+	int64_t min = std::numeric_limits<int64_t>::max();
+	int64_t max = std::numeric_limits<int64_t>::min();
+
+	RangeAggregateRef() = default;
+	explicit RangeAggregateRef(KeyRef group) : group(group) {}
+	RangeAggregateRef(Arena& arena, RangeAggregateRef const& rhs)
+	  : group(arena, rhs.group), count(rhs.count), bytes(rhs.bytes), integerCount(rhs.integerCount), sum(rhs.sum),
+	    min(rhs.min), max(rhs.max) {}
+
+	void add(KeyValueRef const& kv) {
+		++count;
+		bytes += kv.expectedSize();
+		if (kv.value.size() <= sizeof(int64_t)) {
+			uint64_t v = 0;
+			if (kv.value.size()) {
+				memcpy(&v, kv.value.begin(), kv.value.size());
+			}
+			++integerCount;
+			sum = static_cast<int64_t>(static_cast<uint64_t>(sum) + v);
+			min = std::min(min, static_cast<int64_t>(v));
+			max = std::max(max, static_cast<int64_t>(v));
+		}
+	}
+
+	void merge(RangeAggregateRef const& rhs) {
+		count += rhs.count;
+		bytes += rhs.bytes;
+		integerCount += rhs.integerCount;
+		sum = static_cast<int64_t>(static_cast<uint64_t>(sum) + static_cast<uint64_t>(rhs.sum));
+		min = std::min(min, rhs.min);
+		max = std::max(max, rhs.max);
+	}
+
+	bool operator==(RangeAggregateRef const& rhs) const {
+		return group == rhs.group && count == rhs.count && bytes == rhs.bytes && integerCount == rhs.integerCount &&
+		       sum == rhs.sum && min == rhs.min && max == rhs.max;
+	}
+	bool operator!=(RangeAggregateRef const& rhs) const { return !(*this == rhs); }
+
+	int expectedSize() const { return group.expectedSize(); }
+
+	std::string toString() const {
+		return format("%s: count=%lld bytes=%lld integers=%lld sum=%lld min=%lld max=%lld",
+		              group.printable().c_str(),
+		              count,
+		              bytes,
+		              integerCount,
+		              sum,
+		              min,
+		              max);
+	}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, group, count, bytes, integerCount, sum, min, max);
+	}
+};
+
+// Returns the group of key when aggregating by the first tupleElements tuple elements after its first prefixLength
+// bytes: the prefix of key up to the end of those elements. Keys with fewer elements, or that are not tuples, are their
+// own group.
+KeyRef rangeAggregateGroup(KeyRef key, int prefixLength, int tupleElements);
+
+struct GetRangeAggregateReply : public LoadBalancedReply {
+	constexpr static FileIdentifier file_identifier = 9327481;
+	Arena arena;
+	// In key order. Without grouping, a single aggregate unless the range is empty.
+	VectorRef<RangeAggregateRef> groups;
+	Version version;
+	bool more; // The storage server stopped early, and keys from readThrough on were not aggregated
+	KeyRef readThrough;
+	bool cached = false;
+
+	GetRangeAggregateReply() : version(invalidVersion), more(false) {}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar,
+		           LoadBalancedReply::penalty,
+		           LoadBalancedReply::error,
+		           groups,
+		           version,
+		           more,
+		           readThrough,
+		           cached,
+		           arena);
+	}
+};
+
+// Aggregates the key-value pairs of a range within one shard, optionally grouped as described by rangeAggregateGroup
+// when groupTupleElements is positive
+struct GetRangeAggregateRequest : TimedRequest {
+	constexpr static FileIdentifier file_identifier = 4570186;
+	SpanID spanContext;
+	Arena arena;
+	KeyRangeRef keys;
+	Version version;
+	int groupPrefixLength, groupTupleElements;
+	Optional<TagSet> tags;
+	Optional<UID> debugID;
+	ReplyPromise<GetRangeAggregateReply> reply;
+
+	GetRangeAggregateRequest() : version(invalidVersion), groupPrefixLength(0), groupTupleElements(0) {}
+	GetRangeAggregateRequest(SpanID spanContext,
+	                         KeyRangeRef const& keys,
+	                         Version version,
+	                         int groupPrefixLength,
+	                         int groupTupleElements,
+	                         Optional<TagSet> tags,
+	                         Optional<UID> debugID)
+	  : spanContext(spanContext), keys(arena, keys), version(version), groupPrefixLength(groupPrefixLength),
+	    groupTupleElements(groupTupleElements), tags(tags), debugID(debugID) {}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, keys, version, groupPrefixLength, groupTupleElements, tags, debugID, reply, spanContext, arena);
+	}
+};
+
 struct GetKeyReply : public LoadBalancedReply {
 	constexpr static FileIdentifier file_identifier = 11226513;
 	KeySelector sel;
@@ -502,6 +637,44 @@ struct WaitMetricsRequest {
 	}
 };
 
+struct WaitMetricsBatchReply {
+	constexpr static FileIdentifier file_identifier = 14329561;
+	// The indices in the request of the ranges whose metrics are out of their bounds, and their current metrics
+	std::vector<int> changed;
+	std::vector<StorageMetrics> metrics;
+	// The indices in the request of the ranges which are no longer readable on this server
+	std::vector<int> notReadable;
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, changed, metrics, notReadable);
+	}
+};
+
+struct WaitMetricsBatchRequest {
+	// Like a WaitMetricsRequest for each of the given ranges, so that the metrics of many shards on one storage server
+	// can be watched with a single request. Waits for the metrics of any range to leave its bounds, or for any range to
+	// become unreadable, and then returns all the ranges for which that has happened. Returns nothing on a timeout.
+	constexpr static FileIdentifier file_identifier = 6502388;
+	Arena arena;
+	VectorRef<KeyRangeRef> keys;
+	std::vector<StorageMetrics> min, max;
+	ReplyPromise<WaitMetricsBatchReply> reply;
+
+	WaitMetricsBatchRequest() {}
+
+	void addRange(KeyRangeRef const& range, StorageMetrics const& rangeMin, StorageMetrics const& rangeMax) {
+		keys.push_back_deep(arena, range);
+		min.push_back(rangeMin);
+		max.push_back(rangeMax);
+	}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, keys, min, max, reply, arena);
+	}
+};
+
 struct SplitMetricsReply {
 	constexpr static FileIdentifier file_identifier = 11530792;
 	Standalone<VectorRef<KeyRef>> splits;
@@ -623,12 +796,14 @@ struct GetStorageMetricsReply {
 	double bytesInputRate;
 	int64_t versionLag;
 	double lastUpdate;
+	double cpuUsage; // Percent of one core used by the storage process, or 0 if unknown
+	double queryRate; // Read requests per second
 
-	GetStorageMetricsReply() : bytesInputRate(0) {}
+	GetStorageMetricsReply() : bytesInputRate(0), cpuUsage(0), queryRate(0) {}
 
 	template <class Ar>
 	void serialize(Ar& ar) {
-		serializer(ar, load, available, capacity, bytesInputRate, versionLag, lastUpdate);
+		serializer(ar, load, available, capacity, bytesInputRate, versionLag, lastUpdate, cpuUsage, queryRate);
 	}
 };
 
@@ -656,6 +831,7 @@ struct StorageQueuingMetricsReply {
 	Optional<TransactionTag> busiestTag;
 	double busiestTagFractionalBusyness;
 	double busiestTagRate;
+	int64_t pendingCompactionBytes = 0; // See IKeyValueStore::getPendingCompactionBytes()
 
 	template <class Ar>
 	void serialize(Ar& ar) {
@@ -672,7 +848,8 @@ struct StorageQueuingMetricsReply {
 		           localRateLimit,
 		           busiestTag,
 		           busiestTagFractionalBusyness,
-		           busiestTagRate);
+		           busiestTagRate,
+		           pendingCompactionBytes);
 	}
 };
 
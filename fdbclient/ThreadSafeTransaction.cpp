@@ -257,6 +257,13 @@ ThreadFuture<RangeResult> ThreadSafeTransaction::getRange(const KeySelectorRef&
 	});
 }
 
+Reference<IRangeStream> ThreadSafeTransaction::getRangeStream(const KeySelectorRef& begin,
+                                                              const KeySelectorRef& end,
+                                                              bool snapshot,
+                                                              int64_t bufferBytes) {
+	return makeReference<ThreadSafeRangeStream>(tr, begin, end, snapshot, bufferBytes);
+}
+
 ThreadFuture<Standalone<VectorRef<const char*>>> ThreadSafeTransaction::getAddressesForKey(const KeyRef& key) {
 	Key k = key;
 
@@ -390,6 +397,55 @@ ThreadFuture<Void> ThreadSafeTransaction::checkDeferredError() {
 	});
 }
 
+ThreadSafeRangeStream::ThreadSafeRangeStream(ISingleThreadTransaction* tr,
+                                             KeySelector begin,
+                                             KeySelector end,
+                                             bool snapshot,
+                                             int64_t bufferBytes)
+  : state(new StreamState) {
+	// The transaction outlives this call, and its destruction is queued on the network thread after this
+	StreamState* state = this->state;
+	onMainThreadVoid(
+	    [tr, state, begin, end, snapshot, bufferBytes]() {
+		    PromiseStream<RangeResult> results;
+		    state->results = results.getFuture();
+		    try {
+			    tr->checkDeferredError();
+			    state->stream =
+			        forwardErrors(tr->getRangeStream(results, begin, end, Snapshot{ snapshot }, bufferBytes), results);
+		    } catch (Error& e) {
+			    results.sendError(e);
+		    }
+	    },
+	    nullptr);
+}
+
+ThreadSafeRangeStream::~ThreadSafeRangeStream() {
+	StreamState* state = this->state;
+	onMainThreadVoid([state]() { delete state; }, nullptr);
+}
+
+ThreadFuture<RangeResult> ThreadSafeRangeStream::next() {
+	StreamState* state = this->state;
+	return onMainThread([state]() -> Future<RangeResult> {
+		// A batch whose future was abandoned before it was ready is handed out again rather than lost
+		if (!state->pending.isValid() || state->pending.isReady()) {
+			state->pending = map(errorOr(waitAndForward(state->results)), [](ErrorOr<RangeResult> result) {
+				if (result.isError()) {
+					if (result.getError().code() == error_code_end_of_stream) {
+						return RangeResult();
+					}
+					throw result.getError();
+				}
+				RangeResult r = result.get();
+				r.more = true;
+				return r;
+			});
+		}
+		return state->pending;
+	});
+}
+
 ThreadFuture<Void> ThreadSafeTransaction::onError(Error const& e) {
 	ISingleThreadTransaction* tr = this->tr;
 	return onMainThread([tr, e]() { return tr->onError(e); });
@@ -68,6 +68,31 @@ public: // Internal use only
 	DatabaseContext* unsafeGetPtr() const { return db; }
 };
 
+// An implementation of IRangeStream that runs a range stream of an ISingleThreadTransaction on the network thread
+class ThreadSafeRangeStream : public IRangeStream, ThreadSafeReferenceCounted<ThreadSafeRangeStream>, NonCopyable {
+public:
+	ThreadSafeRangeStream(ISingleThreadTransaction* tr,
+	                      KeySelector begin,
+	                      KeySelector end,
+	                      bool snapshot,
+	                      int64_t bufferBytes);
+	~ThreadSafeRangeStream() override;
+
+	ThreadFuture<RangeResult> next() override;
+
+	void addref() override { ThreadSafeReferenceCounted<ThreadSafeRangeStream>::addref(); }
+	void delref() override { ThreadSafeReferenceCounted<ThreadSafeRangeStream>::delref(); }
+
+private:
+	// Only accessed on the network thread, and holds nothing allocated until it gets there
+	struct StreamState {
+		FutureStream<RangeResult> results;
+		Future<Void> stream;
+		Future<RangeResult> pending;
+	};
+	StreamState* state;
+};
+
 // An implementation of ITransaction that serializes operations onto the network thread and interacts with the
 // lower-level client APIs exposed by ISingleThreadTransaction
 class ThreadSafeTransaction : public ITransaction, ThreadSafeReferenceCounted<ThreadSafeTransaction>, NonCopyable {
@@ -106,6 +131,10 @@ public:
 	                                   bool reverse = false) override {
 		return getRange(firstGreaterOrEqual(keys.begin), firstGreaterOrEqual(keys.end), limits, snapshot, reverse);
 	}
+	Reference<IRangeStream> getRangeStream(const KeySelectorRef& begin,
+	                                       const KeySelectorRef& end,
+	                                       bool snapshot,
+	                                       int64_t bufferBytes) override;
 	ThreadFuture<Standalone<VectorRef<const char*>>> getAddressesForKey(const KeyRef& key) override;
 	ThreadFuture<Standalone<StringRef>> getVersionstamp() override;
 	ThreadFuture<int64_t> getEstimatedRangeSizeBytes(const KeyRangeRef& keys) override;
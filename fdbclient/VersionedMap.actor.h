@@ -31,6 +31,8 @@
 #include "flow/flow.h"
 #include "flow/actorcompiler.h" // This must be the last #include.
 
+// Destroys the trees in toFree a few nodes at a time.  releaseChildren(tree, toFree) is found by argument dependent
+// lookup and must move onto toFree any child references that are the last reference to their node.
 ACTOR template <class Tree>
 Future<Void> deferredCleanupActor(std::vector<Tree> toFree, TaskPriority taskID = TaskPriority::DefaultYield) {
 	state int freeCount = 0;
@@ -38,10 +40,7 @@ Future<Void> deferredCleanupActor(std::vector<Tree> toFree, TaskPriority taskID
 		Tree a = std::move(toFree.back());
 		toFree.pop_back();
 
-		for (int c = 0; c < 3; c++) {
-			if (a->pointer[c] && a->pointer[c]->isSoleOwner())
-				toFree.push_back(std::move(a->pointer[c]));
-		}
+		releaseChildren(a, toFree);
 
 		if (++freeCount % 100 == 0)
 			wait(yield(taskID));
@@ -1,10 +1,11 @@
 #include "fdbclient/VersionedMap.h"
+#include "fdbclient/BTreeVersionedMap.h"
 #include "flow/TreeBenchmark.h"
 #include "flow/UnitTest.h"
 
-template <typename K>
+template <typename K, template <class, class> class Map = VersionedMap>
 struct VersionedMapHarness {
-	using map = VersionedMap<K, int>;
+	using map = Map<K, int>;
 	using key_type = K;
 
 	struct result {
@@ -54,4 +55,113 @@ TEST_CASE("performance/map/StringRef/VersionedMap") {
 	return Void();
 }
 
+TEST_CASE("performance/map/int/BTreeVersionedMap") {
+	VersionedMapHarness<int, BTreeVersionedMap> tree;
+
+	treeBenchmark(tree, *randomInt);
+
+	return Void();
+}
+
+TEST_CASE("performance/map/StringRef/BTreeVersionedMap") {
+	Arena arena;
+	VersionedMapHarness<StringRef, BTreeVersionedMap> tree;
+
+	treeBenchmark(tree, [&arena]() { return randomStr(arena); });
+
+	return Void();
+}
+
+// Checks every entry of view against the model, in both directions, and a few random seeks
+template <class View>
+static void checkView(View const& view, std::map<int, std::pair<int, Version>> const& model) {
+	auto i = view.begin();
+	for (auto const& [k, v] : model) {
+		ASSERT(i && i.key() == k && *i == v.first && i.insertVersion() == v.second);
+		++i;
+	}
+	ASSERT(i == view.end());
+
+	i = view.end();
+	for (auto m = model.rbegin(); m != model.rend(); ++m) {
+		--i;
+		ASSERT(i && i.key() == m->first);
+	}
+	--i;
+	ASSERT(!i);
+
+	for (int s = 0; s < 20; s++) {
+		int k = deterministicRandom()->randomInt(-10, 1010);
+		auto m = model.lower_bound(k);
+		auto lb = view.lower_bound(k);
+		ASSERT(m == model.end() ? !lb : lb && lb.key() == m->first);
+
+		m = model.upper_bound(k);
+		auto ub = view.upper_bound(k);
+		ASSERT(m == model.end() ? !ub : ub && ub.key() == m->first);
+
+		auto lle = view.lastLessOrEqual(k);
+		ASSERT(m == model.begin() ? !lle : lle && lle.key() == std::prev(m)->first);
+
+		ASSERT((view.find(k) != view.end()) == (model.count(k) != 0));
+	}
+}
+
+TEST_CASE("/fdbclient/BTreeVersionedMap/randomized") {
+	BTreeVersionedMap<int, int> vm;
+	std::map<Version, std::map<int, std::pair<int, Version>>> models;
+	std::map<int, std::pair<int, Version>> latest;
+	std::vector<Future<Void>> cleanups;
+
+	// A small key space keeps the tree dense enough that inserts, range clears and merges all interact
+	int keySpace = deterministicRandom()->randomInt(10, 1000);
+	for (Version v = 1; v <= 300; v++) {
+		vm.createNewVersion(v);
+		int ops = deterministicRandom()->coinflip() ? deterministicRandom()->randomInt(0, 4)
+		                                            : deterministicRandom()->randomInt(0, 300);
+		for (int o = 0; o < ops; o++) {
+			int k = deterministicRandom()->randomInt(0, keySpace);
+			int r = deterministicRandom()->randomInt(0, 10);
+			if (r < 6) {
+				vm.insert(k, o);
+				latest[k] = std::make_pair(o, v);
+			} else if (r < 8) {
+				int e = k + deterministicRandom()->randomInt(0, keySpace / 4 + 2);
+				vm.erase(k, e);
+				latest.erase(latest.lower_bound(k), latest.lower_bound(e));
+			} else if (latest.count(k)) {
+				if (deterministicRandom()->coinflip()) {
+					vm.erase(k);
+				} else {
+					vm.erase(vm.atLatest().find(k));
+				}
+				latest.erase(k);
+			}
+		}
+		models[v] = latest;
+		ASSERT(vm.atLatest().validate() == latest.size());
+
+		if (deterministicRandom()->random01() < 0.1) {
+			Version oldest = deterministicRandom()->randomInt(vm.getOldestVersion(), v + 1);
+			if (deterministicRandom()->coinflip()) {
+				vm.forgetVersionsBefore(oldest);
+			} else {
+				cleanups.push_back(vm.forgetVersionsBeforeAsync(oldest));
+			}
+			models.erase(models.begin(), models.lower_bound(oldest));
+		}
+
+		// Every version that has not been forgotten must be unaffected by later mutations
+		for (int c = 0; c < 3; c++) {
+			auto m = models.lower_bound(deterministicRandom()->randomInt(vm.getOldestVersion(), v + 1));
+			if (m != models.end()) {
+				ASSERT(vm.at(m->first).validate() == m->second.size());
+				checkView(vm.at(m->first), m->second);
+			}
+		}
+	}
+
+	return waitForAll(cleanups);
+}
+
 void forceLinkVersionedMapTests() {}
@@ -568,6 +568,14 @@ void check(const Reference<PTree<T>>& p) {
 	}
 }
 
+template <class T>
+void releaseChildren(Reference<PTree<T>>& p, std::vector<Reference<PTree<T>>>& toFree) {
+	for (int c = 0; c < 3; c++) {
+		if (p->pointer[c] && p->pointer[c]->isSoleOwner())
+			toFree.push_back(std::move(p->pointer[c]));
+	}
+}
+
 // Remove pointers to any child nodes that have been updated at or before the given version
 // This essentially gets rid of node versions that will never be read (beyond 5s worth of versions)
 // TODO look into making this per-version compaction. (We could keep track of updated nodes at each version for example)
@@ -596,6 +604,8 @@ void compact(Reference<PTree<T>>& p, Version newOldestVersion) {
 
 class ValueOrClearToRef {
 public:
+	ValueOrClearToRef() : isClear(false) {}
+
 	static ValueOrClearToRef value(ValueRef const& v) { return ValueOrClearToRef(v, false); }
 	static ValueOrClearToRef clearTo(KeyRef const& k) { return ValueOrClearToRef(k, true); }
 
@@ -66,6 +66,7 @@ void applyMetadataMutations(SpanID const& spanContext,
                             std::map<UID, Reference<StorageInfo>>* storageCache,
                             std::map<Tag, Version>* tag_popped,
                             std::unordered_map<UID, StorageServerInterface>* tssMapping,
+                            KeyServersChangeLog* keyServersChanges,
                             bool initialCommit // true if the mutations were already written to the txnStateStore as part of recovery
 ) {
 	// std::map<keyRef, vector<uint16_t>> cacheRangeInfo;
@@ -120,6 +121,9 @@ void applyMetadataMutations(SpanID const& spanContext,
 						}
 						uniquify(info.tags);
 						keyInfo->insert(insertRange, info);
+						if (keyServersChanges) {
+							keyServersChanges->add(insertRange);
+						}
 					}
 				}
 				if (!initialCommit)
@@ -421,6 +425,9 @@ void applyMetadataMutations(SpanID const& spanContext,
 					                clearRange.begin == StringRef()
 					                    ? ServerCacheInfo()
 					                    : keyInfo->rangeContainingKeyBefore(clearRange.begin).value());
+					if (keyServersChanges) {
+						keyServersChanges->add(clearRange);
+					}
 				}
 
 				if (!initialCommit)
@@ -823,6 +830,7 @@ void applyMetadataMutations(SpanID const& spanContext,
 	                       &proxyCommitData.storageCache,
 	                       &proxyCommitData.tag_popped,
 	                       &proxyCommitData.tssMapping,
+	                       &proxyCommitData.keyServersChanges,
 	                       initialCommit);
 }
 
@@ -853,5 +861,6 @@ void applyMetadataMutations(SpanID const& spanContext,
 	                       /* storageCache= */ nullptr,
 	                       /* tag_popped= */ nullptr,
 	                       /* tssMapping= */ nullptr,
+	                       /* keyServersChanges= */ nullptr,
 	                       /* initialCommit= */ false);
 }
@@ -140,6 +140,7 @@ public:
 		--iPrevious;
 		if (iPrevious.mutation().clearAfterBoundary) {
 			ib.mutation().clearAll();
+			iPrevious.mutation().splitSortedRecords(boundary, ib.mutation());
 		}
 		return ib;
 	}
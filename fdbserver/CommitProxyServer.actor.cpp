@@ -19,6 +19,7 @@
  */
 
 #include <algorithm>
+#include <numeric>
 #include <tuple>
 
 #include <fdbclient/DatabaseContext.h>
@@ -195,6 +196,15 @@ struct ResolutionRequestBuilder {
 	}
 };
 
+// Ready when the proxy's current version lease expires, unless a batch was already sent for it
+Future<Void> leaseExpiryFlush(ProxyCommitData* commitData, double flushedLeaseExpiry) {
+	double expiry = commitData->leaseExpiry.get();
+	if (expiry <= 0 || expiry == flushedLeaseExpiry) {
+		return Never();
+	}
+	return delayUntil(expiry, TaskPriority::ProxyCommitBatcher);
+}
+
 ACTOR Future<Void> commitBatcher(ProxyCommitData* commitData,
                                  PromiseStream<std::pair<std::vector<CommitTransactionRequest>, int>> out,
                                  FutureStream<CommitTransactionRequest> in,
@@ -203,11 +213,16 @@ ACTOR Future<Void> commitBatcher(ProxyCommitData* commitData,
 	wait(delayJittered(commitData->commitBatchInterval, TaskPriority::ProxyCommitBatcher));
 
 	state double lastBatch = 0;
+	state double flushedLeaseExpiry = 0;
 
 	loop {
 		state Future<Void> timeout;
+		state Future<Void> leaseExpired;
 		state std::vector<CommitTransactionRequest> batch;
 		state int batchBytes = 0;
+		// The batch size limits, which are reduced to meet COMMIT_TRANSACTION_BATCH_TARGET_LATENCY
+		state int countLimit = commitData->commitBatchController.countLimit();
+		state int bytesLimit = commitData->commitBatchController.bytesLimit(desiredBytes);
 
 		if (SERVER_KNOBS->MAX_COMMIT_BATCH_INTERVAL <= 0) {
 			timeout = Never();
@@ -215,8 +230,12 @@ ACTOR Future<Void> commitBatcher(ProxyCommitData* commitData,
 			timeout = delayJittered(SERVER_KNOBS->MAX_COMMIT_BATCH_INTERVAL, TaskPriority::ProxyCommitBatcher);
 		}
 
-		while (!timeout.isReady() &&
-		       !(batch.size() == SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_COUNT_MAX || batchBytes >= desiredBytes)) {
+		// Other proxies' commits wait for the end of our version lease, so send a batch, even an empty one, to commit
+		// it as soon as the lease expires
+		leaseExpired = leaseExpiryFlush(commitData, flushedLeaseExpiry);
+
+		while (!timeout.isReady() && !leaseExpired.isReady() &&
+		       !(batch.size() >= countLimit || batchBytes >= bytesLimit)) {
 			choose {
 				when(CommitTransactionRequest req = waitNext(in)) {
 					// WARNING: this code is run at a high priority, so it needs to do as little work as possible
@@ -269,8 +288,16 @@ ACTOR Future<Void> commitBatcher(ProxyCommitData* commitData,
 					commitData->commitBatchesMemBytesCount += bytes;
 				}
 				when(wait(timeout)) {}
+				when(wait(leaseExpired)) {}
+				when(wait(commitData->leaseExpiry.onChange())) {
+					leaseExpired = leaseExpiryFlush(commitData, flushedLeaseExpiry);
+				}
 			}
 		}
+		if (leaseExpired.isReady()) {
+			TEST(batch.empty()); // Empty commit batch sent at version lease expiry
+			flushedLeaseExpiry = commitData->leaseExpiry.get();
+		}
 		out.send({ std::move(batch), batchBytes });
 		lastBatch = now();
 	}
@@ -474,12 +501,23 @@ struct CommitBatchContext {
 	int transactionNum = 0;
 	int yieldBytes = 0;
 
+	// The shard of each single key mutation of the committed transactions, in commit order, and whether the shard is
+	// cached.  Looked up for the whole batch at once by lookupMutationShards().
+	std::vector<ServerCacheInfo*> mutationShards;
+	std::vector<bool*> mutationCached;
+	int singleKeyMutationNum = 0;
+
 	LogSystemDiskQueueAdapter::CommitMessage msg;
 
 	Future<Version> loggingComplete;
 
 	double commitStartTime;
 
+	// Latencies of the phases of the batch: waiting for the commit version, resolution, and logging
+	double versionLatency = 0;
+	double resolutionLatency = 0;
+	double loggingLatency = 0;
+
 	CommitBatchContext(ProxyCommitData*, const std::vector<CommitTransactionRequest>*, const int);
 
 	void setupTraceBatch();
@@ -617,26 +655,49 @@ ACTOR Future<Void> preresolutionProcessing(CommitBatchContext* self) {
 		    "CommitDebug", debugID.get().first(), "CommitProxyServer.commitBatch.GettingCommitVersion");
 	}
 
-	GetCommitVersionRequest req(span.context,
-	                            pProxyCommitData->commitVersionRequestNumber++,
-	                            pProxyCommitData->mostRecentProcessedRequestNumber,
-	                            pProxyCommitData->dbgid);
-	GetCommitVersionReply versionReply = wait(brokenPromiseToNever(
-	    pProxyCommitData->master.getCommitVersion.getReply(req, TaskPriority::ProxyMasterVersionReply)));
+	if (pProxyCommitData->leaseEnd != invalidVersion) {
+		// Assign the next version of our lease without asking the master, keeping pace with the master's clock so
+		// that leaseEnd is reached when the lease expires
+		TEST(true); // Commit version assigned from lease
+		self->prevVersion = pProxyCommitData->leasePrevVersion;
+		double remaining = std::max(0.0, pProxyCommitData->leaseExpiry.get() - now());
+		self->commitVersion = std::max<Version>(
+		    self->prevVersion + 1,
+		    pProxyCommitData->leaseEnd - Version(remaining * SERVER_KNOBS->VERSIONS_PER_SECOND));
+		pProxyCommitData->leasePrevVersion = self->commitVersion;
+		if (self->commitVersion == pProxyCommitData->leaseEnd) {
+			pProxyCommitData->leaseEnd = invalidVersion;
+			pProxyCommitData->leaseExpiry.set(0);
+		}
+	} else {
+		GetCommitVersionRequest req(span.context,
+		                            pProxyCommitData->commitVersionRequestNumber++,
+		                            pProxyCommitData->mostRecentProcessedRequestNumber,
+		                            pProxyCommitData->dbgid);
+		GetCommitVersionReply versionReply = wait(brokenPromiseToNever(
+		    pProxyCommitData->master.getCommitVersion.getReply(req, TaskPriority::ProxyMasterVersionReply)));
+
+		pProxyCommitData->mostRecentProcessedRequestNumber = versionReply.requestNum;
+
+		self->commitVersion = versionReply.version;
+		self->prevVersion = versionReply.prevVersion;
+
+		if (versionReply.leaseEnd != invalidVersion) {
+			ASSERT(versionReply.leaseEnd > versionReply.version);
+			pProxyCommitData->leasePrevVersion = versionReply.version;
+			pProxyCommitData->leaseEnd = versionReply.leaseEnd;
+			pProxyCommitData->leaseExpiry.set(now() + versionReply.leaseDuration);
+		}
 
-	pProxyCommitData->mostRecentProcessedRequestNumber = versionReply.requestNum;
+		for (auto it : versionReply.resolverChanges) {
+			auto rs = pProxyCommitData->keyResolvers.modify(it.range);
+			for (auto r = rs.begin(); r != rs.end(); ++r)
+				r->value().emplace_back(versionReply.resolverChangesVersion, it.dest);
+		}
+	}
 
 	pProxyCommitData->stats.txnCommitVersionAssigned += trs.size();
-	pProxyCommitData->stats.lastCommitVersionAssigned = versionReply.version;
-
-	self->commitVersion = versionReply.version;
-	self->prevVersion = versionReply.prevVersion;
-
-	for (auto it : versionReply.resolverChanges) {
-		auto rs = pProxyCommitData->keyResolvers.modify(it.range);
-		for (auto r = rs.begin(); r != rs.end(); ++r)
-			r->value().emplace_back(versionReply.resolverChangesVersion, it.dest);
-	}
+	pProxyCommitData->stats.lastCommitVersionAssigned = self->commitVersion;
 
 	//TraceEvent("ProxyGotVer", pProxyContext->dbgid).detail("Commit", commitVersion).detail("Prev", prevVersion);
 
@@ -873,12 +934,40 @@ ACTOR Future<Void> applyMetadataToCommittedTransactions(CommitBatchContext* self
 	return Void();
 }
 
+/// Looks up the shards of all single key mutations in the batch by sorting their keys and sweeping keyInfo and
+/// cacheInfo once, which is much cheaper than searching both maps for each mutation of a large batch.
+void lookupMutationShards(CommitBatchContext* self) {
+	ProxyCommitData* const pProxyCommitData = self->pProxyCommitData;
+	std::vector<KeyRef> keys;
+	for (int t = 0; t < self->trs.size(); t++) {
+		if (!(self->committed[t] == ConflictBatch::TransactionCommitted &&
+		      (!self->locked || self->trs[t].isLockAware()))) {
+			continue;
+		}
+		for (auto const& m : self->trs[t].transaction.mutations) {
+			if (isSingleKeyMutation((MutationRef::Type)m.type)) {
+				keys.push_back(m.param1);
+			}
+		}
+	}
+
+	std::vector<int> order(keys.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&keys](int a, int b) { return keys[a] < keys[b]; });
+
+	pProxyCommitData->keyInfo.lookupSorted(keys, order, self->mutationShards);
+	pProxyCommitData->cacheInfo.lookupSorted(keys, order, self->mutationCached);
+	self->singleKeyMutationNum = 0;
+}
+
 /// This second pass through committed transactions assigns the actual mutations to the appropriate storage servers'
 /// tags
 ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 	state ProxyCommitData* const pProxyCommitData = self->pProxyCommitData;
 	state std::vector<CommitTransactionRequest>& trs = self->trs;
 
+	lookupMutationShards(self);
+
 	for (; self->transactionNum < trs.size(); self->transactionNum++) {
 		if (!(self->committed[self->transactionNum] == ConflictBatch::TransactionCommitted &&
 		      (!self->locked || trs[self->transactionNum].isLockAware()))) {
@@ -910,7 +999,11 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 			// if necessary.  Serialize (splits of) the mutation into the message buffer and add the tags.
 
 			if (isSingleKeyMutation((MutationRef::Type)m.type)) {
-				auto& tags = pProxyCommitData->tagsForKey(m.param1);
+				ServerCacheInfo* shard = self->mutationShards[self->singleKeyMutationNum];
+				bool cached = *self->mutationCached[self->singleKeyMutationNum];
+				self->singleKeyMutationNum++;
+				shard->populateTags();
+				auto& tags = shard->tags;
 
 				// sample single key mutation based on cost
 				// the expectation of sampling is every COMMIT_SAMPLE_COST sample once
@@ -922,7 +1015,7 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 					double prob = mul * cost / totalCosts;
 
 					if (deterministicRandom()->random01() < prob) {
-						for (const auto& ssInfo : pProxyCommitData->keyInfo[m.param1].src_info) {
+						for (const auto& ssInfo : shard->src_info) {
 							auto id = ssInfo->interf.id();
 							// scale cost
 							cost = cost < CLIENT_KNOBS->COMMIT_SAMPLE_COST ? CLIENT_KNOBS->COMMIT_SAMPLE_COST : cost;
@@ -946,7 +1039,7 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 				    .detail("To", tags)
 				    .detail("Mutation", m);
 				self->toCommit.addTags(tags);
-				if (pProxyCommitData->cacheInfo[m.param1]) {
+				if (cached) {
 					self->toCommit.addTag(cacheTag);
 				}
 				self->toCommit.writeTypedMessage(m);
@@ -977,10 +1070,10 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 					}
 				} else {
 					TEST(true); // A clear range extends past a shard boundary
-					std::set<Tag> allSources;
+					std::vector<Tag> allSources;
 					for (auto r : ranges) {
 						r.value().populateTags();
-						allSources.insert(r.value().tags.begin(), r.value().tags.end());
+						allSources.insert(allSources.end(), r.value().tags.begin(), r.value().tags.end());
 
 						// check whether clear is sampled
 						if (checkSample && !trCost->get().clearIdxCosts.empty() &&
@@ -995,6 +1088,7 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 							trCost->get().clearIdxCosts.pop_front();
 						}
 					}
+					uniquify(allSources);
 					DEBUG_MUTATION("ProxyCommit", self->commitVersion, m)
 					    .detail("Dbgid", pProxyCommitData->dbgid)
 					    .detail("To", allSources)
@@ -1374,16 +1468,27 @@ ACTOR Future<Void> reply(CommitBatchContext* self) {
 	}
 
 	// Dynamic batching for commits
-	double target_latency =
-	    (now() - self->startTime) * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_LATENCY_FRACTION;
-	pProxyCommitData->commitBatchInterval =
-	    std::max(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN,
-	             std::min(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MAX,
-	                      target_latency * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA +
-	                          pProxyCommitData->commitBatchInterval *
-	                              (1 - SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA)));
+	pProxyCommitData->stats.commitVersionLatency.addMeasurement(self->versionLatency);
+	pProxyCommitData->stats.commitResolutionLatency.addMeasurement(self->resolutionLatency);
+	pProxyCommitData->stats.commitLoggingLatency.addMeasurement(self->loggingLatency);
+	if (SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_TARGET_LATENCY > 0) {
+		pProxyCommitData->commitBatchInterval = pProxyCommitData->commitBatchController.update(
+		    self->versionLatency, self->resolutionLatency, self->loggingLatency);
+	} else {
+		double target_latency =
+		    (now() - self->startTime) * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_LATENCY_FRACTION;
+		pProxyCommitData->commitBatchInterval =
+		    std::max(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN,
+		             std::min(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MAX,
+		                      target_latency * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA +
+		                          pProxyCommitData->commitBatchInterval *
+		                              (1 - SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA)));
+		pProxyCommitData->commitBatchController.sizeFraction = 1.0;
+	}
 
 	pProxyCommitData->stats.commitBatchingWindowSize.addMeasurement(pProxyCommitData->commitBatchInterval);
+	pProxyCommitData->stats.commitBatchingSizeFraction.addMeasurement(
+	    pProxyCommitData->commitBatchController.sizeFraction);
 	pProxyCommitData->commitBatchesMemBytesCount -= self->currentBatchMemBytesCount;
 	ASSERT_ABORT(pProxyCommitData->commitBatchesMemBytesCount >= 0);
 	wait(self->releaseFuture);
@@ -1411,21 +1516,27 @@ ACTOR Future<Void> commitBatch(ProxyCommitData* self,
 
 	/////// Phase 1: Pre-resolution processing (CPU bound except waiting for a version # which is separately pipelined
 	/// and *should* be available by now (unless empty commit); ordered; currently atomic but could yield)
+	state double phaseStart = now();
 	wait(CommitBatch::preresolutionProcessing(&context));
 	if (context.rejected) {
 		self->commitBatchesMemBytesCount -= currentBatchMemBytesCount;
 		return Void();
 	}
+	context.versionLatency = now() - phaseStart;
 
 	/////// Phase 2: Resolution (waiting on the network; pipelined)
+	phaseStart = now();
 	wait(CommitBatch::getResolution(&context));
+	context.resolutionLatency = now() - phaseStart;
 
 	////// Phase 3: Post-resolution processing (CPU bound except for very rare situations; ordered; currently atomic but
 	/// doesn't need to be)
+	phaseStart = now();
 	wait(CommitBatch::postResolution(&context));
 
 	/////// Phase 4: Logging (network bound; pipelined up to MAX_READ_TRANSACTION_LIFE_VERSIONS (limited by loop above))
 	wait(CommitBatch::transactionLogging(&context));
+	context.loggingLatency = now() - phaseStart;
 
 	/////// Phase 5: Replies (CPU bound; no particular order required, though ordered execution would be best for
 	/// latency)
@@ -1448,6 +1559,21 @@ void maybeAddTssMapping(GetKeyServerLocationsReply& reply,
 	}
 }
 
+// Adds the source storage servers of one keyInfo range to the reply
+void addKeyServerLocation(GetKeyServerLocationsReply& reply,
+                          ProxyCommitData* commitData,
+                          std::unordered_set<UID>& tssMappingsIncluded,
+                          KeyRangeRef range,
+                          ServerCacheInfo const& info) {
+	vector<StorageServerInterface> ssis;
+	ssis.reserve(info.src_info.size());
+	for (auto& it : info.src_info) {
+		ssis.push_back(it->interf);
+		maybeAddTssMapping(reply, commitData, tssMappingsIncluded, it->interf.id());
+	}
+	reply.results.emplace_back(range, ssis);
+}
+
 ACTOR static Future<Void> doKeyServerLocationRequest(GetKeyServerLocationsRequest req, ProxyCommitData* commitData) {
 	// We can't respond to these requests until we have valid txnStateStore
 	wait(commitData->validState.getFuture());
@@ -1458,38 +1584,20 @@ ACTOR static Future<Void> doKeyServerLocationRequest(GetKeyServerLocationsReques
 	if (!req.end.present()) {
 		auto r = req.reverse ? commitData->keyInfo.rangeContainingKeyBefore(req.begin)
 		                     : commitData->keyInfo.rangeContaining(req.begin);
-		vector<StorageServerInterface> ssis;
-		ssis.reserve(r.value().src_info.size());
-		for (auto& it : r.value().src_info) {
-			ssis.push_back(it->interf);
-			maybeAddTssMapping(rep, commitData, tssMappingsIncluded, it->interf.id());
-		}
-		rep.results.emplace_back(r.range(), ssis);
+		addKeyServerLocation(rep, commitData, tssMappingsIncluded, r.range(), r.value());
 	} else if (!req.reverse) {
 		int count = 0;
 		for (auto r = commitData->keyInfo.rangeContaining(req.begin);
 		     r != commitData->keyInfo.ranges().end() && count < req.limit && r.begin() < req.end.get();
 		     ++r) {
-			vector<StorageServerInterface> ssis;
-			ssis.reserve(r.value().src_info.size());
-			for (auto& it : r.value().src_info) {
-				ssis.push_back(it->interf);
-				maybeAddTssMapping(rep, commitData, tssMappingsIncluded, it->interf.id());
-			}
-			rep.results.emplace_back(r.range(), ssis);
+			addKeyServerLocation(rep, commitData, tssMappingsIncluded, r.range(), r.value());
 			count++;
 		}
 	} else {
 		int count = 0;
 		auto r = commitData->keyInfo.rangeContainingKeyBefore(req.end.get());
 		while (count < req.limit && req.begin < r.end()) {
-			vector<StorageServerInterface> ssis;
-			ssis.reserve(r.value().src_info.size());
-			for (auto& it : r.value().src_info) {
-				ssis.push_back(it->interf);
-				maybeAddTssMapping(rep, commitData, tssMappingsIncluded, it->interf.id());
-			}
-			rep.results.emplace_back(r.range(), ssis);
+			addKeyServerLocation(rep, commitData, tssMappingsIncluded, r.range(), r.value());
 			if (r == commitData->keyInfo.ranges().begin()) {
 				break;
 			}
@@ -1521,6 +1629,66 @@ ACTOR static Future<Void> readRequestServer(CommitProxyInterface proxy,
 	}
 }
 
+ACTOR static Future<Void> doKeyServersChangesRequest(KeyServersChangesRequest req, ProxyCommitData* commitData) {
+	state KeyServersChangeLog* changeLog = &commitData->keyServersChanges;
+	wait(commitData->validState.getFuture());
+
+	if (req.changeLogId == changeLog->id && req.position == changeLog->end) {
+		choose {
+			when(wait(changeLog->onChange.onTrigger())) {}
+			when(wait(delay(SERVER_KNOBS->KEY_SERVERS_CHANGES_TIMEOUT))) {}
+		}
+	}
+	// Waiters are woken while metadata mutations are being applied, so yield before reading keyInfo
+	wait(delay(0, TaskPriority::DefaultEndpoint));
+
+	KeyServersChangesReply rep;
+	rep.changeLogId = changeLog->id;
+	if (req.changeLogId != changeLog->id || req.position < changeLog->begin() || req.position > changeLog->end) {
+		rep.reset = true;
+		rep.position = changeLog->end;
+	} else {
+		std::unordered_set<UID> tssMappingsIncluded;
+		int64_t position = req.position;
+		for (; position < changeLog->end &&
+		       rep.locations.results.size() < SERVER_KNOBS->KEY_SERVERS_CHANGES_REPLY_LIMIT;
+		     ++position) {
+			KeyRangeRef changed = changeLog->changes[position - changeLog->begin()];
+			for (auto r : commitData->keyInfo.intersectingRanges(changed)) {
+				// Consecutive changes to one shard (e.g. the start and end of a move) only need to be returned once
+				if (!rep.locations.results.empty() && rep.locations.results.back().first == r.range()) {
+					continue;
+				}
+				addKeyServerLocation(rep.locations, commitData, tssMappingsIncluded, r.range(), r.value());
+			}
+		}
+		rep.position = position;
+	}
+	req.reply.send(rep);
+	return Void();
+}
+
+ACTOR static Future<Void> keyServersChangesServer(CommitProxyInterface proxy,
+                                                  PromiseStream<Future<Void>> addActor,
+                                                  ProxyCommitData* commitData) {
+	loop {
+		KeyServersChangesRequest req = waitNext(proxy.getKeyServersChanges.getFuture());
+		addActor.send(doKeyServersChangesRequest(req, commitData));
+	}
+}
+
+// Feeds the transactions of coalesced client commits to the commit batcher one at a time, so that each of them is
+// resolved, assigned a versionstamp and replied to as if the client had sent it on its own
+ACTOR static Future<Void> commitBatchServer(CommitProxyInterface proxy, ProxyCommitData* commitData) {
+	loop {
+		CommitTransactionBatchRequest req = waitNext(proxy.commitBatch.getFuture());
+		++commitData->stats.coalescedCommitsIn;
+		for (auto& tr : req.transactions) {
+			proxy.commit.send(std::move(tr));
+		}
+	}
+}
+
 ACTOR static Future<Void> rejoinServer(CommitProxyInterface proxy, ProxyCommitData* commitData) {
 	// We can't respond to these requests until we have valid txnStateStore
 	wait(commitData->validState.getFuture());
@@ -1882,6 +2050,8 @@ ACTOR Future<Void> commitProxyServerCore(CommitProxyInterface proxy,
 
 	addActor.send(monitorRemoteCommitted(&commitData));
 	addActor.send(readRequestServer(proxy, addActor, &commitData));
+	addActor.send(keyServersChangesServer(proxy, addActor, &commitData));
+	addActor.send(commitBatchServer(proxy, &commitData));
 	addActor.send(rejoinServer(proxy, &commitData));
 	addActor.send(ddMetricsRequestServer(proxy, db));
 	addActor.send(reportTxnTagCommitCost(proxy.id(), db, &commitData.ssTrTagCommitCost));
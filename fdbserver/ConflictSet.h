@@ -30,6 +30,7 @@
 struct ConflictSet;
 ConflictSet* newConflictSet();
 void clearConflictSet(ConflictSet*, Version);
+int64_t getConflictSetMemoryUsage(ConflictSet*);
 void destroyConflictSet(ConflictSet*);
 
 struct ConflictBatch {
@@ -310,6 +310,16 @@ public:
 		return getMinAvailableSpaceRatio() >= minRatio && getMinAvailableSpace() > SERVER_KNOBS->MIN_AVAILABLE_SPACE;
 	}
 
+	double getLoadScore() const override {
+		double score = 0;
+		for (const auto& server : servers) {
+			if (server->serverMetrics.present()) {
+				score = std::max(score, getStorageServerLoadScore(server->serverMetrics.get()));
+			}
+		}
+		return score;
+	}
+
 	Future<Void> updateStorageMetrics() override { return doUpdateStorageMetrics(this); }
 
 	bool isOptimal() const override {
@@ -868,6 +878,19 @@ struct DDTeamCollection : ReferenceCounted<DDTeamCollection> {
 		return Void();
 	}
 
+	// The metric getTeam() ranks teams by: their bytes, weighted by their load when looking for a less utilized team,
+	// or their load alone if requested
+	static double teamLoadRank(IDataDistributionTeam const& team, GetTeamRequest const& req) {
+		if (req.rankByLoadScore) {
+			return team.getLoadScore();
+		}
+		double loadBytes = team.getLoadBytes(true, req.inflightPenalty);
+		if (req.preferLowerUtilization) {
+			loadBytes *= 1 + SERVER_KNOBS->DD_LOAD_SCORE_WEIGHT * team.getLoadScore();
+		}
+		return loadBytes;
+	}
+
 	// SOMEDAY: Make bestTeam better about deciding to leave a shard where it is (e.g. in PRIORITY_TEAM_HEALTHY case)
 	//		    use keys, src, dest, metrics, priority, system load, etc.. to decide...
 	ACTOR static Future<Void> getTeam(DDTeamCollection* self, GetTeamRequest req) {
@@ -911,11 +934,12 @@ struct DDTeamCollection : ReferenceCounted<DDTeamCollection> {
 			}
 
 			// Select the best team
-			// Currently the metric is minimum used disk space (adjusted for data in flight)
+			// Currently the metric is minimum used disk space (adjusted for data in flight), weighted by the team's
+			//   load when choosing a destination, see teamLoadRank()
 			// Only healthy teams may be selected. The team has to be healthy at the moment we update
 			//   shardsAffectedByTeamFailure or we could be dropping a shard on the floor (since team
 			//   tracking is "edge triggered")
-			// SOMEDAY: Account for capacity, load (when shardMetrics load is high)
+			// SOMEDAY: Account for capacity
 
 			// self->teams.size() can be 0 under the ConfigureTest.txt test when we change configurations
 			// The situation happens rarely. We may want to eliminate this situation someday
@@ -924,7 +948,7 @@ struct DDTeamCollection : ReferenceCounted<DDTeamCollection> {
 				return Void();
 			}
 
-			int64_t bestLoadBytes = 0;
+			double bestLoadBytes = 0;
 			Optional<Reference<IDataDistributionTeam>> bestOption;
 			std::vector<Reference<IDataDistributionTeam>> randomTeams;
 			const std::set<UID> completeSources(req.completeSources.begin(), req.completeSources.end());
@@ -968,7 +992,7 @@ struct DDTeamCollection : ReferenceCounted<DDTeamCollection> {
 					if (self->teams[currentIndex]->isHealthy() &&
 					    (!req.preferLowerUtilization ||
 					     self->teams[currentIndex]->hasHealthyAvailableSpace(self->medianAvailableSpace))) {
-						int64_t loadBytes = self->teams[currentIndex]->getLoadBytes(true, req.inflightPenalty);
+						double loadBytes = teamLoadRank(*self->teams[currentIndex], req);
 						if ((!bestOption.present() || (req.preferLowerUtilization && loadBytes < bestLoadBytes) ||
 						     (!req.preferLowerUtilization && loadBytes > bestLoadBytes)) &&
 						    (!req.teamMustHaveShards ||
@@ -1020,7 +1044,7 @@ struct DDTeamCollection : ReferenceCounted<DDTeamCollection> {
 				}
 
 				for (int i = 0; i < randomTeams.size(); i++) {
-					int64_t loadBytes = randomTeams[i]->getLoadBytes(true, req.inflightPenalty);
+					double loadBytes = teamLoadRank(*randomTeams[i], req);
 					if (!bestOption.present() || (req.preferLowerUtilization && loadBytes < bestLoadBytes) ||
 					    (!req.preferLowerUtilization && loadBytes > bestLoadBytes)) {
 						bestLoadBytes = loadBytes;
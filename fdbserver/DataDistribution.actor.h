@@ -32,6 +32,8 @@
 struct RelocateShard {
 	KeyRange keys;
 	int priority;
+	// Set by load rebalancing: the move is abandoned if the least loaded destination has a higher load score
+	Optional<double> maxDestLoadScore;
 
 	RelocateShard() : priority(0) {}
 	RelocateShard(KeyRange const& keys, int priority) : keys(keys), priority(priority) {}
@@ -47,6 +49,8 @@ struct IDataDistributionTeam {
 	virtual int64_t getMinAvailableSpace(bool includeInFlight = true) const = 0;
 	virtual double getMinAvailableSpaceRatio(bool includeInFlight = true) const = 0;
 	virtual bool hasHealthyAvailableSpace(double minRatio) const = 0;
+	// The load score of the team's most loaded server, see getStorageServerLoadScore()
+	virtual double getLoadScore() const = 0;
 	virtual Future<Void> updateStorageMetrics() = 0;
 	virtual void addref() = 0;
 	virtual void delref() = 0;
@@ -79,6 +83,7 @@ struct GetTeamRequest {
 	bool preferLowerUtilization;
 	bool teamMustHaveShards;
 	double inflightPenalty;
+	bool rankByLoadScore = false; // Rank teams by getLoadScore() instead of bytes
 	std::vector<UID> completeSources;
 	std::vector<UID> src;
 	Promise<std::pair<Optional<Reference<IDataDistributionTeam>>, bool>> reply;
@@ -97,7 +102,7 @@ struct GetTeamRequest {
 
 		ss << "WantsNewServers:" << wantsNewServers << " WantsTrueBest:" << wantsTrueBest
 		   << " PreferLowerUtilization:" << preferLowerUtilization << " teamMustHaveShards:" << teamMustHaveShards
-		   << " inflightPenalty:" << inflightPenalty << ";";
+		   << " inflightPenalty:" << inflightPenalty << " rankByLoadScore:" << rankByLoadScore << ";";
 		ss << "CompleteSources:";
 		for (const auto& cs : completeSources) {
 			ss << cs.toString() << ",";
@@ -237,7 +242,8 @@ struct ShardMetrics {
 
 struct ShardTrackedData {
 	Future<Void> trackShard;
-	Future<Void> trackBytes;
+	// Triggered to have the batch tracking the metrics of the shard drop it once the shard is split or merged
+	Reference<AsyncVar<Void>> metricsBatchChanged;
 	Reference<AsyncVar<Optional<ShardMetrics>>> stats;
 };
 
@@ -287,6 +293,13 @@ ShardSizeBounds getShardSizeBounds(KeyRangeRef shard, int64_t maxShardSize);
 // Determines the maximum shard size based on the size of the database
 int64_t getMaxShardSize(double dbSizeEstimate);
 
+// The fraction of a storage server's capacity used by the read and write rates of a shard, in the most utilized of the
+// dimensions normalized by the DD_STORAGE_*_CAPACITY knobs
+double getStorageLoadScore(StorageMetrics const& metrics);
+
+// Like getStorageLoadScore() for a whole storage server, also accounting for its query rate and CPU usage
+double getStorageServerLoadScore(GetStorageMetricsReply const& metrics);
+
 struct DDTeamCollection;
 ACTOR Future<vector<std::pair<StorageServerInterface, ProcessClass>>> getServerListAndProcessClasses(Transaction* tr);
 
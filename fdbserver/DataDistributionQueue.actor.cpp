@@ -47,6 +47,7 @@ struct RelocateData {
 	std::vector<UID> src;
 	std::vector<UID> completeSources;
 	bool wantsNewServers;
+	Optional<double> maxDestLoadScore;
 	TraceInterval interval;
 
 	RelocateData()
@@ -60,7 +61,7 @@ struct RelocateData {
 	                    rs.priority == SERVER_KNOBS->PRIORITY_REBALANCE_UNDERUTILIZED_TEAM ||
 	                    rs.priority == SERVER_KNOBS->PRIORITY_SPLIT_SHARD ||
 	                    rs.priority == SERVER_KNOBS->PRIORITY_TEAM_REDUNDANT),
-	    interval("QueuedRelocation") {}
+	    maxDestLoadScore(rs.maxDestLoadScore), interval("QueuedRelocation") {}
 
 	static bool isHealthPriority(int priority) {
 		return priority == SERVER_KNOBS->PRIORITY_POPULATE_REGION ||
@@ -191,6 +192,14 @@ public:
 		return all([minRatio](IDataDistributionTeam const& team) { return team.hasHealthyAvailableSpace(minRatio); });
 	}
 
+	double getLoadScore() const override {
+		double result = 0;
+		for (const auto& team : teams) {
+			result = std::max(result, team->getLoadScore());
+		}
+		return result;
+	}
+
 	Future<Void> updateStorageMetrics() override {
 		std::vector<Future<Void>> futures;
 
@@ -685,6 +694,8 @@ struct DDQueueData {
 					rd.boundaryPriority = std::max(rd.boundaryPriority, rrs.boundaryPriority);
 				}
 				rd.priority = std::max(rd.priority, std::max(rd.boundaryPriority, rd.healthPriority));
+				// The queued job's move must happen whatever the destination's load
+				rd.maxDestLoadScore.reset();
 			}
 
 			if (rd.keys.contains(rrs.keys)) {
@@ -958,6 +969,7 @@ ACTOR Future<Void> dataDistributionRelocator(DDQueueData* self, RelocateData rd,
 	state std::vector<std::pair<Reference<IDataDistributionTeam>, bool>> bestTeams;
 	state double startTime = now();
 	state std::vector<UID> destIds;
+	state bool checkDestLoad = rd.maxDestLoadScore.present();
 
 	try {
 		if (now() - self->lastInterval < 1.0) {
@@ -1009,6 +1021,7 @@ ACTOR Future<Void> dataDistributionRelocator(DDQueueData* self, RelocateData rd,
 					                          inflightPenalty);
 					req.src = rd.src;
 					req.completeSources = rd.completeSources;
+					req.rankByLoadScore = rd.maxDestLoadScore.present();
 					// bestTeam.second = false if the bestTeam in the teamCollection (in the DC) does not have any
 					// server that hosts the relocateData. This is possible, for example, in a fearless configuration
 					// when the remote DC is just brought up.
@@ -1047,6 +1060,28 @@ ACTOR Future<Void> dataDistributionRelocator(DDQueueData* self, RelocateData rd,
 				wait(delay(SERVER_KNOBS->BEST_TEAM_STUCK_DELAY, TaskPriority::DataDistributionLaunch));
 			}
 
+			// A load rebalancing move is only worth making if the destination stays less loaded than the source,
+			// which may no longer hold by the time the relocation runs
+			if (checkDestLoad) {
+				checkDestLoad = false;
+				double destLoad = 0;
+				for (const auto& team : bestTeams) {
+					destLoad = std::max(destLoad, team.first->getLoadScore());
+				}
+				if (destLoad > rd.maxDestLoadScore.get()) {
+					TEST(true); // Load rebalancing move abandoned because the destination is too loaded
+					TraceEvent(relocateShardInterval.end(), distributorId)
+					    .detail("Duration", now() - startTime)
+					    .detail("Result", "DestinationTooLoaded")
+					    .detail("DestLoad", destLoad)
+					    .detail("MaxDestLoad", rd.maxDestLoadScore.get());
+					signalledTransferComplete = true;
+					dataTransferComplete.send(rd);
+					relocationComplete.send(rd);
+					return Void();
+				}
+			}
+
 			destIds.clear();
 			state std::vector<UID> healthyIds;
 			state std::vector<UID> extraIds;
@@ -1328,6 +1363,122 @@ ACTOR Future<bool> rebalanceTeams(DDQueueData* self,
 	return false;
 }
 
+// Move a shard carrying part of sourceTeam's load away if sourceTeam is hot and much more loaded than destTeam. The
+// shard is chosen so that destTeam would stay less loaded than sourceTeam by a margin, so that moves do not oscillate.
+// The relocator picks the least loaded team as the destination and abandons the move if that team no longer meets the
+// margin.
+ACTOR Future<bool> rebalanceLoad(DDQueueData* self,
+                                 Reference<IDataDistributionTeam> sourceTeam,
+                                 Reference<IDataDistributionTeam> destTeam,
+                                 bool primary,
+                                 TraceEvent* traceEvent) {
+	if (g_network->isSimulated() && g_simulator.speedUpSimulation) {
+		traceEvent->detail("CancelingDueToSimulationSpeedup", true);
+		return false;
+	}
+
+	state double sourceLoad = sourceTeam->getLoadScore();
+	double destLoad = destTeam->getLoadScore();
+	state double maxShardLoad = (sourceLoad - destLoad - SERVER_KNOBS->DD_LOAD_SCORE_HYSTERESIS) / 2;
+	traceEvent->detail("SourceLoad", sourceLoad).detail("DestLoad", destLoad);
+
+	if (sourceLoad < SERVER_KNOBS->DD_HOT_TEAM_LOAD_SCORE || maxShardLoad <= 0) {
+		return false;
+	}
+
+	state std::vector<KeyRange> shards = self->shardsAffectedByTeamFailure->getShardsFor(
+	    ShardsAffectedByTeamFailure::Team(sourceTeam->getServerIDs(), primary));
+	traceEvent->detail("ShardsInSource", shards.size());
+	deterministicRandom()->randomShuffle(shards);
+
+	// The hottest sampled shard that can be moved without making the destination hotter than the source. Shards
+	// which are too hot to move whole are split by the tracker when DD_SPLIT_READ_HOT_SHARDS is set.
+	state KeyRange moveShard;
+	state double moveShardLoad = 0;
+	state int i = 0;
+	for (; i < std::min<int>(shards.size(), SERVER_KNOBS->REBALANCE_MAX_RETRIES); i++) {
+		StorageMetrics metrics =
+		    wait(brokenPromiseToNever(self->getShardMetrics.getReply(GetMetricsRequest(shards[i]))));
+		double shardLoad = getStorageLoadScore(metrics);
+		if (shardLoad > moveShardLoad && shardLoad <= maxShardLoad) {
+			moveShard = shards[i];
+			moveShardLoad = shardLoad;
+		}
+	}
+
+	traceEvent->detail("ShardLoad", moveShardLoad).detail("MaxShardLoad", maxShardLoad);
+	if (moveShardLoad == 0) {
+		return false;
+	}
+
+	// Verify the shard is still in ShardsAffectedByTeamFailure
+	shards = self->shardsAffectedByTeamFailure->getShardsFor(
+	    ShardsAffectedByTeamFailure::Team(sourceTeam->getServerIDs(), primary));
+	if (std::find(shards.begin(), shards.end(), moveShard) == shards.end()) {
+		traceEvent->detail("ShardStillPresent", false);
+		return false;
+	}
+
+	traceEvent->detail("ShardStillPresent", true);
+	RelocateShard rs(moveShard, SERVER_KNOBS->PRIORITY_REBALANCE_OVERUTILIZED_TEAM);
+	// The destination gains the shard's load and the source loses it
+	rs.maxDestLoadScore = sourceLoad - 2 * moveShardLoad - SERVER_KNOBS->DD_LOAD_SCORE_HYSTERESIS;
+	self->output.send(rs);
+	return true;
+}
+
+// Moves load from the most loaded team, by read and write rates, queries and CPU rather than bytes, at most once per
+// DD_LOAD_REBALANCE_INTERVAL. Destinations are chosen by the relocator, as the least loaded team.
+ACTOR Future<Void> BgDDLoadRebalancer(DDQueueData* self, int teamCollectionIndex) {
+	state Transaction tr(self->cx);
+	loop {
+		state bool moved = false;
+		state TraceEvent traceEvent("BgDDLoadRebalancer", self->distributorId);
+		traceEvent.suppressFor(5.0);
+
+		try {
+			wait(delay(SERVER_KNOBS->DD_LOAD_REBALANCE_INTERVAL, TaskPriority::DataDistributionLaunch));
+			tr.setOption(FDBTransactionOptions::LOCK_AWARE);
+			Optional<Value> val = wait(tr.get(rebalanceDDIgnoreKey));
+			// The knob is checked on every pass, so that load rebalancing can be turned on while data distribution runs
+			bool enabled = SERVER_KNOBS->DD_LOAD_REBALANCE && !val.present();
+			traceEvent.detail("Enabled", enabled)
+			    .detail("QueuedRelocations",
+			            self->priority_relocations[SERVER_KNOBS->PRIORITY_REBALANCE_OVERUTILIZED_TEAM]);
+
+			if (enabled && self->priority_relocations[SERVER_KNOBS->PRIORITY_REBALANCE_OVERUTILIZED_TEAM] <
+			                   SERVER_KNOBS->DD_REBALANCE_PARALLELISM) {
+				GetTeamRequest loadedRequest(true, true, false, true);
+				loadedRequest.rankByLoadScore = true;
+				state std::pair<Optional<Reference<IDataDistributionTeam>>, bool> loadedTeam =
+				    wait(brokenPromiseToNever(
+				        self->teamCollections[teamCollectionIndex].getTeam.getReply(loadedRequest)));
+
+				GetTeamRequest idleRequest(true, true, true, false);
+				idleRequest.rankByLoadScore = true;
+				std::pair<Optional<Reference<IDataDistributionTeam>>, bool> idleTeam = wait(
+				    brokenPromiseToNever(self->teamCollections[teamCollectionIndex].getTeam.getReply(idleRequest)));
+
+				if (loadedTeam.first.present() && idleTeam.first.present()) {
+					traceEvent.detail("SourceTeam", loadedTeam.first.get()->getDesc())
+					    .detail("DestTeam", idleTeam.first.get()->getDesc());
+					bool _moved = wait(rebalanceLoad(
+					    self, loadedTeam.first.get(), idleTeam.first.get(), teamCollectionIndex == 0, &traceEvent));
+					moved = _moved;
+				}
+			}
+			tr.reset();
+		} catch (Error& e) {
+			traceEvent.error(
+			    e, true); // Log actor_cancelled because it's not legal to suppress an event that's initialized
+			wait(tr.onError(e));
+		}
+
+		traceEvent.detail("Moved", moved);
+		traceEvent.log();
+	}
+}
+
 ACTOR Future<Void> BgDDMountainChopper(DDQueueData* self, int teamCollectionIndex) {
 	state double rebalancePollingInterval = SERVER_KNOBS->BG_REBALANCE_POLLING_INTERVAL;
 	state int resetCount = SERVER_KNOBS->DD_REBALANCE_RESET_AMOUNT;
@@ -1580,6 +1731,7 @@ ACTOR Future<Void> dataDistributionQueue(Database cx,
 	for (int i = 0; i < teamCollections.size(); i++) {
 		balancingFutures.push_back(BgDDMountainChopper(&self, i));
 		balancingFutures.push_back(BgDDValleyFiller(&self, i));
+		balancingFutures.push_back(BgDDLoadRebalancer(&self, i));
 	}
 	balancingFutures.push_back(delayedAsyncVar(self.rawProcessingUnhealthy, processingUnhealthy, 0));
 
@@ -66,11 +66,50 @@ ACTOR Future<Void> updateMaxShardSize(Reference<AsyncVar<int64_t>> dbSizeEstimat
 	}
 }
 
+// The metrics of a shard tracked by trackShardMetricsBatch()
+struct BatchedShardMetrics {
+	KeyRange keys;
+	Reference<AsyncVar<Optional<ShardMetrics>>> stats;
+	BandwidthStatus bandwidthStatus;
+	double lastLowBandwidthStartTime;
+	int shardCount;
+	// The bounds outside which changes to the metrics are reported, which are recomputed when the metrics change
+	Optional<ShardSizeBounds> bounds;
+	// Set while the shard does not have a single location, e.g. after a merge or while it is moved, during which its
+	// metrics are requested on their own
+	bool separate;
+
+	BatchedShardMetrics(KeyRange const& keys, Reference<AsyncVar<Optional<ShardMetrics>>> const& stats)
+	  : keys(keys), stats(stats), bandwidthStatus(BandwidthStatusNormal), lastLowBandwidthStartTime(now()),
+	    shardCount(1), separate(false) {
+		if (stats->get().present()) {
+			bandwidthStatus = getBandwidthStatus(stats->get().get().metrics);
+			lastLowBandwidthStartTime = stats->get().get().lastLowBandwidthStartTime;
+			shardCount = stats->get().get().shardCount;
+		}
+	}
+};
+
+// Shards on the same team whose metrics are tracked together by trackShardMetricsBatch()
+struct ShardMetricsBatch : ReferenceCounted<ShardMetricsBatch> {
+	std::vector<UID> team;
+	std::vector<BatchedShardMetrics> shards;
+	// Triggered when shards are added to the batch, or split or merged
+	Reference<AsyncVar<Void>> changed;
+	// Whether new shards on the team are added to this batch
+	bool open;
+
+	explicit ShardMetricsBatch(std::vector<UID> const& team)
+	  : team(team), changed(makeReference<AsyncVar<Void>>()), open(true) {}
+};
+
 struct DataDistributionTracker {
 	Database cx;
 	UID distributorId;
 	KeyRangeMap<ShardTrackedData>& shards;
 	ActorCollection sizeChanges;
+	ActorCollection shardMetricsBatches;
+	std::map<std::vector<UID>, Reference<ShardMetricsBatch>> openShardMetricsBatches;
 
 	int64_t systemSizeEstimate;
 	Reference<AsyncVar<int64_t>> dbSizeEstimate;
@@ -124,20 +163,24 @@ struct DataDistributionTracker {
 	                        KeyRangeMap<ShardTrackedData>& shards,
 	                        bool& trackerCancelled)
 	  : cx(cx), distributorId(distributorId), dbSizeEstimate(new AsyncVar<int64_t>()), systemSizeEstimate(0),
-	    maxShardSize(new AsyncVar<Optional<int64_t>>()), sizeChanges(false), readyToStart(readyToStart), output(output),
-	    shardsAffectedByTeamFailure(shardsAffectedByTeamFailure), anyZeroHealthyTeams(anyZeroHealthyTeams),
-	    shards(shards), trackerCancelled(trackerCancelled) {}
+	    maxShardSize(new AsyncVar<Optional<int64_t>>()), sizeChanges(false), shardMetricsBatches(false),
+	    readyToStart(readyToStart), output(output), shardsAffectedByTeamFailure(shardsAffectedByTeamFailure),
+	    anyZeroHealthyTeams(anyZeroHealthyTeams), shards(shards), trackerCancelled(trackerCancelled) {}
 
 	~DataDistributionTracker() {
 		trackerCancelled = true;
 		// Cancel all actors so they aren't waiting on sizeChanged broken promise
 		sizeChanges.clear(false);
+		shardMetricsBatches.clear(false);
 	}
 };
 
+// Tracks the metrics of the shards in the metrics batch of the given team, or if none is given, of the team
+// shardsAffectedByTeamFailure has for the shards
 void restartShardTrackers(DataDistributionTracker* self,
                           KeyRangeRef keys,
-                          Optional<ShardMetrics> startingMetrics = Optional<ShardMetrics>());
+                          Optional<ShardMetrics> startingMetrics = Optional<ShardMetrics>(),
+                          std::vector<UID> team = std::vector<UID>());
 
 // Gets the permitted size and IO bounds for a shard. A shard that starts at allKeys.begin
 //  (i.e. '') will have a permitted size of 0, since the database can contain no data.
@@ -182,141 +225,260 @@ int64_t getMaxShardSize(double dbSizeEstimate) {
 	                (int64_t)SERVER_KNOBS->MAX_SHARD_BYTES);
 }
 
-ACTOR Future<Void> trackShardMetrics(DataDistributionTracker::SafeAccessor self,
-                                     KeyRange keys,
-                                     Reference<AsyncVar<Optional<ShardMetrics>>> shardMetrics) {
-	state BandwidthStatus bandwidthStatus =
-	    shardMetrics->get().present() ? getBandwidthStatus(shardMetrics->get().get().metrics) : BandwidthStatusNormal;
-	state double lastLowBandwidthStartTime =
-	    shardMetrics->get().present() ? shardMetrics->get().get().lastLowBandwidthStartTime : now();
-	state int shardCount = shardMetrics->get().present() ? shardMetrics->get().get().shardCount : 1;
-	state ReadBandwidthStatus readBandwidthStatus = shardMetrics->get().present()
-	                                                    ? getReadBandwidthStatus(shardMetrics->get().get().metrics)
-	                                                    : ReadBandwidthStatusNormal;
+double getStorageLoadScore(StorageMetrics const& metrics) {
+	return std::max(metrics.bytesReadPerKSecond / (1000 * SERVER_KNOBS->DD_STORAGE_READ_BYTES_CAPACITY),
+	                metrics.bytesPerKSecond / (1000 * SERVER_KNOBS->DD_STORAGE_WRITE_BYTES_CAPACITY));
+}
 
-	wait(delay(0, TaskPriority::DataDistribution));
+double getStorageServerLoadScore(GetStorageMetricsReply const& metrics) {
+	return std::max({ getStorageLoadScore(metrics.load),
+	                  metrics.queryRate / SERVER_KNOBS->DD_STORAGE_QUERY_CAPACITY,
+	                  metrics.cpuUsage / 100 });
+}
 
-	/*TraceEvent("TrackShardMetricsStarting")
-	    .detail("TrackerID", trackerID)
+// Whether a shard should be split because of its reads, and kept from being merged back
+bool isReadHotShard(KeyRangeRef keys, StorageMetrics const& metrics) {
+	return SERVER_KNOBS->DD_SPLIT_READ_HOT_SHARDS && keys.begin < keyServersKeys.begin &&
+	       getReadBandwidthStatus(metrics) == ReadBandwidthStatusHigh;
+}
+
+// Gets the bounds outside which changes to the metrics of a tracked shard are reported to the tracker
+ShardSizeBounds getShardMetricsBounds(DataDistributionTracker* self,
+                                      KeyRange const& keys,
+                                      Optional<ShardMetrics> const& shardMetrics,
+                                      BandwidthStatus bandwidthStatus) {
+	ShardSizeBounds bounds;
+	if (shardMetrics.present()) {
+		auto bytes = shardMetrics.get().metrics.bytes;
+		auto readBandwidthStatus = getReadBandwidthStatus(shardMetrics.get().metrics);
+
+		bounds.max.bytes = std::max(int64_t(bytes * 1.1), (int64_t)SERVER_KNOBS->MIN_SHARD_BYTES);
+		bounds.min.bytes = std::min(int64_t(bytes * 0.9),
+		                            std::max(int64_t(bytes - (SERVER_KNOBS->MIN_SHARD_BYTES * 0.1)), (int64_t)0));
+		bounds.permittedError.bytes = bytes * 0.1;
+		if (bandwidthStatus == BandwidthStatusNormal) { // Not high or low
+			bounds.max.bytesPerKSecond = SERVER_KNOBS->SHARD_MAX_BYTES_PER_KSEC;
+			bounds.min.bytesPerKSecond = SERVER_KNOBS->SHARD_MIN_BYTES_PER_KSEC;
+			bounds.permittedError.bytesPerKSecond = bounds.min.bytesPerKSecond / 4;
+		} else if (bandwidthStatus == BandwidthStatusHigh) { // > 10MB/sec for 100MB shard, proportionally lower
+			                                                 // for smaller shard, > 200KB/sec no matter what
+			bounds.max.bytesPerKSecond = bounds.max.infinity;
+			bounds.min.bytesPerKSecond = SERVER_KNOBS->SHARD_MAX_BYTES_PER_KSEC;
+			bounds.permittedError.bytesPerKSecond = bounds.min.bytesPerKSecond / 4;
+		} else if (bandwidthStatus == BandwidthStatusLow) { // < 10KB/sec
+			bounds.max.bytesPerKSecond = SERVER_KNOBS->SHARD_MIN_BYTES_PER_KSEC;
+			bounds.min.bytesPerKSecond = 0;
+			bounds.permittedError.bytesPerKSecond = bounds.max.bytesPerKSecond / 4;
+		} else {
+			ASSERT(false);
+		}
+		// handle read bandkwith status
+		if (readBandwidthStatus == ReadBandwidthStatusNormal) {
+			bounds.max.bytesReadPerKSecond =
+			    std::max((int64_t)(SERVER_KNOBS->SHARD_MAX_READ_DENSITY_RATIO * bytes *
+			                       SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS *
+			                       (1.0 + SERVER_KNOBS->SHARD_MAX_BYTES_READ_PER_KSEC_JITTER)),
+			             SERVER_KNOBS->SHARD_READ_HOT_BANDWITH_MIN_PER_KSECONDS);
+			bounds.min.bytesReadPerKSecond = 0;
+			bounds.permittedError.bytesReadPerKSecond = bounds.min.bytesReadPerKSecond / 4;
+		} else if (readBandwidthStatus == ReadBandwidthStatusHigh) {
+			bounds.max.bytesReadPerKSecond = bounds.max.infinity;
+			bounds.min.bytesReadPerKSecond = SERVER_KNOBS->SHARD_MAX_READ_DENSITY_RATIO * bytes *
+			                                 SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS *
+			                                 (1.0 - SERVER_KNOBS->SHARD_MAX_BYTES_READ_PER_KSEC_JITTER);
+			bounds.permittedError.bytesReadPerKSecond = bounds.min.bytesReadPerKSecond / 4;
+			// TraceEvent("RHDTriggerReadHotLoggingForShard")
+			//     .detail("ShardBegin", keys.begin.printable().c_str())
+			//     .detail("ShardEnd", keys.end.printable().c_str());
+			self->readHotShard.send(keys);
+		} else {
+			ASSERT(false);
+		}
+	} else {
+		bounds.max.bytes = -1;
+		bounds.min.bytes = -1;
+		bounds.permittedError.bytes = -1;
+		bounds.max.bytesPerKSecond = bounds.max.infinity;
+		bounds.min.bytesPerKSecond = 0;
+		bounds.permittedError.bytesPerKSecond = bounds.permittedError.infinity;
+		bounds.max.bytesReadPerKSecond = bounds.max.infinity;
+		bounds.min.bytesReadPerKSecond = 0;
+		bounds.permittedError.bytesReadPerKSecond = bounds.permittedError.infinity;
+	}
+
+	bounds.max.iosPerKSecond = bounds.max.infinity;
+	bounds.min.iosPerKSecond = 0;
+	bounds.permittedError.iosPerKSecond = bounds.permittedError.infinity;
+	return bounds;
+}
+
+// Records new metrics reported for a tracked shard
+void updateShardMetrics(DataDistributionTracker* self,
+                        KeyRange const& keys,
+                        Reference<AsyncVar<Optional<ShardMetrics>>> shardMetrics,
+                        StorageMetrics const& metrics,
+                        BandwidthStatus& bandwidthStatus,
+                        double& lastLowBandwidthStartTime,
+                        int shardCount) {
+	BandwidthStatus newBandwidthStatus = getBandwidthStatus(metrics);
+	if (newBandwidthStatus == BandwidthStatusLow && bandwidthStatus != BandwidthStatusLow) {
+		lastLowBandwidthStartTime = now();
+	}
+	bandwidthStatus = newBandwidthStatus;
+
+	/*TraceEvent("ShardSizeUpdate")
 	    .detail("Keys", keys)
-	    .detail("TrackedBytesInitiallyPresent", shardMetrics->get().present())
-	    .detail("StartingMetrics", shardMetrics->get().present() ? shardMetrics->get().get().metrics.bytes : 0)
-	    .detail("StartingMerges", shardMetrics->get().present() ? shardMetrics->get().get().merges : 0);*/
+	    .detail("UpdatedSize", metrics.metrics.bytes)
+	    .detail("Bandwidth", metrics.metrics.bytesPerKSecond)
+	    .detail("BandwithStatus", getBandwidthStatus(metrics))
+	    .detail("BytesLower", bounds.min.bytes)
+	    .detail("BytesUpper", bounds.max.bytes)
+	    .detail("BandwidthLower", bounds.min.bytesPerKSecond)
+	    .detail("BandwidthUpper", bounds.max.bytesPerKSecond)
+	    .detail("ShardSizePresent", shardSize->get().present())
+	    .detail("OldShardSize", shardSize->get().present() ? shardSize->get().get().metrics.bytes : 0)
+	    .detail("TrackerID", trackerID);*/
+
+	if (shardMetrics->get().present()) {
+		self->dbSizeEstimate->set(self->dbSizeEstimate->get() + metrics.bytes -
+		                          shardMetrics->get().get().metrics.bytes);
+		if (keys.begin >= systemKeys.begin) {
+			self->systemSizeEstimate += metrics.bytes - shardMetrics->get().get().metrics.bytes;
+		}
+	}
+
+	shardMetrics->set(ShardMetrics(metrics, lastLowBandwidthStartTime, shardCount));
+}
+
+// Whether the shard tracked with the given stats is still in the shard map, and not replaced by a split or merge
+bool isTrackedShard(DataDistributionTracker* self,
+                    KeyRange const& keys,
+                    Reference<AsyncVar<Optional<ShardMetrics>>> const& shardMetrics) {
+	auto shard = self->shards.rangeContaining(keys.begin);
+	return shard.range() == keys && shard.value().stats == shardMetrics;
+}
+
+// Tracks the metrics of a batch of shards on the same team with a single request to its storage servers, instead of an
+// actor and a request for each shard. Shards which are split or merged are dropped from the batch, since their
+// replacements are added to batches of their own, and the metrics of shards without a single location are requested
+// separately until they have one again.
+ACTOR Future<Void> trackShardMetricsBatch(DataDistributionTracker::SafeAccessor self,
+                                          Reference<ShardMetricsBatch> batch) {
+	state Standalone<VectorRef<KeyRangeRef>> ranges;
+	state std::vector<StorageMetrics> minMetrics;
+	state std::vector<StorageMetrics> maxMetrics;
+	// The indices in the batch of the shards whose metrics are requested together, and of those requested separately
+	state std::vector<int> batched;
+	state std::vector<int> separate;
+	state Future<WaitMetricsBatchReply> batchReply;
+	state std::vector<Future<std::pair<Optional<StorageMetrics>, int>>> separateReplies;
+
+	wait(delay(0, TaskPriority::DataDistribution));
 
 	try {
 		loop {
-			state ShardSizeBounds bounds;
-			if (shardMetrics->get().present()) {
-				auto bytes = shardMetrics->get().get().metrics.bytes;
-				auto readBandwidthStatus = getReadBandwidthStatus(shardMetrics->get().get().metrics);
-
-				bounds.max.bytes = std::max(int64_t(bytes * 1.1), (int64_t)SERVER_KNOBS->MIN_SHARD_BYTES);
-				bounds.min.bytes = std::min(
-				    int64_t(bytes * 0.9), std::max(int64_t(bytes - (SERVER_KNOBS->MIN_SHARD_BYTES * 0.1)), (int64_t)0));
-				bounds.permittedError.bytes = bytes * 0.1;
-				if (bandwidthStatus == BandwidthStatusNormal) { // Not high or low
-					bounds.max.bytesPerKSecond = SERVER_KNOBS->SHARD_MAX_BYTES_PER_KSEC;
-					bounds.min.bytesPerKSecond = SERVER_KNOBS->SHARD_MIN_BYTES_PER_KSEC;
-					bounds.permittedError.bytesPerKSecond = bounds.min.bytesPerKSecond / 4;
-				} else if (bandwidthStatus == BandwidthStatusHigh) { // > 10MB/sec for 100MB shard, proportionally lower
-					                                                 // for smaller shard, > 200KB/sec no matter what
-					bounds.max.bytesPerKSecond = bounds.max.infinity;
-					bounds.min.bytesPerKSecond = SERVER_KNOBS->SHARD_MAX_BYTES_PER_KSEC;
-					bounds.permittedError.bytesPerKSecond = bounds.min.bytesPerKSecond / 4;
-				} else if (bandwidthStatus == BandwidthStatusLow) { // < 10KB/sec
-					bounds.max.bytesPerKSecond = SERVER_KNOBS->SHARD_MIN_BYTES_PER_KSEC;
-					bounds.min.bytesPerKSecond = 0;
-					bounds.permittedError.bytesPerKSecond = bounds.max.bytesPerKSecond / 4;
-				} else {
-					ASSERT(false);
+			for (int i = 0; i < batch->shards.size(); i++) {
+				if (!isTrackedShard(self(), batch->shards[i].keys, batch->shards[i].stats)) {
+					TEST(true); // Shard dropped from a metrics batch after a split or merge
+					swapAndPop(&batch->shards, i);
+					i--;
 				}
-				// handle read bandkwith status
-				if (readBandwidthStatus == ReadBandwidthStatusNormal) {
-					bounds.max.bytesReadPerKSecond =
-					    std::max((int64_t)(SERVER_KNOBS->SHARD_MAX_READ_DENSITY_RATIO * bytes *
-					                       SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS *
-					                       (1.0 + SERVER_KNOBS->SHARD_MAX_BYTES_READ_PER_KSEC_JITTER)),
-					             SERVER_KNOBS->SHARD_READ_HOT_BANDWITH_MIN_PER_KSECONDS);
-					bounds.min.bytesReadPerKSecond = 0;
-					bounds.permittedError.bytesReadPerKSecond = bounds.min.bytesReadPerKSecond / 4;
-				} else if (readBandwidthStatus == ReadBandwidthStatusHigh) {
-					bounds.max.bytesReadPerKSecond = bounds.max.infinity;
-					bounds.min.bytesReadPerKSecond = SERVER_KNOBS->SHARD_MAX_READ_DENSITY_RATIO * bytes *
-					                                 SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS *
-					                                 (1.0 - SERVER_KNOBS->SHARD_MAX_BYTES_READ_PER_KSEC_JITTER);
-					bounds.permittedError.bytesReadPerKSecond = bounds.min.bytesReadPerKSecond / 4;
-					// TraceEvent("RHDTriggerReadHotLoggingForShard")
-					//     .detail("ShardBegin", keys.begin.printable().c_str())
-					//     .detail("ShardEnd", keys.end.printable().c_str());
-					self()->readHotShard.send(keys);
-				} else {
-					ASSERT(false);
+			}
+			if (batch->shards.empty()) {
+				if (batch->open) {
+					self()->openShardMetricsBatches.erase(batch->team);
 				}
-			} else {
-				bounds.max.bytes = -1;
-				bounds.min.bytes = -1;
-				bounds.permittedError.bytes = -1;
-				bounds.max.bytesPerKSecond = bounds.max.infinity;
-				bounds.min.bytesPerKSecond = 0;
-				bounds.permittedError.bytesPerKSecond = bounds.permittedError.infinity;
-				bounds.max.bytesReadPerKSecond = bounds.max.infinity;
-				bounds.min.bytesReadPerKSecond = 0;
-				bounds.permittedError.bytesReadPerKSecond = bounds.permittedError.infinity;
+				return Void();
 			}
 
-			bounds.max.iosPerKSecond = bounds.max.infinity;
-			bounds.min.iosPerKSecond = 0;
-			bounds.permittedError.iosPerKSecond = bounds.permittedError.infinity;
-
-			loop {
-				Transaction tr(self()->cx);
-				// metrics.second is the number of key-ranges (i.e., shards) in the 'keys' key-range
-				std::pair<Optional<StorageMetrics>, int> metrics =
-				    wait(tr.waitStorageMetrics(keys,
-				                               bounds.min,
-				                               bounds.max,
-				                               bounds.permittedError,
-				                               CLIENT_KNOBS->STORAGE_METRICS_SHARD_LIMIT,
-				                               shardCount));
-				if (metrics.first.present()) {
-					BandwidthStatus newBandwidthStatus = getBandwidthStatus(metrics.first.get());
-					if (newBandwidthStatus == BandwidthStatusLow && bandwidthStatus != BandwidthStatusLow) {
-						lastLowBandwidthStartTime = now();
-					}
-					bandwidthStatus = newBandwidthStatus;
-
-					/*TraceEvent("ShardSizeUpdate")
-					    .detail("Keys", keys)
-					    .detail("UpdatedSize", metrics.metrics.bytes)
-					    .detail("Bandwidth", metrics.metrics.bytesPerKSecond)
-					    .detail("BandwithStatus", getBandwidthStatus(metrics))
-					    .detail("BytesLower", bounds.min.bytes)
-					    .detail("BytesUpper", bounds.max.bytes)
-					    .detail("BandwidthLower", bounds.min.bytesPerKSecond)
-					    .detail("BandwidthUpper", bounds.max.bytesPerKSecond)
-					    .detail("ShardSizePresent", shardSize->get().present())
-					    .detail("OldShardSize", shardSize->get().present() ? shardSize->get().get().metrics.bytes : 0)
-					    .detail("TrackerID", trackerID);*/
-
-					if (shardMetrics->get().present()) {
-						self()->dbSizeEstimate->set(self()->dbSizeEstimate->get() + metrics.first.get().bytes -
-						                            shardMetrics->get().get().metrics.bytes);
-						if (keys.begin >= systemKeys.begin) {
-							self()->systemSizeEstimate +=
-							    metrics.first.get().bytes - shardMetrics->get().get().metrics.bytes;
+			Transaction tr(self()->cx);
+			ranges = Standalone<VectorRef<KeyRangeRef>>();
+			minMetrics.clear();
+			maxMetrics.clear();
+			batched.clear();
+			separate.clear();
+			separateReplies.clear();
+			for (int i = 0; i < batch->shards.size(); i++) {
+				BatchedShardMetrics& shard = batch->shards[i];
+				if (!shard.bounds.present()) {
+					shard.bounds =
+					    getShardMetricsBounds(self(), shard.keys, shard.stats->get(), shard.bandwidthStatus);
+				}
+				ShardSizeBounds const& bounds = shard.bounds.get();
+				if (shard.separate) {
+					separate.push_back(i);
+					separateReplies.push_back(tr.waitStorageMetrics(shard.keys,
+					                                                bounds.min,
+					                                                bounds.max,
+					                                                bounds.permittedError,
+					                                                CLIENT_KNOBS->STORAGE_METRICS_SHARD_LIMIT,
+					                                                shard.shardCount));
+				} else {
+					batched.push_back(i);
+					ranges.push_back(ranges.arena(), shard.keys);
+					ranges.arena().dependsOn(shard.keys.arena());
+					minMetrics.push_back(bounds.min);
+					maxMetrics.push_back(bounds.max);
+				}
+			}
+			batchReply = batched.empty() ? Never() : tr.waitStorageMetricsBatch(ranges, minMetrics, maxMetrics);
+
+			choose {
+				when(WaitMetricsBatchReply reply = wait(batchReply)) {
+					for (int j = 0; j < reply.changed.size(); j++) {
+						int i = batched[reply.changed[j]];
+						if (isTrackedShard(self(), batch->shards[i].keys, batch->shards[i].stats)) {
+							batch->shards[i].shardCount = 1;
+							batch->shards[i].bounds.reset();
+							updateShardMetrics(self(),
+							                   batch->shards[i].keys,
+							                   batch->shards[i].stats,
+							                   reply.metrics[j],
+							                   batch->shards[i].bandwidthStatus,
+							                   batch->shards[i].lastLowBandwidthStartTime,
+							                   1);
 						}
 					}
-
-					shardMetrics->set(ShardMetrics(metrics.first.get(), lastLowBandwidthStartTime, shardCount));
-					break;
-				} else {
-					shardCount = metrics.second;
-					if (shardMetrics->get().present()) {
-						auto newShardMetrics = shardMetrics->get().get();
-						newShardMetrics.shardCount = shardCount;
-						shardMetrics->set(newShardMetrics);
+					for (int r : reply.notReadable) {
+						TEST(true); // Metrics of a shard in a batch requested separately
+						batch->shards[batched[r]].separate = true;
+					}
+				}
+				when(wait(separateReplies.empty() ? Never() : waitForAny(separateReplies))) {
+					for (int j = 0; j < separateReplies.size(); j++) {
+						int i = separate[j];
+						if (!separateReplies[j].isReady() ||
+						    !isTrackedShard(self(), batch->shards[i].keys, batch->shards[i].stats)) {
+							continue;
+						}
+						// metrics.second is the number of key-ranges (i.e., shards) in the shard's key-range
+						std::pair<Optional<StorageMetrics>, int> metrics = separateReplies[j].get();
+						if (metrics.first.present()) {
+							// The shard may have a single location again
+							batch->shards[i].separate = false;
+							batch->shards[i].bounds.reset();
+							updateShardMetrics(self(),
+							                   batch->shards[i].keys,
+							                   batch->shards[i].stats,
+							                   metrics.first.get(),
+							                   batch->shards[i].bandwidthStatus,
+							                   batch->shards[i].lastLowBandwidthStartTime,
+							                   batch->shards[i].shardCount);
+						} else {
+							batch->shards[i].shardCount = metrics.second;
+							auto const& shardMetrics = batch->shards[i].stats;
+							if (shardMetrics->get().present()) {
+								auto newShardMetrics = shardMetrics->get().get();
+								newShardMetrics.shardCount = metrics.second;
+								shardMetrics->set(newShardMetrics);
+							}
+						}
 					}
 				}
+				when(wait(batch->changed->onChange())) {
+					// Picks up all the shards added to or replaced in the batch by a split or merge at once
+					wait(delay(0, TaskPriority::DataDistribution));
+				}
 			}
 		}
 	} catch (Error& e) {
@@ -327,6 +489,27 @@ ACTOR Future<Void> trackShardMetrics(DataDistributionTracker::SafeAccessor self,
 	}
 }
 
+// Adds a shard to the open metrics batch of its team, and returns the batch's changed trigger. A new batch is opened
+// once the open one has DD_SHARD_METRICS_BATCH_SIZE shards.
+Reference<AsyncVar<Void>> trackShardMetrics(DataDistributionTracker* self,
+                                            std::vector<UID> const& team,
+                                            KeyRange const& keys,
+                                            Reference<AsyncVar<Optional<ShardMetrics>>> const& shardMetrics) {
+	Reference<ShardMetricsBatch> batch = self->openShardMetricsBatches[team];
+	if (!batch.isValid()) {
+		batch = makeReference<ShardMetricsBatch>(team);
+		self->openShardMetricsBatches[team] = batch;
+		self->shardMetricsBatches.add(trackShardMetricsBatch(DataDistributionTracker::SafeAccessor(self), batch));
+	}
+	batch->shards.emplace_back(keys, shardMetrics);
+	if (batch->shards.size() >= SERVER_KNOBS->DD_SHARD_METRICS_BATCH_SIZE) {
+		batch->open = false;
+		self->openShardMetricsBatches.erase(team);
+	}
+	batch->changed->trigger();
+	return batch->changed;
+}
+
 ACTOR Future<Void> readHotDetector(DataDistributionTracker* self) {
 	try {
 		loop {
@@ -472,6 +655,7 @@ ACTOR Future<Void> shardSplitter(DataDistributionTracker* self,
                                  ShardSizeBounds shardBounds) {
 	state StorageMetrics metrics = shardSize->get().get().metrics;
 	state BandwidthStatus bandwidthStatus = getBandwidthStatus(metrics);
+	state bool readHot = isReadHotShard(keys, metrics);
 
 	// Split
 	TEST(true); // shard to be split
@@ -481,7 +665,10 @@ ACTOR Future<Void> shardSplitter(DataDistributionTracker* self,
 	splitMetrics.bytesPerKSecond =
 	    keys.begin >= keyServersKeys.begin ? splitMetrics.infinity : SERVER_KNOBS->SHARD_SPLIT_BYTES_PER_KSEC;
 	splitMetrics.iosPerKSecond = splitMetrics.infinity;
-	splitMetrics.bytesReadPerKSecond = splitMetrics.infinity; // Don't split by readBandwidth
+	// Split read hot shards into halves by read bandwidth, so that their hot parts can be moved apart
+	splitMetrics.bytesReadPerKSecond =
+	    readHot ? std::max(metrics.bytesReadPerKSecond / 2, SERVER_KNOBS->SHARD_READ_HOT_BANDWITH_MIN_PER_KSECONDS)
+	            : splitMetrics.infinity;
 
 	state Standalone<VectorRef<KeyRef>> splitKeys = wait(getSplitKeys(self, keys, splitMetrics, metrics));
 	// fprintf(stderr, "split keys:\n");
@@ -501,6 +688,7 @@ ACTOR Future<Void> shardSplitter(DataDistributionTracker* self,
 		            : bandwidthStatus == BandwidthStatusNormal ? "Normal"
 		                                                       : "Low")
 		    .detail("BytesPerKSec", metrics.bytesPerKSecond)
+		    .detail("ReadHot", readHot)
 		    .detail("NumShards", numShards);
 	}
 
@@ -619,6 +807,7 @@ Future<Void> shardMerger(DataDistributionTracker* self,
 		// If we just recently get the current shard's metrics (i.e., less than DD_LOW_BANDWIDTH_DELAY ago), it means
 		// the shard's metric may not be stable yet. So we cannot continue merging in this direction.
 		if (endingStats.bytes >= shardBounds.min.bytes || getBandwidthStatus(endingStats) != BandwidthStatusLow ||
+		    isReadHotShard(merged, endingStats) ||
 		    now() - lastLowBandwidthStartTime < SERVER_KNOBS->DD_LOW_BANDWIDTH_DELAY ||
 		    shardsMerged >= SERVER_KNOBS->DD_MERGE_LIMIT) {
 			// The merged range is larger than the min bounds so we cannot continue merging in this direction.
@@ -687,9 +876,13 @@ ACTOR Future<Void> shardEvaluator(DataDistributionTracker* self,
 	StorageMetrics const& stats = shardSize->get().get().metrics;
 	auto bandwidthStatus = getBandwidthStatus(stats);
 
+	bool readHot = isReadHotShard(keys, stats);
+
+	// Storage servers do not split shards smaller than twice MIN_SHARD_BYTES
 	bool shouldSplit = stats.bytes > shardBounds.max.bytes ||
-	                   (bandwidthStatus == BandwidthStatusHigh && keys.begin < keyServersKeys.begin);
-	bool shouldMerge = stats.bytes < shardBounds.min.bytes && bandwidthStatus == BandwidthStatusLow;
+	                   (bandwidthStatus == BandwidthStatusHigh && keys.begin < keyServersKeys.begin) ||
+	                   (readHot && stats.bytes >= 2 * SERVER_KNOBS->MIN_SHARD_BYTES);
+	bool shouldMerge = stats.bytes < shardBounds.min.bytes && bandwidthStatus == BandwidthStatusLow && !readHot;
 
 	// Every invocation must set this or clear it
 	if (shouldMerge && !self->anyZeroHealthyTeams->get()) {
@@ -771,7 +964,25 @@ ACTOR Future<Void> shardTracker(DataDistributionTracker::SafeAccessor self,
 	}
 }
 
-void restartShardTrackers(DataDistributionTracker* self, KeyRangeRef keys, Optional<ShardMetrics> startingMetrics) {
+void restartShardTrackers(DataDistributionTracker* self,
+                          KeyRangeRef keys,
+                          Optional<ShardMetrics> startingMetrics,
+                          std::vector<UID> team) {
+	if (team.empty()) {
+		for (auto const& t : self->shardsAffectedByTeamFailure->getTeamsFor(keys).first) {
+			team.insert(team.end(), t.servers.begin(), t.servers.end());
+		}
+		std::sort(team.begin(), team.end());
+	}
+
+	// The batches tracking the metrics of the replaced shards are triggered once they are out of the shard map
+	std::vector<Reference<AsyncVar<Void>>> replacedBatches;
+	for (auto r : self->shards.intersectingRanges(keys)) {
+		if (r.value().metricsBatchChanged.isValid()) {
+			replacedBatches.push_back(r.value().metricsBatchChanged);
+		}
+	}
+
 	auto ranges = self->shards.getAffectedRangesAfterInsertion(keys, ShardTrackedData());
 	for (int i = 0; i < ranges.size(); i++) {
 		if (!ranges[i].value.trackShard.isValid() && ranges[i].begin != keys.begin) {
@@ -798,9 +1009,13 @@ void restartShardTrackers(DataDistributionTracker* self, KeyRangeRef keys, Optio
 		ShardTrackedData data;
 		data.stats = shardMetrics;
 		data.trackShard = shardTracker(DataDistributionTracker::SafeAccessor(self), ranges[i], shardMetrics);
-		data.trackBytes = trackShardMetrics(DataDistributionTracker::SafeAccessor(self), ranges[i], shardMetrics);
+		data.metricsBatchChanged = trackShardMetrics(self, team, ranges[i], shardMetrics);
 		self->shards.insert(ranges[i], data);
 	}
+
+	for (auto& changed : replacedBatches) {
+		changed->trigger();
+	}
 }
 
 ACTOR Future<Void> trackInitialShards(DataDistributionTracker* self, Reference<InitialDataDistribution> initData) {
@@ -810,9 +1025,18 @@ ACTOR Future<Void> trackInitialShards(DataDistributionTracker* self, Reference<I
 	// SOMEDAY: Figure out what this priority should actually be
 	wait(delay(0.0, TaskPriority::DataDistribution));
 
+	// The metrics of shards on the same team are tracked in batches, so that the number of actors and requests tracking
+	// them scales with the number of teams rather than the number of shards
 	state int s;
 	for (s = 0; s < initData->shards.size() - 1; s++) {
-		restartShardTrackers(self, KeyRangeRef(initData->shards[s].key, initData->shards[s + 1].key));
+		DDShardInfo const& shard = initData->shards[s];
+		std::vector<UID> team = shard.hasDest ? shard.primaryDest : shard.primarySrc;
+		team.insert(team.end(),
+		            shard.hasDest ? shard.remoteDest.begin() : shard.remoteSrc.begin(),
+		            shard.hasDest ? shard.remoteDest.end() : shard.remoteSrc.end());
+		std::sort(team.begin(), team.end());
+		restartShardTrackers(
+		    self, KeyRangeRef(shard.key, initData->shards[s + 1].key), Optional<ShardMetrics>(), std::move(team));
 		wait(yield(TaskPriority::DataDistribution));
 	}
 
@@ -998,6 +998,10 @@ public:
 		ASSERT(initialized);
 		return endLocation();
 	}
+	location getPoppedLocation() const override {
+		ASSERT(initialized);
+		return poppedSeq;
+	}
 
 	Future<Void> getError() override { return rawQueue->getError(); }
 	Future<Void> onClosed() override { return rawQueue->onClosed(); }
@@ -1573,6 +1577,7 @@ public:
 	}
 	location getNextCommitLocation() const override { return queue->getNextCommitLocation(); }
 	location getNextPushLocation() const override { return queue->getNextPushLocation(); }
+	location getPoppedLocation() const override { return queue->getPoppedLocation(); }
 
 	location push(StringRef contents) override {
 		pushed = queue->push(contents);
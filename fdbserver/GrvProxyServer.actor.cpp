@@ -26,6 +26,7 @@
 #include "fdbserver/WaitFailure.h"
 #include "fdbserver/WorkerInterface.actor.h"
 #include "flow/flow.h"
+#include "flow/UnitTest.h"
 #include "flow/actorcompiler.h" // This must be the last #include.
 
 struct GrvProxyStats {
@@ -212,6 +213,133 @@ struct GrvTransactionRateInfo {
 	}
 };
 
+// Queues the GetReadVersion requests of one priority by transaction tag, and starts them from the queues of the tags in
+// deficit round robin order, so that a burst of requests with one tag does not hold up the requests with other tags
+// until Ratekeeper throttles the tag. Each queue in its turn may start up to GRV_TAG_QUEUE_QUANTUM transactions, plus
+// what it had left over from its previous turn. Requests with several tags are queued by the first of them, and
+// requests without tags share a queue.
+class GrvTagQueue {
+	struct TagQueue {
+		Deque<GetReadVersionRequest> requests;
+		int64_t transactions = 0;
+		int64_t deficit = 0;
+		GrvTagQueueStats stats;
+	};
+
+	TransactionTagMap<TagQueue> queues;
+	// The tags with queued requests, starting with the one whose turn it is
+	std::deque<TransactionTag> turns;
+	int requestCount = 0;
+
+	static TransactionTag queueTag(GetReadVersionRequest const& req) {
+		return req.tags.empty() ? TransactionTag() : req.tags.begin()->first;
+	}
+
+	void startTurn() {
+		TransactionTag const& tag = turns.front();
+		queues[tag].deficit += std::max<int64_t>(
+		    1, SERVER_KNOBS->GRV_TAG_QUEUE_QUANTUM * (tag.size() == 0 ? SERVER_KNOBS->GRV_UNTAGGED_QUEUE_WEIGHT : 1.0));
+	}
+
+	// Removes the tag from the turns once its queue is empty
+	void removeIfEmpty(TransactionTag const& tag, TagQueue& queue) {
+		if (!queue.requests.empty()) {
+			return;
+		}
+		queue.deficit = 0;
+		bool hadTurn = turns.front() == tag;
+		turns.erase(std::find(turns.begin(), turns.end(), tag));
+		if (hadTurn && !turns.empty()) {
+			startTurn();
+		}
+	}
+
+public:
+	Span span;
+
+	explicit GrvTagQueue(Location loc) : span(deterministicRandom()->randomUniqueID(), loc) {}
+
+	bool empty() const { return requestCount == 0; }
+	int size() const { return requestCount; }
+
+	void push_back(GetReadVersionRequest const& req) {
+		TransactionTag tag = queueTag(req);
+		TagQueue& queue = queues[tag];
+		if (queue.requests.empty()) {
+			turns.push_back(tag);
+			if (turns.size() == 1) {
+				startTurn();
+			}
+		}
+		queue.requests.push_back(req);
+		queue.transactions += req.transactionCount;
+		queue.stats.maxQueuedTransactions = std::max(queue.stats.maxQueuedTransactions, queue.transactions);
+		++requestCount;
+	}
+
+	// The next request to start. The transaction count and request time of the request are used by pop_front(), so
+	// they must be left in it if the request is moved out.
+	GetReadVersionRequest& front() {
+		ASSERT(!empty());
+		loop {
+			TagQueue& queue = queues[turns.front()];
+			if (queue.deficit >= queue.requests.front().transactionCount) {
+				return queue.requests.front();
+			}
+			turns.push_back(turns.front());
+			turns.pop_front();
+			startTurn();
+		}
+	}
+
+	// Removes the request returned by front(), which has been started
+	void pop_front() {
+		TransactionTag tag = turns.front();
+		TagQueue& queue = queues[tag];
+		GetReadVersionRequest& req = queue.requests.front();
+		queue.deficit -= req.transactionCount;
+		queue.transactions -= req.transactionCount;
+		queue.stats.addWait(g_network->timer() - req.requestTime(), req.transactionCount);
+		queue.requests.pop_front();
+		--requestCount;
+		removeIfEmpty(tag, queue);
+	}
+
+	// Removes the newest request of the tag with the most queued transactions, to make room for other requests
+	GetReadVersionRequest popLongest() {
+		ASSERT(!empty());
+		TransactionTag longest = turns.front();
+		for (auto const& tag : turns) {
+			if (queues[tag].transactions > queues[longest].transactions) {
+				longest = tag;
+			}
+		}
+		TagQueue& queue = queues[longest];
+		GetReadVersionRequest req = std::move(queue.requests.back());
+		queue.requests.pop_back();
+		queue.transactions -= req.transactionCount;
+		--requestCount;
+		removeIfEmpty(longest, queue);
+		return req;
+	}
+
+	// Adds the statistics of each tag's queue since the last call to stats, and forgets the tags with empty queues
+	void takeStats(TransactionTagMap<GrvTagQueueStats>& stats) {
+		for (auto it = queues.begin(); it != queues.end();) {
+			if (it->second.stats.maxQueuedTransactions > 0) {
+				stats[it->first] += it->second.stats;
+			}
+			if (it->second.requests.empty()) {
+				it = queues.erase(it);
+			} else {
+				it->second.stats = GrvTagQueueStats();
+				it->second.stats.maxQueuedTransactions = it->second.transactions;
+				++it;
+			}
+		}
+	}
+};
+
 struct GrvProxyData {
 	GrvProxyInterface proxy;
 	UID dbgid;
@@ -284,6 +412,7 @@ ACTOR Future<Void> getRate(UID myID,
                            GetHealthMetricsReply* detailedHealthMetricsReply,
                            TransactionTagMap<uint64_t>* transactionTagCounter,
                            PrioritizedTransactionTagMap<ClientTagThrottleLimits>* throttledTags,
+                           std::vector<GrvTagQueue*> tagQueues,
                            GrvProxyStats* stats) {
 	state Future<Void> nextRequestTimer = Never();
 	state Future<Void> leaseTimeout = Never();
@@ -315,8 +444,12 @@ ACTOR Future<Void> getRate(UID myID,
 					tagCounts[priorityThrottles.first] = (*transactionTagCounter)[priorityThrottles.first];
 				}
 			}
-			reply = brokenPromiseToNever(db->get().ratekeeper.get().getRateInfo.getReply(GetRateInfoRequest(
-			    myID, *inTransactionCount, *inBatchTransactionCount, *transactionTagCounter, detailed)));
+			GetRateInfoRequest req(
+			    myID, *inTransactionCount, *inBatchTransactionCount, *transactionTagCounter, detailed);
+			for (auto queue : tagQueues) {
+				queue->takeStats(req.tagQueueStats);
+			}
+			reply = brokenPromiseToNever(db->get().ratekeeper.get().getRateInfo.getReply(req));
 			transactionTagCounter->clear();
 			expectingDetailedReply = detailed;
 		}
@@ -369,16 +502,16 @@ void proxyGRVThresholdExceeded(const GetReadVersionRequest* req, GrvProxyStats*
 }
 
 // Drop a GetReadVersion request from a queue, by responding an error to the request.
-void dropRequestFromQueue(Deque<GetReadVersionRequest>* queue, GrvProxyStats* stats) {
-	proxyGRVThresholdExceeded(&queue->front(), stats);
-	queue->pop_front();
+void dropRequestFromQueue(GrvTagQueue* queue, GrvProxyStats* stats) {
+	GetReadVersionRequest req = queue->popLongest();
+	proxyGRVThresholdExceeded(&req, stats);
 }
 
 // Put a GetReadVersion request into the queue corresponding to its priority.
 ACTOR Future<Void> queueGetReadVersionRequests(Reference<AsyncVar<ServerDBInfo> const> db,
-                                               SpannedDeque<GetReadVersionRequest>* systemQueue,
-                                               SpannedDeque<GetReadVersionRequest>* defaultQueue,
-                                               SpannedDeque<GetReadVersionRequest>* batchQueue,
+                                               GrvTagQueue* systemQueue,
+                                               GrvTagQueue* defaultQueue,
+                                               GrvTagQueue* batchQueue,
                                                FutureStream<GetReadVersionRequest> readVersionRequests,
                                                PromiseStream<Void> GRVTimer,
                                                double* lastGRVTime,
@@ -694,9 +827,9 @@ ACTOR static Future<Void> transactionStarter(GrvProxyInterface proxy,
 	state GrvTransactionRateInfo normalRateInfo(10);
 	state GrvTransactionRateInfo batchRateInfo(0);
 
-	state SpannedDeque<GetReadVersionRequest> systemQueue("GP:transactionStarterSystemQueue"_loc);
-	state SpannedDeque<GetReadVersionRequest> defaultQueue("GP:transactionStarterDefaultQueue"_loc);
-	state SpannedDeque<GetReadVersionRequest> batchQueue("GP:transactionStarterBatchQueue"_loc);
+	state GrvTagQueue systemQueue("GP:transactionStarterSystemQueue"_loc);
+	state GrvTagQueue defaultQueue("GP:transactionStarterDefaultQueue"_loc);
+	state GrvTagQueue batchQueue("GP:transactionStarterBatchQueue"_loc);
 
 	state TransactionTagMap<uint64_t> transactionTagCounter;
 	state PrioritizedTransactionTagMap<ClientTagThrottleLimits> throttledTags;
@@ -717,6 +850,7 @@ ACTOR static Future<Void> transactionStarter(GrvProxyInterface proxy,
 	                      detailedHealthMetricsReply,
 	                      &transactionTagCounter,
 	                      &throttledTags,
+	                      { &systemQueue, &defaultQueue, &batchQueue },
 	                      &grvProxyData->stats));
 	addActor.send(queueGetReadVersionRequests(db,
 	                                          &systemQueue,
@@ -773,7 +907,7 @@ ACTOR static Future<Void> transactionStarter(GrvProxyInterface proxy,
 		uint32_t defaultQueueSize = defaultQueue.size();
 		uint32_t batchQueueSize = batchQueue.size();
 		while (requestsToStart < SERVER_KNOBS->START_TRANSACTION_MAX_REQUESTS_TO_START) {
-			SpannedDeque<GetReadVersionRequest>* transactionQueue;
+			GrvTagQueue* transactionQueue;
 			if (!systemQueue.empty()) {
 				transactionQueue = &systemQueue;
 			} else if (!defaultQueue.empty()) {
@@ -974,3 +1108,44 @@ ACTOR Future<Void> grvProxyServer(GrvProxyInterface proxy,
 	}
 	return Void();
 }
+
+TEST_CASE("/fdbserver/GrvProxyServer/GrvTagQueue") {
+	GrvTagQueue queue("GrvTagQueueTest"_loc);
+	TransactionTagMap<uint32_t> noisyTags, quietTags;
+	noisyTags["noisy"_sr] = 1;
+	quietTags["quiet"_sr] = 1;
+	for (int i = 0; i < 1000; i++) {
+		queue.push_back(GetReadVersionRequest(SpanID(), 1, TransactionPriority::DEFAULT, 0, noisyTags));
+	}
+	for (int i = 0; i < 5; i++) {
+		queue.push_back(GetReadVersionRequest(SpanID(), 1, TransactionPriority::DEFAULT, 0, quietTags));
+	}
+	queue.push_back(GetReadVersionRequest(SpanID(), 1, TransactionPriority::DEFAULT));
+	ASSERT(queue.size() == 1006);
+
+	// The requests queued behind the burst are started after at most a turn of the noisy tag each
+	int started = 0, quietStarted = 0;
+	while (quietStarted < 5) {
+		if (queue.front().tags.count("quiet"_sr)) {
+			++quietStarted;
+		}
+		queue.pop_front();
+		++started;
+	}
+	ASSERT(started <= 6 + 6 * SERVER_KNOBS->GRV_TAG_QUEUE_QUANTUM);
+
+	// Requests are dropped from the longest queue first
+	GetReadVersionRequest dropped = queue.popLongest();
+	ASSERT(dropped.tags.count("noisy"_sr));
+
+	TransactionTagMap<GrvTagQueueStats> stats;
+	queue.takeStats(stats);
+	ASSERT(stats["noisy"_sr].maxQueuedTransactions == 1000);
+	ASSERT(stats["quiet"_sr].startedTransactions == 5);
+
+	while (!queue.empty()) {
+		queue.pop_front();
+	}
+	ASSERT(queue.size() == 0);
+	return Void();
+}
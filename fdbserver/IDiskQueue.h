@@ -80,6 +80,8 @@ public:
 	    const = 0; // If commit() were to be called, all buffered writes would be written starting at `location`.
 	virtual location getNextPushLocation()
 	    const = 0; // If push() were to be called, the pushed data would be written starting at `location`.
+	virtual location getPoppedLocation()
+	    const = 0; // All bytes before `location` have been popped.  Only valid after initializeRecovery().
 
 	virtual Future<Standalone<StringRef>> read(location start, location end, CheckHashes vc) = 0;
 	virtual location push(StringRef contents) = 0; // Appends the given bytes to the byte stream.  Returns a location
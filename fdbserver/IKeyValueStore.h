@@ -39,11 +39,38 @@ public:
 	                          // may not take effect in the background.
 };
 
+// Reads ranges of a store like IKeyValueStore::readRange(), but keeps its position in the store between reads, so that
+// a read beginning where the last one ended needn't seek again.  A cursor may read the store as of any commit which
+// ended since the cursor was opened.  The reads of a cursor must be issued one at a time.
+class IKeyValueCursor : public ReferenceCounted<IKeyValueCursor> {
+public:
+	virtual ~IKeyValueCursor() {}
+	virtual Future<RangeResult> readRange(KeyRangeRef keys, int rowLimit = 1 << 30, int byteLimit = 1 << 30) = 0;
+};
+
+// Statistics of a store that caches blocks and compacts them in the background, which other stores don't report
+struct KeyValueStoreEngineStats {
+	double blockCacheHitRate = 1.0; // The fraction of block reads served from the cache over a recent interval
+	int64_t stallMicros = 0; // The total time writes have been stalled on compaction or flushes since the store opened
+	int64_t l0Files = 0; // The number of files waiting to be compacted out of level 0
+};
+
 class IKeyValueStore : public IClosable {
 public:
 	virtual KeyValueStoreType getType() const = 0;
 	virtual void set(KeyValueRef keyValue, const Arena* arena = nullptr) = 0;
 	virtual void clear(KeyRangeRef range, const Arena* arena = nullptr) = 0;
+
+	// Sets kvs, which are sorted and all within range, into range, which is empty.  Stores which can write sorted
+	// data more efficiently than one key at a time override this and canSetSortedRange().  The default sets every key
+	// synchronously, so callers writing large ranges to other stores should call set() with yields in between.
+	virtual void setSortedRange(KeyRangeRef range, VectorRef<KeyValueRef> kvs, const Arena* arena = nullptr) {
+		for (auto& kv : kvs) {
+			set(kv, arena);
+		}
+	}
+	virtual bool canSetSortedRange() const { return false; }
+
 	virtual Future<Void> commit(
 	    bool sequential = false) = 0; // returns when prior sets and clears are (atomically) durable
 
@@ -58,6 +85,35 @@ public:
 	// The total size of the returned value (less the last entry) will be less than byteLimit
 	virtual Future<RangeResult> readRange(KeyRangeRef keys, int rowLimit = 1 << 30, int byteLimit = 1 << 30) = 0;
 
+	// Like readValuePrefix() of each key, sorted ascending, with the maxLength paired with it.  The keys need only be
+	// valid until this returns.  Stores which read many keys more cheaply together than one at a time, such as those
+	// reading on a thread pool, override this and readRanges().
+	virtual Future<std::vector<Optional<Value>>> readValuePrefixes(std::vector<std::pair<KeyRef, int>> const& keys,
+	                                                               Optional<UID> debugID = Optional<UID>()) {
+		std::vector<Future<Optional<Value>>> values;
+		values.reserve(keys.size());
+		for (auto const& [key, maxLength] : keys) {
+			values.push_back(readValuePrefix(key, maxLength, debugID));
+		}
+		return getAll(values);
+	}
+
+	// Like readRange() of each of ranges, sorted ascending, with the same limits for each
+	virtual Future<std::vector<RangeResult>> readRanges(std::vector<KeyRangeRef> const& ranges,
+	                                                    int rowLimit = 1 << 30,
+	                                                    int byteLimit = 1 << 30) {
+		std::vector<Future<RangeResult>> results;
+		results.reserve(ranges.size());
+		for (auto const& range : ranges) {
+			results.push_back(readRange(range, rowLimit, byteLimit));
+		}
+		return getAll(results);
+	}
+
+	// Stores which can continue a read where the last one ended without seeking override this, and the default cursor
+	// just calls readRange()
+	virtual Reference<IKeyValueCursor> openCursor();
+
 	// To debug MEMORY_RADIXTREE type ONLY
 	// Returns (1) how many key & value pairs have been inserted (2) how many nodes have been created (3) how many
 	// key size is less than 12 bytes
@@ -66,10 +122,38 @@ public:
 	// Returns the amount of free and total space for this store, in bytes
 	virtual StorageBytes getStorageBytes() const = 0;
 
+	// Returns the bytes this store estimates it must compact in the background to catch up with its writes, for stores
+	// that slow writes down once too many are pending
+	virtual int64_t getPendingCompactionBytes() const { return 0; }
+
+	virtual Optional<KeyValueStoreEngineStats> getEngineStats() const { return Optional<KeyValueStoreEngineStats>(); }
+
 	virtual void resyncLog() {}
 
 	virtual void enableSnapshot() {}
 
+	// Stores which can keep earlier commits readable (see STORAGE_SNAPSHOT_RETENTION_VERSIONS) override the following.
+	virtual bool canRetainSnapshots() const { return false; }
+
+	// Labels the next commit() with the version of the data it makes durable, and allows the store to discard
+	// commits labelled with versions older than oldestRetainedVersion
+	virtual void setCommitVersion(Version version, Version oldestRetainedVersion) {}
+
+	// Returns true if the commit labelled with exactly the given version can be read with readValueAt()/readRangeAt()
+	virtual bool retainsSnapshot(Version version) const { return false; }
+
+	// Like readValue() and readRange(), but read the commit labelled with the given version. Throw
+	// transaction_too_old if it is not retained.
+	virtual Future<Optional<Value>> readValueAt(KeyRef key, Version version, Optional<UID> debugID = Optional<UID>()) {
+		return transaction_too_old();
+	}
+	virtual Future<RangeResult> readRangeAt(KeyRangeRef keys,
+	                                        Version version,
+	                                        int rowLimit = 1 << 30,
+	                                        int byteLimit = 1 << 30) {
+		return transaction_too_old();
+	}
+
 	/*
 	Concurrency contract
 	    Causal consistency:
@@ -94,6 +178,21 @@ protected:
 	virtual ~IKeyValueStore() {}
 };
 
+class ReadRangeCursor final : public IKeyValueCursor {
+public:
+	explicit ReadRangeCursor(IKeyValueStore* store) : store(store) {}
+	Future<RangeResult> readRange(KeyRangeRef keys, int rowLimit = 1 << 30, int byteLimit = 1 << 30) override {
+		return store->readRange(keys, rowLimit, byteLimit);
+	}
+
+private:
+	IKeyValueStore* store;
+};
+
+inline Reference<IKeyValueCursor> IKeyValueStore::openCursor() {
+	return makeReference<ReadRangeCursor>(this);
+}
+
 extern IKeyValueStore* keyValueStoreSQLite(std::string const& filename,
                                            UID logID,
                                            KeyValueStoreType storeType,
@@ -25,8 +25,10 @@
 #include "fdbserver/IDiskQueue.h"
 #include "fdbserver/IKeyValueContainer.h"
 #include "fdbserver/IKeyValueStore.h"
+#include "fdbserver/PackedKeyValueContainer.h"
 #include "fdbserver/RadixTree.h"
 #include "flow/ActorCollection.h"
+#include "flow/crc32c.h"
 #include "flow/actorcompiler.h" // This must be the last #include.
 
 #define OP_DISK_OVERHEAD (sizeof(OpHeader) + 1)
@@ -40,13 +42,18 @@ public:
 	                    KeyValueStoreType storeType,
 	                    bool disableSnapshot,
 	                    bool replaceContent,
-	                    bool exactRecovery);
+	                    bool exactRecovery,
+	                    std::string checkpointFilename = std::string());
 
 	// IClosable
 	Future<Void> getError() override { return log->getError(); }
 	Future<Void> onClosed() override { return log->onClosed(); }
 	void dispose() override {
 		recovering.cancel();
+		checkpointing.cancel();
+		if (!checkpointFilename.empty()) {
+			deleteCheckpoint(id, checkpointFilename);
+		}
 		log->dispose();
 		if (reserved_buffer != nullptr) {
 			delete[] reserved_buffer;
@@ -56,6 +63,7 @@ public:
 	}
 	void close() override {
 		recovering.cancel();
+		checkpointing.cancel();
 		log->close();
 		if (reserved_buffer != nullptr) {
 			delete[] reserved_buffer;
@@ -165,7 +173,7 @@ public:
 			if (disableSnapshot) {
 				return Void();
 			}
-			log_op(OpCommit, StringRef(), StringRef());
+			lastCommitLocation = log_op(OpCommit, StringRef(), StringRef());
 		} else {
 			int64_t bytesWritten = commit_queue(queue, !disableSnapshot, sequential);
 
@@ -178,7 +186,7 @@ public:
 				                       OP_DISK_OVERHEAD; // OP_DISK_OVERHEAD is for the following log_op(OpCommit)
 				notifiedCommittedWriteBytes.set(committedWriteBytes); // This set will cause snapshot items to be
 				                                                      // written, so it must happen before the OpCommit
-				log_op(OpCommit, StringRef(), StringRef());
+				lastCommitLocation = log_op(OpCommit, StringRef(), StringRef());
 				overheadWriteBytes = log->getCommitOverhead();
 			}
 		}
@@ -190,7 +198,7 @@ public:
 		transactionIsLarge = false;
 		firstCommitWithSnapshot = false;
 
-		addActor.send(commitAndUpdateVersions(this, c, previousSnapshotEnd));
+		addActor.send(commitAndUpdateVersions(this, c, previousSnapshotEnd, ++commitsStarted));
 		return c;
 	}
 
@@ -225,6 +233,38 @@ public:
 		}
 	}
 
+	// Reads the whole batch at once, rather than returning a ready future for each key
+	Future<std::vector<Optional<Value>>> readValuePrefixes(std::vector<std::pair<KeyRef, int>> const& keys,
+	                                                       Optional<UID> debugID = Optional<UID>()) override {
+		if (recovering.isError())
+			throw recovering.getError();
+		if (!recovering.isReady())
+			return IKeyValueStore::readValuePrefixes(keys, debugID);
+
+		std::vector<Optional<Value>> values;
+		values.reserve(keys.size());
+		for (auto const& [key, maxLength] : keys) {
+			values.push_back(readValuePrefix(key, maxLength).get());
+		}
+		return values;
+	}
+
+	Future<std::vector<RangeResult>> readRanges(std::vector<KeyRangeRef> const& ranges,
+	                                            int rowLimit = 1 << 30,
+	                                            int byteLimit = 1 << 30) override {
+		if (recovering.isError())
+			throw recovering.getError();
+		if (!recovering.isReady())
+			return IKeyValueStore::readRanges(ranges, rowLimit, byteLimit);
+
+		std::vector<RangeResult> results;
+		results.reserve(ranges.size());
+		for (auto const& range : ranges) {
+			results.push_back(readRange(range, rowLimit, byteLimit).get());
+		}
+		return results;
+	}
+
 	// If rowLimit>=0, reads first rows sorted ascending, otherwise reads last rows sorted descending
 	// The total size of the returned value (less the last entry) will be less than byteLimit
 	Future<RangeResult> readRange(KeyRangeRef keys, int rowLimit = 1 << 30, int byteLimit = 1 << 30) override {
@@ -306,6 +346,58 @@ private:
 		int len1, len2;
 	};
 
+	// A checkpoint is a file holding the data of the store as of the end of some commit in the log, so that recovery
+	// can load it and replay only the log after that commit.  It is written while later commits proceed, so it can also
+	// hold the effects of some of their mutations, which is harmless since replaying the log repeats them.  The file
+	// is a sequence of blocks of sorted, prefix compressed key value pairs, then a CheckpointMeta holding the index of
+	// the blocks, then a CheckpointFooter.
+	struct CheckpointBlock {
+		Key firstKey;
+		int64_t offset;
+		int size;
+		uint32_t checksum;
+
+		template <class Ar>
+		void serialize(Ar& ar) {
+			serializer(ar, firstKey, offset, size, checksum);
+		}
+	};
+
+	struct CheckpointMeta {
+		// The log location to replay from, and the snapshot state recovery would have reached there
+		IDiskQueue::location location;
+		IDiskQueue::location previousSnapshotEnd, currentSnapshotEnd;
+		Key nextSnapshotKey;
+		int64_t items;
+		std::vector<CheckpointBlock> blocks;
+
+		CheckpointMeta() : items(0) {}
+
+		template <class Ar>
+		void serialize(Ar& ar) {
+			serializer(ar, location, previousSnapshotEnd, currentSnapshotEnd, nextSnapshotKey, items, blocks);
+		}
+	};
+
+#pragma pack(push, 1)
+	struct CheckpointFooter {
+		uint64_t magic;
+		int64_t metaOffset;
+		int metaSize;
+		uint32_t metaChecksum;
+	};
+
+	// Each key value pair in a checkpoint block is one of these followed by the key suffix and the value.  The first
+	// pair in a block borrows nothing from the previous key.
+	struct CheckpointEntryHeader {
+		uint16_t prefixLength; // Bytes borrowed from the previous key
+		uint16_t suffixLength;
+		uint32_t valueLength;
+	};
+#pragma pack(pop)
+
+	static constexpr uint64_t checkpointMagic = 0x4650434d454d4b56;
+
 	struct OpQueue {
 		OpQueue() : numBytes(0) {}
 
@@ -390,6 +482,16 @@ private:
 	int64_t memoryLimit; // The upper limit on the memory used by the store (excluding, possibly, some clear operations)
 	std::vector<std::pair<KeyValueMapPair, uint64_t>> dataSets;
 
+	std::string checkpointFilename; // Empty if this store does not keep a checkpoint
+	Future<Void> checkpointing;
+	IDiskQueue::location lastCommitLocation; // The end of the most recently logged OpCommit
+	Key nextSnapshotKey; // The next key in the current snapshot as of lastCommitLocation, unless resetSnapshot is set
+	int64_t commitsStarted;
+	NotifiedVersion commitsDurable; // The number of the latest commit known to be durable
+	IDiskQueue::location checkpointLocation; // The log is not popped past here, so that recovery can replay it from the
+	                                         // durable checkpoint and from any checkpoint being written
+	bool checkpointDurable;
+
 	int64_t commit_queue(OpQueue& ops, bool log, bool sequential = false) {
 		int64_t total = 0, count = 0;
 		IDiskQueue::location log_location = 0;
@@ -449,15 +551,34 @@ private:
 	}
 
 	ACTOR static Future<Void> recover(KeyValueStoreMemory* self, bool exactRecovery) {
+		state bool checkpointLoaded = false;
+		state bool logEmpty = false;
+		if (!self->checkpointFilename.empty() && fileExists(self->checkpointFilename)) {
+			if (SERVER_KNOBS->MEMORY_CHECKPOINT_INTERVAL > 0) {
+				bool loaded = wait(loadCheckpoint(self, &logEmpty));
+				checkpointLoaded = loaded;
+			}
+			if (!checkpointLoaded) {
+				// The log is replayed from its beginning instead (a rejected checkpoint leaves it positioned there),
+				// but the checkpoint must be gone before the log is popped any further
+				TraceEvent("KVSMemDiscardingCheckpoint", self->id).detail("Filename", self->checkpointFilename);
+				wait(IAsyncFileSystem::filesystem()->deleteFile(self->checkpointFilename, true));
+			}
+		}
+
 		loop {
+			if (!checkpointLoaded) {
+				self->previousSnapshotEnd = self->currentSnapshotEnd =
+				    self->log->getNextReadLocation(); // not really, but popping up to here does nothing
+			}
+
 			// 'uncommitted' variables track something that might be rolled back by an OpRollback, and are copied into
 			// permanent variables (in self) in OpCommit.  OpRollback does the reverse (copying the permanent versions
 			// over the uncommitted versions) the uncommitted and committed variables should be equal initially (to
 			// whatever makes sense if there are no committed transactions recovered)
 			state Key uncommittedNextKey = self->recoveredSnapshotKey;
-			state IDiskQueue::location uncommittedPrevSnapshotEnd = self->previousSnapshotEnd =
-			    self->log->getNextReadLocation(); // not really, but popping up to here does nothing
-			state IDiskQueue::location uncommittedSnapshotEnd = self->currentSnapshotEnd = uncommittedPrevSnapshotEnd;
+			state IDiskQueue::location uncommittedPrevSnapshotEnd = self->previousSnapshotEnd;
+			state IDiskQueue::location uncommittedSnapshotEnd = self->currentSnapshotEnd;
 
 			state int zeroFillSize = 0;
 			state int dbgSnapshotItemCount = 0;
@@ -477,6 +598,10 @@ private:
 
 			try {
 				loop {
+					if (logEmpty) {
+						TraceEvent("KVSMemRecoveryComplete", self->id).detail("Reason", "Log is empty");
+						break;
+					}
 					{
 						Standalone<StringRef> data = wait(self->log->readNext(sizeof(OpHeader)));
 						if (data.size() != sizeof(OpHeader)) {
@@ -626,6 +751,7 @@ private:
 				    .detail("SnapshotEnd", dbgSnapshotEndCount)
 				    .detail("Mutations", dbgMutationCount)
 				    .detail("Commits", dbgCommitCount)
+				    .detail("CheckpointLoaded", checkpointLoaded)
 				    .detail("TimeTaken", now() - startt);
 
 				self->semiCommit();
@@ -634,7 +760,8 @@ private:
 				bool ok = e.code() == error_code_operation_cancelled || e.code() == error_code_file_not_found ||
 				          e.code() == error_code_disk_adapter_reset;
 				TraceEvent(ok ? SevInfo : SevError, "ErrorDuringRecovery", dbgid).error(e, true);
-				if (e.code() != error_code_disk_adapter_reset) {
+				// The log can't be replayed again from the checkpoint, whose data is about to be cleared
+				if (e.code() != error_code_disk_adapter_reset || checkpointLoaded) {
 					throw e;
 				}
 				self->data.clear();
@@ -688,6 +815,9 @@ private:
 		TraceEvent("KVSMemStartingSnapshot", self->id).detail("StartKey", nextKey);
 
 		loop {
+			// Snapshot items are only written during commits, before their OpCommit, so this is where recovery would
+			// continue the snapshot after replaying up to the end of the latest commit
+			self->nextSnapshotKey = nextKeyAfter ? keyAfter(nextKey) : nextKey;
 			wait(self->notifiedCommittedWriteBytes.whenAtLeast(snapshotTotalWrittenBytes + 1));
 
 			if (self->resetSnapshot) {
@@ -824,6 +954,285 @@ private:
 		}
 	}
 
+	ACTOR static Future<Void> checkpointer(KeyValueStoreMemory* self) {
+		wait(self->recovering);
+		state int64_t checkpointedCommits = 0;
+		loop {
+			wait(delay(SERVER_KNOBS->MEMORY_CHECKPOINT_INTERVAL));
+			// There is nothing to checkpoint before the first commit, and nothing new without another one
+			if (self->commitsStarted > checkpointedCommits) {
+				checkpointedCommits = self->commitsStarted;
+				wait(writeCheckpoint(self));
+			}
+		}
+	}
+
+	// Writes the data in the container to a new checkpoint file, which replaces the previous one once it is usable
+	ACTOR static Future<Void> writeCheckpoint(KeyValueStoreMemory* self) {
+		state CheckpointMeta meta;
+		state Reference<IAsyncFile> file;
+		state Standalone<StringRef> block;
+		state Key lastKey;
+		state int64_t offset = 0;
+		state Standalone<StringRef> metaBytes;
+		state CheckpointFooter footer;
+		state double startTime = now();
+
+		meta.location = self->lastCommitLocation;
+		meta.previousSnapshotEnd = self->previousSnapshotEnd;
+		meta.currentSnapshotEnd = self->currentSnapshotEnd;
+		meta.nextSnapshotKey = self->resetSnapshot ? Key() : self->nextSnapshotKey;
+
+		// Until this checkpoint is durable recovery could still need the log from the previous one, if any
+		if (!self->checkpointDurable) {
+			self->checkpointLocation = meta.location;
+		}
+
+		try {
+			Reference<IAsyncFile> f = wait(IAsyncFileSystem::filesystem()->open(
+			    self->checkpointFilename,
+			    IAsyncFile::OPEN_ATOMIC_WRITE_AND_CREATE | IAsyncFile::OPEN_CREATE | IAsyncFile::OPEN_READWRITE |
+			        IAsyncFile::OPEN_UNCACHED,
+			    0600));
+			file = f;
+
+			loop {
+				// The container may have changed during the last write, so continue from the last key written
+				auto it = meta.blocks.empty() ? self->data.begin() : self->data.upper_bound(lastKey);
+				if (it == self->data.end()) {
+					break;
+				}
+
+				CheckpointBlock info;
+				info.offset = offset;
+				BinaryWriter writer(Unversioned());
+				std::string prevKey;
+				bool first = true;
+				while (it != self->data.end() && writer.getLength() < SERVER_KNOBS->MEMORY_CHECKPOINT_BLOCK_BYTES) {
+					KeyRef key = it.getKey(self->reserved_buffer);
+					ValueRef value = it.getValue();
+					if (first) {
+						info.firstKey = key;
+						first = false;
+					}
+
+					CheckpointEntryHeader h;
+					h.prefixLength = commonPrefixLength(key, StringRef((const uint8_t*)prevKey.data(), prevKey.size()));
+					h.suffixLength = key.size() - h.prefixLength;
+					h.valueLength = value.size();
+					writer.serializeBytes(&h, sizeof(h));
+					writer.serializeBytes(key.substr(h.prefixLength));
+					writer.serializeBytes(value);
+
+					prevKey.assign((const char*)key.begin(), key.size());
+					++meta.items;
+					++it;
+				}
+				lastKey = StringRef((const uint8_t*)prevKey.data(), prevKey.size());
+
+				block = writer.toValue();
+				info.size = block.size();
+				info.checksum = crc32c_append(0, block.begin(), block.size());
+				meta.blocks.push_back(info);
+				wait(file->write(block.begin(), block.size(), offset));
+				offset += block.size();
+			}
+
+			metaBytes = BinaryWriter::toValue(meta, Unversioned());
+			footer.magic = checkpointMagic;
+			footer.metaOffset = offset;
+			footer.metaSize = metaBytes.size();
+			footer.metaChecksum = crc32c_append(0, metaBytes.begin(), metaBytes.size());
+			wait(file->write(metaBytes.begin(), metaBytes.size(), offset));
+			wait(file->write(&footer, sizeof(footer), offset + metaBytes.size()));
+
+			// The checkpoint can hold mutations logged after meta.location that are not committed yet, or in large
+			// transaction mode not even logged, so it is only usable once a commit started after it is durable
+			wait(self->commitsDurable.whenAtLeast(self->commitsStarted + 1));
+			wait(file->sync());
+			self->checkpointLocation = meta.location;
+			self->checkpointDurable = true;
+
+			TraceEvent("KVSMemCheckpointWritten", self->id)
+			    .detail("Location", meta.location)
+			    .detail("Items", meta.items)
+			    .detail("Blocks", meta.blocks.size())
+			    .detail("Bytes", footer.metaOffset + footer.metaSize + sizeof(footer))
+			    .detail("TimeTaken", now() - startTime);
+		} catch (Error& e) {
+			if (e.code() == error_code_actor_cancelled) {
+				throw;
+			}
+			TraceEvent(SevWarnAlways, "KVSMemCheckpointFailed", self->id).error(e);
+			if (!self->checkpointDurable) {
+				self->checkpointLocation = std::numeric_limits<int64_t>::max();
+			}
+		}
+		return Void();
+	}
+
+	// Inserts the key value pairs of a checkpoint block into the container, returning how many there were
+	int loadCheckpointBlock(StringRef block, KeyRef firstKey) {
+		std::string key;
+		const uint8_t* p = block.begin();
+		int count = 0;
+		while (p != block.end()) {
+			CheckpointEntryHeader h;
+			if (block.end() - p < (int)sizeof(h)) {
+				throw checksum_failed();
+			}
+			memcpy(&h, p, sizeof(h));
+			p += sizeof(h);
+			if (h.prefixLength > key.size() || block.end() - p < (int64_t)h.suffixLength + h.valueLength) {
+				throw checksum_failed();
+			}
+
+			key.resize(h.prefixLength);
+			key.append((const char*)p, h.suffixLength);
+			p += h.suffixLength;
+			KeyRef k((const uint8_t*)key.data(), key.size());
+			ValueRef v(p, h.valueLength);
+			p += h.valueLength;
+			if (count++ == 0 && k != firstKey) {
+				throw checksum_failed();
+			}
+			// Only IKeyValueContainer inserts batches faster than single pairs, and radix_tree can't insert them at all
+			if constexpr (std::is_same<Container, IKeyValueContainer>::value) {
+				KeyValueMapPair pair(k, v);
+				dataSets.emplace_back(pair, pair.arena.getSize() + data.getElementBytes());
+			} else {
+				data.insert(k, v);
+			}
+		}
+		if (!dataSets.empty()) {
+			data.insert(dataSets);
+			dataSets.clear();
+		}
+		return count;
+	}
+
+	// Loads the checkpoint into the empty container and prepares the log to be replayed from where the checkpoint was
+	// taken, returning false (with the container left empty) if the checkpoint can't be used
+	ACTOR static Future<bool> loadCheckpoint(KeyValueStoreMemory* self, bool* logEmpty) {
+		state Reference<IAsyncFile> file;
+		state int64_t size;
+		state CheckpointFooter footer;
+		state Standalone<StringRef> metaBytes;
+		state CheckpointMeta meta;
+		state std::deque<std::pair<Standalone<StringRef>, Future<int>>> reads;
+		state int nextRead = 0;
+		state int b;
+		state int64_t items = 0;
+		state double startTime = now();
+
+		try {
+			Reference<IAsyncFile> f = wait(IAsyncFileSystem::filesystem()->open(
+			    self->checkpointFilename, IAsyncFile::OPEN_READONLY | IAsyncFile::OPEN_UNCACHED, 0));
+			file = f;
+			int64_t fileSize = wait(file->size());
+			size = fileSize;
+			if (size < (int64_t)sizeof(footer)) {
+				throw checksum_failed();
+			}
+
+			int footerBytes = wait(file->read(&footer, sizeof(footer), size - sizeof(footer)));
+			if (footerBytes != (int)sizeof(footer) || footer.magic != checkpointMagic || footer.metaSize < 0 ||
+			    footer.metaOffset + footer.metaSize + (int64_t)sizeof(footer) != size) {
+				throw checksum_failed();
+			}
+			metaBytes = makeString(footer.metaSize);
+			int metaRead = wait(file->read(mutateString(metaBytes), footer.metaSize, footer.metaOffset));
+			if (metaRead != footer.metaSize ||
+			    crc32c_append(0, metaBytes.begin(), metaBytes.size()) != footer.metaChecksum) {
+				throw checksum_failed();
+			}
+			meta = BinaryReader::fromStringRef<CheckpointMeta>(metaBytes, Unversioned());
+
+			// Blocks are read ahead of the one being inserted so that the reads overlap with building the container
+			for (b = 0; b < meta.blocks.size(); ++b) {
+				while (nextRead < meta.blocks.size() &&
+				       nextRead <= b + SERVER_KNOBS->MEMORY_CHECKPOINT_READ_AHEAD_BLOCKS) {
+					CheckpointBlock const& next = meta.blocks[nextRead++];
+					Standalone<StringRef> buf = makeString(next.size);
+					reads.emplace_back(buf, file->read(mutateString(buf), next.size, next.offset));
+				}
+				int bytesRead = wait(reads.front().second);
+				Standalone<StringRef> block = reads.front().first;
+				reads.pop_front();
+
+				CheckpointBlock const& info = meta.blocks[b];
+				if (bytesRead != info.size || crc32c_append(0, block.begin(), block.size()) != info.checksum) {
+					throw checksum_failed();
+				}
+				items += self->loadCheckpointBlock(block, info.firstKey);
+				wait(yield());
+			}
+			if (items != meta.items) {
+				throw checksum_failed();
+			}
+
+			// The log always holds at least the commit that made the checkpoint durable, so if it is empty the
+			// checkpoint doesn't belong to it
+			bool recovered = wait(self->log->initializeRecovery(meta.location));
+			if (recovered) {
+				*logEmpty = true;
+				self->data.clear();
+				TraceEvent(SevWarnAlways, "KVSMemCheckpointWithoutLog", self->id)
+				    .detail("Filename", self->checkpointFilename);
+				return false;
+			}
+			// The queue starts reading at its popped location instead if that is later, so a checkpoint older than
+			// the log can't be replayed from.  The log is then positioned exactly where a full replay would start.
+			// (A read location past meta.location only because it skipped a page header is still fine.)
+			if (self->log->getPoppedLocation() > meta.location) {
+				TraceEvent(SevWarnAlways, "KVSMemCheckpointBeforeLog", self->id)
+				    .detail("Filename", self->checkpointFilename)
+				    .detail("Location", meta.location)
+				    .detail("Popped", self->log->getPoppedLocation())
+				    .detail("NextReadLocation", self->log->getNextReadLocation());
+				self->data.clear();
+				return false;
+			}
+		} catch (Error& e) {
+			if (e.code() == error_code_actor_cancelled) {
+				throw;
+			}
+			TraceEvent(SevWarnAlways, "KVSMemCheckpointUnusable", self->id)
+			    .error(e)
+			    .detail("Filename", self->checkpointFilename);
+			self->data.clear();
+			self->dataSets.clear();
+			return false;
+		}
+
+		self->recoveredSnapshotKey = meta.nextSnapshotKey;
+		self->previousSnapshotEnd = meta.previousSnapshotEnd;
+		self->currentSnapshotEnd = meta.currentSnapshotEnd;
+		self->checkpointLocation = meta.location;
+		self->checkpointDurable = true;
+
+		TraceEvent("KVSMemCheckpointLoaded", self->id)
+		    .detail("Location", meta.location)
+		    .detail("Items", items)
+		    .detail("Blocks", meta.blocks.size())
+		    .detail("Bytes", size)
+		    .detail("TimeTaken", now() - startTime);
+		return true;
+	}
+
+	// Deletes the checkpoint of a store that is being disposed
+	ACTOR static void deleteCheckpoint(UID id, std::string filename) {
+		try {
+			wait(IAsyncFileSystem::filesystem()->deleteFile(filename, false));
+		} catch (Error& e) {
+			TraceEvent(e.code() == error_code_file_not_found ? SevInfo : SevWarnAlways,
+			           "KVSMemDeleteCheckpointError",
+			           id)
+			    .error(e)
+			    .detail("Filename", filename);
+		}
+	}
+
 	ACTOR static Future<Optional<Value>> waitAndReadValue(KeyValueStoreMemory* self, Key key) {
 		wait(self->recovering);
 		return self->readValue(key).get();
@@ -846,9 +1255,13 @@ private:
 	}
 	ACTOR static Future<Void> commitAndUpdateVersions(KeyValueStoreMemory* self,
 	                                                  Future<Void> commit,
-	                                                  IDiskQueue::location location) {
+	                                                  IDiskQueue::location location,
+	                                                  int64_t commitNumber) {
 		wait(commit);
-		self->log->pop(location);
+		self->log->pop(std::min(location, self->checkpointLocation));
+		if (commitNumber > self->commitsDurable.get()) {
+			self->commitsDurable.set(commitNumber);
+		}
 		return Void();
 	}
 };
@@ -860,11 +1273,13 @@ KeyValueStoreMemory<Container>::KeyValueStoreMemory(IDiskQueue* log,
                                                     KeyValueStoreType storeType,
                                                     bool disableSnapshot,
                                                     bool replaceContent,
-                                                    bool exactRecovery)
+                                                    bool exactRecovery,
+                                                    std::string checkpointFilename)
   : log(log), id(id), type(storeType), previousSnapshotEnd(-1), currentSnapshotEnd(-1), resetSnapshot(false),
     memoryLimit(memoryLimit), committedWriteBytes(0), overheadWriteBytes(0), committedDataSize(0), transactionSize(0),
     transactionIsLarge(false), disableSnapshot(disableSnapshot), replaceContent(replaceContent), snapshotCount(0),
-    firstCommitWithSnapshot(true) {
+    firstCommitWithSnapshot(true), checkpointFilename(checkpointFilename), commitsStarted(0), commitsDurable(0),
+    checkpointLocation(std::numeric_limits<int64_t>::max()), checkpointDurable(false) {
 	// create reserved buffer for radixtree store type
 	this->reserved_buffer =
 	    (storeType == KeyValueStoreType::MEMORY) ? nullptr : new uint8_t[CLIENT_KNOBS->SYSTEM_KEY_SIZE_LIMIT];
@@ -874,6 +1289,9 @@ KeyValueStoreMemory<Container>::KeyValueStoreMemory(IDiskQueue* log,
 	recovering = recover(this, exactRecovery);
 	snapshotting = snapshot(this);
 	commitActors = actorCollection(addActor.getFuture());
+	if (!this->checkpointFilename.empty() && SERVER_KNOBS->MEMORY_CHECKPOINT_INTERVAL > 0) {
+		checkpointing = checkpointer(this);
+	}
 }
 
 IKeyValueStore* keyValueStoreMemory(std::string const& basename,
@@ -887,10 +1305,16 @@ IKeyValueStore* keyValueStoreMemory(std::string const& basename,
 	    .detail("StoreType", storeType);
 
 	IDiskQueue* log = openDiskQueue(basename, ext, logID, DiskQueueVersion::V1);
+	std::string checkpointFilename = basename + "checkpoint." + ext;
 	if (storeType == KeyValueStoreType::MEMORY_RADIXTREE) {
-		return new KeyValueStoreMemory<radix_tree>(log, logID, memoryLimit, storeType, false, false, false);
+		return new KeyValueStoreMemory<radix_tree>(
+		    log, logID, memoryLimit, storeType, false, false, false, checkpointFilename);
+	} else if (SERVER_KNOBS->MEMORY_PACKED_CONTAINER) {
+		return new KeyValueStoreMemory<PackedKeyValueContainer>(
+		    log, logID, memoryLimit, storeType, false, false, false, checkpointFilename);
 	} else {
-		return new KeyValueStoreMemory<IKeyValueContainer>(log, logID, memoryLimit, storeType, false, false, false);
+		return new KeyValueStoreMemory<IKeyValueContainer>(
+		    log, logID, memoryLimit, storeType, false, false, false, checkpointFilename);
 	}
 }
 
@@ -903,3 +1327,67 @@ IKeyValueStore* keyValueStoreLogSystem(class IDiskQueue* queue,
 	return new KeyValueStoreMemory<IKeyValueContainer>(
 	    queue, logID, memoryLimit, KeyValueStoreType::MEMORY, disableSnapshot, replaceContent, exactRecovery);
 }
+
+#include "fdbclient/IKnobCollection.h"
+#include "flow/UnitTest.h"
+
+namespace {
+
+void setMemoryCheckpointInterval(double interval) {
+	IKnobCollection::getMutableGlobalKnobCollection().setKnob("memory_checkpoint_interval",
+	                                                          KnobValueRef::create(ParsedKnobValue(interval)));
+}
+
+TEST_CASE("/fdbserver/KeyValueStoreMemory/CheckpointRecovery") {
+	state double oldInterval = SERVER_KNOBS->MEMORY_CHECKPOINT_INTERVAL;
+	state std::string basename = "kvsmem-checkpoint-test-" + deterministicRandom()->randomUniqueID().toString() + "-";
+	state std::string checkpointFilename = basename + "checkpoint.fdq";
+	state IKeyValueStore* kvStore;
+	state int i;
+	setMemoryCheckpointInterval(0.1);
+
+	kvStore = keyValueStoreMemory(basename, deterministicRandom()->randomUniqueID(), 1e9, "fdq");
+	wait(kvStore->init());
+	for (i = 0; i < 1000; ++i) {
+		kvStore->set(KeyValueRef(StringRef(format("key%04d", i)), StringRef(format("value%d", i))));
+	}
+	wait(kvStore->commit(false));
+
+	// Keep committing until a checkpoint has replaced the file, then commit changes that only the log holds
+	while (!fileExists(checkpointFilename)) {
+		wait(delay(0.1));
+		kvStore->set(KeyValueRef(LiteralStringRef("counter"), StringRef(format("%d", i++))));
+		wait(kvStore->commit(false));
+	}
+	kvStore->set(KeyValueRef(LiteralStringRef("key0001"), LiteralStringRef("updated")));
+	kvStore->clear(KeyRangeRef(LiteralStringRef("key0500"), LiteralStringRef("key0600")));
+	wait(kvStore->commit(false));
+
+	state Future<Void> closed = kvStore->onClosed();
+	kvStore->close();
+	wait(closed);
+
+	kvStore = keyValueStoreMemory(basename, deterministicRandom()->randomUniqueID(), 1e9, "fdq");
+	wait(kvStore->init());
+	// A checkpoint that recovery could not use would have been deleted
+	ASSERT(fileExists(checkpointFilename));
+
+	Optional<Value> updated = wait(kvStore->readValue(LiteralStringRef("key0001")));
+	ASSERT(updated == Optional<Value>(LiteralStringRef("updated")));
+	Optional<Value> counter = wait(kvStore->readValue(LiteralStringRef("counter")));
+	ASSERT(counter.present());
+	RangeResult result = wait(kvStore->readRange(KeyRangeRef(LiteralStringRef("key"), LiteralStringRef("key\xff"))));
+	ASSERT(result.size() == 900);
+	ASSERT(result[499].key == LiteralStringRef("key0499"));
+	ASSERT(result[500].key == LiteralStringRef("key0600"));
+	ASSERT(result.back().value == LiteralStringRef("value999"));
+
+	closed = kvStore->onClosed();
+	kvStore->dispose();
+	wait(closed);
+
+	setMemoryCheckpointInterval(oldInterval);
+	return Void();
+}
+
+} // namespace
@@ -5,12 +5,18 @@
 #include <rocksdb/filter_policy.h>
 #include <rocksdb/options.h>
 #include <rocksdb/slice_transform.h>
+#include <rocksdb/statistics.h>
 #include <rocksdb/table.h>
 #include <rocksdb/utilities/table_properties_collectors.h>
 #include "fdbserver/CoroFlow.h"
 #include "flow/flow.h"
+#include "flow/Histogram.h"
 #include "flow/IThreadPool.h"
 
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
 #endif // SSD_ROCKSDB_EXPERIMENTAL
 
 #include "fdbserver/IKeyValueStore.h"
@@ -89,6 +95,133 @@ rocksdb::ReadOptions getReadOptions() {
 	return options;
 }
 
+// Iterators are costly to create, so the reader threads share a pool of them for range reads.  An iterator reads the
+// database as it was when the iterator was created, so the pool is emptied after each commit.  Cursors also keep their
+// iterators here between reads, so that those are released by commits too.
+class ReadIteratorPool {
+public:
+	// The bounds an iterator was created with.  RocksDB reads them through pointers, so every read sets them to its own
+	// range before it seeks.
+	struct ReadBounds {
+		Key begin, end;
+		rocksdb::Slice lower, upper;
+	};
+
+	struct Lease {
+		std::unique_ptr<rocksdb::Iterator> iterator;
+		uint64_t generation;
+		std::unique_ptr<ReadBounds> bounds;
+
+		// Must be followed by a seek before the iterator is used
+		void setBounds(KeyRangeRef keys) {
+			bounds->begin = keys.begin;
+			bounds->end = keys.end;
+			bounds->lower = toSlice(bounds->begin);
+			bounds->upper = toSlice(bounds->end);
+		}
+	};
+
+	// The iterator of a cursor, which is at the first key at or after resumeKey, or at the key before that one if
+	// onLastRow.  The position is unknown if resumeKey is absent.
+	struct CursorPosition {
+		Lease lease;
+		Optional<Key> resumeKey;
+		bool onLastRow = false;
+	};
+
+	explicit ReadIteratorPool(rocksdb::DB*& db) : db(db), generation(0), nextCursorID(0) {}
+
+	uint64_t newCursorID() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return nextCursorID++;
+	}
+
+	// Returns the iterator cursor kept with keep(), or no iterator if it has none or there was a commit since
+	CursorPosition take(uint64_t cursorID) {
+		std::lock_guard<std::mutex> lock(mutex);
+		CursorPosition position;
+		auto it = cursorPositions.find(cursorID);
+		if (it != cursorPositions.end()) {
+			position = std::move(it->second);
+			cursorPositions.erase(it);
+		}
+		return position;
+	}
+
+	void keep(uint64_t cursorID, CursorPosition position) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (SERVER_KNOBS->ROCKSDB_READ_RANGE_REUSE_ITERATORS && position.lease.generation == generation &&
+		    position.lease.iterator->status().ok()) {
+			cursorPositions[cursorID] = std::move(position);
+		}
+	}
+
+	// Called when a cursor is destroyed
+	void forget(uint64_t cursorID) {
+		CursorPosition position;
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = cursorPositions.find(cursorID);
+		if (it != cursorPositions.end()) {
+			position = std::move(it->second);
+			cursorPositions.erase(it);
+		}
+	}
+
+	// Returns an iterator no other reader is using, which must be given back with put()
+	Lease get() {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!idle.empty()) {
+			Lease lease = std::move(idle.back());
+			idle.pop_back();
+			return lease;
+		}
+		Lease lease{ nullptr, generation, std::make_unique<ReadBounds>() };
+		// Created with the lock held, so that an iterator created before a commit can't enter the pool after it
+		auto options = getReadOptions();
+		// When using a prefix extractor, ensure that keys are returned in order even if they cross
+		// a prefix boundary.
+		options.auto_prefix_mode = (SERVER_KNOBS->ROCKSDB_PREFIX_LEN > 0);
+		options.iterate_lower_bound = &lease.bounds->lower;
+		options.iterate_upper_bound = &lease.bounds->upper;
+		lease.iterator.reset(db->NewIterator(options));
+		return lease;
+	}
+
+	void put(Lease lease) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (SERVER_KNOBS->ROCKSDB_READ_RANGE_REUSE_ITERATORS && lease.generation == generation &&
+		    lease.iterator->status().ok()) {
+			idle.push_back(std::move(lease));
+		}
+	}
+
+	// Called after each commit
+	void update() {
+		std::vector<Lease> stale;
+		std::unordered_map<uint64_t, CursorPosition> staleCursorPositions;
+		std::lock_guard<std::mutex> lock(mutex);
+		++generation;
+		stale.swap(idle);
+		staleCursorPositions.swap(cursorPositions);
+	}
+
+private:
+	rocksdb::DB*& db;
+	std::mutex mutex;
+	std::vector<Lease> idle;
+	std::unordered_map<uint64_t, CursorPosition> cursorPositions;
+	uint64_t generation;
+	uint64_t nextCursorID;
+};
+
+ACTOR template <class T>
+Future<T> sampleLatency(Future<T> result, Reference<Histogram> latency) {
+	state double start = timer_monotonic();
+	T t = wait(result);
+	latency->sampleSeconds(timer_monotonic() - start);
+	return t;
+}
+
 struct RocksDBKeyValueStore : IKeyValueStore {
 	using DB = rocksdb::DB*;
 	using CF = rocksdb::ColumnFamilyHandle*;
@@ -96,8 +229,10 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 	struct Writer : IThreadPoolReceiver {
 		DB& db;
 		UID id;
+		std::shared_ptr<ReadIteratorPool> readIterPool;
 
-		explicit Writer(DB& db, UID id) : db(db), id(id) {}
+		explicit Writer(DB& db, UID id, std::shared_ptr<ReadIteratorPool> readIterPool)
+		  : db(db), id(id), readIterPool(readIterPool) {}
 
 		~Writer() override {
 			if (db) {
@@ -117,6 +252,7 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 
 		struct OpenAction : TypedAction<Writer, OpenAction> {
 			std::string path;
+			std::shared_ptr<rocksdb::Statistics> statistics;
 			ThreadReturnPromise<Void> done;
 
 			double getTimeEstimate() const override { return SERVER_KNOBS->COMMIT_TIME_ESTIMATE; }
@@ -135,7 +271,9 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 			std::vector<rocksdb::ColumnFamilyDescriptor> defaultCF = { rocksdb::ColumnFamilyDescriptor{
 				"default", getCFOptions() } };
 			std::vector<rocksdb::ColumnFamilyHandle*> handle;
-			auto status = rocksdb::DB::Open(getOptions(), a.path, defaultCF, &handle, &db);
+			auto options = getOptions();
+			options.statistics = a.statistics;
+			auto status = rocksdb::DB::Open(options, a.path, defaultCF, &handle, &db);
 			if (!status.ok()) {
 				TraceEvent(SevError, "RocksDBError").detail("Error", status.ToString()).detail("Method", "Open");
 				a.done.sendError(statusToError(status));
@@ -174,6 +312,7 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 			rocksdb::WriteOptions options;
 			options.sync = !SERVER_KNOBS->ROCKSDB_UNSAFE_AUTO_FSYNC;
 			auto s = db->Write(options, a.batchToCommit.get());
+			readIterPool->update();
 			if (!s.ok()) {
 				TraceEvent(SevError, "RocksDBError").detail("Error", s.ToString()).detail("Method", "Commit");
 				a.done.sendError(statusToError(s));
@@ -199,6 +338,8 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 				a.done.send(Void());
 				return;
 			}
+			// The readers have stopped, so this releases every iterator, which must not outlive the database
+			readIterPool->update();
 			auto s = db->Close();
 			if (!s.ok()) {
 				TraceEvent(SevError, "RocksDBError").detail("Error", s.ToString()).detail("Method", "Close");
@@ -220,75 +361,80 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 
 	struct Reader : IThreadPoolReceiver {
 		DB& db;
+		std::shared_ptr<ReadIteratorPool> readIterPool;
 
-		explicit Reader(DB& db) : db(db) {}
+		explicit Reader(DB& db, std::shared_ptr<ReadIteratorPool> readIterPool) : db(db), readIterPool(readIterPool) {}
 
 		void init() override {}
 
-		struct ReadValueAction : TypedAction<Reader, ReadValueAction> {
-			Key key;
-			Optional<UID> debugID;
-			ThreadReturnPromise<Optional<Value>> result;
-			ReadValueAction(KeyRef key, Optional<UID> debugID) : key(key), debugID(debugID) {}
-			double getTimeEstimate() const override { return SERVER_KNOBS->READ_VALUE_TIME_ESTIMATE; }
+		// Point reads, of whole values or of their first maxLength bytes, that were issued together and are read with
+		// one MultiGet
+		struct ReadValuesAction : TypedAction<Reader, ReadValuesAction> {
+			struct Read {
+				Key key;
+				int maxLength; // Or -1 for the whole value
+				Optional<UID> debugID;
+				ThreadReturnPromise<Optional<Value>> result;
+				Read(KeyRef key, int maxLength, Optional<UID> debugID)
+				  : key(key), maxLength(maxLength), debugID(debugID) {}
+			};
+			std::deque<Read> reads;
+			bool sorted = false; // Whether the reads are in key order
+			double getTimeEstimate() const override { return SERVER_KNOBS->READ_VALUE_TIME_ESTIMATE * reads.size(); }
 		};
-		void action(ReadValueAction& a) {
+		void action(ReadValuesAction& a) {
 			Optional<TraceBatch> traceBatch;
-			if (a.debugID.present()) {
-				traceBatch = { TraceBatch{} };
-				traceBatch.get().addEvent("GetValueDebug", a.debugID.get().first(), "Reader.Before");
-			}
-			rocksdb::PinnableSlice value;
-			auto s = db->Get(getReadOptions(), db->DefaultColumnFamily(), toSlice(a.key), &value);
-			if (a.debugID.present()) {
-				traceBatch.get().addEvent("GetValueDebug", a.debugID.get().first(), "Reader.After");
-				traceBatch.get().dump();
-			}
-			if (s.ok()) {
-				a.result.send(Value(toStringRef(value)));
-			} else {
-				if (!s.IsNotFound()) {
-					TraceEvent(SevError, "RocksDBError").detail("Error", s.ToString()).detail("Method", "ReadValue");
+			for (auto const& r : a.reads) {
+				if (r.debugID.present()) {
+					if (!traceBatch.present()) {
+						traceBatch = { TraceBatch{} };
+					}
+					traceBatch.get().addEvent(r.maxLength < 0 ? "GetValueDebug" : "GetValuePrefixDebug",
+					                          r.debugID.get().first(),
+					                          "Reader.Before");
 				}
-				a.result.send(Optional<Value>());
 			}
-		}
 
-		struct ReadValuePrefixAction : TypedAction<Reader, ReadValuePrefixAction> {
-			Key key;
-			int maxLength;
-			Optional<UID> debugID;
-			ThreadReturnPromise<Optional<Value>> result;
-			ReadValuePrefixAction(Key key, int maxLength, Optional<UID> debugID)
-			  : key(key), maxLength(maxLength), debugID(debugID){};
-			double getTimeEstimate() const override { return SERVER_KNOBS->READ_VALUE_TIME_ESTIMATE; }
-		};
-		void action(ReadValuePrefixAction& a) {
-			rocksdb::PinnableSlice value;
-			Optional<TraceBatch> traceBatch;
-			if (a.debugID.present()) {
-				traceBatch = { TraceBatch{} };
-				traceBatch.get().addEvent("GetValuePrefixDebug",
-				                          a.debugID.get().first(),
-				                          "Reader.Before"); //.detail("TaskID", g_network->getCurrentTask());
+			int count = a.reads.size();
+			std::vector<rocksdb::Slice> keys;
+			keys.reserve(count);
+			for (auto const& r : a.reads) {
+				keys.push_back(toSlice(r.key));
 			}
-			auto s = db->Get(getReadOptions(), db->DefaultColumnFamily(), toSlice(a.key), &value);
-			if (a.debugID.present()) {
-				traceBatch.get().addEvent("GetValuePrefixDebug",
-				                          a.debugID.get().first(),
-				                          "Reader.After"); //.detail("TaskID", g_network->getCurrentTask());
+			std::vector<rocksdb::PinnableSlice> values(count);
+			std::vector<rocksdb::Status> statuses(count);
+			db->MultiGet(getReadOptions(),
+			             db->DefaultColumnFamily(),
+			             count,
+			             keys.data(),
+			             values.data(),
+			             statuses.data(),
+			             /*sorted_input=*/a.sorted);
+
+			if (traceBatch.present()) {
+				for (auto const& r : a.reads) {
+					if (r.debugID.present()) {
+						traceBatch.get().addEvent(r.maxLength < 0 ? "GetValueDebug" : "GetValuePrefixDebug",
+						                          r.debugID.get().first(),
+						                          "Reader.After");
+					}
+				}
 				traceBatch.get().dump();
 			}
-			if (s.ok()) {
-				a.result.send(Value(StringRef(reinterpret_cast<const uint8_t*>(value.data()),
-				                              std::min(value.size(), size_t(a.maxLength)))));
-			} else {
-				if (!s.IsNotFound()) {
-					TraceEvent(SevError, "RocksDBError")
-					    .detail("Error", s.ToString())
-					    .detail("Method", "ReadValuePrefix");
+			for (int i = 0; i < count; ++i) {
+				auto& r = a.reads[i];
+				if (statuses[i].ok()) {
+					size_t length =
+					    r.maxLength < 0 ? values[i].size() : std::min(values[i].size(), size_t(r.maxLength));
+					r.result.send(Value(StringRef(reinterpret_cast<const uint8_t*>(values[i].data()), length)));
+				} else {
+					if (!statuses[i].IsNotFound()) {
+						TraceEvent(SevError, "RocksDBError")
+						    .detail("Error", statuses[i].ToString())
+						    .detail("Method", r.maxLength < 0 ? "ReadValue" : "ReadValuePrefix");
+					}
+					r.result.send(Optional<Value>());
 				}
-				a.result.send(Optional<Value>());
 			}
 		}
 
@@ -300,47 +446,49 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 			  : keys(keys), rowLimit(rowLimit), byteLimit(byteLimit) {}
 			double getTimeEstimate() const override { return SERVER_KNOBS->READ_RANGE_TIME_ESTIMATE; }
 		};
-		void action(ReadRangeAction& a) {
+
+		// Reads keys with the leased iterator.  A forward read doesn't seek if seek is false, because the iterator is
+		// already at the first key at or after keys.begin and bounded by keys.end.
+		RangeResult readRange(ReadIteratorPool::Lease& lease,
+		                      KeyRangeRef keys,
+		                      int rowLimit,
+		                      int byteLimit,
+		                      bool seek = true) {
 			RangeResult result;
-			if (a.rowLimit == 0 || a.byteLimit == 0) {
-				a.result.send(result);
+			if (rowLimit == 0 || byteLimit == 0) {
+				return result;
 			}
+			rocksdb::Iterator* cursor = lease.iterator.get();
 			int accumulatedBytes = 0;
 			rocksdb::Status s;
-			auto options = getReadOptions();
-			// When using a prefix extractor, ensure that keys are returned in order even if they cross
-			// a prefix boundary.
-			options.auto_prefix_mode = (SERVER_KNOBS->ROCKSDB_PREFIX_LEN > 0);
-			if (a.rowLimit >= 0) {
-				auto endSlice = toSlice(a.keys.end);
-				options.iterate_upper_bound = &endSlice;
-				auto cursor = std::unique_ptr<rocksdb::Iterator>(db->NewIterator(options));
-				cursor->Seek(toSlice(a.keys.begin));
-				while (cursor->Valid() && toStringRef(cursor->key()) < a.keys.end) {
+			if (rowLimit >= 0) {
+				if (seek) {
+					lease.setBounds(keys);
+					cursor->Seek(toSlice(keys.begin));
+				}
+				while (cursor->Valid() && toStringRef(cursor->key()) < keys.end) {
 					KeyValueRef kv(toStringRef(cursor->key()), toStringRef(cursor->value()));
 					accumulatedBytes += sizeof(KeyValueRef) + kv.expectedSize();
 					result.push_back_deep(result.arena(), kv);
 					// Calling `cursor->Next()` is potentially expensive, so short-circut here just in case.
-					if (result.size() >= a.rowLimit || accumulatedBytes >= a.byteLimit) {
+					if (result.size() >= rowLimit || accumulatedBytes >= byteLimit) {
 						break;
 					}
 					cursor->Next();
 				}
 				s = cursor->status();
 			} else {
-				auto beginSlice = toSlice(a.keys.begin);
-				options.iterate_lower_bound = &beginSlice;
-				auto cursor = std::unique_ptr<rocksdb::Iterator>(db->NewIterator(options));
-				cursor->SeekForPrev(toSlice(a.keys.end));
-				if (cursor->Valid() && toStringRef(cursor->key()) == a.keys.end) {
+				lease.setBounds(keys);
+				cursor->SeekForPrev(toSlice(keys.end));
+				if (cursor->Valid() && toStringRef(cursor->key()) == keys.end) {
 					cursor->Prev();
 				}
-				while (cursor->Valid() && toStringRef(cursor->key()) >= a.keys.begin) {
+				while (cursor->Valid() && toStringRef(cursor->key()) >= keys.begin) {
 					KeyValueRef kv(toStringRef(cursor->key()), toStringRef(cursor->value()));
 					accumulatedBytes += sizeof(KeyValueRef) + kv.expectedSize();
 					result.push_back_deep(result.arena(), kv);
 					// Calling `cursor->Prev()` is potentially expensive, so short-circut here just in case.
-					if (result.size() >= -a.rowLimit || accumulatedBytes >= a.byteLimit) {
+					if (result.size() >= -rowLimit || accumulatedBytes >= byteLimit) {
 						break;
 					}
 					cursor->Prev();
@@ -352,12 +500,87 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 				TraceEvent(SevError, "RocksDBError").detail("Error", s.ToString()).detail("Method", "ReadRange");
 			}
 			result.more =
-			    (result.size() == a.rowLimit) || (result.size() == -a.rowLimit) || (accumulatedBytes >= a.byteLimit);
+			    (result.size() == rowLimit) || (result.size() == -rowLimit) || (accumulatedBytes >= byteLimit);
 			if (result.more) {
 				result.readThrough = result[result.size() - 1].key;
 			}
+			return result;
+		}
+
+		void action(ReadRangeAction& a) {
+			ReadIteratorPool::Lease lease = readIterPool->get();
+			RangeResult result = readRange(lease, a.keys, a.rowLimit, a.byteLimit);
+			readIterPool->put(std::move(lease));
+			a.result.send(result);
+		}
+
+		// A read of a cursor, which continues from the position of the cursor's iterator if it is already at or just
+		// before the first key of a forward read
+		struct CursorReadRangeAction : TypedAction<Reader, CursorReadRangeAction>,
+		                               FastAllocated<CursorReadRangeAction> {
+			uint64_t cursorID;
+			KeyRange keys;
+			int rowLimit, byteLimit;
+			ThreadReturnPromise<RangeResult> result;
+			CursorReadRangeAction(uint64_t cursorID, KeyRange keys, int rowLimit, int byteLimit)
+			  : cursorID(cursorID), keys(keys), rowLimit(rowLimit), byteLimit(byteLimit) {}
+			double getTimeEstimate() const override { return SERVER_KNOBS->READ_RANGE_TIME_ESTIMATE; }
+		};
+		void action(CursorReadRangeAction& a) {
+			ReadIteratorPool::CursorPosition position = readIterPool->take(a.cursorID);
+			bool positioned = false;
+			if (!position.lease.iterator) {
+				position.lease = readIterPool->get();
+				position.resumeKey.reset();
+			} else if (a.rowLimit > 0 && position.resumeKey.present() && position.resumeKey.get() <= a.keys.begin &&
+			           position.lease.bounds->end == a.keys.end) {
+				// The iterator can only move on without seeking within the same upper bound, since RocksDB applies a
+				// changed bound at the next seek
+				rocksdb::Iterator* cursor = position.lease.iterator.get();
+				if (position.onLastRow) {
+					cursor->Next();
+				}
+				positioned = cursor->Valid() ? toStringRef(cursor->key()) >= a.keys.begin : cursor->status().ok();
+				position.onLastRow = false;
+			}
+
+			RangeResult result = readRange(position.lease, a.keys, a.rowLimit, a.byteLimit, !positioned);
+			if (a.rowLimit > 0 && a.byteLimit != 0) {
+				// A forward read ends on its last row if it stopped at a limit, and otherwise at the first key after it
+				position.resumeKey = result.empty() ? Key(a.keys.begin) : keyAfter(result.back().key);
+				position.onLastRow = result.more;
+			} else if (a.rowLimit != 0 && a.byteLimit != 0) {
+				position.resumeKey.reset();
+			}
+			readIterPool->keep(a.cursorID, std::move(position));
 			a.result.send(result);
 		}
+
+		// Ranges read one after another with the same iterator
+		struct ReadRangesAction : TypedAction<Reader, ReadRangesAction> {
+			Arena arena;
+			std::vector<KeyRangeRef> ranges;
+			int rowLimit, byteLimit;
+			ThreadReturnPromise<std::vector<RangeResult>> result;
+			ReadRangesAction(std::vector<KeyRangeRef> const& ranges, int rowLimit, int byteLimit)
+			  : rowLimit(rowLimit), byteLimit(byteLimit) {
+				this->ranges.reserve(ranges.size());
+				for (auto const& range : ranges) {
+					this->ranges.emplace_back(arena, range);
+				}
+			}
+			double getTimeEstimate() const override { return SERVER_KNOBS->READ_RANGE_TIME_ESTIMATE * ranges.size(); }
+		};
+		void action(ReadRangesAction& a) {
+			ReadIteratorPool::Lease lease = readIterPool->get();
+			std::vector<RangeResult> results;
+			results.reserve(a.ranges.size());
+			for (auto const& range : a.ranges) {
+				results.push_back(readRange(lease, range, a.rowLimit, a.byteLimit));
+			}
+			readIterPool->put(std::move(lease));
+			a.result.send(results);
+		}
 	};
 
 	DB db = nullptr;
@@ -368,8 +591,34 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 	Promise<Void> errorPromise;
 	Promise<Void> closePromise;
 	std::unique_ptr<rocksdb::WriteBatch> writeBatch;
-
-	explicit RocksDBKeyValueStore(const std::string& path, UID id) : path(path), id(id) {
+	std::shared_ptr<ReadIteratorPool> readIterPool;
+	// Point reads not yet posted to the reader threads, and the posting of them at the end of this run loop iteration
+	Reader::ReadValuesAction* pendingReads = nullptr;
+	Future<Void> pendingReadsPosted;
+	std::shared_ptr<rocksdb::Statistics> statistics;
+	Future<Void> metrics;
+	KeyValueStoreEngineStats engineStats; // Updated by traceMetrics()
+
+	Reference<Histogram> readValueLatency;
+	Reference<Histogram> readValuePrefixLatency;
+	Reference<Histogram> readRangeLatency;
+	Reference<Histogram> readValuesBatchSize;
+
+	explicit RocksDBKeyValueStore(const std::string& path, UID id)
+	  : path(path), id(id), readIterPool(std::make_shared<ReadIteratorPool>(db)),
+	    statistics(rocksdb::CreateDBStatistics()),
+	    readValueLatency(Histogram::getHistogram(LiteralStringRef("RocksDBReader"),
+	                                             LiteralStringRef("ReadValueLatency"),
+	                                             Histogram::Unit::microseconds)),
+	    readValuePrefixLatency(Histogram::getHistogram(LiteralStringRef("RocksDBReader"),
+	                                                   LiteralStringRef("ReadValuePrefixLatency"),
+	                                                   Histogram::Unit::microseconds)),
+	    readRangeLatency(Histogram::getHistogram(LiteralStringRef("RocksDBReader"),
+	                                             LiteralStringRef("ReadRangeLatency"),
+	                                             Histogram::Unit::microseconds)),
+	    readValuesBatchSize(Histogram::getHistogram(LiteralStringRef("RocksDBReader"),
+	                                                LiteralStringRef("ReadValuesBatchSize"),
+	                                                Histogram::Unit::count)) {
 		// In simluation, run the reader/writer threads as Coro threads (i.e. in the network thread. The storage engine
 		// is still multi-threaded as background compaction threads are still present. Reads/writes to disk will also
 		// block the network thread in a way that would be unacceptable in production but is a necessary evil here. When
@@ -387,15 +636,17 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 			writeThread = createGenericThreadPool();
 			readThreads = createGenericThreadPool();
 		}
-		writeThread->addThread(new Writer(db, id), "fdb-rocksdb-wr");
+		writeThread->addThread(new Writer(db, id, readIterPool), "fdb-rocksdb-wr");
 		for (unsigned i = 0; i < SERVER_KNOBS->ROCKSDB_READ_PARALLELISM; ++i) {
-			readThreads->addThread(new Reader(db), "fdb-rocksdb-re");
+			readThreads->addThread(new Reader(db, readIterPool), "fdb-rocksdb-re");
 		}
 	}
 
 	Future<Void> getError() override { return errorPromise.getFuture(); }
 
 	ACTOR static void doClose(RocksDBKeyValueStore* self, bool deleteOnClose) {
+		self->metrics = Future<Void>();
+		self->postPendingReads();
 		wait(self->readThreads->stop());
 		auto a = new Writer::CloseAction(self->path, deleteOnClose);
 		auto f = a->done.getFuture();
@@ -420,11 +671,102 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 	Future<Void> init() override {
 		std::unique_ptr<Writer::OpenAction> a(new Writer::OpenAction());
 		a->path = path;
+		a->statistics = statistics;
 		auto res = a->done.getFuture();
 		writeThread->post(a.release());
+		if (!metrics.isValid()) {
+			metrics = logMetrics(this, res);
+		}
 		return res;
 	}
 
+	// Traces the statistics that tell whether writes are stalled on compaction or flushes and how well reads are served
+	// by the block cache.  The tickers count events since the last trace, while the histograms and the per level
+	// compaction stats cover everything since the database was opened.
+	void traceMetrics(TraceEvent& e) {
+		static const std::vector<std::pair<const char*, uint32_t>> tickers = {
+			{ "BlockCacheHits", rocksdb::BLOCK_CACHE_HIT },
+			{ "BlockCacheMisses", rocksdb::BLOCK_CACHE_MISS },
+			{ "StallMicros", rocksdb::STALL_MICROS },
+			{ "BytesRead", rocksdb::BYTES_READ },
+			{ "BytesWritten", rocksdb::BYTES_WRITTEN },
+			{ "CompactReadBytes", rocksdb::COMPACT_READ_BYTES },
+			{ "CompactWriteBytes", rocksdb::COMPACT_WRITE_BYTES },
+			{ "FlushWriteBytes", rocksdb::FLUSH_WRITE_BYTES },
+		};
+		static const std::vector<std::pair<const char*, std::string>> intProperties = {
+			{ "PendingCompactionBytes", rocksdb::DB::Properties::kEstimatePendingCompactionBytes },
+			{ "RunningCompactions", rocksdb::DB::Properties::kNumRunningCompactions },
+			{ "RunningFlushes", rocksdb::DB::Properties::kNumRunningFlushes },
+			{ "ImmutableMemtables", rocksdb::DB::Properties::kNumImmutableMemTable },
+			{ "MemtableBytes", rocksdb::DB::Properties::kCurSizeAllMemTables },
+			{ "ActualDelayedWriteRate", rocksdb::DB::Properties::kActualDelayedWriteRate },
+			{ "IsWriteStopped", rocksdb::DB::Properties::kIsWriteStopped },
+			{ "BlockCacheUsage", rocksdb::DB::Properties::kBlockCacheUsage },
+		};
+		static const std::vector<std::pair<const char*, uint32_t>> histograms = {
+			{ "Get", rocksdb::DB_GET },
+			{ "Write", rocksdb::DB_WRITE },
+			{ "Compaction", rocksdb::COMPACTION_TIME },
+			{ "Flush", rocksdb::FLUSH_TIME },
+		};
+
+		std::map<std::string, uint64_t> tickerCounts;
+		for (const auto& [name, ticker] : tickers) {
+			tickerCounts[name] = statistics->getAndResetTickerCount(ticker);
+			e.detail(name, tickerCounts[name]);
+		}
+		uint64_t blockCacheReads = tickerCounts["BlockCacheHits"] + tickerCounts["BlockCacheMisses"];
+		engineStats.blockCacheHitRate =
+		    blockCacheReads ? tickerCounts["BlockCacheHits"] / (double)blockCacheReads : 1.0;
+		engineStats.stallMicros += tickerCounts["StallMicros"];
+		e.detail("BlockCacheHitRate", engineStats.blockCacheHitRate);
+
+		for (const auto& [name, property] : intProperties) {
+			uint64_t value = 0;
+			if (db->GetIntProperty(property, &value)) {
+				e.detail(name, value);
+			}
+		}
+		std::string l0Files;
+		if (db->GetProperty(rocksdb::DB::Properties::kNumFilesAtLevelPrefix + "0", &l0Files)) {
+			e.detail("L0Files", l0Files);
+		}
+
+		for (const auto& [name, histogram] : histograms) {
+			rocksdb::HistogramData data;
+			statistics->histogramData(histogram, &data);
+			e.detail(std::string(name) + "P50Micros", data.median);
+			e.detail(std::string(name) + "P99Micros", data.percentile99);
+			e.detail(std::string(name) + "MaxMicros", data.max);
+		}
+
+		// The compaction stats of each level with files have keys like compaction.L1.ReadGB
+		std::map<std::string, std::string> cfStats;
+		if (db->GetMapProperty(rocksdb::DB::Properties::kCFStats, &cfStats)) {
+			const std::string prefix = "compaction.L";
+			for (const auto& [key, value] : cfStats) {
+				if (key.compare(0, prefix.size(), prefix) != 0) {
+					continue;
+				}
+				auto dot = key.find('.', prefix.size());
+				std::string stat = dot == std::string::npos ? "" : key.substr(dot + 1);
+				if (stat == "ReadGB" || stat == "WriteGB") {
+					e.detail(key.substr(prefix.size() - 1, dot - prefix.size() + 1) + stat, value);
+				}
+			}
+		}
+	}
+
+	ACTOR static Future<Void> logMetrics(RocksDBKeyValueStore* self, Future<Void> opened) {
+		wait(opened);
+		loop {
+			wait(delay(SERVER_KNOBS->ROCKSDB_METRICS_DELAY));
+			TraceEvent e("RocksDBMetrics", self->id);
+			self->traceMetrics(e);
+		}
+	}
+
 	void set(KeyValueRef kv, const Arena*) override {
 		if (writeBatch == nullptr) {
 			writeBatch.reset(new rocksdb::WriteBatch());
@@ -452,24 +794,103 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 		return res;
 	}
 
-	Future<Optional<Value>> readValue(KeyRef key, Optional<UID> debugID) override {
-		auto a = new Reader::ReadValueAction(key, debugID);
-		auto res = a->result.getFuture();
-		readThreads->post(a);
+	void postPendingReads() {
+		if (pendingReads != nullptr) {
+			readValuesBatchSize->sample(pendingReads->reads.size());
+			readThreads->post(pendingReads);
+			pendingReads = nullptr;
+		}
+	}
+
+	ACTOR static Future<Void> postPendingReadsLater(RocksDBKeyValueStore* self) {
+		wait(delay(0));
+		self->postPendingReads();
+		return Void();
+	}
+
+	// Point reads issued in the same run loop iteration are batched, up to ROCKSDB_MULTIGET_MAX_BATCH of them
+	Future<Optional<Value>> read(KeyRef key, int maxLength, Optional<UID> debugID) {
+		if (pendingReads == nullptr) {
+			pendingReads = new Reader::ReadValuesAction();
+			if (SERVER_KNOBS->ROCKSDB_MULTIGET_MAX_BATCH > 1) {
+				pendingReadsPosted = postPendingReadsLater(this);
+			}
+		}
+		pendingReads->reads.emplace_back(key, maxLength, debugID);
+		auto res = pendingReads->reads.back().result.getFuture();
+		if (pendingReads->reads.size() >= SERVER_KNOBS->ROCKSDB_MULTIGET_MAX_BATCH) {
+			postPendingReads();
+		}
 		return res;
 	}
 
+	Future<Optional<Value>> readValue(KeyRef key, Optional<UID> debugID) override {
+		return sampleLatency(read(key, -1, debugID), readValueLatency);
+	}
+
 	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength, Optional<UID> debugID) override {
-		auto a = new Reader::ReadValuePrefixAction(key, maxLength, debugID);
-		auto res = a->result.getFuture();
-		readThreads->post(a);
-		return res;
+		return sampleLatency(read(key, maxLength, debugID), readValuePrefixLatency);
 	}
 
 	Future<RangeResult> readRange(KeyRangeRef keys, int rowLimit, int byteLimit) override {
 		auto a = new Reader::ReadRangeAction(keys, rowLimit, byteLimit);
 		auto res = a->result.getFuture();
 		readThreads->post(a);
+		return sampleLatency(res, readRangeLatency);
+	}
+
+	class Cursor final : public IKeyValueCursor {
+	public:
+		Cursor(Reference<IThreadPool> readThreads,
+		       std::shared_ptr<ReadIteratorPool> readIterPool,
+		       Reference<Histogram> readRangeLatency)
+		  : readThreads(readThreads), readIterPool(readIterPool), readRangeLatency(readRangeLatency),
+		    id(readIterPool->newCursorID()) {}
+		~Cursor() override { readIterPool->forget(id); }
+
+		Future<RangeResult> readRange(KeyRangeRef keys, int rowLimit, int byteLimit) override {
+			auto a = new Reader::CursorReadRangeAction(id, keys, rowLimit, byteLimit);
+			auto res = a->result.getFuture();
+			readThreads->post(a);
+			return sampleLatency(res, readRangeLatency);
+		}
+
+	private:
+		Reference<IThreadPool> readThreads;
+		std::shared_ptr<ReadIteratorPool> readIterPool;
+		Reference<Histogram> readRangeLatency;
+		uint64_t id;
+	};
+
+	Reference<IKeyValueCursor> openCursor() override {
+		return makeReference<Cursor>(readThreads, readIterPool, readRangeLatency);
+	}
+
+	Future<std::vector<Optional<Value>>> readValuePrefixes(std::vector<std::pair<KeyRef, int>> const& keys,
+	                                                       Optional<UID> debugID) override {
+		if (keys.empty()) {
+			return std::vector<Optional<Value>>();
+		}
+		auto a = new Reader::ReadValuesAction();
+		a->sorted = true;
+		std::vector<Future<Optional<Value>>> results;
+		results.reserve(keys.size());
+		for (auto const& [key, maxLength] : keys) {
+			// The debug ID traces the batch once, rather than once per key
+			a->reads.emplace_back(key, maxLength, results.empty() ? debugID : Optional<UID>());
+			results.push_back(a->reads.back().result.getFuture());
+		}
+		readValuesBatchSize->sample(a->reads.size());
+		readThreads->post(a);
+		return sampleLatency(getAll(results), readValuePrefixLatency);
+	}
+
+	Future<std::vector<RangeResult>> readRanges(std::vector<KeyRangeRef> const& ranges,
+	                                            int rowLimit,
+	                                            int byteLimit) override {
+		auto a = new Reader::ReadRangesAction(ranges, rowLimit, byteLimit);
+		auto res = a->result.getFuture();
+		readThreads->post(a);
 		return res;
 	}
 
@@ -483,6 +904,24 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 
 		return StorageBytes(free, total, live, free);
 	}
+
+	int64_t getPendingCompactionBytes() const override {
+		uint64_t pending = 0;
+		if (db != nullptr) {
+			db->GetIntProperty(rocksdb::DB::Properties::kEstimatePendingCompactionBytes, &pending);
+		}
+		return pending;
+	}
+
+	// The block cache hit rate and stalls are those as of the last RocksDBMetrics event
+	Optional<KeyValueStoreEngineStats> getEngineStats() const override {
+		KeyValueStoreEngineStats stats = engineStats;
+		std::string l0Files;
+		if (db != nullptr && db->GetProperty(rocksdb::DB::Properties::kNumFilesAtLevelPrefix + "0", &l0Files)) {
+			stats.l0Files = std::stoll(l0Files);
+		}
+		return stats;
+	}
 };
 
 } // namespace
@@ -541,6 +980,92 @@ TEST_CASE("noSim/fdbserver/KeyValueStoreRocksDB/Reopen") {
 	return Void();
 }
 
+TEST_CASE("noSim/fdbserver/KeyValueStoreRocksDB/BatchedReads") {
+	state const std::string rocksDBTestDir = "rocksdb-kvstore-batched-reads-test-db";
+	platform::eraseDirectoryRecursive(rocksDBTestDir);
+
+	state IKeyValueStore* kvStore = new RocksDBKeyValueStore(rocksDBTestDir, deterministicRandom()->randomUniqueID());
+	wait(kvStore->init());
+
+	kvStore->set({ LiteralStringRef("a"), LiteralStringRef("apple") });
+	kvStore->set({ LiteralStringRef("c"), LiteralStringRef("cherry") });
+	wait(kvStore->commit(false));
+
+	std::vector<Optional<Value>> values = wait(kvStore->readValuePrefixes(
+	    { { LiteralStringRef("a"), 3 }, { LiteralStringRef("b"), 3 }, { LiteralStringRef("c"), 100 } }));
+	ASSERT(values.size() == 3);
+	ASSERT(values[0] == Optional<Value>(LiteralStringRef("app")));
+	ASSERT(!values[1].present());
+	ASSERT(values[2] == Optional<Value>(LiteralStringRef("cherry")));
+
+	state std::vector<KeyRangeRef> ranges = { KeyRangeRef(LiteralStringRef("a"), LiteralStringRef("z")),
+	                                          KeyRangeRef(LiteralStringRef("b"), LiteralStringRef("c")) };
+	std::vector<RangeResult> results = wait(kvStore->readRanges(ranges, 1));
+	ASSERT(results.size() == 2);
+	ASSERT(results[0].size() == 1 && results[0][0].key == LiteralStringRef("a") && results[0].more);
+	ASSERT(results[1].empty() && !results[1].more);
+
+	Future<Void> closed = kvStore->onClosed();
+	kvStore->dispose();
+	wait(closed);
+
+	platform::eraseDirectoryRecursive(rocksDBTestDir);
+	return Void();
+}
+
+TEST_CASE("noSim/fdbserver/KeyValueStoreRocksDB/Cursor") {
+	state const std::string rocksDBTestDir = "rocksdb-kvstore-cursor-test-db";
+	platform::eraseDirectoryRecursive(rocksDBTestDir);
+
+	state IKeyValueStore* kvStore = new RocksDBKeyValueStore(rocksDBTestDir, deterministicRandom()->randomUniqueID());
+	wait(kvStore->init());
+
+	state int i;
+	for (i = 0; i < 100; i++) {
+		kvStore->set({ StringRef(format("key%03d", i)), LiteralStringRef("value") });
+	}
+	wait(kvStore->commit(false));
+
+	// Reads the keys in batches, each continuing where the last one ended, or just past it, or before it
+	state Reference<IKeyValueCursor> cursor = kvStore->openCursor();
+	state Key begin = LiteralStringRef("key");
+	state int expected = 0;
+	loop {
+		RangeResult r = wait(cursor->readRange(KeyRangeRef(begin, LiteralStringRef("l")), 7));
+		for (auto const& kv : r) {
+			ASSERT(kv.key == StringRef(format("key%03d", expected++)));
+		}
+		if (!r.more) {
+			break;
+		}
+		if (deterministicRandom()->coinflip()) {
+			begin = keyAfter(r.back().key);
+		} else if (deterministicRandom()->coinflip()) {
+			begin = r.back().key.withSuffix(LiteralStringRef("\x01"));
+		} else {
+			begin = r.back().key;
+			--expected;
+		}
+		// Commits release the cursor's iterator, after which it seeks again
+		if (deterministicRandom()->random01() < 0.2) {
+			kvStore->set({ LiteralStringRef("a"), LiteralStringRef("value") });
+			wait(kvStore->commit(false));
+		}
+	}
+	ASSERT(expected == 100);
+
+	RangeResult last = wait(cursor->readRange(KeyRangeRef(LiteralStringRef("key"), LiteralStringRef("l")), -1));
+	ASSERT(last.size() == 1 && last[0].key == LiteralStringRef("key099"));
+	cursor.clear();
+
+	Future<Void> closed = kvStore->onClosed();
+	kvStore->dispose();
+	wait(closed);
+
+	platform::eraseDirectoryRecursive(rocksDBTestDir);
+	return Void();
+}
+
 } // namespace
 
 #endif // SSD_ROCKSDB_EXPERIMENTAL
@@ -1312,8 +1312,7 @@ int SQLiteDB::checkAllPageChecksums() {
 
 	// Now that the file itself is open and locked, let sqlite open the database
 	// Note that VFSAsync will also call g_network->open (including for the WAL), so its flags are important, too
-	// TODO:  If better performance is needed, make AsyncFileReadAheadCache work and be enabled by SQLITE_OPEN_READAHEAD
-	// which was added for that purpose.
+	// The scan below reads the database in page order, so VFSAsync reads ahead of it once it is under way.
 	int result = sqlite3_open_v2(apath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr);
 	checkError("open", result);
 
@@ -1580,6 +1579,11 @@ public:
 	Future<Optional<Value>> readValue(KeyRef key, Optional<UID> debugID) override;
 	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength, Optional<UID> debugID) override;
 	Future<RangeResult> readRange(KeyRangeRef keys, int rowLimit = 1 << 30, int byteLimit = 1 << 30) override;
+	Future<std::vector<Optional<Value>>> readValuePrefixes(std::vector<std::pair<KeyRef, int>> const& keys,
+	                                                       Optional<UID> debugID) override;
+	Future<std::vector<RangeResult>> readRanges(std::vector<KeyRangeRef> const& ranges,
+	                                            int rowLimit = 1 << 30,
+	                                            int byteLimit = 1 << 30) override;
 
 	KeyValueStoreSQLite(std::string const& filename,
 	                    UID logID,
@@ -1704,6 +1708,64 @@ private:
 			rr.result.send(getCursor()->get().getRange(rr.keys, rr.rowLimit, rr.byteLimit));
 			++counter;
 		}
+
+		// A batch of sorted keys, read one after another with the same cursor
+		struct ReadValuePrefixesAction final : TypedAction<Reader, ReadValuePrefixesAction>,
+		                                       FastAllocated<ReadValuePrefixesAction> {
+			Arena arena;
+			std::vector<std::pair<KeyRef, int>> keys;
+			Optional<UID> debugID;
+			ThreadReturnPromise<std::vector<Optional<Value>>> result;
+			ReadValuePrefixesAction(std::vector<std::pair<KeyRef, int>> const& keys, Optional<UID> debugID)
+			  : debugID(debugID) {
+				this->keys.reserve(keys.size());
+				for (auto const& [key, maxLength] : keys) {
+					this->keys.emplace_back(KeyRef(arena, key), maxLength);
+				}
+			}
+			double getTimeEstimate() const override { return SERVER_KNOBS->READ_VALUE_TIME_ESTIMATE * keys.size(); }
+		};
+		void action(ReadValuePrefixesAction& rv) {
+			if (rv.debugID.present())
+				g_traceBatch.addEvent("GetValuePrefixDebug", rv.debugID.get().first(), "Reader.Before");
+
+			Reference<ReadCursor> cursor = getCursor();
+			std::vector<Optional<Value>> values;
+			values.reserve(rv.keys.size());
+			for (auto const& [key, maxLength] : rv.keys) {
+				values.push_back(cursor->get().getPrefix(key, maxLength));
+			}
+			rv.result.send(values);
+			++counter;
+
+			if (rv.debugID.present())
+				g_traceBatch.addEvent("GetValuePrefixDebug", rv.debugID.get().first(), "Reader.After");
+		}
+
+		struct ReadRangesAction final : TypedAction<Reader, ReadRangesAction>, FastAllocated<ReadRangesAction> {
+			Arena arena;
+			std::vector<KeyRangeRef> ranges;
+			int rowLimit, byteLimit;
+			ThreadReturnPromise<std::vector<RangeResult>> result;
+			ReadRangesAction(std::vector<KeyRangeRef> const& ranges, int rowLimit, int byteLimit)
+			  : rowLimit(rowLimit), byteLimit(byteLimit) {
+				this->ranges.reserve(ranges.size());
+				for (auto const& range : ranges) {
+					this->ranges.emplace_back(arena, range);
+				}
+			}
+			double getTimeEstimate() const override { return SERVER_KNOBS->READ_RANGE_TIME_ESTIMATE * ranges.size(); }
+		};
+		void action(ReadRangesAction& rr) {
+			Reference<ReadCursor> cursor = getCursor();
+			std::vector<RangeResult> results;
+			results.reserve(rr.ranges.size());
+			for (auto const& range : rr.ranges) {
+				results.push_back(cursor->get().getRange(range, rr.rowLimit, rr.byteLimit));
+			}
+			rr.result.send(results);
+			++counter;
+		}
 	};
 
 	struct Writer : IThreadPoolReceiver {
@@ -2212,6 +2274,24 @@ Future<RangeResult> KeyValueStoreSQLite::readRange(KeyRangeRef keys, int rowLimi
 	readThreads->post(p);
 	return f;
 }
+Future<std::vector<Optional<Value>>> KeyValueStoreSQLite::readValuePrefixes(
+    std::vector<std::pair<KeyRef, int>> const& keys,
+    Optional<UID> debugID) {
+	++readsRequested;
+	auto p = new Reader::ReadValuePrefixesAction(keys, debugID);
+	auto f = p->result.getFuture();
+	readThreads->post(p);
+	return f;
+}
+Future<std::vector<RangeResult>> KeyValueStoreSQLite::readRanges(std::vector<KeyRangeRef> const& ranges,
+                                                                 int rowLimit,
+                                                                 int byteLimit) {
+	++readsRequested;
+	auto p = new Reader::ReadRangesAction(ranges, rowLimit, byteLimit);
+	auto f = p->result.getFuture();
+	readThreads->post(p);
+	return f;
+}
 Future<KeyValueStoreSQLite::SpringCleaningWorkPerformed> KeyValueStoreSQLite::doClean() {
 	++writesRequested;
 	auto p = new Writer::SpringCleaningAction;
@@ -987,7 +987,7 @@ struct LogPushData : NonCopyable {
 	void addTag(Tag tag) { next_message_tags.push_back(tag); }
 
 	template <class T>
-	void addTags(T tags) {
+	void addTags(T const& tags) {
 		next_message_tags.insert(next_message_tags.end(), tags.begin(), tags.end());
 	}
 
@@ -1000,15 +1000,7 @@ struct LogPushData : NonCopyable {
 
 	void writeMessage(StringRef rawMessageWithoutLength, bool usePreviousLocations) {
 		if (!usePreviousLocations) {
-			prev_tags.clear();
-			if (logSystem->hasRemoteLogs()) {
-				prev_tags.push_back(logSystem->getRandomRouterTag());
-			}
-			for (auto& tag : next_message_tags) {
-				prev_tags.push_back(tag);
-			}
-			msg_locations.clear();
-			logSystem->getPushLocations(prev_tags, msg_locations);
+			updatePushLocations(false);
 			next_message_tags.clear();
 		}
 		uint32_t subseq = this->subsequence++;
@@ -1025,15 +1017,7 @@ struct LogPushData : NonCopyable {
 
 	template <class T>
 	void writeTypedMessage(T const& item, bool metadataMessage = false, bool allLocations = false) {
-		prev_tags.clear();
-		if (logSystem->hasRemoteLogs()) {
-			prev_tags.push_back(logSystem->getRandomRouterTag());
-		}
-		for (auto& tag : next_message_tags) {
-			prev_tags.push_back(tag);
-		}
-		msg_locations.clear();
-		logSystem->getPushLocations(prev_tags, msg_locations, allLocations);
+		updatePushLocations(allLocations);
 
 		BinaryWriter bw(AssumeVersion(g_network->protocolVersion()));
 
@@ -1121,6 +1105,7 @@ private:
 	std::vector<BinaryWriter> messagesWriter;
 	std::vector<bool> isEmptyMessage; // if messagesWriter has written anything
 	std::vector<int> msg_locations;
+	bool msg_all_locations = false; // msg_locations were computed with allLocations
 	// Stores message locations that have had span information written to them
 	// for the current transaction. Adding transaction info will reset this
 	// field.
@@ -1128,6 +1113,29 @@ private:
 	uint32_t subsequence;
 	SpanID spanContext;
 
+	// Sets prev_tags to the tags of the next message, including a log router tag if there are remote logs, and
+	// msg_locations to the logs it is pushed to.  Consecutive messages usually have the same tags, e.g. mutations of
+	// keys in the same shard, so the locations of the previous message are reused if its tags were the same.
+	void updatePushLocations(bool allLocations) {
+		bool hasRouterTag = logSystem->hasRemoteLogs();
+		Tag routerTag = hasRouterTag ? logSystem->getRandomRouterTag() : invalidTag;
+		if (allLocations == msg_all_locations && !prev_tags.empty() &&
+		    prev_tags.size() == next_message_tags.size() + hasRouterTag &&
+		    (!hasRouterTag || prev_tags[0] == routerTag) &&
+		    std::equal(next_message_tags.begin(), next_message_tags.end(), prev_tags.begin() + hasRouterTag)) {
+			return;
+		}
+
+		prev_tags.clear();
+		if (hasRouterTag) {
+			prev_tags.push_back(routerTag);
+		}
+		prev_tags.insert(prev_tags.end(), next_message_tags.begin(), next_message_tags.end());
+		msg_locations.clear();
+		logSystem->getPushLocations(prev_tags, msg_locations, allLocations);
+		msg_all_locations = allLocations;
+	}
+
 	// Writes transaction info to the message stream at the given location if
 	// it has not already been written (for the current transaction). Returns
 	// true on a successful write, and false if the location has already been
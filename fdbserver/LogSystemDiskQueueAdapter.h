@@ -105,6 +105,10 @@ public:
 		ASSERT(false);
 		throw internal_error();
 	}
+	IDiskQueue::location getPoppedLocation() const override {
+		ASSERT(false);
+		throw internal_error();
+	}
 	Future<Standalone<StringRef>> read(location start, location end, CheckHashes ch) override {
 		ASSERT(false);
 		throw internal_error();
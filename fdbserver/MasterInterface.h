@@ -151,14 +151,28 @@ struct GetCommitVersionReply {
 	Version version;
 	Version prevVersion;
 	uint64_t requestNum;
-
-	GetCommitVersionReply() : resolverChangesVersion(0), version(0), prevVersion(0), requestNum(0) {}
+	// If valid, the proxy may also assign the versions in (version, leaseEnd] to its later commit batches, and must
+	// commit leaseEnd itself within leaseDuration seconds
+	Version leaseEnd;
+	double leaseDuration;
+
+	GetCommitVersionReply()
+	  : resolverChangesVersion(0), version(0), prevVersion(0), requestNum(0), leaseEnd(invalidVersion),
+	    leaseDuration(0) {}
 	explicit GetCommitVersionReply(Version version, Version prevVersion, uint64_t requestNum)
-	  : version(version), prevVersion(prevVersion), resolverChangesVersion(0), requestNum(requestNum) {}
+	  : version(version), prevVersion(prevVersion), resolverChangesVersion(0), requestNum(requestNum),
+	    leaseEnd(invalidVersion), leaseDuration(0) {}
 
 	template <class Ar>
 	void serialize(Ar& ar) {
-		serializer(ar, resolverChanges, resolverChangesVersion, version, prevVersion, requestNum);
+		serializer(ar,
+		           resolverChanges,
+		           resolverChangesVersion,
+		           version,
+		           prevVersion,
+		           requestNum,
+		           leaseEnd,
+		           leaseDuration);
 	}
 };
 
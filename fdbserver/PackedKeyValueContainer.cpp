@@ -0,0 +1,523 @@
+/*
+ * PackedKeyValueContainer.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2021 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "fdbserver/PackedKeyValueContainer.h"
+#include "flow/IRandom.h"
+#include "flow/UnitTest.h"
+
+// Lengths are stored as little endian base 128 varints
+static void appendLength(std::vector<uint8_t>& out, uint32_t n) {
+	while (n >= 0x80) {
+		out.push_back((n & 0x7f) | 0x80);
+		n >>= 7;
+	}
+	out.push_back(n);
+}
+
+static uint32_t readLength(const uint8_t*& p) {
+	uint32_t n = 0;
+	int shift = 0;
+	while (*p & 0x80) {
+		n |= uint32_t(*p++ & 0x7f) << shift;
+		shift += 7;
+	}
+	return n | (uint32_t(*p++) << shift);
+}
+
+void PackedKeyValueContainer::iterator::decode() {
+	const uint8_t* begin = block->second.data.data();
+	const uint8_t* p = begin + offset;
+	int prefixLength = readLength(p);
+	int suffixLength = readLength(p);
+	int valueLength = readLength(p);
+	key.resize(prefixLength);
+	key.append((const char*)p, suffixLength);
+	p += suffixLength;
+	value = StringRef(p, valueLength);
+	next = p + valueLength - begin;
+}
+
+PackedKeyValueContainer::iterator& PackedKeyValueContainer::iterator::operator++() {
+	offset = next;
+	if (offset == block->second.data.size()) {
+		++block;
+		offset = next = 0;
+		key.clear();
+		value = StringRef();
+		if (block == blocks->end()) {
+			return *this;
+		}
+	}
+	decode();
+	return *this;
+}
+
+void PackedKeyValueContainer::clear() {
+	blocks.clear();
+	count = 0;
+	totalBytes = 0;
+	lastKeyValid = false;
+}
+
+PackedKeyValueContainer::iterator PackedKeyValueContainer::seek(BlockMap::iterator b,
+                                                                const StringRef& key,
+                                                                bool orEqual) {
+	// If the pair isn't in b, it is the first one in the next block, since that block's keys are all greater than key
+	iterator i(&blocks, b);
+	while (i.block == b) {
+		int c = i.getKey(nullptr).compare(key);
+		if (c > 0 || (c == 0 && orEqual)) {
+			break;
+		}
+		++i;
+	}
+	return i;
+}
+
+PackedKeyValueContainer::iterator PackedKeyValueContainer::find(const StringRef& key) {
+	iterator i = lower_bound(key);
+	if (i.block != blocks.end() && i.getKey(nullptr) == key) {
+		return i;
+	}
+	return end();
+}
+
+PackedKeyValueContainer::iterator PackedKeyValueContainer::lower_bound(const StringRef& key) {
+	auto b = blocks.upper_bound(key);
+	if (b == blocks.begin()) {
+		return iterator(&blocks, b);
+	}
+	return seek(std::prev(b), key, true);
+}
+
+PackedKeyValueContainer::iterator PackedKeyValueContainer::upper_bound(const StringRef& key) {
+	auto b = blocks.upper_bound(key);
+	if (b == blocks.begin()) {
+		return iterator(&blocks, b);
+	}
+	return seek(std::prev(b), key, false);
+}
+
+PackedKeyValueContainer::iterator PackedKeyValueContainer::previous(iterator i) {
+	if (i.block == blocks.end() || i.offset == 0) {
+		if (i.block == blocks.begin()) {
+			return end();
+		}
+		iterator p(&blocks, std::prev(i.block));
+		while (!p.lastInBlock()) {
+			++p;
+		}
+		return p;
+	}
+
+	// Keys can only be decoded forward, so scan from the start of the block
+	iterator p(&blocks, i.block);
+	while (p.next != i.offset) {
+		++p;
+	}
+	return p;
+}
+
+PackedKeyValueContainer::iterator PackedKeyValueContainer::insert(const StringRef& key,
+                                                                  const StringRef& val,
+                                                                  bool replaceExisting) {
+	// Appending, which is how sorted data is loaded, adds to the last block without rewriting it
+	if (blocks.empty() || key > lastKey()) {
+		StringRef prevKey;
+		BlockMap::iterator b;
+		if (blocks.empty() || blocks.rbegin()->second.data.size() >= BLOCK_BYTES) {
+			if (!blocks.empty()) {
+				b = std::prev(blocks.end());
+				totalBytes -= blockBytes(b->first, b->second);
+				b->second.data.shrink_to_fit();
+				totalBytes += blockBytes(b->first, b->second);
+			}
+			b = blocks.emplace_hint(blocks.end(), Key(key), Block());
+		} else {
+			b = std::prev(blocks.end());
+			prevKey = lastKey();
+			totalBytes -= blockBytes(b->first, b->second);
+		}
+
+		int offset = b->second.data.size();
+		appendPair(b->second, prevKey, key, val);
+		totalBytes += blockBytes(b->first, b->second);
+		++count;
+
+		iterator i(&blocks, b, offset, prevKey);
+		lastKeyBuffer.assign((const char*)key.begin(), key.size());
+		lastKeyValid = true;
+		return i;
+	}
+
+	auto b = blocks.upper_bound(key);
+	if (b == blocks.begin()) {
+		// The key will be the first in the first block, whose index key must be lowered to it
+		auto node = blocks.extract(b);
+		totalBytes += key.size() - node.key().size();
+		node.key() = Key(key);
+		b = blocks.insert(std::move(node)).position;
+	} else {
+		--b;
+	}
+
+	// The pair is spliced into the block, and the pair after it re-encoded against the new key
+	Block& block = b->second;
+	iterator i(&blocks, b);
+	std::string prevKey;
+	while (i.block == b && i.getKey(nullptr) < key) {
+		prevKey = i.key;
+		++i;
+	}
+	bool following = i.block == b;
+	int offset = following ? i.offset : block.data.size();
+	int replaced = following ? i.next - i.offset : 0;
+	std::vector<uint8_t> bytes;
+	encodePair(bytes, StringRef(prevKey), key, val);
+	if (following && i.getKey(nullptr) == key) {
+		if (!replaceExisting) {
+			return i;
+		}
+	} else {
+		if (following) {
+			encodePair(bytes, key, i.getKey(nullptr), i.getValue());
+		}
+		++block.count;
+		++count;
+	}
+	totalBytes -= blockBytes(b->first, block);
+	splice(block.data, offset, replaced, bytes);
+	totalBytes += blockBytes(b->first, block);
+
+	if (block.data.size() > 2 * BLOCK_BYTES) {
+		Arena arena;
+		std::vector<KeyValueRef> pairs;
+		decodeBlock(block, arena, pairs);
+		rewrite(b, pairs);
+		return lower_bound(key);
+	}
+	return iterator(&blocks, b, offset, StringRef(prevKey));
+}
+
+int PackedKeyValueContainer::insert(const std::vector<std::pair<KeyValueMapPair, uint64_t>>& pairs,
+                                    bool replaceExisting) {
+	for (auto const& p : pairs) {
+		insert(p.first.key, p.first.value, replaceExisting);
+	}
+	return pairs.size();
+}
+
+void PackedKeyValueContainer::erase(iterator begin, iterator end) {
+	if (begin == end) {
+		return;
+	}
+	lastKeyValid = false;
+
+	Arena arena;
+	StringRef beginKey(arena, begin.getKey(nullptr));
+	StringRef endKey(arena, end.getKey(nullptr));
+	std::vector<KeyValueRef> pairs;
+	auto keep = [&](BlockMap::iterator b, auto pred) {
+		pairs.clear();
+		decodeBlock(b->second, arena, pairs);
+		pairs.erase(std::remove_if(pairs.begin(), pairs.end(), [&](KeyValueRef const& kv) { return !pred(kv.key); }),
+		            pairs.end());
+		rewrite(b, pairs);
+	};
+
+	if (begin.block == end.block) {
+		// The pairs are cut out of the block, and the pair after them re-encoded against the pair before them, which
+		// shares the first prefixLength bytes of beginKey
+		Block& block = begin.block->second;
+		const uint8_t* p = block.data.data() + begin.offset;
+		int prefixLength = readLength(p);
+		std::vector<uint8_t> bytes;
+		encodePair(bytes, beginKey.substr(0, prefixLength), endKey, end.getValue());
+		int erased = 0;
+		for (iterator i = begin; i != end; ++i) {
+			++erased;
+		}
+		totalBytes -= blockBytes(begin.block->first, block);
+		splice(block.data, begin.offset, end.next - begin.offset, bytes);
+		totalBytes += blockBytes(begin.block->first, block);
+		block.count -= erased;
+		count -= erased;
+	} else {
+		// Blocks entirely within the range are dropped without being decoded
+		for (auto b = std::next(begin.block); b != end.block;) {
+			removeBlock(b++);
+		}
+		if (end.block != blocks.end() && end.offset != 0) {
+			keep(end.block, [&](StringRef k) { return k >= endKey; });
+		}
+		if (begin.offset == 0) {
+			removeBlock(begin.block);
+		} else {
+			keep(begin.block, [&](StringRef k) { return k < beginKey; });
+		}
+	}
+
+	// The blocks on either side of the range may now be small enough to merge
+	auto b = blocks.upper_bound(beginKey);
+	if (b != blocks.begin()) {
+		mergeWithNext(std::prev(b));
+	}
+}
+
+uint64_t PackedKeyValueContainer::sumTo(iterator to) const {
+	if (to.block == blocks.end()) {
+		return totalBytes;
+	}
+	int64_t bytes = 0;
+	for (auto b = blocks.begin(); b != to.block; ++b) {
+		bytes += blockBytes(b->first, b->second);
+	}
+	return bytes + to.offset;
+}
+
+void PackedKeyValueContainer::rewrite(BlockMap::iterator b, const std::vector<KeyValueRef>& pairs) {
+	totalBytes -= blockBytes(b->first, b->second);
+	count -= b->second.count;
+	if (pairs.empty()) {
+		blocks.erase(b);
+		return;
+	}
+
+	// The pairs refer to the current contents of the block, so the new blocks are built before replacing it
+	Block whole;
+	StringRef prevKey;
+	for (auto const& kv : pairs) {
+		appendPair(whole, prevKey, kv.key, kv.value);
+		prevKey = kv.key;
+	}
+
+	// Blocks are split into parts of at least BLOCK_BYTES, so that a full block isn't split again by its next insert
+	std::vector<Block> parts;
+	std::vector<int> firstPairs;
+	if (whole.data.size() <= 2 * BLOCK_BYTES) {
+		parts.push_back(std::move(whole));
+		firstPairs.push_back(0);
+	} else {
+		int partBytes = whole.data.size() / (whole.data.size() / BLOCK_BYTES);
+		for (int p = 0; p < pairs.size(); ++p) {
+			if (parts.empty() || parts.back().data.size() >= partBytes) {
+				parts.emplace_back();
+				firstPairs.push_back(p);
+				prevKey = StringRef();
+			}
+			appendPair(parts.back(), prevKey, pairs[p].key, pairs[p].value);
+			prevKey = pairs[p].key;
+		}
+	}
+
+	auto next = std::next(b);
+	for (int p = 0; p < parts.size(); ++p) {
+		parts[p].data.shrink_to_fit();
+		auto target = b;
+		if (p == 0) {
+			b->second = std::move(parts[0]);
+		} else {
+			target = blocks.emplace_hint(next, Key(pairs[firstPairs[p]].key), std::move(parts[p]));
+		}
+		totalBytes += blockBytes(target->first, target->second);
+		count += target->second.count;
+	}
+}
+
+void PackedKeyValueContainer::mergeWithNext(BlockMap::iterator b) {
+	auto n = std::next(b);
+	if (n == blocks.end() || b->second.data.size() + n->second.data.size() > BLOCK_BYTES) {
+		return;
+	}
+	Arena arena;
+	std::vector<KeyValueRef> pairs;
+	decodeBlock(b->second, arena, pairs);
+	decodeBlock(n->second, arena, pairs);
+	rewrite(b, pairs);
+	removeBlock(n);
+}
+
+void PackedKeyValueContainer::removeBlock(BlockMap::iterator b) {
+	totalBytes -= blockBytes(b->first, b->second);
+	count -= b->second.count;
+	blocks.erase(b);
+}
+
+StringRef PackedKeyValueContainer::lastKey() {
+	if (!lastKeyValid) {
+		iterator i(&blocks, std::prev(blocks.end()));
+		while (!i.lastInBlock()) {
+			++i;
+		}
+		lastKeyBuffer = i.key;
+		lastKeyValid = true;
+	}
+	return StringRef((const uint8_t*)lastKeyBuffer.data(), lastKeyBuffer.size());
+}
+
+void PackedKeyValueContainer::decodeBlock(const Block& block, Arena& arena, std::vector<KeyValueRef>& pairs) {
+	std::string key;
+	const uint8_t* p = block.data.data();
+	const uint8_t* end = p + block.data.size();
+	while (p != end) {
+		int prefixLength = readLength(p);
+		int suffixLength = readLength(p);
+		int valueLength = readLength(p);
+		key.resize(prefixLength);
+		key.append((const char*)p, suffixLength);
+		p += suffixLength;
+		pairs.emplace_back(StringRef(arena, StringRef((const uint8_t*)key.data(), key.size())),
+		                   StringRef(p, valueLength));
+		p += valueLength;
+	}
+}
+
+void PackedKeyValueContainer::appendPair(Block& block,
+                                         const StringRef& prevKey,
+                                         const StringRef& key,
+                                         const StringRef& value) {
+	encodePair(block.data, prevKey, key, value);
+	++block.count;
+}
+
+void PackedKeyValueContainer::encodePair(std::vector<uint8_t>& out,
+                                         const StringRef& prevKey,
+                                         const StringRef& key,
+                                         const StringRef& value) {
+	int prefixLength = 0;
+	int maxPrefixLength = std::min(prevKey.size(), key.size());
+	while (prefixLength < maxPrefixLength && prevKey[prefixLength] == key[prefixLength]) {
+		++prefixLength;
+	}
+	appendLength(out, prefixLength);
+	appendLength(out, key.size() - prefixLength);
+	appendLength(out, value.size());
+	out.insert(out.end(), key.begin() + prefixLength, key.end());
+	out.insert(out.end(), value.begin(), value.end());
+}
+
+void PackedKeyValueContainer::splice(std::vector<uint8_t>& data,
+                                     int offset,
+                                     int length,
+                                     const std::vector<uint8_t>& bytes) {
+	// Blocks grow in small steps rather than doubling, since their capacity counts against the memory limit
+	size_t size = data.size() - length + bytes.size();
+	if (size > data.capacity()) {
+		data.reserve(size + size / 8);
+	}
+	if (bytes.size() >= length) {
+		data.insert(data.begin() + offset + length, bytes.begin() + length, bytes.end());
+		std::copy(bytes.begin(), bytes.begin() + length, data.begin() + offset);
+	} else {
+		std::copy(bytes.begin(), bytes.end(), data.begin() + offset);
+		data.erase(data.begin() + offset + bytes.size(), data.begin() + offset + length);
+	}
+}
+
+// The memory used by a block and its entry in the index, which is a map node holding the index key in an Arena
+int64_t PackedKeyValueContainer::blockBytes(const Key& separator, const Block& block) {
+	return sizeof(BlockMap::value_type) + 4 * sizeof(void*) + separator.size() + block.data.capacity();
+}
+
+// Checks the container against a std::map after random inserts and erases
+TEST_CASE("/fdbserver/PackedKeyValueContainer/randomOps") {
+	PackedKeyValueContainer c;
+	std::map<std::string, std::string> expected;
+	Arena arena;
+
+	auto randomKey = [&]() {
+		// Keys share prefixes, like the keys of most workloads
+		static const std::vector<const char*> prefixes = { "", "a", "table/", "table/index/" };
+		return format(
+		    "%s/%06d", deterministicRandom()->randomChoice(prefixes), deterministicRandom()->randomInt(0, 2000));
+	};
+	auto check = [&]() {
+		ASSERT(std::get<0>(c.size()) == expected.size());
+		auto i = c.begin();
+		for (auto const& kv : expected) {
+			ASSERT(i != c.end());
+			ASSERT(i.getKey(nullptr) == StringRef(kv.first));
+			ASSERT(i.getValue() == StringRef(kv.second));
+			++i;
+		}
+		ASSERT(i == c.end());
+
+		auto r = c.previous(c.end());
+		for (auto e = expected.rbegin(); e != expected.rend(); ++e) {
+			ASSERT(r != c.end());
+			ASSERT(r.getKey(nullptr) == StringRef(e->first));
+			r = c.previous(r);
+		}
+		ASSERT(r == c.end());
+
+		for (int j = 0; j < 100; ++j) {
+			std::string key = randomKey();
+			auto lower = expected.lower_bound(key);
+			auto upper = expected.upper_bound(key);
+			auto l = c.lower_bound(key);
+			auto u = c.upper_bound(key);
+			auto f = c.find(key);
+			ASSERT(lower == expected.end() ? l == c.end() : l.getKey(nullptr) == StringRef(lower->first));
+			ASSERT(upper == expected.end() ? u == c.end() : u.getKey(nullptr) == StringRef(upper->first));
+			ASSERT(expected.count(key) ? f == l : f == c.end());
+		}
+	};
+
+	for (int round = 0; round < 50; ++round) {
+		int inserts = deterministicRandom()->randomInt(0, 500);
+		for (int i = 0; i < inserts; ++i) {
+			std::string key = randomKey();
+			int valueSize = deterministicRandom()->random01() < 0.01 ? deterministicRandom()->randomInt(0, 20000)
+			                                                          : deterministicRandom()->randomInt(0, 100);
+			std::string value = deterministicRandom()->randomAlphaNumeric(valueSize);
+			bool replace = deterministicRandom()->coinflip();
+			auto it = c.insert(StringRef(key), StringRef(value), replace);
+			ASSERT(it.getKey(nullptr) == StringRef(key));
+			if (replace || !expected.count(key)) {
+				expected[key] = value;
+			}
+			ASSERT(it.getValue() == StringRef(expected[key]));
+		}
+
+		int erases = deterministicRandom()->randomInt(0, 10);
+		for (int i = 0; i < erases; ++i) {
+			std::string begin = randomKey();
+			// Clearing single keys is the most common erase
+			std::string end = deterministicRandom()->coinflip() ? begin + '\x00' : randomKey();
+			if (end < begin) {
+				std::swap(begin, end);
+			}
+			if (deterministicRandom()->random01() < 0.1) {
+				c.erase(c.lower_bound(begin), c.end());
+				expected.erase(expected.lower_bound(begin), expected.end());
+			} else {
+				c.erase(c.lower_bound(begin), c.lower_bound(end));
+				expected.erase(expected.lower_bound(begin), expected.lower_bound(end));
+			}
+		}
+		check();
+	}
+
+	c.clear();
+	ASSERT(c.empty() && c.begin() == c.end() && c.sumTo(c.end()) == 0);
+	return Void();
+}
@@ -0,0 +1,146 @@
+/*
+ * PackedKeyValueContainer.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2021 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FDBSERVER_PACKEDKEYVALUECONTAINER_H
+#define FDBSERVER_PACKEDKEYVALUECONTAINER_H
+#pragma once
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "fdbclient/FDBTypes.h"
+#include "fdbserver/IKeyValueContainer.h"
+#include "flow/Arena.h"
+
+// A sorted key value container for KeyValueStoreMemory that packs its pairs into blocks of about BLOCK_BYTES.  Each
+// pair is stored as the number of bytes its key shares with the previous key in the block, the rest of the key and the
+// value, with the lengths as varints, and only the blocks are indexed.  Compared to IKeyValueContainer this saves the
+// tree node and Arena of each pair, at the cost of decoding part of a block for each lookup and moving the rest of a
+// block for each modification.
+//
+// Any modification invalidates all iterators.  The key returned by an iterator is held by the iterator, so it is valid
+// until the iterator is changed or destroyed.
+class PackedKeyValueContainer : NonCopyable {
+public:
+	static constexpr int BLOCK_BYTES = 1024;
+
+private:
+	struct Block {
+		std::vector<uint8_t> data;
+		int count = 0;
+	};
+
+	// Each block is indexed by a key that is no greater than any key in it and greater than every key in the blocks
+	// before it
+	using BlockMap = std::map<Key, Block, std::less<>>;
+
+public:
+	class iterator {
+	public:
+		bool operator==(const iterator& r) const { return block == r.block && offset == r.offset; }
+		bool operator!=(const iterator& r) const { return !(*this == r); }
+		iterator& operator++();
+
+		StringRef getKey(uint8_t* content) const { return StringRef((const uint8_t*)key.data(), key.size()); }
+		StringRef getValue() const { return value; }
+
+	private:
+		friend class PackedKeyValueContainer;
+
+		// An iterator at the pair at offset in block, whose key shares a prefix with prevKey
+		iterator(BlockMap* blocks, BlockMap::iterator block, int offset = 0, StringRef prevKey = StringRef())
+		  : blocks(blocks), block(block), offset(offset), next(offset),
+		    key((const char*)prevKey.begin(), prevKey.size()) {
+			if (block != blocks->end()) {
+				decode();
+			}
+		}
+
+		// Reads the pair at offset, whose key shares a prefix with the current key
+		void decode();
+		bool lastInBlock() const { return next == block->second.data.size(); }
+
+		BlockMap* blocks;
+		BlockMap::iterator block;
+		int offset; // Of the current pair in the block
+		int next; // Of the pair after it
+		std::string key;
+		StringRef value;
+	};
+
+	PackedKeyValueContainer() : count(0), totalBytes(0), lastKeyValid(false) {}
+
+	bool empty() const { return blocks.empty(); }
+	void clear();
+
+	// The number of pairs, the number of blocks, and zero
+	std::tuple<size_t, size_t, size_t> size() const { return std::make_tuple(count, blocks.size(), 0); }
+
+	iterator begin() { return iterator(&blocks, blocks.begin()); }
+	iterator end() const {
+		BlockMap* b = const_cast<BlockMap*>(&blocks);
+		return iterator(b, b->end());
+	}
+	iterator find(const StringRef& key);
+	iterator lower_bound(const StringRef& key);
+	iterator upper_bound(const StringRef& key);
+	iterator previous(iterator i);
+
+	iterator insert(const StringRef& key, const StringRef& val, bool replaceExisting = true);
+	// The metrics are ignored, since the space used by a pair depends on its neighbors
+	int insert(const std::vector<std::pair<KeyValueMapPair, uint64_t>>& pairs, bool replaceExisting = true);
+	void erase(iterator begin, iterator end);
+
+	// The memory used by the pairs before to, including the blocks and the index
+	uint64_t sumTo(iterator to) const;
+
+	static constexpr int getElementBytes() { return 0; }
+
+private:
+	// Returns the first pair at or after (or only after, if orEqual is false) key, starting the search in block b
+	iterator seek(BlockMap::iterator b, const StringRef& key, bool orEqual);
+	// Replaces the pairs of block b, splitting them into several blocks if there are too many and removing b if there
+	// are none
+	void rewrite(BlockMap::iterator b, const std::vector<KeyValueRef>& pairs);
+	// Merges block b with the one after it if they would fit in one block
+	void mergeWithNext(BlockMap::iterator b);
+	void removeBlock(BlockMap::iterator b);
+	StringRef lastKey();
+
+	static void decodeBlock(const Block& block, Arena& arena, std::vector<KeyValueRef>& pairs);
+	static void appendPair(Block& block, const StringRef& prevKey, const StringRef& key, const StringRef& value);
+	static void encodePair(std::vector<uint8_t>& out,
+	                       const StringRef& prevKey,
+	                       const StringRef& key,
+	                       const StringRef& value);
+	// Replaces the length bytes at offset in data with bytes
+	static void splice(std::vector<uint8_t>& data, int offset, int length, const std::vector<uint8_t>& bytes);
+	static int64_t blockBytes(const Key& separator, const Block& block);
+
+	BlockMap blocks;
+	size_t count;
+	int64_t totalBytes;
+	std::string lastKeyBuffer; // The greatest key in the container, if lastKeyValid
+	bool lastKeyValid;
+};
+
+#endif
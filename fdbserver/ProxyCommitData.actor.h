@@ -54,6 +54,7 @@ struct ProxyStats {
 	Counter txnConflicts;
 	Counter txnRejectedForQueuedTooLong;
 	Counter commitBatchIn, commitBatchOut;
+	Counter coalescedCommitsIn; // Client messages carrying several transactions, counted once per message
 	Counter mutationBytes;
 	Counter mutations;
 	Counter conflictRanges;
@@ -68,6 +69,12 @@ struct ProxyStats {
 	LatencySample commitBatchingEmptyMessageRatio;
 
 	LatencySample commitBatchingWindowSize;
+	LatencySample commitBatchingSizeFraction;
+
+	// Latencies of the phases of commit batches: waiting for the commit version, resolution, and logging
+	LatencySample commitVersionLatency;
+	LatencySample commitResolutionLatency;
+	LatencySample commitLoggingLatency;
 
 	Future<Void> logger;
 
@@ -96,6 +103,7 @@ struct ProxyStats {
 	    txnCommitOutSuccess("TxnCommitOutSuccess", cc), txnCommitErrors("TxnCommitErrors", cc),
 	    txnConflicts("TxnConflicts", cc), commitBatchIn("CommitBatchIn", cc),
 	    txnRejectedForQueuedTooLong("TxnRejectedForQueuedTooLong", cc), commitBatchOut("CommitBatchOut", cc),
+	    coalescedCommitsIn("CoalescedCommitsIn", cc),
 	    mutationBytes("MutationBytes", cc), mutations("Mutations", cc), conflictRanges("ConflictRanges", cc),
 	    keyServerLocationIn("KeyServerLocationIn", cc), keyServerLocationOut("KeyServerLocationOut", cc),
 	    keyServerLocationErrors("KeyServerLocationErrors", cc), lastCommitVersionAssigned(0),
@@ -112,7 +120,23 @@ struct ProxyStats {
 	    commitBatchingWindowSize("CommitBatchingWindowSize",
 	                             id,
 	                             SERVER_KNOBS->LATENCY_METRICS_LOGGING_INTERVAL,
-	                             SERVER_KNOBS->LATENCY_SAMPLE_SIZE) {
+	                             SERVER_KNOBS->LATENCY_SAMPLE_SIZE),
+	    commitBatchingSizeFraction("CommitBatchingSizeFraction",
+	                               id,
+	                               SERVER_KNOBS->LATENCY_METRICS_LOGGING_INTERVAL,
+	                               SERVER_KNOBS->LATENCY_SAMPLE_SIZE),
+	    commitVersionLatency("CommitVersionLatencyMetrics",
+	                         id,
+	                         SERVER_KNOBS->LATENCY_METRICS_LOGGING_INTERVAL,
+	                         SERVER_KNOBS->LATENCY_SAMPLE_SIZE),
+	    commitResolutionLatency("CommitResolutionLatencyMetrics",
+	                            id,
+	                            SERVER_KNOBS->LATENCY_METRICS_LOGGING_INTERVAL,
+	                            SERVER_KNOBS->LATENCY_SAMPLE_SIZE),
+	    commitLoggingLatency("CommitLoggingLatencyMetrics",
+	                         id,
+	                         SERVER_KNOBS->LATENCY_METRICS_LOGGING_INTERVAL,
+	                         SERVER_KNOBS->LATENCY_SAMPLE_SIZE) {
 		specialCounter(cc, "LastAssignedCommitVersion", [this]() { return this->lastCommitVersionAssigned; });
 		specialCounter(cc, "Version", [pVersion]() { return *pVersion; });
 		specialCounter(cc, "CommittedVersion", [pCommittedVersion]() { return pCommittedVersion->get(); });
@@ -125,6 +149,71 @@ struct ProxyStats {
 	}
 };
 
+// The key ranges whose keyServers entries recently changed on a commit proxy, so that subscribed clients can update
+// their location caches without first being sent to the old location (see KeyServersChangesRequest)
+struct KeyServersChangeLog {
+	UID id; // Changes whenever positions in this log are not comparable with previously returned ones
+	int64_t end = 0; // Position after the last recorded change
+	std::deque<KeyRange> changes; // changes[i] is at position begin() + i
+	AsyncTrigger onChange;
+
+	KeyServersChangeLog() : id(deterministicRandom()->randomUniqueID()) {}
+
+	int64_t begin() const { return end - changes.size(); }
+
+	void add(KeyRangeRef range) {
+		changes.push_back(range);
+		++end;
+		while (changes.size() > SERVER_KNOBS->KEY_SERVERS_CHANGE_LOG_SIZE) {
+			changes.pop_front();
+		}
+		// Waiters run synchronously here, in the middle of applying metadata mutations, so they must yield before
+		// reading keyInfo
+		onChange.trigger();
+	}
+};
+
+// Chooses the commit batching interval and batch size for the target commit latency
+// COMMIT_TRANSACTION_BATCH_TARGET_LATENCY, from the smoothed latencies of the phases of recent commit batches.  A
+// commit waits up to the batching interval for its batch to start, so the interval is what remains of the target after
+// the phases.  Batches are made smaller while the phases and the minimum interval take longer than the target, and
+// larger again while they are at least COMMIT_TRANSACTION_BATCH_SIZE_HYSTERESIS below it, so that the size settles
+// rather than oscillating.
+struct CommitBatchController {
+	// Waiting for the commit version, resolution, and logging to the tlogs
+	double versionLatency = 0, resolutionLatency = 0, loggingLatency = 0;
+	// Fraction of the COMMIT_TRANSACTION_BATCH_COUNT_MAX and batch bytes limits in use
+	double sizeFraction = 1.0;
+
+	// Returns the next batching interval
+	double update(double version, double resolution, double logging) {
+		double alpha = SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA;
+		versionLatency = alpha * version + (1 - alpha) * versionLatency;
+		resolutionLatency = alpha * resolution + (1 - alpha) * resolutionLatency;
+		loggingLatency = alpha * logging + (1 - alpha) * loggingLatency;
+
+		double phasesLatency = versionLatency + resolutionLatency + loggingLatency;
+		double interval = std::max(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN,
+		                           std::min(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MAX,
+		                                    SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_TARGET_LATENCY - phasesLatency));
+		double minLatency = phasesLatency + SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN;
+		if (minLatency > SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_TARGET_LATENCY) {
+			sizeFraction = std::max(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_MIN_SIZE_FRACTION,
+			                        sizeFraction * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_SIZE_DECREASE_RATE);
+		} else if (minLatency < SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_TARGET_LATENCY *
+		                            (1 - SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_SIZE_HYSTERESIS)) {
+			sizeFraction = std::min(1.0, sizeFraction * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_SIZE_INCREASE_RATE);
+		}
+		return interval;
+	}
+
+	int countLimit() const {
+		return std::max(1, (int)(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_COUNT_MAX * sizeFraction));
+	}
+
+	int bytesLimit(int maxBytes) const { return std::max(1, (int)(maxBytes * sizeFraction)); }
+};
+
 struct ProxyCommitData {
 	UID dbgid;
 	int64_t commitBatchesMemBytesCount;
@@ -146,6 +235,7 @@ struct ProxyCommitData {
 	uint64_t mostRecentProcessedRequestNumber;
 	KeyRangeMap<Deque<std::pair<Version, int>>> keyResolvers;
 	KeyRangeMap<ServerCacheInfo> keyInfo; // keyrange -> all storage servers in all DCs for the keyrange
+	KeyServersChangeLog keyServersChanges;
 	KeyRangeMap<bool> cacheInfo;
 	std::map<Key, ApplyMutationsData> uid_applyMutationsData;
 	bool firstProxy;
@@ -153,6 +243,7 @@ struct ProxyCommitData {
 	bool locked;
 	Optional<Value> metadataVersion;
 	double commitBatchInterval;
+	CommitBatchController commitBatchController;
 
 	int64_t localCommitBatchesStarted;
 	NotifiedVersion latestLocalCommitBatchResolving;
@@ -176,6 +267,12 @@ struct ProxyCommitData {
 	double lastStartCommit;
 	double lastCommitLatency;
 	int updateCommitRequests = 0;
+
+	// Versions in (leasePrevVersion, leaseEnd] leased from the master, which must commit leaseEnd by leaseExpiry
+	Version leasePrevVersion = invalidVersion;
+	Version leaseEnd = invalidVersion;
+	AsyncVar<double> leaseExpiry; // 0 if there is no lease
+
 	NotifiedDouble lastCommitTime;
 
 	vector<double> commitComputePerOperation;
@@ -30,6 +30,9 @@
 #include "fdbserver/RatekeeperInterface.h"
 #include "fdbserver/ServerDBInfo.h"
 #include "fdbserver/WaitFailure.h"
+#include "flow/UnitTest.h"
+#include <fstream>
+#include <numeric>
 #include "flow/actorcompiler.h" // This must be the last #include.
 
 enum limitReason_t {
@@ -45,6 +48,7 @@ enum limitReason_t {
 	log_server_min_free_space_ratio,
 	storage_server_durability_lag, // 10
 	storage_server_list_fetch_failed,
+	storage_server_pending_compaction,
 	limitReason_t_end
 };
 
@@ -61,7 +65,8 @@ const char* limitReasonName[] = { "workload",
 	                              "log_server_min_free_space",
 	                              "log_server_min_free_space_ratio",
 	                              "storage_server_durability_lag",
-	                              "storage_server_list_fetch_failed" };
+	                              "storage_server_list_fetch_failed",
+	                              "storage_server_pending_compaction" };
 static_assert(sizeof(limitReasonName) / sizeof(limitReasonName[0]) == limitReason_t_end, "limitReasonDesc table size");
 
 // NOTE: This has a corresponding table in Script.cs (see RatekeeperReason graph)
@@ -77,7 +82,8 @@ const char* limitReasonDesc[] = { "Workload or read performance.",
 	                              "Log server running out of space (approaching 100MB limit).",
 	                              "Log server running out of space (approaching 5% limit).",
 	                              "Storage server durable version falling behind.",
-	                              "Unable to fetch storage server list." };
+	                              "Unable to fetch storage server list.",
+	                              "Storage server falling behind on compaction." };
 
 static_assert(sizeof(limitReasonDesc) / sizeof(limitReasonDesc[0]) == limitReason_t_end, "limitReasonDesc table size");
 
@@ -91,6 +97,7 @@ struct StorageQueueInfo {
 	Smoother smoothDurableVersion, smoothLatestVersion;
 	Smoother smoothFreeSpace;
 	Smoother smoothTotalSpace;
+	Smoother smoothPendingCompactionBytes;
 	limitReason_t limitReason;
 
 	Optional<TransactionTag> busiestReadTag, busiestWriteTag;
@@ -107,7 +114,7 @@ struct StorageQueueInfo {
 	    smoothInputBytes(SERVER_KNOBS->SMOOTHING_AMOUNT), verySmoothDurableBytes(SERVER_KNOBS->SLOW_SMOOTHING_AMOUNT),
 	    smoothDurableVersion(SERVER_KNOBS->SMOOTHING_AMOUNT), smoothLatestVersion(SERVER_KNOBS->SMOOTHING_AMOUNT),
 	    smoothFreeSpace(SERVER_KNOBS->SMOOTHING_AMOUNT), smoothTotalSpace(SERVER_KNOBS->SMOOTHING_AMOUNT),
-	    limitReason(limitReason_t::unlimited) {
+	    smoothPendingCompactionBytes(SERVER_KNOBS->SMOOTHING_AMOUNT), limitReason(limitReason_t::unlimited) {
 		// FIXME: this is a tacky workaround for a potential uninitialized use in trackStorageServerQueueInfo
 		lastReply.instanceID = -1;
 	}
@@ -562,6 +569,9 @@ struct RatekeeperData {
 	RkTagThrottleCollection throttledTags;
 	uint64_t throttledTagChangeId;
 
+	// Each GRV proxy's queues for each transaction tag since they were last logged
+	std::map<UID, TransactionTagMap<GrvTagQueueStats>> grvTagQueueStats;
+
 	RatekeeperLimits normalLimits;
 	RatekeeperLimits batchLimits;
 
@@ -600,6 +610,58 @@ struct RatekeeperData {
 	}
 };
 
+// Updates the smoothed queue metrics of a storage server from its latest reply
+void updateStorageQueueInfo(RatekeeperData* self, StorageQueueInfo& ss, StorageQueuingMetricsReply const& reply) {
+	ss.valid = true;
+	ss.prevReply = ss.lastReply;
+	ss.lastReply = reply;
+	if (ss.prevReply.instanceID != reply.instanceID) {
+		ss.smoothDurableBytes.reset(reply.bytesDurable);
+		ss.verySmoothDurableBytes.reset(reply.bytesDurable);
+		ss.smoothInputBytes.reset(reply.bytesInput);
+		ss.smoothFreeSpace.reset(reply.storageBytes.available);
+		ss.smoothTotalSpace.reset(reply.storageBytes.total);
+		ss.smoothPendingCompactionBytes.reset(reply.pendingCompactionBytes);
+		ss.smoothDurableVersion.reset(reply.durableVersion);
+		ss.smoothLatestVersion.reset(reply.version);
+	} else {
+		self->smoothTotalDurableBytes.addDelta(reply.bytesDurable - ss.prevReply.bytesDurable);
+		ss.smoothDurableBytes.setTotal(reply.bytesDurable);
+		ss.verySmoothDurableBytes.setTotal(reply.bytesDurable);
+		ss.smoothInputBytes.setTotal(reply.bytesInput);
+		ss.smoothFreeSpace.setTotal(reply.storageBytes.available);
+		ss.smoothTotalSpace.setTotal(reply.storageBytes.total);
+		ss.smoothPendingCompactionBytes.setTotal(reply.pendingCompactionBytes);
+		ss.smoothDurableVersion.setTotal(reply.durableVersion);
+		ss.smoothLatestVersion.setTotal(reply.version);
+	}
+
+	ss.busiestReadTag = reply.busiestTag;
+	ss.busiestReadTagFractionalBusyness = reply.busiestTagFractionalBusyness;
+	ss.busiestReadTagRate = reply.busiestTagRate;
+}
+
+// Updates the smoothed queue metrics of a tlog from its latest reply
+void updateTLogQueueInfo(RatekeeperData* self, TLogQueueInfo& tl, TLogQueuingMetricsReply const& reply) {
+	tl.valid = true;
+	tl.prevReply = tl.lastReply;
+	tl.lastReply = reply;
+	if (tl.prevReply.instanceID != reply.instanceID) {
+		tl.smoothDurableBytes.reset(reply.bytesDurable);
+		tl.verySmoothDurableBytes.reset(reply.bytesDurable);
+		tl.smoothInputBytes.reset(reply.bytesInput);
+		tl.smoothFreeSpace.reset(reply.storageBytes.available);
+		tl.smoothTotalSpace.reset(reply.storageBytes.total);
+	} else {
+		self->smoothTotalDurableBytes.addDelta(reply.bytesDurable - tl.prevReply.bytesDurable);
+		tl.smoothDurableBytes.setTotal(reply.bytesDurable);
+		tl.verySmoothDurableBytes.setTotal(reply.bytesDurable);
+		tl.smoothInputBytes.setTotal(reply.bytesInput);
+		tl.smoothFreeSpace.setTotal(reply.storageBytes.available);
+		tl.smoothTotalSpace.setTotal(reply.storageBytes.total);
+	}
+}
+
 // SOMEDAY: template trackStorageServerQueueInfo and trackTLogQueueInfo into one function
 ACTOR Future<Void> trackStorageServerQueueInfo(RatekeeperData* self, StorageServerInterface ssi) {
 	self->storageQueueInfo.insert(mapPair(ssi.id(), StorageQueueInfo(ssi.id(), ssi.locality)));
@@ -610,32 +672,7 @@ ACTOR Future<Void> trackStorageServerQueueInfo(RatekeeperData* self, StorageServ
 			ErrorOr<StorageQueuingMetricsReply> reply = wait(ssi.getQueuingMetrics.getReplyUnlessFailedFor(
 			    StorageQueuingMetricsRequest(), 0, 0)); // SOMEDAY: or tryGetReply?
 			if (reply.present()) {
-				myQueueInfo->value.valid = true;
-				myQueueInfo->value.prevReply = myQueueInfo->value.lastReply;
-				myQueueInfo->value.lastReply = reply.get();
-				if (myQueueInfo->value.prevReply.instanceID != reply.get().instanceID) {
-					myQueueInfo->value.smoothDurableBytes.reset(reply.get().bytesDurable);
-					myQueueInfo->value.verySmoothDurableBytes.reset(reply.get().bytesDurable);
-					myQueueInfo->value.smoothInputBytes.reset(reply.get().bytesInput);
-					myQueueInfo->value.smoothFreeSpace.reset(reply.get().storageBytes.available);
-					myQueueInfo->value.smoothTotalSpace.reset(reply.get().storageBytes.total);
-					myQueueInfo->value.smoothDurableVersion.reset(reply.get().durableVersion);
-					myQueueInfo->value.smoothLatestVersion.reset(reply.get().version);
-				} else {
-					self->smoothTotalDurableBytes.addDelta(reply.get().bytesDurable -
-					                                       myQueueInfo->value.prevReply.bytesDurable);
-					myQueueInfo->value.smoothDurableBytes.setTotal(reply.get().bytesDurable);
-					myQueueInfo->value.verySmoothDurableBytes.setTotal(reply.get().bytesDurable);
-					myQueueInfo->value.smoothInputBytes.setTotal(reply.get().bytesInput);
-					myQueueInfo->value.smoothFreeSpace.setTotal(reply.get().storageBytes.available);
-					myQueueInfo->value.smoothTotalSpace.setTotal(reply.get().storageBytes.total);
-					myQueueInfo->value.smoothDurableVersion.setTotal(reply.get().durableVersion);
-					myQueueInfo->value.smoothLatestVersion.setTotal(reply.get().version);
-				}
-
-				myQueueInfo->value.busiestReadTag = reply.get().busiestTag;
-				myQueueInfo->value.busiestReadTagFractionalBusyness = reply.get().busiestTagFractionalBusyness;
-				myQueueInfo->value.busiestReadTagRate = reply.get().busiestTagRate;
+				updateStorageQueueInfo(self, myQueueInfo->value, reply.get());
 			} else {
 				if (myQueueInfo->value.valid) {
 					TraceEvent("RkStorageServerDidNotRespond", self->id).detail("StorageServer", ssi.id());
@@ -663,24 +700,7 @@ ACTOR Future<Void> trackTLogQueueInfo(RatekeeperData* self, TLogInterface tli) {
 			ErrorOr<TLogQueuingMetricsReply> reply = wait(tli.getQueuingMetrics.getReplyUnlessFailedFor(
 			    TLogQueuingMetricsRequest(), 0, 0)); // SOMEDAY: or tryGetReply?
 			if (reply.present()) {
-				myQueueInfo->value.valid = true;
-				myQueueInfo->value.prevReply = myQueueInfo->value.lastReply;
-				myQueueInfo->value.lastReply = reply.get();
-				if (myQueueInfo->value.prevReply.instanceID != reply.get().instanceID) {
-					myQueueInfo->value.smoothDurableBytes.reset(reply.get().bytesDurable);
-					myQueueInfo->value.verySmoothDurableBytes.reset(reply.get().bytesDurable);
-					myQueueInfo->value.smoothInputBytes.reset(reply.get().bytesInput);
-					myQueueInfo->value.smoothFreeSpace.reset(reply.get().storageBytes.available);
-					myQueueInfo->value.smoothTotalSpace.reset(reply.get().storageBytes.total);
-				} else {
-					self->smoothTotalDurableBytes.addDelta(reply.get().bytesDurable -
-					                                       myQueueInfo->value.prevReply.bytesDurable);
-					myQueueInfo->value.smoothDurableBytes.setTotal(reply.get().bytesDurable);
-					myQueueInfo->value.verySmoothDurableBytes.setTotal(reply.get().bytesDurable);
-					myQueueInfo->value.smoothInputBytes.setTotal(reply.get().bytesInput);
-					myQueueInfo->value.smoothFreeSpace.setTotal(reply.get().storageBytes.available);
-					myQueueInfo->value.smoothTotalSpace.setTotal(reply.get().storageBytes.total);
-				}
+				updateTLogQueueInfo(self, myQueueInfo->value, reply.get());
 			} else {
 				if (myQueueInfo->value.valid) {
 					TraceEvent("RkTLogDidNotRespond", self->id).detail("TransactionLog", tli.id());
@@ -928,6 +948,36 @@ Future<Void> refreshStorageServerCommitCost(RatekeeperData* self) {
 	return Void();
 }
 
+// Logs the GRV proxy queues of the tags with the most queued transactions
+void logGrvTagQueues(RatekeeperData* self) {
+	// A tag's queue length is the sum of its peak queue lengths on each proxy
+	TransactionTagMap<GrvTagQueueStats> total;
+	for (auto const& [proxy, proxyStats] : self->grvTagQueueStats) {
+		for (auto const& [tag, stats] : proxyStats) {
+			total[tag] += stats;
+		}
+	}
+	std::vector<std::pair<int64_t, TransactionTag>> longest;
+	for (auto const& [tag, stats] : total) {
+		longest.emplace_back(stats.maxQueuedTransactions, tag);
+	}
+	int count = std::min<int>(longest.size(), SERVER_KNOBS->GRV_TAG_QUEUE_LOGGING_TAGS);
+	std::partial_sort(longest.begin(), longest.begin() + count, longest.end(), std::greater<>());
+	for (int i = 0; i < count; i++) {
+		GrvTagQueueStats const& stats = total[longest[i].second];
+		std::string histogram;
+		for (int b = 0; b < stats.waitHistogram.size(); b++) {
+			histogram += format("%s%lld", b ? " " : "", stats.waitHistogram[b]);
+		}
+		TraceEvent("RkGrvTagQueue", self->id)
+		    .detail("Tag", printable(longest[i].second))
+		    .detail("MaxQueuedTransactions", stats.maxQueuedTransactions)
+		    .detail("StartedTransactions", stats.startedTransactions)
+		    .detail("WaitMillisecondsLog2Histogram", histogram);
+	}
+	self->grvTagQueueStats.clear();
+}
+
 void tryAutoThrottleTag(RatekeeperData* self,
                         TransactionTag tag,
                         double rate,
@@ -1039,6 +1089,23 @@ void updateRate(RatekeeperData* self, RatekeeperLimits* limits) {
 			}
 		}
 
+		// Storage engines that compact in the background stall writes once too many bytes are waiting to be
+		// compacted, so the target queue shrinks as they approach STORAGE_PENDING_COMPACTION_LIMIT_BYTES, the same
+		// way it does when space runs low
+		int64_t compactionHeadroom = SERVER_KNOBS->STORAGE_PENDING_COMPACTION_LIMIT_BYTES -
+		                             (int64_t)ss.smoothPendingCompactionBytes.smoothTotal();
+		if (compactionHeadroom < SERVER_KNOBS->STORAGE_PENDING_COMPACTION_SPRING_BYTES) {
+			int64_t compactionTargetBytes = std::max<int64_t>(
+			    1,
+			    (double)limits->storageTargetBytes * std::max<int64_t>(0, compactionHeadroom) /
+			        SERVER_KNOBS->STORAGE_PENDING_COMPACTION_SPRING_BYTES);
+			if (compactionTargetBytes < targetBytes) {
+				targetBytes = compactionTargetBytes;
+				springBytes = std::max<int64_t>(1, std::min<int64_t>(springBytes, targetBytes * 0.2));
+				ssLimitReason = limitReason_t::storage_server_pending_compaction;
+			}
+		}
+
 		int64_t storageQueue = ss.lastReply.bytesInput - ss.smoothDurableBytes.smoothTotal();
 		worstStorageQueueStorageServer = std::max(worstStorageQueueStorageServer, storageQueue);
 
@@ -1429,6 +1496,8 @@ ACTOR Future<Void> ratekeeper(RatekeeperInterface rkInterf, Reference<AsyncVar<S
 	RatekeeperData* selfPtr = &self; // let flow compiler capture self
 	self.addActor.send(
 	    recurring([selfPtr]() { refreshStorageServerCommitCost(selfPtr); }, SERVER_KNOBS->TAG_MEASUREMENT_INTERVAL));
+	self.addActor.send(
+	    recurring([selfPtr]() { logGrvTagQueues(selfPtr); }, SERVER_KNOBS->GRV_TAG_QUEUE_LOGGING_INTERVAL));
 
 	TraceEvent("RkTLogQueueSizeParameters", rkInterf.id())
 	    .detail("Target", SERVER_KNOBS->TARGET_BYTES_PER_TLOG)
@@ -1485,6 +1554,12 @@ ACTOR Future<Void> ratekeeper(RatekeeperInterface rkInterf, Reference<AsyncVar<S
 						self.throttledTags.addRequests(tag.first, tag.second);
 					}
 				}
+				if (!req.tagQueueStats.empty()) {
+					auto& proxyStats = self.grvTagQueueStats[req.requesterID];
+					for (auto const& [tag, stats] : req.tagQueueStats) {
+						proxyStats[tag].addLaterReport(stats);
+					}
+				}
 				if (p.batchTransactions > 0) {
 					self.smoothBatchReleasedTransactions.addDelta(req.batchReleasedTransactions - p.batchTransactions);
 				}
@@ -1542,3 +1617,392 @@ ACTOR Future<Void> ratekeeper(RatekeeperInterface rkInterf, Reference<AsyncVar<S
 	}
 	return Void();
 }
+
+// Ratekeeper control loop simulator.  Runs updateRate() against modeled storage servers and tlogs, or against their
+// metrics replayed from trace files, so that the effect of ratekeeper knob changes on throughput and queue sizes can be
+// evaluated without a cluster.  It is run in simulation, where its delays take no time, by
+// tests/RatekeeperSimulator.txt, which passes the test options below as parameters; knobs are set with --knob_.
+namespace {
+
+// A storage server or tlog of the simulated cluster
+struct RkSimServer {
+	UID id;
+	double bytesPerSecond;
+	int64_t bytesInput = 0;
+	int64_t bytesDurable = 0;
+	Version durableVersion = 0;
+	// The bytesInput after each version which is not yet durable
+	Deque<std::pair<Version, int64_t>> versions;
+
+	RkSimServer(double bytesPerSecond) : id(deterministicRandom()->randomUniqueID()), bytesPerSecond(bytesPerSecond) {}
+
+	void write(Version version, int64_t bytes) {
+		bytesInput += bytes;
+		versions.push_back(std::make_pair(version, bytesInput));
+	}
+
+	// Makes up to maxBytes of the input of the versions up to durableLimit durable
+	void makeDurable(Version durableLimit, int64_t maxBytes) {
+		int64_t limit = bytesDurable + maxBytes;
+		while (!versions.empty() && versions.front().first <= durableLimit && versions.front().second <= limit) {
+			durableVersion = versions.front().first;
+			bytesDurable = versions.front().second;
+			versions.pop_front();
+		}
+		if (!versions.empty() && versions.front().first <= durableLimit) {
+			bytesDurable = limit;
+		}
+	}
+
+	StorageBytes storageBytes(int64_t diskBytes, int64_t used) const {
+		return StorageBytes(diskBytes - used, diskBytes, used, diskBytes - used);
+	}
+};
+
+// The attributes of an XML trace event
+typedef std::map<std::string, std::string> RkSimTraceEvent;
+
+// Returns the attributes of the trace event on a line of an XML trace file, or nothing for other lines
+RkSimTraceEvent parseTraceEvent(std::string const& line) {
+	RkSimTraceEvent event;
+	if (line.find("<Event ") == std::string::npos) {
+		return event;
+	}
+	size_t pos = 0;
+	while ((pos = line.find("=\"", pos)) != std::string::npos) {
+		size_t nameBegin = line.rfind(' ', pos) + 1;
+		size_t valueEnd = line.find('"', pos + 2);
+		if (valueEnd == std::string::npos) {
+			break;
+		}
+		event[line.substr(nameBegin, pos - nameBegin)] = line.substr(pos + 2, valueEnd - pos - 2);
+		pos = valueEnd + 1;
+	}
+	return event;
+}
+
+// The value of a trace event detail holding an integer or a counter, which is traced as "rate roughness total"
+int64_t traceEventTotal(RkSimTraceEvent const& event, std::string const& name) {
+	auto it = event.find(name);
+	if (it == event.end()) {
+		return 0;
+	}
+	size_t space = it->second.rfind(' ');
+	return atoll(it->second.c_str() + (space == std::string::npos ? 0 : space + 1));
+}
+
+double traceEventDouble(RkSimTraceEvent const& event, std::string const& name) {
+	auto it = event.find(name);
+	return it == event.end() ? 0 : atof(it->second.c_str());
+}
+
+class RatekeeperSimulator {
+public:
+	RatekeeperSimulator(RatekeeperData* rk, UnitTestParameters const& params) : rk(rk) {
+		Optional<std::string> traceFiles = params.get("traceFiles");
+		if (traceFiles.present()) {
+			readTraceFiles(traceFiles.get());
+			duration = params.getDouble("duration").orDefault(
+			    events.empty() ? 0 : traceEventDouble(events.back(), "Time") - traceStart);
+		} else {
+			duration = params.getDouble("duration").orDefault(300);
+		}
+		reportInterval = params.getDouble("reportInterval").orDefault(1.0);
+
+		// The offered load: "constant", "ramp" from zero, or "step" up to offeredTps for the middle third of the run
+		// from a quarter of it
+		loadCurve = params.get("loadCurve").orDefault("step");
+		ASSERT(loadCurve == "constant" || loadCurve == "ramp" || loadCurve == "step");
+		offeredTps = params.getDouble("offeredTps").orDefault(100000);
+		transactionBytes = params.getInt("transactionBytes").orDefault(1000);
+		diskBytes = params.getInt("diskBytes").orDefault(1e12);
+
+		// The cluster: storage servers make their input durable at storageBytesPerSecond, the last of them
+		// storageSkew slower, and tlogs spill at tlogBytesPerSecond
+		rk->configuration.storageTeamSize = params.getInt("teamSize").orDefault(3);
+		int storageServers = params.getInt("storageServers").orDefault(10);
+		int tlogCount = params.getInt("tlogs").orDefault(3);
+		double storageBytesPerSecond = params.getDouble("storageBytesPerSecond").orDefault(20e6);
+		double storageSkew = params.getDouble("storageSkew").orDefault(0.0);
+		double tlogBytesPerSecond = params.getDouble("tlogBytesPerSecond").orDefault(100e6);
+		for (int i = 0; i < storageServers; i++) {
+			storage.emplace_back(storageBytesPerSecond * (1 - storageSkew * i / std::max(1, storageServers - 1)));
+		}
+		for (int i = 0; i < tlogCount; i++) {
+			tlogs.emplace_back(tlogBytesPerSecond);
+		}
+		if (!replaying()) {
+			for (auto const& ss : storage) {
+				LocalityData locality;
+				locality.set(LocalityData::keyZoneId, Standalone<StringRef>(ss.id.toString()));
+				rk->storageQueueInfo.insert(mapPair(ss.id, StorageQueueInfo(ss.id, locality)));
+			}
+			for (auto const& tl : tlogs) {
+				rk->tlogQueueInfo.insert(mapPair(tl.id, TLogQueueInfo(tl.id)));
+			}
+		}
+		reasonSteps.resize(limitReason_t_end);
+
+		TraceEvent("RkSimulatorStart")
+		    .detail("TraceFiles", traceFiles.orDefault(""))
+		    .detail("TraceEvents", events.size())
+		    .detail("Duration", duration)
+		    .detail("LoadCurve", loadCurve)
+		    .detail("OfferedTPS", offeredTps)
+		    .detail("TransactionBytes", transactionBytes)
+		    .detail("StorageServers", storageServers)
+		    .detail("TLogs", tlogCount)
+		    .detail("StorageBytesPerSecond", storageBytesPerSecond)
+		    .detail("StorageSkew", storageSkew)
+		    .detail("TLogBytesPerSecond", tlogBytesPerSecond);
+	}
+
+	bool done() const { return time >= duration; }
+
+	// Advances the simulation by dt seconds, which have just passed, and recomputes the ratekeeper's limits
+	void step(double dt) {
+		time += dt;
+		double offered, released;
+		if (replaying()) {
+			replayTraceEvents();
+			offered = released = recordedReleasedTps;
+		} else {
+			offered = offeredLoad();
+			released = std::min(offered, rk->normalLimits.tpsLimit);
+			simulateCluster(dt, released);
+		}
+		rk->smoothReleasedTransactions.addDelta(released * dt);
+		rk->lastSSListFetchedTimestamp = now();
+		updateRate(rk, &rk->normalLimits);
+		updateRate(rk, &rk->batchLimits);
+
+		offeredTransactions += offered * dt;
+		releasedTransactions += released * dt;
+		maxStorageQueue = std::max(maxStorageQueue, rk->healthMetrics.worstStorageQueue);
+		maxTLogQueue = std::max(maxTLogQueue, rk->healthMetrics.worstTLogQueue);
+		maxDurabilityLag = std::max(maxDurabilityLag, rk->healthMetrics.worstStorageDurabilityLag);
+		tpsLimitChange += std::abs(std::min(rk->normalLimits.tpsLimit, 1e9) - std::min(lastTpsLimit, 1e9));
+		lastTpsLimit = rk->normalLimits.tpsLimit;
+		reasonSteps[rk->normalLimits.reasonMetric.getValue()]++;
+
+		if (time >= lastReport + reportInterval) {
+			lastReport = time;
+			TraceEvent ev("RkSimulatorStep");
+			ev.detail("Time", time)
+			    .detail("OfferedTPS", offered)
+			    .detail("ReleasedTPS", released)
+			    .detail("TPSLimit", rk->normalLimits.tpsLimit)
+			    .detail("BatchTPSLimit", rk->batchLimits.tpsLimit)
+			    .detail("Reason", limitReasonName[rk->normalLimits.reasonMetric.getValue()])
+			    .detail("WorstStorageServerQueue", rk->healthMetrics.worstStorageQueue)
+			    .detail("WorstTLogQueue", rk->healthMetrics.worstTLogQueue)
+			    .detail("WorstStorageServerDurabilityLag", rk->healthMetrics.worstStorageDurabilityLag);
+			if (replaying()) {
+				ev.detail("RecordedTPSLimit", recordedTpsLimit).detail("RecordedReason", recordedReason);
+			}
+		}
+	}
+
+	void report() const {
+		TraceEvent ev("RkSimulatorResult");
+		ev.detail("Duration", time)
+		    .detail("OfferedTPS", offeredTransactions / time)
+		    .detail("AchievedTPS", releasedTransactions / time)
+		    .detail("MaxStorageServerQueue", maxStorageQueue)
+		    .detail("MaxTLogQueue", maxTLogQueue)
+		    .detail("MaxStorageServerDurabilityLag", maxDurabilityLag)
+		    .detail("TPSLimitChangePerSecond", tpsLimitChange / time);
+		printf("Ratekeeper simulation of %.1f seconds: offered %.1f TPS, achieved %.1f TPS\n",
+		       time,
+		       offeredTransactions / time,
+		       releasedTransactions / time);
+		printf("Max storage queue %lld bytes, max tlog queue %lld bytes, max durability lag %lld versions\n",
+		       (long long)maxStorageQueue,
+		       (long long)maxTLogQueue,
+		       (long long)maxDurabilityLag);
+		for (int r = 0; r < limitReason_t_end; r++) {
+			if (reasonSteps[r]) {
+				ev.detail(format("Limited_%s", limitReasonName[r]), reasonSteps[r]);
+				printf("  %5.1f%% of the time limited by %s\n",
+				       100.0 * reasonSteps[r] / std::max(1, totalSteps()),
+				       limitReasonName[r]);
+			}
+		}
+	}
+
+private:
+	bool replaying() const { return !events.empty(); }
+
+	int totalSteps() const { return std::accumulate(reasonSteps.begin(), reasonSteps.end(), 0); }
+
+	double offeredLoad() const {
+		if (loadCurve == "ramp") {
+			return offeredTps * time / duration;
+		}
+		if (loadCurve == "step" && (time < duration / 3 || time >= 2 * duration / 3)) {
+			return offeredTps / 4;
+		}
+		return offeredTps;
+	}
+
+	// Writes the released transactions to the storage servers and tlogs, makes what they can of their input durable,
+	// and reports their queues to the ratekeeper like trackStorageServerQueueInfo and trackTLogQueueInfo
+	void simulateCluster(double dt, double releasedTps) {
+		version += dt * SERVER_KNOBS->VERSIONS_PER_SECOND;
+		int64_t bytes = releasedTps * dt * transactionBytes;
+		int teamSize = rk->configuration.storageTeamSize;
+		Version minDurableVersion = version;
+		for (auto& ss : storage) {
+			ss.write(version, bytes * teamSize / storage.size());
+			// Storage servers keep the versions which can still be read in memory
+			ss.makeDurable(version - SERVER_KNOBS->MAX_READ_TRANSACTION_LIFE_VERSIONS, ss.bytesPerSecond * dt);
+			minDurableVersion = std::min(minDurableVersion, ss.durableVersion);
+
+			StorageQueuingMetricsReply reply;
+			reply.localTime = now();
+			reply.instanceID = 0;
+			reply.bytesInput = ss.bytesInput;
+			reply.bytesDurable = ss.bytesDurable;
+			reply.storageBytes = ss.storageBytes(diskBytes, ss.bytesDurable);
+			reply.version = version;
+			reply.durableVersion = ss.durableVersion;
+			reply.cpuUsage = reply.diskUsage = reply.localRateLimit = 0;
+			reply.busiestTagFractionalBusyness = reply.busiestTagRate = 0;
+			updateStorageQueueInfo(rk, rk->storageQueueInfo.find(ss.id)->value, reply);
+		}
+		for (auto& tl : tlogs) {
+			tl.write(version, bytes * std::min<int>(teamSize, tlogs.size()) / tlogs.size());
+			// Tlogs drop the versions which are durable on all storage servers, and spill the oldest versions when
+			// their queue is larger than the spill threshold
+			tl.makeDurable(minDurableVersion, std::numeric_limits<int64_t>::max());
+			int64_t overThreshold = tl.bytesInput - tl.bytesDurable - SERVER_KNOBS->TLOG_SPILL_THRESHOLD;
+			if (overThreshold > 0) {
+				tl.makeDurable(version, std::min<int64_t>(overThreshold, tl.bytesPerSecond * dt));
+			}
+
+			TLogQueuingMetricsReply reply;
+			reply.localTime = now();
+			reply.instanceID = 0;
+			reply.bytesInput = tl.bytesInput;
+			reply.bytesDurable = tl.bytesDurable;
+			reply.storageBytes = tl.storageBytes(diskBytes, tl.bytesInput - tl.bytesDurable);
+			reply.v = version;
+			updateTLogQueueInfo(rk, rk->tlogQueueInfo.find(tl.id)->value, reply);
+		}
+	}
+
+	// Reads the StorageMetrics, TLogMetrics and RkUpdate events of the given comma separated trace files
+	void readTraceFiles(std::string const& traceFiles) {
+		StringRef files(traceFiles);
+		while (files.size()) {
+			std::string file = files.eat(","_sr).toString();
+			std::ifstream in(file);
+			if (!in.is_open()) {
+				TraceEvent(SevError, "RkSimulatorTraceFileError").detail("File", file);
+				throw file_not_found();
+			}
+			std::string line;
+			while (std::getline(in, line)) {
+				RkSimTraceEvent event = parseTraceEvent(line);
+				auto type = event.find("Type");
+				if (type != event.end() &&
+				    (type->second == "StorageMetrics" || type->second == "TLogMetrics" || type->second == "RkUpdate")) {
+					events.push_back(std::move(event));
+				}
+			}
+		}
+		std::stable_sort(events.begin(), events.end(), [](RkSimTraceEvent const& a, RkSimTraceEvent const& b) {
+			return traceEventDouble(a, "Time") < traceEventDouble(b, "Time");
+		});
+		traceStart = events.empty() ? 0 : traceEventDouble(events.front(), "Time");
+	}
+
+	// Reports the metrics recorded up to the current time to the ratekeeper.  The recorded release rate is replayed
+	// as is, so replays show the limits the ratekeeper would have computed for the recorded load.
+	void replayTraceEvents() {
+		for (; nextEvent < events.size() && traceEventDouble(events[nextEvent], "Time") <= traceStart + time;
+		     nextEvent++) {
+			RkSimTraceEvent const& event = events[nextEvent];
+			std::string const& type = event.at("Type");
+			std::string idString = event.count("ID") ? event.at("ID") : std::string();
+			UID id(strtoull(idString.c_str(), nullptr, 16), 0);
+			StorageBytes storageBytes(traceEventTotal(event, "KvstoreBytesFree"),
+			                          traceEventTotal(event, "KvstoreBytesTotal"),
+			                          traceEventTotal(event, "KvstoreBytesUsed"),
+			                          traceEventTotal(event, "KvstoreBytesAvailable"));
+			if (type == "StorageMetrics") {
+				if (rk->storageQueueInfo.find(id) == rk->storageQueueInfo.end()) {
+					LocalityData locality;
+					locality.set(LocalityData::keyZoneId, Standalone<StringRef>(idString));
+					rk->storageQueueInfo.insert(mapPair(id, StorageQueueInfo(id, locality)));
+				}
+				StorageQueuingMetricsReply reply;
+				reply.localTime = now();
+				reply.instanceID = 0;
+				reply.bytesInput = traceEventTotal(event, "BytesInput");
+				reply.bytesDurable = traceEventTotal(event, "BytesDurable");
+				reply.storageBytes = storageBytes;
+				reply.version = traceEventTotal(event, "Version");
+				reply.durableVersion = traceEventTotal(event, "DurableVersion");
+				reply.cpuUsage = reply.diskUsage = reply.localRateLimit = 0;
+				reply.busiestTagFractionalBusyness = reply.busiestTagRate = 0;
+				updateStorageQueueInfo(rk, rk->storageQueueInfo.find(id)->value, reply);
+			} else if (type == "TLogMetrics") {
+				if (rk->tlogQueueInfo.find(id) == rk->tlogQueueInfo.end()) {
+					rk->tlogQueueInfo.insert(mapPair(id, TLogQueueInfo(id)));
+				}
+				// The ratekeeper is sent the queue of the whole tlog process, shared by its generations
+				TLogQueuingMetricsReply reply;
+				reply.localTime = now();
+				reply.instanceID = 0;
+				reply.bytesInput = traceEventTotal(event, "SharedBytesInput");
+				reply.bytesDurable = traceEventTotal(event, "SharedBytesDurable");
+				reply.storageBytes = storageBytes;
+				reply.v = traceEventTotal(event, "Version");
+				updateTLogQueueInfo(rk, rk->tlogQueueInfo.find(id)->value, reply);
+			} else {
+				recordedReleasedTps = traceEventDouble(event, "ReleasedTPS");
+				recordedTpsLimit = traceEventDouble(event, "TPSLimit");
+				int64_t reason = traceEventTotal(event, "Reason");
+				recordedReason = reason < limitReason_t_end ? limitReasonName[reason] : std::string();
+			}
+		}
+	}
+
+	RatekeeperData* rk;
+	double duration, reportInterval;
+	std::string loadCurve;
+	double offeredTps;
+	int64_t transactionBytes, diskBytes;
+
+	std::vector<RkSimServer> storage, tlogs;
+	Version version = 0;
+
+	std::vector<RkSimTraceEvent> events;
+	size_t nextEvent = 0;
+	double traceStart = 0;
+	double recordedReleasedTps = 0, recordedTpsLimit = 0;
+	std::string recordedReason;
+
+	double time = 0, lastReport = 0;
+	double offeredTransactions = 0, releasedTransactions = 0;
+	int64_t maxStorageQueue = 0, maxTLogQueue = 0, maxDurabilityLag = 0;
+	double tpsLimitChange = 0, lastTpsLimit = 0;
+	std::vector<int> reasonSteps;
+};
+
+} // namespace
+
+TEST_CASE(":/fdbserver/Ratekeeper/simulator") {
+	state RatekeeperData rk(deterministicRandom()->randomUniqueID(), Database());
+	state RatekeeperSimulator simulator(&rk, params);
+
+	// There is no database whose expired throttles should be cleaned up
+	rk.expiredTagThrottleCleanup = Future<Void>();
+	while (!simulator.done()) {
+		wait(delay(SERVER_KNOBS->METRIC_UPDATE_RATE));
+		simulator.step(SERVER_KNOBS->METRIC_UPDATE_RATE);
+	}
+	simulator.report();
+	return Void();
+}
@@ -84,6 +84,61 @@ struct GetRateInfoReply {
 	}
 };
 
+// The GetReadVersion requests queued on a GRV proxy with one transaction tag, since the proxy last reported to
+// Ratekeeper
+struct GrvTagQueueStats {
+	// Bucket b of the wait histogram counts the transactions that waited less than 2^b ms, and more than the previous
+	// bucket. The last bucket counts all longer waits.
+	constexpr static int WAIT_BUCKETS = 12;
+
+	int64_t maxQueuedTransactions = 0;
+	int64_t startedTransactions = 0;
+	std::vector<int64_t> waitHistogram;
+
+	void addWait(double seconds, int64_t transactions) {
+		if (waitHistogram.empty()) {
+			waitHistogram.resize(WAIT_BUCKETS);
+		}
+		int bucket = 0;
+		for (double limit = 0.001; bucket < WAIT_BUCKETS - 1 && seconds >= limit; limit *= 2) {
+			bucket++;
+		}
+		waitHistogram[bucket] += transactions;
+		startedTransactions += transactions;
+	}
+
+	// Adds a later report of the same proxy, whose peak queue length is combined with this one's by taking the maximum
+	void addLaterReport(const GrvTagQueueStats& other) {
+		maxQueuedTransactions = std::max(maxQueuedTransactions, other.maxQueuedTransactions);
+		addStarted(other);
+	}
+
+	// Adds the report of another proxy over the same time, whose queue adds to this one's
+	GrvTagQueueStats& operator+=(const GrvTagQueueStats& other) {
+		maxQueuedTransactions += other.maxQueuedTransactions;
+		addStarted(other);
+		return *this;
+	}
+
+private:
+	void addStarted(const GrvTagQueueStats& other) {
+		startedTransactions += other.startedTransactions;
+		if (waitHistogram.size() < other.waitHistogram.size()) {
+			waitHistogram.resize(other.waitHistogram.size());
+		}
+		for (int b = 0; b < other.waitHistogram.size(); b++) {
+			waitHistogram[b] += other.waitHistogram[b];
+		}
+	}
+
+public:
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, maxQueuedTransactions, startedTransactions, waitHistogram);
+	}
+};
+
 struct GetRateInfoRequest {
 	constexpr static FileIdentifier file_identifier = 9068521;
 	UID requesterID;
@@ -93,6 +148,7 @@ struct GetRateInfoRequest {
 	TransactionTagMap<uint64_t> throttledTagCounts;
 	bool detailed;
 	ReplyPromise<struct GetRateInfoReply> reply;
+	TransactionTagMap<GrvTagQueueStats> tagQueueStats;
 
 	GetRateInfoRequest() {}
 	GetRateInfoRequest(UID const& requesterID,
@@ -106,8 +162,14 @@ struct GetRateInfoRequest {
 
 	template <class Ar>
 	void serialize(Ar& ar) {
-		serializer(
-		    ar, requesterID, totalReleasedTransactions, batchReleasedTransactions, throttledTagCounts, detailed, reply);
+		serializer(ar,
+		           requesterID,
+		           totalReleasedTransactions,
+		           batchReleasedTransactions,
+		           throttledTagCounts,
+		           detailed,
+		           reply,
+		           tagQueueStats);
 	}
 };
 
@@ -1361,10 +1361,12 @@ void SimulationConfig::setReplicationType(const TestConfig& testConfig) {
 			ASSERT(false); // Programmer forgot to adjust cases.
 		}
 		if (deterministicRandom()->random01() < 0.5) {
-			int logSpill = deterministicRandom()->randomInt(TLogSpillType::VALUE, TLogSpillType::END);
-			set_config(format("log_spill:=%d", logSpill));
 			int logVersion =
 			    deterministicRandom()->randomInt(TLogVersion::MIN_RECRUITABLE, testConfig.maxTLogVersion + 1);
+			// Spilling to segments is not understood by TLogs older than V7
+			int logSpill = deterministicRandom()->randomInt(
+			    TLogSpillType::VALUE, logVersion >= TLogVersion::V7 ? TLogSpillType::END : TLogSpillType::SEGMENT);
+			set_config(format("log_spill:=%d", logSpill));
 			set_config(format("log_version:=%d", logVersion));
 		} else {
 			if (deterministicRandom()->random01() < 0.7)
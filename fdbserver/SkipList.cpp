@@ -46,9 +46,8 @@ static inline int skfastrand() {
 	return g_seed;
 }
 
-PerfDoubleCounter g_buildTest("Build", skc), g_add("Add", skc), g_detectConflicts("Detect", skc), g_sort("D.Sort", skc),
-    g_combine("D.Combine", skc), g_checkRead("D.CheckRead", skc), g_checkBatch("D.CheckIntraBatch", skc),
-    g_merge("D.MergeWrite", skc), g_removeBefore("D.RemoveBefore", skc);
+PerfDoubleCounter g_sort("D.Sort", skc), g_combine("D.Combine", skc), g_checkRead("D.CheckRead", skc),
+    g_checkBatch("D.CheckIntraBatch", skc), g_merge("D.MergeWrite", skc), g_removeBefore("D.RemoveBefore", skc);
 
 static force_inline int compare(const StringRef& a, const StringRef& b) {
 	int c = memcmp(a.begin(), b.begin(), min(a.size(), b.size()));
@@ -237,12 +236,131 @@ private:
 		return level;
 	}
 
+	// Returns the first 8 bytes of a key as a big endian integer, padded with zeros. Keys whose prefixes differ are
+	// ordered like their prefixes, so most comparisons are decided by a single integer comparison.
+	static force_inline uint64_t keyPrefix(const uint8_t* key, int length) {
+		uint64_t prefix = 0;
+		memcpy(&prefix, key, min(length, (int)sizeof(prefix)));
+		return bigEndian64(prefix);
+	}
+
+	// Nodes are allocated sequentially from BlockSize aligned blocks owned by the SkipList, so the nodes inserted by
+	// one addConflictRanges() call (i.e. at one version) are adjacent in memory. Each block counts its live nodes and
+	// is freed as a whole when the last of them is destroyed. Nodes larger than MaxBlockNodeSize are allocated
+	// separately.
+	// A single surviving node keeps its whole block alive, so the allocator tracks how many block bytes are held by
+	// live nodes and the SkipList compacts itself into fresh blocks when most block memory is wasted.
+	struct NodeBlock {
+		static constexpr int BlockSize = 16 << 10;
+		static constexpr int MaxBlockNodeSize = BlockSize / 8;
+		static constexpr int HeaderSize = 64;
+
+		int liveNodes;
+
+		static NodeBlock* containing(void* node) {
+			return (NodeBlock*)(uintptr_t(node) & ~uintptr_t(BlockSize - 1));
+		}
+
+		// Returns true if the block was freed
+		static bool release(NodeBlock* block) {
+			if (--block->liveNodes == 0) {
+				aligned_free(block);
+				INSTRUMENT_RELEASE("SkipListNodeBlock");
+				return true;
+			}
+			return false;
+		}
+	};
+
+	class NodeAllocator : NonCopyable {
+	public:
+		NodeAllocator() = default;
+		~NodeAllocator() {
+			if (current) {
+				releaseBlock(current);
+			}
+		}
+
+		static int roundedSize(int nodeSize) { return (nodeSize + 7) & ~7; }
+
+		void* allocate(int nodeSize) {
+			nodeSize = roundedSize(nodeSize);
+			if (nodeSize > NodeBlock::MaxBlockNodeSize) {
+				INSTRUMENT_ALLOCATE("SkipListNodeLarge");
+				largeBytes += nodeSize;
+				return new char[nodeSize];
+			}
+			if (!current || used + nodeSize > NodeBlock::BlockSize) {
+				if (current) {
+					releaseBlock(current);
+				}
+				// The allocator holds a reference to the current block so it is not freed while it is being filled
+				current = (NodeBlock*)aligned_alloc(NodeBlock::BlockSize, NodeBlock::BlockSize);
+				INSTRUMENT_ALLOCATE("SkipListNodeBlock");
+				current->liveNodes = 1;
+				used = NodeBlock::HeaderSize;
+				blockBytes += NodeBlock::BlockSize;
+			}
+			void* node = (uint8_t*)current + used;
+			used += nodeSize;
+			liveBlockBytes += nodeSize;
+			++current->liveNodes;
+			return node;
+		}
+
+		void release(void* node, int nodeSize) {
+			nodeSize = roundedSize(nodeSize);
+			if (nodeSize > NodeBlock::MaxBlockNodeSize) {
+				delete[](char*) node;
+				INSTRUMENT_RELEASE("SkipListNodeLarge");
+				largeBytes -= nodeSize;
+			} else {
+				liveBlockBytes -= nodeSize;
+				releaseBlock(NodeBlock::containing(node));
+			}
+		}
+
+		// Returns the number of bytes allocated from the system for nodes
+		int64_t memoryUsage() const { return blockBytes + largeBytes; }
+
+		// Returns true if much more block memory is pinned than is used by live nodes, which happens when a few
+		// long lived nodes are scattered across blocks whose other nodes have been removed.
+		bool fragmented() const {
+			return blockBytes > 2 * liveBlockBytes + MinCompactionBlocks * NodeBlock::BlockSize;
+		}
+
+		void swap(NodeAllocator& other) {
+			std::swap(current, other.current);
+			std::swap(used, other.used);
+			std::swap(blockBytes, other.blockBytes);
+			std::swap(liveBlockBytes, other.liveBlockBytes);
+			std::swap(largeBytes, other.largeBytes);
+		}
+
+	private:
+		static constexpr int MinCompactionBlocks = 16;
+
+		NodeBlock* current = nullptr;
+		int used = 0;
+		int64_t blockBytes = 0; // Bytes of blocks which have not been freed
+		int64_t liveBlockBytes = 0; // Bytes of live nodes within those blocks
+		int64_t largeBytes = 0; // Bytes of live nodes allocated outside of blocks
+
+		void releaseBlock(NodeBlock* block) {
+			if (NodeBlock::release(block)) {
+				blockBytes -= NodeBlock::BlockSize;
+			}
+		}
+	};
+
 	// Represent a node in the SkipList. The node has multiple (i.e., level) pointers to
 	// other nodes, and keeps a record of the max versions for each level.
 	struct Node {
 		int level() const { return nPointers - 1; }
 		uint8_t* value() { return end() + nPointers * (sizeof(Node*) + sizeof(Version)); }
+		uint8_t const* value() const { return end() + nPointers * (sizeof(Node*) + sizeof(Version)); }
 		int length() const { return valueLength; }
+		uint64_t prefix() const { return valuePrefix; }
 
 		// Returns the next node pointer at the given level.
 		Node* getNext(int level) { return *((Node**)end() + level); }
@@ -256,24 +374,14 @@ private:
 
 		// Return a node with initialized value but uninitialized pointers
 		// Memory layout: *this, (level+1) Node*, (level+1) Version, value
-		static Node* create(const StringRef& value, int level) {
+		static Node* create(NodeAllocator& allocator, const StringRef& value, uint64_t prefix, int level) {
 			int nodeSize = sizeof(Node) + value.size() + (level + 1) * (sizeof(Node*) + sizeof(Version));
-
-			Node* n;
-			if (nodeSize <= 64) {
-				n = (Node*)FastAllocator<64>::allocate();
-				INSTRUMENT_ALLOCATE("SkipListNode64");
-			} else if (nodeSize <= 128) {
-				n = (Node*)FastAllocator<128>::allocate();
-				INSTRUMENT_ALLOCATE("SkipListNode128");
-			} else {
-				n = (Node*)new char[nodeSize];
-				INSTRUMENT_ALLOCATE("SkipListNodeLarge");
-			}
+			Node* n = (Node*)allocator.allocate(nodeSize);
 
 			n->nPointers = level + 1;
 
 			n->valueLength = value.size();
+			n->valuePrefix = prefix;
 			if (value.size() > 0) {
 				memcpy(n->value(), value.begin(), value.size());
 			}
@@ -289,26 +397,23 @@ private:
 			setMaxVersion(level, v);
 		}
 
-		void destroy() {
+		// Returns a copy of this node allocated from allocator, with the same pointers and max versions
+		Node* copy(NodeAllocator& allocator) const {
 			int nodeSize = getNodeSize();
-			if (nodeSize <= 64) {
-				FastAllocator<64>::release(this);
-				INSTRUMENT_RELEASE("SkipListNode64");
-			} else if (nodeSize <= 128) {
-				FastAllocator<128>::release(this);
-				INSTRUMENT_RELEASE("SkipListNode128");
-			} else {
-				delete[](char*) this;
-				INSTRUMENT_RELEASE("SkipListNodeLarge");
-			}
+			Node* n = (Node*)allocator.allocate(nodeSize);
+			memcpy((void*)n, (const void*)this, nodeSize);
+			return n;
 		}
 
+		void destroy(NodeAllocator& allocator) { allocator.release(this, getNodeSize()); }
+
 	private:
 		int getNodeSize() const { return sizeof(Node) + valueLength + nPointers * (sizeof(Node*) + sizeof(Version)); }
 		// Returns the first Node* pointer
 		uint8_t* end() { return (uint8_t*)(this + 1); }
 		uint8_t const* end() const { return (uint8_t const*)(this + 1); }
 		int nPointers, valueLength;
+		uint64_t valuePrefix; // keyPrefix(value(), length())
 	};
 
 	static force_inline bool less(const uint8_t* a, int aLen, const uint8_t* b, int bLen) {
@@ -320,13 +425,26 @@ private:
 		return aLen < bLen;
 	}
 
+	// Returns true if the node's value is less than value, whose keyPrefix() is valuePrefix
+	static force_inline bool less(const Node* n, const StringRef& value, uint64_t valuePrefix) {
+		if (n->prefix() != valuePrefix)
+			return n->prefix() < valuePrefix;
+		return less(n->value(), n->length(), value.begin(), value.size());
+	}
+
+	static force_inline bool equals(const Node* n, const StringRef& value, uint64_t valuePrefix) {
+		return n->prefix() == valuePrefix && n->length() == value.size() &&
+		       !memcmp(n->value(), value.begin(), value.size());
+	}
+
+	NodeAllocator allocator;
 	Node* header;
 
 	void destroy() {
 		Node *next, *x;
 		for (x = header; x; x = next) {
 			next = x->getNext(0);
-			x->destroy();
+			x->destroy(allocator);
 		}
 	}
 
@@ -341,12 +459,15 @@ public:
 		Node* x = nullptr;
 		Node* alreadyChecked = nullptr;
 		StringRef value;
+		uint64_t prefix = 0; // keyPrefix(value)
 
 		Finger() = default;
-		Finger(Node* header, const StringRef& ptr) : value(ptr), x(header) {}
+		Finger(Node* header, const StringRef& ptr)
+		  : x(header), value(ptr), prefix(keyPrefix(ptr.begin(), ptr.size())) {}
 
 		void init(const StringRef& value, Node* header) {
 			this->value = value;
+			prefix = keyPrefix(value.begin(), value.size());
 			x = header;
 			alreadyChecked = nullptr;
 			level = MaxLevels;
@@ -368,7 +489,7 @@ public:
 		force_inline bool advance() {
 			Node* next = x->getNext(level - 1);
 
-			if (next == alreadyChecked || !less(next->value(), next->length(), value.begin(), value.size())) {
+			if (next == alreadyChecked || !less(next, value, prefix)) {
 				alreadyChecked = next;
 				level--;
 				finger[level] = x;
@@ -391,7 +512,7 @@ public:
 		force_inline Node* found() const {
 			// valid after finished returns true
 			Node* n = finger[0]->getNext(0); // or alreadyChecked, but that is more easily invalidated
-			if (n && n->length() == value.size() && !memcmp(n->value(), value.begin(), value.size()))
+			if (n && equals(n, value, prefix))
 				return n;
 			else
 				return nullptr;
@@ -414,21 +535,58 @@ public:
 		return count;
 	}
 
+	// Returns the number of bytes allocated for the nodes of the list
+	int64_t memoryUsage() const { return allocator.memoryUsage(); }
+
+	// Copies the nodes into fresh blocks if removals have left the existing blocks mostly empty. Invalidates any
+	// Finger into the list.
+	void compactIfFragmented() {
+		if (!allocator.fragmented()) {
+			return;
+		}
+		NodeAllocator compacted;
+		Node* last[MaxLevels];
+		Node* newHeader = header->copy(compacted);
+		for (int l = 0; l < MaxLevels; l++) {
+			last[l] = newHeader;
+		}
+		for (Node* x = header->getNext(0); x; x = x->getNext(0)) {
+			Node* n = x->copy(compacted);
+			for (int l = 0; l <= n->level(); l++) {
+				last[l]->setNext(l, n);
+				last[l] = n;
+			}
+		}
+		for (int l = 0; l < MaxLevels; l++) {
+			last[l]->setNext(l, nullptr);
+		}
+		destroy();
+		header = newHeader;
+		allocator.swap(compacted);
+	}
+
 	explicit SkipList(Version version = 0) {
-		header = Node::create(StringRef(), MaxLevels - 1);
+		header = Node::create(allocator, StringRef(), 0, MaxLevels - 1);
 		for (int l = 0; l < MaxLevels; l++) {
 			header->setNext(l, nullptr);
 			header->setMaxVersion(l, version);
 		}
 	}
 	~SkipList() { destroy(); }
-	SkipList(SkipList&& other) noexcept : header(other.header) { other.header = nullptr; }
+	SkipList(SkipList&& other) noexcept : header(other.header) {
+		allocator.swap(other.allocator);
+		other.header = nullptr;
+	}
 	void operator=(SkipList&& other) noexcept {
 		destroy();
 		header = other.header;
 		other.header = nullptr;
+		allocator.swap(other.allocator);
+	}
+	void swap(SkipList& other) {
+		std::swap(header, other.header);
+		allocator.swap(other.allocator);
 	}
-	void swap(SkipList& other) { std::swap(header, other.header); }
 
 	void addConflictRanges(const Finger* fingers, int rangeCount, Version version) {
 		for (int r = rangeCount - 1; r >= 0; r--) {
@@ -529,10 +687,11 @@ public:
 		// vtune: 11 parts
 		results[0].init(values[0], header);
 		const StringRef& endValue = values[count - 1];
+		const uint64_t endPrefix = keyPrefix(endValue.begin(), endValue.size());
 		while (results[0].level > 1) {
 			results[0].nextLevel();
 			Node* ac = results[0].alreadyChecked;
-			if (ac && less(ac->value(), ac->length(), endValue.begin(), endValue.size()))
+			if (ac && less(ac, endValue, endPrefix))
 				break;
 		}
 
@@ -548,6 +707,7 @@ public:
 			results[i].x = x;
 			results[i].alreadyChecked = nullptr;
 			results[i].value = values[i];
+			results[i].prefix = keyPrefix(values[i].begin(), values[i].size());
 			for (int j = startLevel; j < MaxLevels; j++)
 				results[i].finger[j] = results[0].finger[j];
 		}
@@ -602,7 +762,7 @@ public:
 					f.finger[l]->setNext(l, x->getNext(l));
 				for (int i = 1; i <= x->level(); i++)
 					f.finger[i]->setMaxVersion(i, max(f.finger[i]->getMaxVersion(i), x->getMaxVersion(i)));
-				x->destroy();
+				x->destroy(allocator);
 			}
 			wasAbove = isAbove;
 		}
@@ -624,7 +784,7 @@ private:
 
 		while (true) {
 			Node* next = x->getNext(0);
-			x->destroy();
+			x->destroy(allocator);
 			if (x == end.finger[0])
 				break;
 			x = next;
@@ -634,7 +794,7 @@ private:
 	void insert(const Finger& f, Version version) {
 		int level = randomLevel();
 		// cout << std::string((const char*)value,length) << " level: " << level << endl;
-		Node* x = Node::create(f.value, level);
+		Node* x = Node::create(allocator, f.value, f.prefix, level);
 		x->setMaxVersion(0, version);
 		for (int i = 0; i <= level; i++) {
 			x->setNext(i, f.finger[i]->getNext(i));
@@ -747,8 +907,7 @@ private:
 						return noConflict();
 					s = nextS;
 					if (start.finished()) {
-						if (nextS->length() == start.value.size() &&
-						    !memcmp(nextS->value(), start.value.begin(), start.value.size()))
+						if (equals(nextS, start.value, start.prefix))
 							return noConflict();
 						else
 							return conflict();
@@ -800,6 +959,9 @@ ConflictSet* newConflictSet() {
 void clearConflictSet(ConflictSet* cs, Version v) {
 	SkipList(v).swap(cs->versionHistory);
 }
+int64_t getConflictSetMemoryUsage(ConflictSet* cs) {
+	return cs->versionHistory.memoryUsage();
+}
 void destroyConflictSet(ConflictSet* cs) {
 	delete cs;
 }
@@ -954,6 +1116,7 @@ void ConflictBatch::detectConflicts(Version now,
 		cs->versionHistory.find(&cs->removalKey, &finger, &temp, 1);
 		cs->versionHistory.removeBefore(cs->oldestVersion, finger, combinedWriteConflictRanges.size() * 3 + 10);
 		cs->removalKey = finger.getValue();
+		cs->versionHistory.compactIfFragmented();
 	}
 	g_removeBefore += timer() - t;
 }
@@ -1014,21 +1177,6 @@ void ConflictBatch::combineWriteConflictRanges() {
 }
 
 namespace {
-StringRef setK(Arena& arena, int i) {
-	char t[sizeof(i)];
-	*(int*)t = i;
-
-	const int keySize = 16;
-
-	char* ss = new (arena) char[keySize];
-	for (int c = 0; c < keySize - sizeof(i); c++)
-		ss[c] = '.';
-	for (int c = 0; c < sizeof(i); c++)
-		ss[c + keySize - sizeof(i)] = t[sizeof(i) - 1 - c];
-
-	return StringRef((const uint8_t*)ss, keySize);
-}
-
 void miniConflictSetTest() {
 	for (int i = 0; i < 2000000; i++) {
 		int size = 64 * 5; // Also run 64*64*5 to test multiple words of andValues and orValues
@@ -1082,99 +1230,11 @@ void operatorLessThanTest() {
 }
 } // namespace
 
+// The conflict set's performance is measured by flowbench's bench_conflict_set
 void skipListTest() {
 	printf("Skip list test\n");
 
 	miniConflictSetTest();
 
 	operatorLessThanTest();
-
-	setAffinity(0);
-
-	double start;
-
-	ConflictSet* cs = newConflictSet();
-
-	Arena testDataArena;
-	VectorRef<VectorRef<KeyRangeRef>> testData;
-	const int batches = 500; // deterministicRandom()->randomInt(500, 5000);
-	const int data_per_batch = 5000;
-	testData.resize(testDataArena, batches);
-	std::vector<std::vector<uint8_t>> success(batches);
-	std::vector<std::vector<uint8_t>> success2(batches);
-	for (int i = 0; i < batches; i++) {
-		testData[i].resize(testDataArena, data_per_batch);
-		success[i].assign(data_per_batch, false);
-		success2[i].assign(data_per_batch, false);
-		for (int j = 0; j < data_per_batch; j++) {
-			int key = deterministicRandom()->randomInt(0, 20000000);
-			int key2 = key + 1 + deterministicRandom()->randomInt(0, 10);
-			testData[i][j] = KeyRangeRef(setK(testDataArena, key), setK(testDataArena, key2));
-		}
-	}
-	printf("Test data generated: %d batches, %d/batch\n", batches, data_per_batch);
-
-	printf("Running\n");
-
-	int readCount = 1, writeCount = 1;
-	int cranges = 0, tcount = 0;
-
-	start = timer();
-	std::vector<std::vector<int>> nonConflict(batches);
-	Version version = 0;
-	for (const auto& data : testData) {
-		Arena buf;
-		std::vector<CommitTransactionRef> trs;
-		double t = timer();
-		for (int j = 0; j + readCount + writeCount <= data.size(); j += readCount + writeCount) {
-			CommitTransactionRef tr;
-			for (int k = 0; k < readCount; k++) {
-				KeyRangeRef r(buf, data[j + k]);
-				tr.read_conflict_ranges.push_back(buf, r);
-			}
-			for (int k = 0; k < writeCount; k++) {
-				KeyRangeRef r(buf, data[j + readCount + k]);
-				tr.write_conflict_ranges.push_back(buf, r);
-			}
-			cranges += tr.read_conflict_ranges.size() + tr.write_conflict_ranges.size();
-			tr.read_snapshot = version;
-			trs.push_back(tr);
-		}
-		tcount += trs.size();
-		g_buildTest += timer() - t;
-
-		t = timer();
-		ConflictBatch batch(cs);
-		for (const auto& tr : trs) {
-			batch.addTransaction(tr);
-		}
-		g_add += timer() - t;
-
-		t = timer();
-		batch.detectConflicts(version + 50, version, nonConflict[version]);
-		g_detectConflicts += timer() - t;
-
-		version++;
-	}
-	double elapsed = timer() - start;
-	printf("New conflict set: %0.3f sec\n", elapsed);
-	printf("                  %0.3f Mtransactions/sec\n", tcount / elapsed / 1e6);
-	printf("                  %0.3f Mkeys/sec\n", cranges * 2 / elapsed / 1e6);
-
-	elapsed = g_detectConflicts.getValue();
-	printf("Detect only:      %0.3f sec\n", elapsed);
-	printf("                  %0.3f Mtransactions/sec\n", tcount / elapsed / 1e6);
-	printf("                  %0.3f Mkeys/sec\n", cranges * 2 / elapsed / 1e6);
-
-	elapsed = g_checkRead.getValue() + g_merge.getValue();
-	printf("Skiplist only:    %0.3f sec\n", elapsed);
-	printf("                  %0.3f Mtransactions/sec\n", tcount / elapsed / 1e6);
-	printf("                  %0.3f Mkeys/sec\n", cranges * 2 / elapsed / 1e6);
-
-	printf("Performance counters:\n");
-	for (const auto& counter : skc) {
-		printf("%20s: %s\n", counter->getMetric().name().c_str(), counter->getMetric().formatted().c_str());
-	}
-
-	printf("%d entries in version history\n", cs->versionHistory.count());
 }
@@ -494,6 +494,20 @@ struct RolesInfo {
 				if (e.code() != error_code_attribute_not_found)
 					throw e;
 			}
+			try { // Storage servers older than this field don't report it
+				obj.setKeyRawNumber("kvstore_pending_compaction_bytes",
+				                    storageMetrics.getValue("KvstorePendingCompactionBytes"));
+			} catch (Error& e) {
+				if (e.code() != error_code_attribute_not_found)
+					throw e;
+			}
+			// Only storage engines with a block cache and background compaction report these
+			std::string blockCacheHitRate;
+			if (storageMetrics.tryGetValue("KvstoreBlockCacheHitRate", blockCacheHitRate)) {
+				obj.setKeyRawNumber("kvstore_block_cache_hit_rate", blockCacheHitRate);
+				obj.setKeyRawNumber("kvstore_stall_micros", storageMetrics.getValue("KvstoreStallMicros"));
+				obj.setKeyRawNumber("kvstore_l0_files", storageMetrics.getValue("KvstoreL0Files"));
+			}
 			obj["bytes_queried"] = StatusCounter(storageMetrics.getValue("BytesQueried")).getStatus();
 			obj["keys_queried"] = StatusCounter(storageMetrics.getValue("RowsQueried")).getStatus();
 			obj["mutation_bytes"] = StatusCounter(storageMetrics.getValue("MutationBytes")).getStatus();
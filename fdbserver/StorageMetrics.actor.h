@@ -388,7 +388,8 @@ struct StorageServerMetrics {
 				if (remaining.bytes < 2 * SERVER_KNOBS->MIN_SHARD_BYTES)
 					break;
 				KeyRef key = req.keys.end;
-				bool hasUsed = used.bytes != 0 || used.bytesPerKSecond != 0 || used.iosPerKSecond != 0;
+				bool hasUsed = used.bytes != 0 || used.bytesPerKSecond != 0 || used.iosPerKSecond != 0 ||
+				               used.bytesReadPerKSecond != 0;
 				key = getSplitKey(remaining.bytes,
 				                  estimated.bytes,
 				                  req.limits.bytes,
@@ -426,6 +427,17 @@ struct StorageServerMetrics {
 				                  lastKey,
 				                  key,
 				                  hasUsed);
+				key = getSplitKey(remaining.bytesReadPerKSecond,
+				                  estimated.bytesReadPerKSecond,
+				                  req.limits.bytesReadPerKSecond,
+				                  used.bytesReadPerKSecond,
+				                  req.limits.infinity,
+				                  req.isLastShard,
+				                  bytesReadSample,
+				                  SERVER_KNOBS->STORAGE_METRICS_AVERAGE_INTERVAL_PER_KSECONDS,
+				                  lastKey,
+				                  key,
+				                  hasUsed);
 				ASSERT(key != lastKey || hasUsed);
 				if (key == req.keys.end)
 					break;
@@ -450,7 +462,9 @@ struct StorageServerMetrics {
 	                       StorageBytes sb,
 	                       double bytesInputRate,
 	                       int64_t versionLag,
-	                       double lastUpdate) const {
+	                       double lastUpdate,
+	                       double cpuUsage,
+	                       double queryRate) const {
 		GetStorageMetricsReply rep;
 
 		// SOMEDAY: make bytes dynamic with hard disk space
@@ -479,6 +493,8 @@ struct StorageServerMetrics {
 
 		rep.versionLag = versionLag;
 		rep.lastUpdate = lastUpdate;
+		rep.cpuUsage = cpuUsage;
+		rep.queryRate = queryRate;
 
 		req.reply.send(rep);
 	}
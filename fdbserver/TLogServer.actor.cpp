@@ -228,6 +228,7 @@ static const KeyRangeRef persistLogRouterTagsKeys =
 static const KeyRangeRef persistTxsTagsKeys = KeyRangeRef(LiteralStringRef("TxsTags/"), LiteralStringRef("TxsTags0"));
 static const KeyRange persistTagMessagesKeys = prefixRange(LiteralStringRef("TagMsg/"));
 static const KeyRange persistTagMessageRefsKeys = prefixRange(LiteralStringRef("TagMsgRef/"));
+static const KeyRange persistTagMessageSegmentsKeys = prefixRange(LiteralStringRef("TagMsgSeg/"));
 static const KeyRange persistTagPoppedKeys = prefixRange(LiteralStringRef("TagPop/"));
 
 static Key persistTagMessagesKey(UID id, Tag tag, Version version) {
@@ -248,6 +249,16 @@ static Key persistTagMessageRefsKey(UID id, Tag tag, Version version) {
 	return wr.toValue();
 }
 
+// Segments are keyed by the last version they contain
+static Key persistTagMessageSegmentsKey(UID id, Tag tag, Version version) {
+	BinaryWriter wr(Unversioned());
+	wr.serializeBytes(persistTagMessageSegmentsKeys.begin);
+	wr << id;
+	wr << tag;
+	wr << bigEndian64(version);
+	return wr.toValue();
+}
+
 static Key persistTagPoppedKey(UID id, Tag tag) {
 	BinaryWriter wr(Unversioned());
 	wr.serializeBytes(persistTagPoppedKeys.begin);
@@ -279,6 +290,11 @@ static Version decodeTagMessagesKey(StringRef key) {
 	return bigEndian64(BinaryReader::fromStringRef<Version>(stripTagMessagesKey(key), Unversioned()));
 }
 
+static Version decodeTagMessageSegmentsKey(StringRef key) {
+	return bigEndian64(BinaryReader::fromStringRef<Version>(
+	    key.substr(sizeof(UID) + sizeof(Tag) + persistTagMessageSegmentsKeys.begin.size()), Unversioned()));
+}
+
 struct SpilledData {
 	SpilledData() = default;
 	SpilledData(Version version, IDiskQueue::location start, uint32_t length, uint32_t mutationBytes)
@@ -401,6 +417,12 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 		Version versionForPoppedLocation; // `poppedLocation` was calculated at this popped version
 		IDiskQueue::location poppedLocation; // The location of the earliest commit with data for this tag.
 		bool unpoppedRecovered;
+		// For tags spilled to segments: the last version of the most recent segment if it is still below
+		// TLOG_SPILL_SEGMENT_BYTES, so the next updatePersistentData appends to it, or invalidVersion.
+		Version openSegmentVersion;
+		// The last version of a segment whose contents were rewritten into a later segment, to be cleared once that
+		// later segment is durable.
+		Version supersededSegmentVersion;
 		Tag tag;
 
 		TagData(Tag tag,
@@ -411,13 +433,15 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 		        bool unpoppedRecovered)
 		  : tag(tag), nothingPersistent(nothingPersistent), poppedRecently(poppedRecently), popped(popped),
 		    persistentPopped(0), versionForPoppedLocation(0), poppedLocation(poppedLocation),
-		    unpoppedRecovered(unpoppedRecovered) {}
+		    unpoppedRecovered(unpoppedRecovered), openSegmentVersion(invalidVersion),
+		    supersededSegmentVersion(invalidVersion) {}
 
 		TagData(TagData&& r) noexcept
 		  : versionMessages(std::move(r.versionMessages)), nothingPersistent(r.nothingPersistent),
 		    poppedRecently(r.poppedRecently), popped(r.popped), persistentPopped(r.persistentPopped),
-		    versionForPoppedLocation(r.versionForPoppedLocation), poppedLocation(r.poppedLocation), tag(r.tag),
-		    unpoppedRecovered(r.unpoppedRecovered) {}
+		    versionForPoppedLocation(r.versionForPoppedLocation), poppedLocation(r.poppedLocation),
+		    unpoppedRecovered(r.unpoppedRecovered), openSegmentVersion(r.openSegmentVersion),
+		    supersededSegmentVersion(r.supersededSegmentVersion), tag(r.tag) {}
 		void operator=(TagData&& r) noexcept {
 			versionMessages = std::move(r.versionMessages);
 			nothingPersistent = r.nothingPersistent;
@@ -428,6 +452,8 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 			poppedLocation = r.poppedLocation;
 			tag = r.tag;
 			unpoppedRecovered = r.unpoppedRecovered;
+			openSegmentVersion = r.openSegmentVersion;
+			supersededSegmentVersion = r.supersededSegmentVersion;
 		}
 
 		// Erase messages not needed to update *from* versions >= before (thus, messages with toversion <= before)
@@ -548,6 +574,8 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 	CounterCollection cc;
 	Counter bytesInput;
 	Counter bytesDurable;
+	Counter spilledPeekReads; // Reads from persistentData and the disk queue to serve peeks of spilled data
+	Counter spilledPeekBytes; // Bytes read to serve peeks of spilled data
 
 	UID logId;
 	ProtocolVersion protocolVersion;
@@ -627,7 +655,8 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 	                 std::vector<Tag> tags,
 	                 std::string context)
 	  : tLogData(tLogData), knownCommittedVersion(0), logId(interf.id()), cc("TLog", interf.id().toString()),
-	    bytesInput("BytesInput", cc), bytesDurable("BytesDurable", cc), remoteTag(remoteTag), isPrimary(isPrimary),
+	    bytesInput("BytesInput", cc), bytesDurable("BytesDurable", cc), spilledPeekReads("SpilledPeekReads", cc),
+	    spilledPeekBytes("SpilledPeekBytes", cc), remoteTag(remoteTag), isPrimary(isPrimary),
 	    logRouterTags(logRouterTags), txsTags(txsTags), recruitmentID(recruitmentID), protocolVersion(protocolVersion),
 	    logSpillType(logSpillType), logSystem(new AsyncVar<Reference<ILogSystem>>()), logRouterPoppedVersion(0),
 	    durableKnownCommittedVersion(0), minKnownCommittedVersion(0), queuePoppedVersion(0),
@@ -698,6 +727,8 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 			tLogData->persistentData->clear(KeyRangeRef(msgKey, strinc(msgKey)));
 			Key msgRefKey = logIdKey.withPrefix(persistTagMessageRefsKeys.begin);
 			tLogData->persistentData->clear(KeyRangeRef(msgRefKey, strinc(msgRefKey)));
+			Key msgSegmentKey = logIdKey.withPrefix(persistTagMessageSegmentsKeys.begin);
+			tLogData->persistentData->clear(KeyRangeRef(msgSegmentKey, strinc(msgSegmentKey)));
 			Key poppedKey = logIdKey.withPrefix(persistTagPoppedKeys.begin);
 			tLogData->persistentData->clear(KeyRangeRef(poppedKey, strinc(poppedKey)));
 		}
@@ -718,6 +749,7 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 		case TLogSpillType::VALUE:
 			return true;
 		case TLogSpillType::REFERENCE:
+		case TLogSpillType::SEGMENT:
 			return t.locality == tagLocalityTxs || t == txsTag;
 		default:
 			ASSERT(false);
@@ -725,7 +757,14 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 		}
 	}
 
-	bool shouldSpillByReference(Tag t) const { return !shouldSpillByValue(t); }
+	// Messages of tags spilled to segments are copied out of the disk queue into a sequence of large per-tag values in
+	// persistentData, so that peeks of spilled data read a few segments sequentially instead of reading every commit
+	// back from the disk queue, and a lagging tag does not hold the disk queue.
+	bool shouldSpillToSegments(Tag t) const {
+		return logSpillType == TLogSpillType::SEGMENT && !shouldSpillByValue(t);
+	}
+
+	bool shouldSpillByReference(Tag t) const { return !shouldSpillByValue(t) && !shouldSpillToSegments(t); }
 };
 
 template <class T>
@@ -825,6 +864,11 @@ void updatePersistentPopped(TLogData* self, Reference<LogData> logData, Referenc
 	if (logData->shouldSpillByValue(data->tag)) {
 		self->persistentData->clear(KeyRangeRef(persistTagMessagesKey(logData->logId, data->tag, Version(0)),
 		                                        persistTagMessagesKey(logData->logId, data->tag, data->popped)));
+	} else if (logData->shouldSpillToSegments(data->tag)) {
+		// Only whole segments are removed; a segment with some unpopped versions is kept until they are popped too.
+		self->persistentData->clear(
+		    KeyRangeRef(persistTagMessageSegmentsKey(logData->logId, data->tag, Version(0)),
+		                persistTagMessageSegmentsKey(logData->logId, data->tag, data->popped)));
 	} else {
 		self->persistentData->clear(KeyRangeRef(persistTagMessageRefsKey(logData->logId, data->tag, Version(0)),
 		                                        persistTagMessageRefsKey(logData->logId, data->tag, data->popped)));
@@ -836,8 +880,8 @@ void updatePersistentPopped(TLogData* self, Reference<LogData> logData, Referenc
 }
 
 ACTOR Future<Void> updatePoppedLocation(TLogData* self, Reference<LogData> logData, Reference<LogData::TagData> data) {
-	// For anything spilled by value, we do not need to track its popped location.
-	if (logData->shouldSpillByValue(data->tag)) {
+	// For anything spilled by value or to segments, we do not need to track its popped location.
+	if (!logData->shouldSpillByReference(data->tag)) {
 		return Void();
 	}
 
@@ -948,6 +992,7 @@ ACTOR Future<Void> popDiskQueue(TLogData* self, Reference<LogData> logData) {
 
 ACTOR Future<Void> updatePersistentData(TLogData* self, Reference<LogData> logData, Version newPersistentDataVersion) {
 	state BinaryWriter wr(Unversioned());
+	state BinaryWriter segment(Unversioned());
 	// PERSIST: Changes self->persistentDataVersion and writes and commits the relevant changes
 	ASSERT(newPersistentDataVersion <= logData->version.get());
 	ASSERT(newPersistentDataVersion <= logData->queueCommittedVersion.get());
@@ -973,6 +1018,30 @@ ACTOR Future<Void> updatePersistentData(TLogData* self, Reference<LogData> logDa
 				updatePersistentPopped(self, logData, tagData);
 				state Version lastVersion = std::numeric_limits<Version>::min();
 				state IDiskQueue::location firstLocation = std::numeric_limits<IDiskQueue::location>::max();
+				segment = BinaryWriter(Unversioned());
+				if (logData->shouldSpillToSegments(tagData->tag)) {
+					// The segment that superseded this one was made durable by the previous update
+					if (tagData->supersededSegmentVersion != invalidVersion) {
+						self->persistentData->clear(singleKeyRange(persistTagMessageSegmentsKey(
+						    logData->logId, tagData->tag, tagData->supersededSegmentVersion)));
+						tagData->supersededSegmentVersion = invalidVersion;
+					}
+					// Continue the tag's current segment if it has room and there is something to append to it. It is
+					// rewritten under its new last version, and the old copy is kept until the new one is durable so
+					// peeks never miss its versions.
+					if (tagData->openSegmentVersion != invalidVersion && !tagData->versionMessages.empty() &&
+					    tagData->versionMessages.front().first <= newPersistentDataVersion) {
+						state Version openSegmentVersion = tagData->openSegmentVersion;
+						tagData->openSegmentVersion = invalidVersion;
+						Optional<Value> openSegment = wait(self->persistentData->readValue(
+						    persistTagMessageSegmentsKey(logData->logId, tagData->tag, openSegmentVersion)));
+						// The segment is gone if all of its versions were popped
+						if (openSegment.present()) {
+							segment.serializeBytes(openSegment.get());
+							tagData->supersededSegmentVersion = openSegmentVersion;
+						}
+					}
+				}
 				// Transfer unpopped messages with version numbers less than newPersistentDataVersion to persistentData
 				state std::deque<std::pair<Version, LengthPrefixedStringRef>>::iterator msg =
 				    tagData->versionMessages.begin();
@@ -992,6 +1061,34 @@ ACTOR Future<Void> updatePersistentData(TLogData* self, Reference<LogData> logDa
 						}
 						self->persistentData->set(KeyValueRef(
 						    persistTagMessagesKey(logData->logId, tagData->tag, currentVersion), wr.toValue()));
+					} else if (logData->shouldSpillToSegments(tagData->tag)) {
+						// Each version is appended to the tag's current segment as its version, the length of its
+						// messages and the messages as they are sent in peek replies.
+						segment << currentVersion;
+						const int lengthOffset = segment.getLength();
+						segment << uint32_t(0);
+						for (; msg != tagData->versionMessages.end() && msg->first == currentVersion; ++msg) {
+							segment << msg->second.toStringRef();
+						}
+						*(uint32_t*)((uint8_t*)segment.getData() + lengthOffset) =
+						    segment.getLength() - lengthOffset - sizeof(uint32_t);
+						lastVersion = currentVersion;
+
+						if (segment.getLength() >= SERVER_KNOBS->TLOG_SPILL_SEGMENT_BYTES) {
+							self->persistentData->set(KeyValueRef(
+							    persistTagMessageSegmentsKey(logData->logId, tagData->tag, lastVersion),
+							    segment.toValue()));
+							segment = BinaryWriter(Unversioned());
+						}
+
+						Future<Void> f = yield(TaskPriority::UpdateStorage);
+						if (!f.isReady()) {
+							wait(f);
+							msg = std::upper_bound(tagData->versionMessages.begin(),
+							                       tagData->versionMessages.end(),
+							                       std::make_pair(currentVersion, LengthPrefixedStringRef()),
+							                       CompareFirst<std::pair<Version, LengthPrefixedStringRef>>());
+						}
 					} else {
 						// spill everything else by reference
 						const IDiskQueue::location begin = logData->versionLocation[currentVersion].first;
@@ -1039,6 +1136,11 @@ ACTOR Future<Void> updatePersistentData(TLogData* self, Reference<LogData> logDa
 					    KeyValueRef(persistTagMessageRefsKey(logData->logId, tagData->tag, lastVersion), wr.toValue()));
 					tagData->poppedLocation = std::min(tagData->poppedLocation, firstLocation);
 				}
+				if (segment.getLength() > 0) {
+					self->persistentData->set(KeyValueRef(
+					    persistTagMessageSegmentsKey(logData->logId, tagData->tag, lastVersion), segment.toValue()));
+					tagData->openSegmentVersion = lastVersion;
+				}
 
 				wait(yield(TaskPriority::UpdateStorage));
 			}
@@ -1110,7 +1212,7 @@ ACTOR Future<Void> updatePersistentData(TLogData* self, Reference<LogData> logDa
 			for (tagId = 0; tagId < logData->tag_data[tagLocality].size(); tagId++) {
 				Reference<LogData::TagData> tagData = logData->tag_data[tagLocality][tagId];
 				if (tagData) {
-					if (logData->shouldSpillByValue(tagData->tag)) {
+					if (!logData->shouldSpillByReference(tagData->tag)) {
 						minVersion = std::min(minVersion, newPersistentDataVersion);
 					} else {
 						minVersion = std::min(minVersion, tagData->popped);
@@ -1741,6 +1843,8 @@ ACTOR Future<Void> tLogPeekMessages(TLogData* self, TLogPeekRequest req, Referen
 			                persistTagMessagesKey(logData->logId, req.tag, logData->persistentDataDurableVersion + 1)),
 			    SERVER_KNOBS->DESIRED_TOTAL_BYTES,
 			    SERVER_KNOBS->DESIRED_TOTAL_BYTES));
+			++logData->spilledPeekReads;
+			logData->spilledPeekBytes += kvs.expectedSize();
 
 			for (auto& kv : kvs) {
 				auto ver = decodeTagMessagesKey(kv.key);
@@ -1754,6 +1858,46 @@ ACTOR Future<Void> tLogPeekMessages(TLogData* self, TLogPeekRequest req, Referen
 			} else {
 				messages.serializeBytes(messages2.toValue());
 			}
+		} else if (logData->shouldSpillToSegments(req.tag)) {
+			// The read returns at most one segment beyond DESIRED_TOTAL_BYTES
+			state int64_t segmentPeekBytes = SERVER_KNOBS->DESIRED_TOTAL_BYTES + SERVER_KNOBS->TLOG_SPILL_SEGMENT_BYTES;
+			wait(self->peekMemoryLimiter.take(TaskPriority::TLogSpilledPeekReply, segmentPeekBytes));
+			state FlowLock::Releaser segmentMemoryReservation(self->peekMemoryLimiter, segmentPeekBytes);
+			// The first segment may begin before req.begin; whole segments are returned after that.
+			RangeResult kvs = wait(self->persistentData->readRange(
+			    KeyRangeRef(
+			        persistTagMessageSegmentsKey(logData->logId, req.tag, req.begin),
+			        persistTagMessageSegmentsKey(logData->logId, req.tag, logData->persistentDataDurableVersion + 1)),
+			    SERVER_KNOBS->DESIRED_TOTAL_BYTES,
+			    SERVER_KNOBS->DESIRED_TOTAL_BYTES));
+			TEST(true); // TLog peeked data spilled to segments
+			++logData->spilledPeekReads;
+			logData->spilledPeekBytes += kvs.expectedSize();
+
+			// A segment which was continued by a later one is kept until the later one is durable, so the versions it
+			// holds may appear twice.
+			Version nextVersion = req.begin;
+			for (auto& kv : kvs) {
+				BinaryReader rd(kv.value, Unversioned());
+				while (!rd.empty()) {
+					Version ver;
+					uint32_t length;
+					rd >> ver >> length;
+					StringRef versionMessages((const uint8_t*)rd.readBytes(length), length);
+					if (ver >= nextVersion) {
+						messages << VERSION_HEADER << ver;
+						messages.serializeBytes(versionMessages);
+						nextVersion = ver + 1;
+					}
+				}
+			}
+
+			if (kvs.expectedSize() >= SERVER_KNOBS->DESIRED_TOTAL_BYTES) {
+				endVersion = decodeTagMessageSegmentsKey(kvs.end()[-1].key) + 1;
+				onlySpilled = true;
+			} else {
+				messages.serializeBytes(messages2.toValue());
+			}
 		} else {
 			// FIXME: Limit to approximately DESIRED_TOTATL_BYTES somehow.
 			RangeResult kvrefs = wait(self->persistentData->readRange(
@@ -1793,6 +1937,8 @@ ACTOR Future<Void> tLogPeekMessages(TLogData* self, TLogPeekRequest req, Referen
 					break;
 			}
 			earlyEnd = earlyEnd || (kvrefs.size() >= SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK + 1);
+			logData->spilledPeekReads += 1 + commitLocations.size();
+			logData->spilledPeekBytes += kvrefs.expectedSize() + commitBytes;
 			wait(self->peekMemoryLimiter.take(TaskPriority::TLogSpilledPeekReply, commitBytes));
 			state FlowLock::Releaser memoryReservation(self->peekMemoryLimiter, commitBytes);
 			state std::vector<Future<Standalone<StringRef>>> messageReads;
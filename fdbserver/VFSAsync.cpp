@@ -25,8 +25,10 @@
 #include "fdbrpc/fdbrpc.h"
 #include "fdbrpc/IAsyncFile.h"
 #include "fdbserver/CoroFlow.h"
+#include "fdbserver/Knobs.h"
 #include "fdbrpc/simulator.h"
 #include "fdbrpc/AsyncFileReadAhead.actor.h"
+#include "flow/UnitTest.h"
 
 #include <assert.h>
 #include <string.h>
@@ -62,7 +64,8 @@ const uint32_t RESERVED_COUNT = 1U << 29;
 
 VFSAsyncFile::VFSAsyncFile(std::string const& filename, int flags)
   : filename(filename), flags(flags), pLockCount(&filename_lockCount_openCount[filename].first), debug_zcrefs(0),
-    debug_zcreads(0), debug_reads(0), chunkSize(0) {
+    debug_zcreads(0), debug_reads(0), chunkSize(0), lastReadEnd(0), sequentialReads(0), readAheadEnd(0),
+    readAheadWindow(0), debug_readAheads(0) {
 	filename_lockCount_openCount[filename].second++;
 
 	TraceEvent(SevDebug, "VFSAsyncFileConstruct")
@@ -73,12 +76,141 @@ VFSAsyncFile::VFSAsyncFile(std::string const& filename, int flags)
 }
 
 std::map<std::string, std::pair<uint32_t, int>> VFSAsyncFile::filename_lockCount_openCount;
+int64_t VFSAsyncFile::readAheadBytesInProgress = 0;
+
+// Called before each read of the database file.  Once SQLITE_READ_AHEAD_MIN_SEQUENTIAL_READS reads in a row have moved
+// forward through the file, the next window of the file is read into the page cache without waiting for it.  Reads
+// that land in a window already read ahead also count as moving forward, since the leaves of a B-tree are rarely
+// adjacent.  The window starts at SQLITE_READ_AHEAD_INITIAL_BYTES and doubles each time the scan catches up with it,
+// so that point reads and short scans don't read much they won't use.
+static void readAhead(VFSAsyncFile* p, int64_t offset, int length) {
+	if (!(p->flags & SQLITE_OPEN_MAIN_DB) || SERVER_KNOBS->SQLITE_READ_AHEAD_MAX_BYTES <= 0) {
+		return;
+	}
+	// A page that failed to read ahead is read again, and its error reported, if SQLite asks for it
+	while (!p->readAheads.empty() && p->readAheads.front().read.isReady()) {
+		VFSAsyncFile::readAheadBytesInProgress -= p->readAheads.front().length;
+		p->readAheads.pop_front();
+	}
+
+	if (offset >= p->lastReadEnd && (offset == p->lastReadEnd || offset < p->readAheadEnd)) {
+		++p->sequentialReads;
+	} else {
+		p->sequentialReads = 0;
+		p->readAheadEnd = 0;
+		p->readAheadWindow = 0;
+	}
+	p->lastReadEnd = offset + length;
+	if (p->sequentialReads < SERVER_KNOBS->SQLITE_READ_AHEAD_MIN_SEQUENTIAL_READS) {
+		return;
+	}
+
+	int64_t begin = std::max(p->readAheadEnd, p->lastReadEnd);
+	if (begin - p->lastReadEnd > p->readAheadWindow / 2) {
+		return;
+	}
+	Future<int64_t> fileSize = p->file->size();
+	if (!fileSize.isReady() || fileSize.isError()) {
+		return;
+	}
+	p->readAheadWindow = std::min(std::max(2 * p->readAheadWindow, SERVER_KNOBS->SQLITE_READ_AHEAD_INITIAL_BYTES),
+	                              SERVER_KNOBS->SQLITE_READ_AHEAD_MAX_BYTES);
+	int readLength = std::min<int64_t>(p->readAheadWindow, fileSize.get() - begin);
+	if (readLength <= 0 ||
+	    VFSAsyncFile::readAheadBytesInProgress + readLength > SERVER_KNOBS->SQLITE_READ_AHEAD_BUDGET_BYTES) {
+		return;
+	}
+
+	VFSAsyncFile::ReadAhead r;
+	r.length = readLength;
+	try {
+		r.read = p->file->read(new (r.buffer) uint8_t[readLength], readLength, begin);
+	} catch (Error& e) {
+		return;
+	}
+	VFSAsyncFile::readAheadBytesInProgress += readLength;
+	p->readAheads.push_back(std::move(r));
+	p->readAheadEnd = begin + readLength;
+	++p->debug_readAheads;
+}
+
+// A file whose reads all complete at once, for testing readAhead()
+struct ReadAheadTestFile final : IAsyncFile, ReferenceCounted<ReadAheadTestFile> {
+	int64_t fileSize;
+	explicit ReadAheadTestFile(int64_t fileSize) : fileSize(fileSize) {}
+
+	void addref() override { ReferenceCounted<ReadAheadTestFile>::addref(); }
+	void delref() override { ReferenceCounted<ReadAheadTestFile>::delref(); }
+	Future<int> read(void* data, int length, int64_t offset) override {
+		int bytes = std::max<int64_t>(0, std::min<int64_t>(length, fileSize - offset));
+		memset(data, 0, bytes);
+		return bytes;
+	}
+	Future<Void> write(void const* data, int length, int64_t offset) override { return Void(); }
+	Future<Void> truncate(int64_t size) override { return Void(); }
+	Future<Void> sync() override { return Void(); }
+	Future<int64_t> size() const override { return fileSize; }
+	std::string getFilename() const override { return "ReadAheadTestFile"; }
+	int64_t debugFD() const override { return 0; }
+};
+
+// Reads the given pages of a test file, and returns how many times it was read ahead
+static int countReadAheads(std::vector<int64_t> const& pages) {
+	const int pageSize = 4096;
+	VFSAsyncFile p("ReadAheadTestFile", SQLITE_OPEN_MAIN_DB);
+	p.file = makeReference<ReadAheadTestFile>(int64_t(pageSize) << 14);
+	for (int64_t page : pages) {
+		readAhead(&p, page * pageSize, pageSize);
+	}
+	// As asyncClose() would
+	for (auto& r : p.readAheads) {
+		VFSAsyncFile::readAheadBytesInProgress -= r.length;
+	}
+	return p.debug_readAheads;
+}
+
+TEST_CASE("/fdbserver/VFSAsync/ReadAhead") {
+	const int pages = 1 << 14;
+	std::vector<int64_t> sequential;
+	for (int i = 0; i < pages; ++i) {
+		sequential.push_back(i);
+	}
+	// Never the page after the one before, so that no two reads in a row move forward through the file
+	std::vector<int64_t> random;
+	while (int(random.size()) < pages) {
+		int64_t page = deterministicRandom()->randomInt(0, pages);
+		if (random.empty() || page != random.back() + 1) {
+			random.push_back(page);
+		}
+	}
+
+	int sequentialReadAheads = countReadAheads(sequential);
+	int randomReadAheads = countReadAheads(random);
+	printf("Read ahead %d times for %d sequential page reads, %d times for %d random page reads\n",
+	       sequentialReadAheads,
+	       pages,
+	       randomReadAheads,
+	       pages);
+	if (SERVER_KNOBS->SQLITE_READ_AHEAD_MAX_BYTES > 0) {
+		ASSERT(sequentialReadAheads > 0);
+	} else {
+		ASSERT(sequentialReadAheads == 0);
+	}
+	ASSERT(randomReadAheads == 0);
+	return Void();
+}
 
 static int asyncClose(sqlite3_file* pFile) {
 	VFSAsyncFile* p = (VFSAsyncFile*)pFile;
 
 	TraceEvent(SevDebug, "VFSAsyncFileDestroy").detail("Filename", p->filename).backtrace();
 
+	// Reads ahead still in progress are left to finish, with their buffers
+	for (auto& r : p->readAheads) {
+		uncancellable(holdWhile(r.buffer, r.read));
+		VFSAsyncFile::readAheadBytesInProgress -= r.length;
+	}
+
 	// printf("Closing %s: %d zcrefs, %d/%d reads zc\n", filename.c_str(), debug_zcrefs, debug_zcreads,
 	// debug_zcreads+debug_reads);
 	ASSERT(!p->debug_zcrefs);
@@ -89,6 +221,7 @@ static int asyncClose(sqlite3_file* pFile) {
 
 static int asyncRead(sqlite3_file* pFile, void* zBuf, int iAmt, sqlite_int64 iOfst) {
 	VFSAsyncFile* p = (VFSAsyncFile*)pFile;
+	readAhead(p, iOfst, iAmt);
 	try {
 		++p->debug_reads;
 		int readBytes = waitForAndGet(p->file->read(zBuf, iAmt, iOfst));
@@ -123,6 +256,7 @@ static int asyncReleaseZeroCopy(sqlite3_file* pFile, void* data, int iAmt, sqlit
 
 static int asyncReadZeroCopy(sqlite3_file* pFile, void** data, int iAmt, sqlite_int64 iOfst, int* pDataWasCached) {
 	VFSAsyncFile* p = (VFSAsyncFile*)pFile;
+	readAhead(p, iOfst, iAmt);
 	try {
 		int readBytes = iAmt;
 		Future<Void> readFuture = p->file->readZeroCopy(data, &readBytes, iOfst);
@@ -19,6 +19,7 @@
  */
 
 #include "sqlite/sqlite3.h"
+#include <deque>
 #include <string>
 #include <map>
 #include "fdbrpc/IAsyncFile.h"
@@ -85,8 +86,23 @@ struct VFSAsyncFile {
 
 	int chunkSize;
 
+	// SQLite reads the database one page at a time, so forward scans of it are detected and read ahead of, into the
+	// page cache.  Each read ahead copies into its own buffer, which must live until the read finishes.
+	struct ReadAhead {
+		Future<int> read;
+		Arena buffer;
+		int length;
+	};
+	int64_t lastReadEnd; // Offset just past the last page SQLite read
+	int sequentialReads; // Number of reads in a row that continued forward from the one before
+	int64_t readAheadEnd; // Offset just past the last byte read ahead
+	int readAheadWindow; // Bytes read ahead at a time, which grows while the scan continues
+	std::deque<ReadAhead> readAheads;
+	int debug_readAheads;
+
 	VFSAsyncFile(std::string const& filename, int flags);
 	~VFSAsyncFile();
 
 	static std::map<std::string, std::pair<uint32_t, int>> filename_lockCount_openCount;
+	static int64_t readAheadBytesInProgress; // Of all files, limited by SQLITE_READ_AHEAD_BUDGET_BYTES
 };
@@ -18,8 +18,10 @@
  * limitations under the License.
  */
 
+#include "fdbserver/CoroFlow.h"
 #include "fdbserver/Knobs.h"
 #include "flow/IRandom.h"
+#include "flow/IThreadPool.h"
 #include "flow/Knobs.h"
 #include "flow/flow.h"
 #include "flow/Histogram.h"
@@ -1516,6 +1518,8 @@ struct RedwoodMetrics {
 			unsigned int lazyClearFreeExt;
 			unsigned int forceUpdate;
 			unsigned int detachChild;
+			unsigned int pageBuildTimeUs; // Time spent encoding new pages, on any thread
+			unsigned int commitTimeUs; // Sum of the durations of the commits of subtrees rooted at this level
 			EventReasonsArray events;
 		};
 		Counters metrics;
@@ -1715,6 +1719,9 @@ struct RedwoodMetrics {
 				{ "ForceUpdate", metric.forceUpdate },
 				{ "DetachChild", metric.detachChild },
 				{ "", 0 },
+				{ "-PageBuildUs", metric.pageBuildTimeUs },
+				{ "-CommitUs", metric.commitTimeUs },
+				{ "", 0 },
 			};
 
 			if (e != nullptr) {
@@ -3725,9 +3732,11 @@ std::string toString(BTreePageIDRef id) {
 struct RedwoodRecordRef {
 	typedef uint8_t byte;
 
-	RedwoodRecordRef(KeyRef key = KeyRef(), Optional<ValueRef> value = {}) : key(key), value(value) {}
+	RedwoodRecordRef(KeyRef key = KeyRef(), Optional<ValueRef> value = {}, bool externalValue = false)
+	  : key(key), value(value), externalValue(externalValue) {}
 
-	RedwoodRecordRef(Arena& arena, const RedwoodRecordRef& toCopy) : key(arena, toCopy.key) {
+	RedwoodRecordRef(Arena& arena, const RedwoodRecordRef& toCopy)
+	  : key(arena, toCopy.key), externalValue(toCopy.externalValue) {
 		if (toCopy.value.present()) {
 			value = ValueRef(arena, toCopy.value.get());
 		}
@@ -3765,6 +3774,27 @@ struct RedwoodRecordRef {
 		return RedwoodRecordRef(key, StringRef((uint8_t*)&maxPageID, sizeof(maxPageID)));
 	}
 
+	// A leaf record with externalValue set holds, in place of its value, the value's size followed by the IDs of the
+	// pages the value is stored in.  These functions make creating and working with such records more convenient.
+	inline int externalValueSize() const {
+		ASSERT(externalValue);
+		return *(const uint32_t*)value.get().begin();
+	}
+
+	inline VectorRef<LogicalPageID> externalValuePages() const {
+		ASSERT(externalValue);
+		return VectorRef<LogicalPageID>((LogicalPageID*)(value.get().begin() + sizeof(uint32_t)),
+		                                (value.get().size() - sizeof(uint32_t)) / sizeof(LogicalPageID));
+	}
+
+	inline RedwoodRecordRef withExternalValue(Arena& arena, int size, VectorRef<LogicalPageID> pages) const {
+		uint32_t valueSize = size;
+		ValueRef v = makeString(sizeof(uint32_t) + pages.size() * sizeof(LogicalPageID), arena);
+		memcpy(mutateString(v), &valueSize, sizeof(uint32_t));
+		memcpy(mutateString(v) + sizeof(uint32_t), pages.begin(), pages.size() * sizeof(LogicalPageID));
+		return RedwoodRecordRef(key, v, true);
+	}
+
 	// Truncate (key, version, part) tuple to len bytes.
 	void truncate(int len) {
 		ASSERT(len <= key.size());
@@ -3799,6 +3829,8 @@ struct RedwoodRecordRef {
 	// TODO: Use SplitStringRef (unless it ends up being slower)
 	KeyRef key;
 	Optional<ValueRef> value;
+	// Whether value refers to pages holding the actual value, see externalValuePages()
+	bool externalValue;
 
 	int expectedSize() const { return key.expectedSize() + value.expectedSize(); }
 	int kvBytes() const { return expectedSize(); }
@@ -3846,7 +3878,8 @@ struct RedwoodRecordRef {
 		//    1 bit - borrow source is prev ancestor (otherwise next ancestor)
 		//    1 bit - item is deleted
 		//    1 bit - has value (different from a zero-length value, which is still a value)
-		//    3 unused bits
+		//    1 bit - value is stored outside of the tree
+		//    2 unused bits
 		//    2 bits - length fields format
 		//
 		// Length fields using 3 to 8 bytes total depending on length fields format
@@ -3859,7 +3892,8 @@ struct RedwoodRecordRef {
 			PREFIX_SOURCE_PREV = 0x80,
 			IS_DELETED = 0x40,
 			HAS_VALUE = 0x20,
-			// 3 unused bits
+			EXTERNAL_VALUE = 0x10,
+			// 2 unused bits
 			LENGTHS_FORMAT = 0x03
 		};
 
@@ -3940,6 +3974,8 @@ struct RedwoodRecordRef {
 
 		bool hasValue() const { return flags & HAS_VALUE; }
 
+		bool hasExternalValue() const { return flags & EXTERNAL_VALUE; }
+
 		void setPrefixSource(bool val) {
 			if (val) {
 				flags |= PREFIX_SOURCE_PREV;
@@ -3978,12 +4014,14 @@ struct RedwoodRecordRef {
 				k = base.key.substr(0, keyPrefixLen);
 			}
 
-			return RedwoodRecordRef(k, hasValue() ? ValueRef(pData, valueLen) : Optional<ValueRef>());
+			return RedwoodRecordRef(
+			    k, hasValue() ? ValueRef(pData, valueLen) : Optional<ValueRef>(), hasExternalValue());
 		}
 
 		// DeltaTree interface
 		RedwoodRecordRef apply(const Partial& cache) {
-			return RedwoodRecordRef(cache, hasValue() ? Optional<ValueRef>(getValue()) : Optional<ValueRef>());
+			return RedwoodRecordRef(
+			    cache, hasValue() ? Optional<ValueRef>(getValue()) : Optional<ValueRef>(), hasExternalValue());
 		}
 
 		RedwoodRecordRef apply(Arena& arena, const Partial& baseKey, Optional<Partial>& cache) {
@@ -4004,7 +4042,8 @@ struct RedwoodRecordRef {
 			}
 			cache = k;
 
-			return RedwoodRecordRef(k, hasValue() ? ValueRef(pData, valueLen) : Optional<ValueRef>());
+			return RedwoodRecordRef(
+			    k, hasValue() ? ValueRef(pData, valueLen) : Optional<ValueRef>(), hasExternalValue());
 		}
 
 		RedwoodRecordRef apply(Arena& arena, const RedwoodRecordRef& base, Optional<Partial>& cache) {
@@ -4037,6 +4076,9 @@ struct RedwoodRecordRef {
 			if (hasValue()) {
 				flagString += "HasValue|";
 			}
+			if (hasExternalValue()) {
+				flagString += "ExternalValue|";
+			}
 			int lengthFormat = flags & LENGTHS_FORMAT;
 
 			int prefixLen = getKeyPrefixLength();
@@ -4059,16 +4101,19 @@ struct RedwoodRecordRef {
 	// its values, so the Reader does not require the original prev/next ancestors.
 	struct DeltaValueOnly : Delta {
 		RedwoodRecordRef apply(const RedwoodRecordRef& base, Arena& arena) const {
-			return RedwoodRecordRef(KeyRef(), hasValue() ? Optional<ValueRef>(getValue()) : Optional<ValueRef>());
+			return RedwoodRecordRef(
+			    KeyRef(), hasValue() ? Optional<ValueRef>(getValue()) : Optional<ValueRef>(), hasExternalValue());
 		}
 
 		RedwoodRecordRef apply(const Partial& cache) {
-			return RedwoodRecordRef(KeyRef(), hasValue() ? Optional<ValueRef>(getValue()) : Optional<ValueRef>());
+			return RedwoodRecordRef(
+			    KeyRef(), hasValue() ? Optional<ValueRef>(getValue()) : Optional<ValueRef>(), hasExternalValue());
 		}
 
 		RedwoodRecordRef apply(Arena& arena, const RedwoodRecordRef& base, Optional<Partial>& cache) {
 			cache = KeyRef();
-			return RedwoodRecordRef(KeyRef(), hasValue() ? Optional<ValueRef>(getValue()) : Optional<ValueRef>());
+			return RedwoodRecordRef(
+			    KeyRef(), hasValue() ? Optional<ValueRef>(getValue()) : Optional<ValueRef>(), hasExternalValue());
 		}
 	};
 #pragma pack(pop)
@@ -4105,6 +4150,9 @@ struct RedwoodRecordRef {
 	// commonPrefix between *this and base can be passed if known
 	int writeDelta(Delta& d, const RedwoodRecordRef& base, int keyPrefixLen = -1) const {
 		d.flags = value.present() ? Delta::HAS_VALUE : 0;
+		if (externalValue) {
+			d.flags |= Delta::EXTERNAL_VALUE;
+		}
 
 		if (keyPrefixLen < 0) {
 			keyPrefixLen = getCommonPrefixLen(base, 0);
@@ -4170,7 +4218,9 @@ struct RedwoodRecordRef {
 		std::string r;
 		r += format("'%s' => ", key.printable().c_str());
 		if (value.present()) {
-			if (leaf) {
+			if (leaf && externalValue) {
+				r += format("<%d bytes in %s>", externalValueSize(), ::toString(externalValuePages()).c_str());
+			} else if (leaf) {
 				r += format("'%s'", kvformat(value.get()).c_str());
 			} else {
 				r += format("[%s]", ::toString(getChildPage()).c_str());
@@ -4387,24 +4437,50 @@ public:
 
 #pragma pack(push, 1)
 	struct MetaKey {
-		static constexpr int FORMAT_VERSION = 12;
+		// Format 13 adds a flag after root, which is set once any value has been stored outside of the tree.  Trees
+		// are written in format 12 until then, so that trees without external values can still be opened by versions
+		// which only know format 12.
+		static constexpr int FORMAT_VERSION = 13;
+		static constexpr int MIN_FORMAT_VERSION = 12;
 		// This serves as the format version for the entire tree, individual pages will not be versioned
 		uint16_t formatVersion;
 		uint8_t height;
 		LazyClearQueueT::QueueState lazyDeleteQueue;
 		InPlaceArray<LogicalPageID> root;
 
-		KeyRef asKeyRef() const { return KeyRef((uint8_t*)this, sizeof(MetaKey) + root.sizeBytes()); }
+		// True once any value has been stored outside of the tree, after which leaves must be read to be freed
+		bool externalValues() const { return formatVersion >= 13 && *(const uint8_t*)root.end() != 0; }
+
+		void setExternalValues() {
+			formatVersion = 13;
+			*(uint8_t*)root.end() = 1;
+		}
+
+		// Sets root, keeping the flag which follows it in format 13
+		void setRoot(VectorRef<LogicalPageID> newRoot, int availableSpace) {
+			bool flag = externalValues();
+			root.set(newRoot, availableSpace - sizeof(uint8_t));
+			if (formatVersion >= 13) {
+				*(uint8_t*)root.end() = flag;
+			}
+		}
+
+		KeyRef asKeyRef() const {
+			return KeyRef((uint8_t*)this,
+			              sizeof(MetaKey) + root.sizeBytes() + (formatVersion >= 13 ? sizeof(uint8_t) : 0));
+		}
 
 		void fromKeyRef(KeyRef k) {
 			memcpy(this, k.begin(), k.size());
-			ASSERT(formatVersion == FORMAT_VERSION);
+			ASSERT(formatVersion >= MIN_FORMAT_VERSION && formatVersion <= FORMAT_VERSION);
+			ASSERT(asKeyRef().size() == k.size());
 		}
 
 		std::string toString() {
-			return format("{formatVersion=%d  height=%d  root=%s  lazyDeleteQueue=%s}",
+			return format("{formatVersion=%d  height=%d  externalValues=%d  root=%s  lazyDeleteQueue=%s}",
 			              (int)formatVersion,
 			              (int)height,
+			              (int)externalValues(),
 			              ::toString(root.get()).c_str(),
 			              lazyDeleteQueue.toString().c_str());
 		}
@@ -4462,6 +4538,46 @@ public:
 		m_pBuffer->erase(iBegin, iEnd);
 	}
 
+	// Replaces the contents of range with kvs, which must be sorted and within range.  This is meant for loading
+	// data into a range which is known to be empty, such as a newly fetched shard.  Instead of a mutation buffer
+	// boundary per key, the records are kept as one sorted run after the range's begin boundary, and the commit
+	// merges them into the leaves covering range by building full pages from them, and rebuilds the internal pages
+	// above those leaves, without first trying to insert each record into the existing leaves.
+	void setSortedRange(KeyRangeRef range, VectorRef<KeyValueRef> kvs) {
+		if (range.empty()) {
+			ASSERT(kvs.empty());
+			return;
+		}
+		std::vector<RedwoodRecordRef> records;
+		records.reserve(kvs.size());
+		Optional<ValueRef> boundaryValue;
+		for (int i = 0; i < kvs.size(); ++i) {
+			const KeyValueRef& kv = kvs[i];
+			ASSERT(range.contains(kv.key) && (i == 0 || kvs[i - 1].key < kv.key));
+			++g_redwoodMetrics.metric.opSet;
+			g_redwoodMetrics.metric.opSetKeyBytes += kv.key.size();
+			g_redwoodMetrics.metric.opSetValueBytes += kv.value.size();
+			if (kv.key == range.begin) {
+				boundaryValue = kv.value;
+			} else {
+				records.push_back(RedwoodRecordRef(kv.key, kv.value));
+			}
+		}
+		++g_redwoodMetrics.metric.opClear;
+
+		MutationBuffer::iterator iBegin = m_pBuffer->insert(range.begin);
+		MutationBuffer::iterator iEnd = m_pBuffer->insert(range.end);
+		iBegin.mutation().clearAll();
+		++iBegin;
+		m_pBuffer->erase(iBegin, iEnd);
+
+		RangeMutation& m = m_pBuffer->insert(range.begin).mutation();
+		if (boundaryValue.present()) {
+			m.setBoundaryValue(m_pBuffer->copyToArena(boundaryValue.get()));
+		}
+		m.sortedRecords = m_pBuffer->copyToArena(VectorRef<RedwoodRecordRef>(records.data(), records.size()));
+	}
+
 	void setOldestVersion(Version v) { m_newOldestVersion = v; }
 
 	Version getOldestVersion() const { return m_pager->getOldestVersion(); }
@@ -4476,13 +4592,27 @@ public:
 
 	Version getLastCommittedVersion() const { return m_lastCommittedVersion; }
 
-	VersionedBTree(IPager2* pager, std::string name)
+	VersionedBTree(IPager2* pager,
+	               std::string name,
+	               int pageBuildThreads = SERVER_KNOBS->REDWOOD_PAGE_BUILD_THREADS,
+	               int valueSeparationThreshold = SERVER_KNOBS->REDWOOD_VALUE_SEPARATION_THRESHOLD)
 	  : m_pager(pager), m_writeVersion(invalidVersion), m_lastCommittedVersion(invalidVersion), m_pBuffer(nullptr),
-	    m_name(name), m_pHeader(nullptr), m_headerSpace(0) {
+	    m_name(name), m_pHeader(nullptr), m_headerSpace(0), m_valueSeparationThreshold(valueSeparationThreshold) {
 
 		m_lazyClearActor = 0;
 		m_init = init_impl(this);
 		m_latestCommit = m_init;
+
+		if (pageBuildThreads > 0) {
+			if (g_network->isSimulated()) {
+				m_pageBuildPool = CoroThreadPool::createThreadPool();
+			} else {
+				m_pageBuildPool = createGenericThreadPool();
+			}
+			for (int i = 0; i < pageBuildThreads; ++i) {
+				m_pageBuildPool->addThread(new PageBuilder(), "fdb-redwood-build");
+			}
+		}
 	}
 
 	ACTOR static Future<int> incrementalLazyClear(VersionedBTree* self) {
@@ -4528,8 +4658,9 @@ public:
 
 				debug_printf("LazyClear: processing %s\n", toString(entry).c_str());
 
-				// Level 1 (leaf) nodes should never be in the lazy delete queue
-				ASSERT(entry.height > 1);
+				// Level 1 (leaf) nodes are only in the lazy delete queue if they could have values stored outside of
+				// the tree
+				ASSERT(entry.height > 1 || self->m_pHeader->externalValues());
 
 				// Iterate over page entries, skipping key decoding using BTreePage::ValueTree which uses
 				// RedwoodRecordRef::DeltaValueOnly as the delta type type to skip key decoding
@@ -4538,10 +4669,19 @@ public:
 				ASSERT(c.moveFirst());
 				Version v = entry.version;
 				while (1) {
-					if (c.get().value.present()) {
+					if (entry.height == 1) {
+						// Free the values of the leaf which are stored outside of the tree
+						if (c.get().externalValue) {
+							debug_printf("LazyClear: freeing value pages %s\n",
+							             toString(c.get().externalValuePages()).c_str());
+							self->freeExternalValue(c.get(), v);
+							freedPages += c.get().externalValuePages().size();
+						}
+					} else if (c.get().value.present()) {
 						BTreePageIDRef btChildPageID = c.get().getChildPage();
-						// If this page is height 2, then the children are leaves so free them directly
-						if (entry.height == 2) {
+						// If this page is height 2, then the children are leaves so free them directly unless they must
+						// be read to free values stored outside of the tree
+						if (entry.height == 2 && !self->m_pHeader->externalValues()) {
 							debug_printf("LazyClear: freeing child %s\n", toString(btChildPageID).c_str());
 							self->freeBTreePage(btChildPageID, v);
 							freedPages += btChildPageID.size();
@@ -4602,11 +4742,11 @@ public:
 
 		state Key meta = self->m_pager->getMetaKey();
 		if (meta.size() == 0) {
-			self->m_pHeader->formatVersion = MetaKey::FORMAT_VERSION;
+			self->m_pHeader->formatVersion = MetaKey::MIN_FORMAT_VERSION;
 			LogicalPageID id = wait(self->m_pager->newPageID());
 			BTreePageIDRef newRoot((LogicalPageID*)&id, 1);
 			debug_printf("new root %s\n", toString(newRoot).c_str());
-			self->m_pHeader->root.set(newRoot, self->m_headerSpace - sizeof(MetaKey));
+			self->m_pHeader->setRoot(newRoot, self->m_headerSpace - sizeof(MetaKey));
 			self->m_pHeader->height = 1;
 			++latest;
 			Reference<ArenaPage> page = self->m_pager->newPageBuffer();
@@ -4639,6 +4779,10 @@ public:
 		// This probably shouldn't be called directly (meaning deleting an instance directly) but it should be safe,
 		// it will cancel init and commit and leave the pager alive but with potentially an incomplete set of
 		// uncommitted writes so it should not be committed.
+		// Page builds in progress read memory owned by the commit, so stop the page builders first.
+		if (m_pageBuildPool) {
+			m_pageBuildPool->stop();
+		}
 		m_init.cancel();
 		m_latestCommit.cancel();
 
@@ -4754,6 +4898,9 @@ private:
 		bool boundaryChanged;
 		Optional<ValueRef> boundaryValue; // Not present means cleared
 		bool clearAfterBoundary;
+		// Records written after the boundary by setSortedRange(), all greater than the boundary key and less than the
+		// next boundary key.  Only non-empty when clearAfterBoundary is set.
+		VectorRef<RedwoodRecordRef> sortedRecords;
 
 		bool boundaryCleared() const { return boundaryChanged && !boundaryValue.present(); }
 
@@ -4768,6 +4915,35 @@ private:
 		void clearAll() {
 			clearBoundary();
 			clearAfterBoundary = true;
+			sortedRecords = VectorRef<RedwoodRecordRef>();
+		}
+
+		// Returns the sorted records with keys in [begin, end)
+		VectorRef<RedwoodRecordRef> sortedRecordsIn(KeyRef begin, KeyRef end) const {
+			auto keyLess = [](const RedwoodRecordRef& rec, KeyRef k) { return rec.key < k; };
+			auto b = std::lower_bound(sortedRecords.begin(), sortedRecords.end(), begin, keyLess);
+			auto e = std::lower_bound(b, sortedRecords.end(), end, keyLess);
+			return VectorRef<RedwoodRecordRef>(const_cast<RedwoodRecordRef*>(b), e - b);
+		}
+
+		// Called when a new boundary is inserted after this one, within its cleared range.  Moves the sorted records
+		// at or after the new boundary to next, the new boundary's mutation, with a record for the boundary key itself
+		// becoming next's boundary value.
+		void splitSortedRecords(KeyRef boundary, RangeMutation& next) {
+			if (sortedRecords.empty()) {
+				return;
+			}
+			auto i = std::lower_bound(sortedRecords.begin(),
+			                          sortedRecords.end(),
+			                          boundary,
+			                          [](const RedwoodRecordRef& rec, KeyRef k) { return rec.key < k; });
+			int keep = i - sortedRecords.begin();
+			if (i != sortedRecords.end() && i->key == boundary) {
+				next.setBoundaryValue(i->value.get());
+				++i;
+			}
+			next.sortedRecords = VectorRef<RedwoodRecordRef>(i, sortedRecords.end() - i);
+			sortedRecords = VectorRef<RedwoodRecordRef>(sortedRecords.begin(), keep);
 		}
 
 		void setBoundaryValue(ValueRef v) {
@@ -4863,6 +5039,7 @@ public:
 			// also be cleared
 			if (iPrevious.mutation().clearAfterBoundary) {
 				ib.mutation().clearAll();
+				iPrevious.mutation().splitSortedRecords(boundary, ib.mutation());
 			}
 
 			return ib;
@@ -4947,6 +5124,16 @@ private:
 	Future<int> m_lazyClearActor;
 	bool m_lazyClearStop;
 
+	// Encodes new pages during commit, or null to encode them on the network thread
+	Reference<IThreadPool> m_pageBuildPool;
+
+	// Values of at least this many bytes are stored outside of leaves in pages of their own, or 0 to keep all values
+	// in leaves
+	int m_valueSeparationThreshold;
+
+	// Pages holding values stored outside of the tree are counted with the leaf level in metrics
+	static constexpr unsigned int externalValueLevel = 1;
+
 	// Describes a range of a vector of records that should be built into a BTreePage
 	struct PageToBuild {
 		PageToBuild(int index, int blockSize)
@@ -5133,6 +5320,109 @@ private:
 		return pages;
 	}
 
+	// The pager pages of an encoded BTreePage
+	struct BuiltPage {
+		std::vector<Reference<ArenaPage>> pages;
+		int written; // Bytes written to the DeltaTree
+		double buildTime; // Seconds spent encoding the page
+	};
+
+	// Encodes the records [begin, end) into a new BTreePage described by p, with the given boundaries.
+	// This only reads the records and the pager's page size so it can run on any thread.
+	static BuiltPage buildPage(IPager2* pager,
+	                           const PageToBuild& p,
+	                           int height,
+	                           const RedwoodRecordRef* begin,
+	                           const RedwoodRecordRef* end,
+	                           const RedwoodRecordRef& lowerBound,
+	                           const RedwoodRecordRef& upperBound) {
+		double startTime = timer();
+		BuiltPage built;
+		BTreePage* btPage;
+
+		if (p.blockCount == 1) {
+			Reference<ArenaPage> page = pager->newPageBuffer();
+			btPage = (BTreePage*)page->mutate();
+			built.pages.push_back(std::move(page));
+		} else {
+			ASSERT(p.blockCount > 1);
+			btPage = (BTreePage*)new uint8_t[p.pageSize];
+		}
+
+		btPage->height = height;
+		btPage->kvBytes = p.kvBytes;
+
+		int deltaTreeSpace = p.pageSize - sizeof(BTreePage);
+		built.written = btPage->tree()->build(deltaTreeSpace, begin, end, &lowerBound, &upperBound);
+
+		// Create chunked pages
+		// TODO: Avoid copying page bytes, but this is not trivial due to how pager checksums are currently handled.
+		if (p.blockCount != 1) {
+			// Mark the slack in the page buffer as defined
+			VALGRIND_MAKE_MEM_DEFINED(((uint8_t*)btPage) + built.written, (p.blockCount * p.blockSize) - built.written);
+			const uint8_t* rptr = (const uint8_t*)btPage;
+			for (int b = 0; b < p.blockCount; ++b) {
+				Reference<ArenaPage> page = pager->newPageBuffer();
+				memcpy(page->mutate(), rptr, p.blockSize);
+				rptr += p.blockSize;
+				built.pages.push_back(std::move(page));
+			}
+			delete[](uint8_t*) btPage;
+		}
+
+		built.buildTime = timer() - startTime;
+		return built;
+	}
+
+	// Thread pool receiver which encodes BTreePages off of the network thread during commit
+	struct PageBuilder : IThreadPoolReceiver {
+		void init() override {}
+
+		struct BuildAction : TypedAction<PageBuilder, BuildAction> {
+			BuildAction(IPager2* pager,
+			            const PageToBuild& p,
+			            int height,
+			            const RedwoodRecordRef* begin,
+			            const RedwoodRecordRef* end,
+			            const RedwoodRecordRef& lowerBound,
+			            const RedwoodRecordRef& upperBound)
+			  : pager(pager), p(p), height(height), begin(begin), end(end), lowerBound(lowerBound),
+			    upperBound(upperBound) {}
+
+			IPager2* pager;
+			PageToBuild p;
+			int height;
+			const RedwoodRecordRef* begin;
+			const RedwoodRecordRef* end;
+			RedwoodRecordRef lowerBound;
+			RedwoodRecordRef upperBound;
+			ThreadReturnPromise<BuiltPage> result;
+
+			double getTimeEstimate() const override { return 0; }
+		};
+
+		void action(BuildAction& a) {
+			a.result.send(buildPage(a.pager, a.p, a.height, a.begin, a.end, a.lowerBound, a.upperBound));
+		}
+	};
+
+	// Encodes a page on the page build thread pool if there is one, otherwise immediately.
+	// The records and boundaries must remain valid until the returned future is ready.
+	Future<BuiltPage> buildPageAsync(const PageToBuild& p,
+	                                 int height,
+	                                 const RedwoodRecordRef* begin,
+	                                 const RedwoodRecordRef* end,
+	                                 const RedwoodRecordRef& lowerBound,
+	                                 const RedwoodRecordRef& upperBound) {
+		if (!m_pageBuildPool) {
+			return buildPage(m_pager, p, height, begin, end, lowerBound, upperBound);
+		}
+		auto* a = new PageBuilder::BuildAction(m_pager, p, height, begin, end, lowerBound, upperBound);
+		Future<BuiltPage> result = a->result.getFuture();
+		m_pageBuildPool->post(a);
+		return result;
+	}
+
 	// Writes entries to 1 or more pages and return a vector of boundary keys with their ArenaPage(s)
 	ACTOR static Future<Standalone<VectorRef<RedwoodRecordRef>>> writePages(VersionedBTree* self,
 	                                                                        const RedwoodRecordRef* lowerBound,
@@ -5152,13 +5442,19 @@ private:
 		    splitPages(lowerBound, upperBound, prefixLen, entries, height, self->m_blockSize);
 		debug_printf("splitPages returning %s\n", toString(pagesToBuild).c_str());
 
-		// Lower bound of the page being added to
-		state RedwoodRecordRef pageLowerBound = lowerBound->withoutValue();
-		state RedwoodRecordRef pageUpperBound;
+		// Page boundaries, page i is bounded by pageBounds[i] and pageBounds[i + 1]
+		state std::vector<RedwoodRecordRef> pageBounds;
+		pageBounds.reserve(pagesToBuild.size() + 1);
+		pageBounds.push_back(lowerBound->withoutValue());
+
+		// Encoded pages, which may be built concurrently on the page build thread pool
+		state std::vector<Future<BuiltPage>> builtPages;
+		state bool trailingNullLink = false;
 		state int sinceYield = 0;
 
 		state int pageIndex;
 
+		// Start building all of the pages.  Their page IDs are assigned below, in page order.
 		for (pageIndex = 0; pageIndex < pagesToBuild.size(); ++pageIndex) {
 			auto& p = pagesToBuild[pageIndex];
 			debug_printf("building page %d of %d %s\n", pageIndex + 1, pagesToBuild.size(), p.toString().c_str());
@@ -5185,7 +5481,7 @@ private:
 				// adding the extra null link fixes this.
 				if (p.count == 0) {
 					ASSERT(pageIndex == pagesToBuild.size() - 1);
-					records.push_back_deep(records.arena(), pageUpperBound);
+					trailingNullLink = true;
 					break;
 				}
 			}
@@ -5193,39 +5489,38 @@ private:
 			// Use the next entry as the upper bound, or upperBound if there are no more entries beyond this page
 			int endIndex = p.endIndex();
 			bool lastPage = endIndex == entries.size();
-			pageUpperBound = lastPage ? upperBound->withoutValue() : entries[endIndex].withoutValue();
+			RedwoodRecordRef pageUpperBound = lastPage ? upperBound->withoutValue() : entries[endIndex].withoutValue();
 
 			// If this is a leaf page, and not the last one to be written, shorten the upper boundary
 			if (!lastPage && height == 1) {
 				int commonPrefix = pageUpperBound.getCommonPrefixLen(entries[endIndex - 1], prefixLen);
 				pageUpperBound.truncate(commonPrefix + 1);
 			}
+			pageBounds.push_back(pageUpperBound);
 
-			state std::vector<Reference<ArenaPage>> pages;
-			BTreePage* btPage;
-
-			if (p.blockCount == 1) {
-				Reference<ArenaPage> page = self->m_pager->newPageBuffer();
-				btPage = (BTreePage*)page->mutate();
-				pages.push_back(std::move(page));
-			} else {
-				ASSERT(p.blockCount > 1);
-				btPage = (BTreePage*)new uint8_t[p.pageSize];
-			}
-
-			btPage->height = height;
-			btPage->kvBytes = p.kvBytes;
 			g_redwoodMetrics.kvSizeWritten->sample(p.kvBytes);
 
 			debug_printf("Building tree for %s\nlower: %s\nupper: %s\n",
 			             p.toString().c_str(),
-			             pageLowerBound.toString(false).c_str(),
+			             pageBounds[pageIndex].toString(false).c_str(),
 			             pageUpperBound.toString(false).c_str());
 
-			int deltaTreeSpace = p.pageSize - sizeof(BTreePage);
-			state int written = btPage->tree()->build(
-			    deltaTreeSpace, &entries[p.startIndex], &entries[endIndex], &pageLowerBound, &pageUpperBound);
+			builtPages.push_back(self->buildPageAsync(
+			    p, height, &entries[p.startIndex], &entries[endIndex], pageBounds[pageIndex], pageUpperBound));
+
+			if (++sinceYield > 100) {
+				sinceYield = 0;
+				wait(yield());
+			}
+		}
+
+		for (pageIndex = 0; pageIndex < builtPages.size(); ++pageIndex) {
+			wait(success(builtPages[pageIndex]));
+			state std::vector<Reference<ArenaPage>> pages = builtPages[pageIndex].get().pages;
+			state int written = builtPages[pageIndex].get().written;
+			auto& p = pagesToBuild[pageIndex];
 
+			int deltaTreeSpace = p.pageSize - sizeof(BTreePage);
 			if (written > deltaTreeSpace) {
 				debug_printf("ERROR:  Wrote %d bytes to page %s deltaTreeSpace=%d\n",
 				             written,
@@ -5240,25 +5535,14 @@ private:
 			auto& metrics = g_redwoodMetrics.level(height);
 			metrics.metrics.pageBuild += 1;
 			metrics.metrics.pageBuildExt += p.blockCount - 1;
+			metrics.metrics.pageBuildTimeUs += builtPages[pageIndex].get().buildTime * 1e6;
 
 			metrics.buildFillPctSketch->samplePercentage(p.usedFraction());
 			metrics.buildStoredPctSketch->samplePercentage(p.kvFraction());
 			metrics.buildItemCountSketch->sampleRecordCounter(p.count);
 
-			// Create chunked pages
-			// TODO: Avoid copying page bytes, but this is not trivial due to how pager checksums are currently handled.
-			if (p.blockCount != 1) {
-				// Mark the slack in the page buffer as defined
-				VALGRIND_MAKE_MEM_DEFINED(((uint8_t*)btPage) + written, (p.blockCount * p.blockSize) - written);
-				const uint8_t* rptr = (const uint8_t*)btPage;
-				for (int b = 0; b < p.blockCount; ++b) {
-					Reference<ArenaPage> page = self->m_pager->newPageBuffer();
-					memcpy(page->mutate(), rptr, p.blockSize);
-					rptr += p.blockSize;
-					pages.push_back(std::move(page));
-				}
-				delete[](uint8_t*) btPage;
-			}
+			// The encoded page is no longer needed once its pages have been taken
+			builtPages[pageIndex] = Future<BuiltPage>();
 
 			// Write this btree page, which is made of 1 or more pager pages.
 			state BTreePageIDRef childPageID;
@@ -5299,21 +5583,23 @@ private:
 				             toString(previousID).c_str(),
 				             written,
 				             p.toString().c_str(),
-				             pageLowerBound.toString(false).c_str(),
-				             pageUpperBound.toString(false).c_str());
+				             pageBounds[pageIndex].toString(false).c_str(),
+				             pageBounds[pageIndex + 1].toString(false).c_str());
 				for (int j = p.startIndex; j < p.endIndex(); ++j) {
 					debug_printf(" %3d: %s\n", j, entries[j].toString(height == 1).c_str());
 				}
-				ASSERT(pageLowerBound.key <= pageUpperBound.key);
+				ASSERT(pageBounds[pageIndex].key <= pageBounds[pageIndex + 1].key);
 			}
 
 			// Push a new record onto the results set, without the child page, copying it into the records arena
-			records.push_back_deep(records.arena(), pageLowerBound.withoutValue());
+			records.push_back_deep(records.arena(), pageBounds[pageIndex].withoutValue());
 			// Set the child page value of the inserted record to childPageID, which has already been allocated in
 			// records.arena() above
 			records.back().setChildPage(childPageID);
+		}
 
-			pageLowerBound = pageUpperBound;
+		if (trailingNullLink) {
+			records.push_back_deep(records.arena(), pageBounds.back());
 		}
 
 		return records;
@@ -5436,6 +5722,84 @@ private:
 		}
 	}
 
+	// Free the pages holding the value of leaf record rec at v, if its value is stored outside of the tree
+	void freeExternalValue(const RedwoodRecordRef& rec, Version v) {
+		if (rec.externalValue) {
+			for (LogicalPageID id : rec.externalValuePages()) {
+				m_pager->freePage(id, v);
+			}
+		}
+	}
+
+	// Write value to new pages of its own and return their IDs
+	ACTOR static Future<Standalone<VectorRef<LogicalPageID>>> writeExternalValue(VersionedBTree* self, ValueRef value) {
+		state Standalone<VectorRef<LogicalPageID>> pages;
+		state int offset = 0;
+		while (offset < value.size()) {
+			LogicalPageID id = wait(self->m_pager->newPageID());
+			Reference<ArenaPage> page = self->m_pager->newPageBuffer();
+			int len = std::min(value.size() - offset, page->size());
+			memcpy(page->mutate(), value.begin() + offset, len);
+			memset(page->mutate() + len, 0, page->size() - len);
+			self->m_pager->updatePage(PagerEventReasons::Commit, externalValueLevel, id, page);
+			pages.push_back(pages.arena(), id);
+			offset += len;
+		}
+		return pages;
+	}
+
+	// Store the values of leaf records which are at least m_valueSeparationThreshold bytes outside of the tree,
+	// replacing each value with a reference to the pages it was written to.  Values which are already stored outside
+	// of the tree are left as they are, so a value is only written once no matter how often its leaf is rebuilt.
+	ACTOR static Future<Void> writeExternalValues(VersionedBTree* self,
+	                                              Standalone<VectorRef<RedwoodRecordRef>>* records) {
+		state std::vector<std::pair<int, Future<Standalone<VectorRef<LogicalPageID>>>>> writes;
+		for (int i = 0; i < records->size(); ++i) {
+			const RedwoodRecordRef& rec = (*records)[i];
+			if (rec.value.present() && !rec.externalValue &&
+			    rec.value.get().size() >= self->m_valueSeparationThreshold) {
+				writes.push_back(std::make_pair(i, writeExternalValue(self, rec.value.get())));
+			}
+		}
+
+		if (!writes.empty() && !self->m_pHeader->externalValues()) {
+			self->m_pHeader->setExternalValues();
+		}
+
+		state int w;
+		for (w = 0; w < writes.size(); ++w) {
+			Standalone<VectorRef<LogicalPageID>> pages = wait(writes[w].second);
+			RedwoodRecordRef& rec = (*records)[writes[w].first];
+			rec = rec.withExternalValue(records->arena(), rec.value.get().size(), pages);
+		}
+		return Void();
+	}
+
+	// Read up to maxLength bytes of the value of rec, a leaf record whose value is stored outside of the tree.
+	// The memory rec refers to is only used before the first wait.
+	ACTOR static Future<Value> readExternalValue_impl(Reference<IPagerSnapshot> snapshot,
+	                                                  PagerEventReasons reason,
+	                                                  int pageSize,
+	                                                  RedwoodRecordRef rec,
+	                                                  int maxLength) {
+		state Value value = makeString(std::min(rec.externalValueSize(), maxLength));
+		state std::vector<Future<Reference<const ArenaPage>>> reads;
+
+		// Only the pages holding the first maxLength bytes are read
+		VectorRef<LogicalPageID> pages = rec.externalValuePages();
+		for (int offset = 0; offset < value.size(); offset += pageSize) {
+			reads.push_back(snapshot->getPhysicalPage(
+			    reason, externalValueLevel, pages[offset / pageSize], ioMaxPriority, false, false));
+		}
+		wait(waitForAll(reads));
+
+		for (int i = 0; i < reads.size(); ++i) {
+			int offset = i * pageSize;
+			memcpy(mutateString(value) + offset, reads[i].get()->begin(), std::min(value.size() - offset, pageSize));
+		}
+		return value;
+	}
+
 	// Write new version of pageID at version v using page as its data.
 	// Attempts to reuse original id(s) in btPageID, returns BTreePageID.
 	// updateBTreePage is only called from commitSubTree function so write reason is always btree commit
@@ -5803,6 +6167,15 @@ private:
 		}
 	};
 
+	// Adds the time from its construction to its destruction to the commit time of a BTree level
+	struct LevelCommitTimer {
+		LevelCommitTimer(int height) : height(height), startTime(timer()) {}
+		~LevelCommitTimer() { g_redwoodMetrics.level(height).metrics.commitTimeUs += (timer() - startTime) * 1e6; }
+
+		int height;
+		double startTime;
+	};
+
 	ACTOR static Future<Void> commitSubtree(
 	    VersionedBTree* self,
 	    Reference<IPagerSnapshot> snapshot,
@@ -5813,6 +6186,7 @@ private:
 	    MutationBuffer::const_iterator mEnd, // least boundary >= subtreeUpperBound->key
 	    InternalPageSliceUpdate* update) {
 
+		state LevelCommitTimer commitTimer(height);
 		state std::string context;
 		if (REDWOOD_DEBUG) {
 			context = format("CommitSubtree(root=%s): ", toString(rootID).c_str());
@@ -5947,11 +6321,13 @@ private:
 							}
 
 							btPage->kvBytes -= cursor.get().kvBytes();
+							self->freeExternalValue(cursor.get(), writeVersion);
 							cursor.erase();
 						} else {
 							debug_printf("%s Skipped %s [existing, boundary start]\n",
 							             context.c_str(),
 							             cursor.get().toString().c_str());
+							self->freeExternalValue(cursor.get(), writeVersion);
 							cursor.moveNext();
 						}
 					}
@@ -5966,6 +6342,13 @@ private:
 					RedwoodRecordRef rec(mBegin.key(), mBegin.mutation().boundaryValue.get());
 					changesMade = true;
 
+					// Values to be stored outside of the tree are written with a linear merge, after which the
+					// records holding them are known
+					if (updating && self->m_valueSeparationThreshold > 0 &&
+					    rec.value.get().size() >= self->m_valueSeparationThreshold) {
+						switchToLinearMerge();
+					}
+
 					// If updating, add to the page, else add to the output set
 					if (updating) {
 						// Copy page for modification if not already copied
@@ -5996,6 +6379,16 @@ private:
 
 				// Before advancing the iterator, get whether or not the records in the following range must be removed
 				bool remove = mBegin.mutation().clearAfterBoundary;
+				// and the records written to the range by setSortedRange() which belong in this page
+				VectorRef<RedwoodRecordRef> sortedRecords = mBegin.mutation().sortedRecordsIn(
+				    update->subtreeLowerBound.key, update->subtreeUpperBound.key);
+				if (!sortedRecords.empty()) {
+					changesMade = true;
+					// Sorted records are always written with a linear merge, which builds full new pages from them
+					if (updating) {
+						switchToLinearMerge();
+					}
+				}
 				// Advance to the next boundary because we need to know the end key for the current range.
 				++mBegin;
 				if (mBegin == mEnd) {
@@ -6014,6 +6407,14 @@ private:
 					// actually are any but we must assume there are.
 					if (!updating) {
 						changesMade = true;
+
+						// Removed records whose values are stored outside of the tree must be visited to free them
+						if (self->m_pHeader->externalValues()) {
+							while (cursor.valid() && cursor.get().compare(end, update->skipLen) < 0) {
+								self->freeExternalValue(cursor.get(), writeVersion);
+								cursor.moveNext();
+							}
+						}
 					}
 
 					debug_printf("%s Seeking forward to next boundary (remove=%d updating=%d) %s\n",
@@ -6039,6 +6440,7 @@ private:
 							}
 
 							btPage->kvBytes -= cursor.get().kvBytes();
+							self->freeExternalValue(cursor.get(), writeVersion);
 							cursor.erase();
 							changesMade = true;
 						} else {
@@ -6049,6 +6451,16 @@ private:
 						}
 					}
 				}
+
+				// The range was cleared above, so the sorted records are all that remain in it
+				if (!sortedRecords.empty()) {
+					debug_printf("%s Added %d sorted records from %s to %s [mutation, sorted range]\n",
+					             context.c_str(),
+					             sortedRecords.size(),
+					             sortedRecords.front().toString().c_str(),
+					             sortedRecords.back().toString().c_str());
+					merged.append(merged.arena(), sortedRecords.begin(), sortedRecords.size());
+				}
 			}
 
 			// If there are still more records, they have the same key as the end boundary
@@ -6064,6 +6476,13 @@ private:
 				if (remove != updating) {
 					debug_printf(
 					    "%s Ignoring remaining records, remove=%d updating=%d\n", context.c_str(), remove, updating);
+					// Removed records whose values are stored outside of the tree must still be visited to free them
+					if (remove && self->m_pHeader->externalValues()) {
+						while (cursor.valid()) {
+							self->freeExternalValue(cursor.get(), writeVersion);
+							cursor.moveNext();
+						}
+					}
 				} else {
 					// If updating and the key is changing, we must visit the records to erase them.
 					// If not updating and the key is not changing, we must visit the records to add them to the output
@@ -6083,6 +6502,7 @@ private:
 							}
 
 							btPage->kvBytes -= cursor.get().kvBytes();
+							self->freeExternalValue(cursor.get(), writeVersion);
 							cursor.erase();
 						} else {
 							merged.push_back(merged.arena(), cursor.get());
@@ -6142,6 +6562,10 @@ private:
 				return Void();
 			}
 
+			if (self->m_valueSeparationThreshold > 0) {
+				wait(writeExternalValues(self, &merged));
+			}
+
 			// Rebuild new page(s).
 			state Standalone<VectorRef<RedwoodRecordRef>> entries = wait(writePages(
 			    self, &update->subtreeLowerBound, &update->subtreeUpperBound, merged, height, writeVersion, rootID));
@@ -6229,8 +6653,10 @@ private:
 					bool uniform;
 					if (range.clearAfterBoundary) {
 						// If the mutation range after the boundary key is cleared, then the mutation boundary key must
-						// be cleared or must be different than the subtree lower bound key so that it doesn't matter
-						uniform = range.boundaryCleared() || mutationBoundaryKey != u.subtreeLowerBound.key;
+						// be cleared or must be different than the subtree lower bound key so that it doesn't matter.
+						// The range must also not have sorted records to write, which are written by the leaves.
+						uniform = (range.boundaryCleared() || mutationBoundaryKey != u.subtreeLowerBound.key) &&
+						          range.sortedRecords.empty();
 					} else {
 						// If the mutation range after the boundary key is unchanged, then the mutation boundary key
 						// must be also unchanged or must be different than the subtree lower bound key so that it
@@ -6285,7 +6711,9 @@ private:
 							while (c != u.cEnd) {
 								RedwoodRecordRef rec = c.get();
 								if (rec.value.present()) {
-									if (height == 2) {
+									// Leaves must be read to free any values stored outside of the tree, so they
+									// can only be freed directly if there are none
+									if (height == 2 && !self->m_pHeader->externalValues()) {
 										debug_printf("%s: freeing child page in cleared subtree range: %s\n",
 										             context.c_str(),
 										             ::toString(rec.getChildPage()).c_str());
@@ -6580,7 +7008,7 @@ private:
 		}
 
 		debug_printf("new root %s\n", toString(rootPageID).c_str());
-		self->m_pHeader->root.set(rootPageID, self->m_headerSpace - sizeof(MetaKey));
+		self->m_pHeader->setRoot(rootPageID, self->m_headerSpace - sizeof(MetaKey));
 
 		self->m_lazyClearStop = true;
 		wait(success(self->m_lazyClearActor));
@@ -6666,6 +7094,24 @@ public:
 
 		const RedwoodRecordRef get() { return path.back().cursor.get(); }
 
+		// Get up to maxLength bytes of the current record's value, which might be stored outside of the tree
+		Future<Value> getValue(int maxLength = std::numeric_limits<int>::max()) {
+			RedwoodRecordRef rec = get();
+			if (rec.externalValue) {
+				return readExternalValue(rec, maxLength);
+			}
+			Value v;
+			v.arena().dependsOn(path.back().page->getArena());
+			v.contents() = rec.value.get().substr(0, std::min(rec.value.get().size(), maxLength));
+			return v;
+		}
+
+		// Read up to maxLength bytes of the value of rec, a leaf record read with this cursor whose value is stored
+		// outside of the tree
+		Future<Value> readExternalValue(const RedwoodRecordRef& rec, int maxLength = std::numeric_limits<int>::max()) {
+			return readExternalValue_impl(pager, reason, btree->m_blockSize, rec, maxLength);
+		}
+
 		bool inRoot() const { return path.size() == 1; }
 
 		// To enable more efficient range scans, caller can read the lowest page
@@ -6992,11 +7438,40 @@ public:
 
 	Future<Void> commit(bool sequential = false) override {
 		Future<Void> c = m_tree->commit();
-		m_tree->setOldestVersion(m_tree->getLatestVersion());
+		m_tree->setOldestVersion(oldestRetainedBTreeVersion());
 		m_tree->setWriteVersion(m_tree->getWriteVersion() + 1);
 		return catchError(c);
 	}
 
+	bool canRetainSnapshots() const override { return true; }
+
+	void setCommitVersion(Version version, Version oldestRetainedVersion) override {
+		// The commit being labelled is the one at the current write version, which is not readable until it completes
+		m_retainedVersions[version] = m_tree->getWriteVersion();
+		m_retainedVersions.erase(m_retainedVersions.begin(), m_retainedVersions.lower_bound(oldestRetainedVersion));
+	}
+
+	bool retainsSnapshot(Version version) const override { return retainedBTreeVersion(version).present(); }
+
+	Future<Optional<Value>> readValueAt(KeyRef key, Version version, Optional<UID> debugID = Optional<UID>()) override {
+		Optional<Version> v = retainedBTreeVersion(version);
+		if (!v.present()) {
+			return transaction_too_old();
+		}
+		return catchError(readValue_impl(this, key, v.get(), std::numeric_limits<int>::max(), debugID));
+	}
+
+	Future<RangeResult> readRangeAt(KeyRangeRef keys,
+	                                Version version,
+	                                int rowLimit = 1 << 30,
+	                                int byteLimit = 1 << 30) override {
+		Optional<Version> v = retainedBTreeVersion(version);
+		if (!v.present()) {
+			return transaction_too_old();
+		}
+		return catchError(readRange_impl(this, keys, v.get(), rowLimit, byteLimit));
+	}
+
 	KeyValueStoreType getType() const override { return KeyValueStoreType::SSD_REDWOOD_V1; }
 
 	StorageBytes getStorageBytes() const override { return m_tree->getStorageBytes(); }
@@ -7013,24 +7488,83 @@ public:
 		m_tree->set(keyValue);
 	}
 
+	bool canSetSortedRange() const override { return true; }
+
+	void setSortedRange(KeyRangeRef range, VectorRef<KeyValueRef> kvs, const Arena* arena = nullptr) override {
+		debug_printf("SETSORTEDRANGE %s %d records\n", printable(range).c_str(), kvs.size());
+		m_tree->setSortedRange(range, kvs);
+	}
+
 	Future<RangeResult> readRange(KeyRangeRef keys, int rowLimit = 1 << 30, int byteLimit = 1 << 30) override {
 		debug_printf("READRANGE %s\n", printable(keys).c_str());
-		return catchError(readRange_impl(this, keys, rowLimit, byteLimit));
+		return catchError(readRange_impl(this, keys, m_tree->getLastCommittedVersion(), rowLimit, byteLimit));
 	}
 
+	// Keeps its BTreeCursor between reads, so that a forward read beginning where the last one ended continues from
+	// the leaf it stopped in instead of seeking from the root.  The BTreeCursor reads the version that was committed
+	// when it was initialized, which may not stay readable, so it is initialized again once another commit completes.
+	class Cursor final : public IKeyValueCursor {
+	public:
+		explicit Cursor(KeyValueStoreRedwoodUnversioned* store) : store(store) {}
+
+		Future<RangeResult> readRange(KeyRangeRef keys, int rowLimit = 1 << 30, int byteLimit = 1 << 30) override {
+			debug_printf("CURSORREADRANGE %s\n", printable(keys).c_str());
+			return store->catchError(readRange_impl(store,
+			                                        keys,
+			                                        store->m_tree->getLastCommittedVersion(),
+			                                        rowLimit,
+			                                        byteLimit,
+			                                        Reference<Cursor>::addRef(this)));
+		}
+
+		KeyValueStoreRedwoodUnversioned* store;
+		VersionedBTree::BTreeCursor btreeCursor;
+		Version btreeVersion = invalidVersion;
+		// btreeCursor is at the first record at or after resumeKey, or at the record before it if onLastRow.  The
+		// position is unknown if resumeKey is absent.
+		Optional<Key> resumeKey;
+		bool onLastRow = false;
+	};
+
+	Reference<IKeyValueCursor> openCursor() override { return makeReference<Cursor>(this); }
+
+	// Reads keys at btreeVersion, with the BTreeCursor of cursor if it is given
 	ACTOR static Future<RangeResult> readRange_impl(KeyValueStoreRedwoodUnversioned* self,
 	                                                KeyRange keys,
+	                                                Version btreeVersion,
 	                                                int rowLimit,
-	                                                int byteLimit) {
-		state VersionedBTree::BTreeCursor cur;
-		wait(
-		    self->m_tree->initBTreeCursor(&cur, self->m_tree->getLastCommittedVersion(), PagerEventReasons::RangeRead));
+	                                                int byteLimit,
+	                                                Reference<Cursor> cursor = Reference<Cursor>()) {
+		state VersionedBTree::BTreeCursor localCursor;
+		state VersionedBTree::BTreeCursor* cur = cursor ? &cursor->btreeCursor : &localCursor;
+		state Optional<Key> resumeKey;
+		if (cursor) {
+			std::swap(resumeKey, cursor->resumeKey);
+		}
+		if (!cursor || cursor->btreeVersion != btreeVersion) {
+			resumeKey.reset();
+			wait(self->m_tree->initBTreeCursor(cur, btreeVersion, PagerEventReasons::RangeRead));
+			if (cursor) {
+				cursor->btreeVersion = btreeVersion;
+			}
+		}
 
 		state PriorityMultiLock::Lock lock = wait(self->m_concurrentReads.lock());
 		++g_redwoodMetrics.metric.opGetRange;
 
+		// A forward read continues without seeking if cur is already at the first record at or after keys.begin
+		state bool positioned = false;
+		if (rowLimit > 0 && resumeKey.present() && resumeKey.get() <= keys.begin) {
+			if (cursor->onLastRow) {
+				wait(cur->moveNext());
+			}
+			positioned = cur->isValid() ? cur->get().key >= keys.begin : true;
+		}
+
 		state RangeResult result;
 		state int accumulatedBytes = 0;
+		// Reads of values stored outside of the tree, by index in result
+		state std::vector<std::pair<int, Future<Value>>> externalValues;
 		ASSERT(byteLimit > 0);
 
 		if (rowLimit == 0) {
@@ -7038,15 +7572,17 @@ public:
 		}
 
 		if (rowLimit > 0) {
-			wait(cur.seekGTE(keys.begin));
+			if (!positioned) {
+				wait(cur->seekGTE(keys.begin));
+			}
 
 			if (self->prefetch) {
-				cur.prefetch(keys.end, true, rowLimit, byteLimit);
+				cur->prefetch(keys.end, true, rowLimit, byteLimit);
 			}
 
-			while (cur.isValid()) {
+			while (cur->isValid()) {
 				// Read page contents without using waits
-				BTreePage::BinaryTree::Cursor leafCursor = cur.back().cursor;
+				BTreePage::BinaryTree::Cursor leafCursor = cur->back().cursor;
 
 				// we can bypass the bounds check for each key in the leaf if the entire leaf is in range
 				// > because both query end and page upper bound are exclusive of the query results and page contents,
@@ -7056,12 +7592,19 @@ public:
 				bool usedPage = false;
 
 				while (leafCursor.valid()) {
-					KeyValueRef kv = leafCursor.get().toKeyValueRef();
-					if (checkBounds && kv.key.compare(keys.end) >= 0) {
+					RedwoodRecordRef rec = leafCursor.get();
+					if (checkBounds && rec.key.compare(keys.end) >= 0) {
 						break;
 					}
-					accumulatedBytes += kv.expectedSize();
-					result.push_back(result.arena(), kv);
+					if (rec.externalValue) {
+						externalValues.push_back(std::make_pair(result.size(), cur->readExternalValue(rec)));
+						accumulatedBytes += rec.key.expectedSize() + rec.externalValueSize();
+						result.push_back(result.arena(), KeyValueRef(rec.key, ValueRef()));
+					} else {
+						KeyValueRef kv = rec.toKeyValueRef();
+						accumulatedBytes += kv.expectedSize();
+						result.push_back(result.arena(), kv);
+					}
 					usedPage = true;
 					if (--rowLimit == 0 || accumulatedBytes >= byteLimit) {
 						break;
@@ -7073,27 +7616,34 @@ public:
 				// This must be done after visiting all the results in case the Mirror arena changes.
 				if (usedPage) {
 					result.arena().dependsOn(leafCursor.cache->arena);
-					result.arena().dependsOn(cur.back().page->getArena());
+					result.arena().dependsOn(cur->back().page->getArena());
 				}
 
 				// Stop if the leaf cursor is still valid which means we hit a key or size limit or
 				// if the cursor is in the root page, in which case there are no more pages.
-				if (leafCursor.valid() || cur.inRoot()) {
+				if (leafCursor.valid() || cur->inRoot()) {
+					// A cursor is left on the last row returned if a limit was hit, and otherwise on the first record
+					// at or after keys.end
+					if (cursor && leafCursor.valid()) {
+						cur->back().cursor = leafCursor;
+						cursor->onLastRow = rowLimit == 0 || accumulatedBytes >= byteLimit;
+						cursor->resumeKey = cursor->onLastRow ? keyAfter(result.back().key) : Key(keys.end);
+					}
 					break;
 				}
-				cur.popPath();
-				wait(cur.moveNext());
+				cur->popPath();
+				wait(cur->moveNext());
 			}
 		} else {
-			wait(cur.seekLT(keys.end));
+			wait(cur->seekLT(keys.end));
 
 			if (self->prefetch) {
-				cur.prefetch(keys.begin, false, -rowLimit, byteLimit);
+				cur->prefetch(keys.begin, false, -rowLimit, byteLimit);
 			}
 
-			while (cur.isValid()) {
+			while (cur->isValid()) {
 				// Read page contents without using waits
-				BTreePage::BinaryTree::Cursor leafCursor = cur.back().cursor;
+				BTreePage::BinaryTree::Cursor leafCursor = cur->back().cursor;
 
 				// we can bypass the bounds check for each key in the leaf if the entire leaf is in range
 				// < because both query begin and page lower bound are inclusive of the query results and page contents,
@@ -7103,12 +7653,19 @@ public:
 				bool usedPage = false;
 
 				while (leafCursor.valid()) {
-					KeyValueRef kv = leafCursor.get().toKeyValueRef();
-					if (checkBounds && kv.key.compare(keys.begin) < 0) {
+					RedwoodRecordRef rec = leafCursor.get();
+					if (checkBounds && rec.key.compare(keys.begin) < 0) {
 						break;
 					}
-					accumulatedBytes += kv.expectedSize();
-					result.push_back(result.arena(), kv);
+					if (rec.externalValue) {
+						externalValues.push_back(std::make_pair(result.size(), cur->readExternalValue(rec)));
+						accumulatedBytes += rec.key.expectedSize() + rec.externalValueSize();
+						result.push_back(result.arena(), KeyValueRef(rec.key, ValueRef()));
+					} else {
+						KeyValueRef kv = rec.toKeyValueRef();
+						accumulatedBytes += kv.expectedSize();
+						result.push_back(result.arena(), kv);
+					}
 					usedPage = true;
 					if (++rowLimit == 0 || accumulatedBytes >= byteLimit) {
 						break;
@@ -7120,19 +7677,26 @@ public:
 				// This must be done after visiting all the results in case the Mirror arena changes.
 				if (usedPage) {
 					result.arena().dependsOn(leafCursor.cache->arena);
-					result.arena().dependsOn(cur.back().page->getArena());
+					result.arena().dependsOn(cur->back().page->getArena());
 				}
 
 				// Stop if the leaf cursor is still valid which means we hit a key or size limit or
 				// if we started in the root page
-				if (leafCursor.valid() || cur.inRoot()) {
+				if (leafCursor.valid() || cur->inRoot()) {
 					break;
 				}
-				cur.popPath();
-				wait(cur.movePrev());
+				cur->popPath();
+				wait(cur->movePrev());
 			}
 		}
 
+		state int i;
+		for (i = 0; i < externalValues.size(); ++i) {
+			Value v = wait(externalValues[i].second);
+			result[externalValues[i].first].value = v;
+			result.arena().dependsOn(v.arena());
+		}
+
 		result.more = rowLimit == 0 || accumulatedBytes >= byteLimit;
 		if (result.more) {
 			ASSERT(result.size() > 0);
@@ -7144,21 +7708,20 @@ public:
 
 	ACTOR static Future<Optional<Value>> readValue_impl(KeyValueStoreRedwoodUnversioned* self,
 	                                                    Key key,
+	                                                    Version btreeVersion,
+	                                                    int maxLength,
 	                                                    Optional<UID> debugID) {
 		state VersionedBTree::BTreeCursor cur;
-		wait(
-		    self->m_tree->initBTreeCursor(&cur, self->m_tree->getLastCommittedVersion(), PagerEventReasons::PointRead));
+		wait(self->m_tree->initBTreeCursor(&cur, btreeVersion, PagerEventReasons::PointRead));
 
 		state PriorityMultiLock::Lock lock = wait(self->m_concurrentReads.lock());
 		++g_redwoodMetrics.metric.opGet;
 
 		wait(cur.seekGTE(key));
 		if (cur.isValid() && cur.get().key == key) {
-			// Return a Value whose arena depends on the source page arena
-			Value v;
-			v.arena().dependsOn(cur.back().page->getArena());
-			v.contents() = cur.get().value.get();
-			g_redwoodMetrics.kvSizeReadByGet->sample(cur.get().kvBytes());
+			// Only the part of a value stored outside of the tree that is needed is read
+			Value v = wait(cur.getValue(maxLength));
+			g_redwoodMetrics.kvSizeReadByGet->sample(key.expectedSize() + v.expectedSize());
 			return v;
 		}
 
@@ -7166,18 +7729,14 @@ public:
 	}
 
 	Future<Optional<Value>> readValue(KeyRef key, Optional<UID> debugID = Optional<UID>()) override {
-		return catchError(readValue_impl(this, key, debugID));
+		return catchError(
+		    readValue_impl(this, key, m_tree->getLastCommittedVersion(), std::numeric_limits<int>::max(), debugID));
 	}
 
 	Future<Optional<Value>> readValuePrefix(KeyRef key,
 	                                        int maxLength,
 	                                        Optional<UID> debugID = Optional<UID>()) override {
-		return catchError(map(readValue_impl(this, key, debugID), [maxLength](Optional<Value> v) {
-			if (v.present() && v.get().size() > maxLength) {
-				v.get().contents() = v.get().substr(0, maxLength);
-			}
-			return v;
-		}));
+		return catchError(readValue_impl(this, key, m_tree->getLastCommittedVersion(), maxLength, debugID));
 	}
 
 	~KeyValueStoreRedwoodUnversioned() override{};
@@ -7190,6 +7749,25 @@ private:
 	Promise<Void> m_error;
 	PriorityMultiLock m_concurrentReads;
 	bool prefetch;
+	// Commits labelled by setCommitVersion() which are kept readable, as a map of label to BTree version
+	std::map<Version, Version> m_retainedVersions;
+
+	Optional<Version> retainedBTreeVersion(Version version) const {
+		auto i = m_retainedVersions.find(version);
+		if (i == m_retainedVersions.end() || i->second > m_tree->getLastCommittedVersion()) {
+			return Optional<Version>();
+		}
+		return i->second;
+	}
+
+	// The BTree keeps the commit being made and every retained commit after it
+	Version oldestRetainedBTreeVersion() const {
+		Version v = m_tree->getLatestVersion();
+		if (!m_retainedVersions.empty()) {
+			v = std::min(v, m_retainedVersions.begin()->second);
+		}
+		return v;
+	}
 
 	template <typename T>
 	inline Future<T> catchError(Future<T> f) {
@@ -7279,6 +7857,7 @@ ACTOR Future<int> verifyRangeBTreeCursor(VersionedBTree* btree,
 	wait(cur.seekGTE(start));
 
 	state Standalone<VectorRef<KeyValueRef>> results;
+	state Value treeValue;
 
 	while (cur.isValid() && cur.get().key < end) {
 		// Find the next written kv pair that would be present at this version
@@ -7321,7 +7900,9 @@ ACTOR Future<int> verifyRangeBTreeCursor(VersionedBTree* btree,
 			       iLast->first.first.c_str());
 			break;
 		}
-		if (cur.get().value.get() != iLast->second.get()) {
+		Value value = wait(cur.getValue());
+		treeValue = value;
+		if (treeValue != iLast->second.get()) {
 			++errors;
 			++*pErrorCount;
 			printf("VerifyRange(@%" PRId64 ", %s, %s) ERROR: Tree key '%s' has tree value '%s' but expected '%s'\n",
@@ -7329,16 +7910,17 @@ ACTOR Future<int> verifyRangeBTreeCursor(VersionedBTree* btree,
 			       start.printable().c_str(),
 			       end.printable().c_str(),
 			       cur.get().key.toString().c_str(),
-			       cur.get().value.get().toString().c_str(),
+			       treeValue.toString().c_str(),
 			       iLast->second.get().c_str());
 			break;
 		}
 
 		ASSERT(errors == 0);
 
-		results.push_back(results.arena(), cur.get().toKeyValueRef());
+		results.push_back(results.arena(), KeyValueRef(cur.get().key, treeValue));
 		results.arena().dependsOn(cur.back().cursor.cache->arena);
 		results.arena().dependsOn(cur.back().page->getArena());
+		results.arena().dependsOn(treeValue.arena());
 
 		wait(cur.moveNext());
 	}
@@ -7403,7 +7985,9 @@ ACTOR Future<int> verifyRangeBTreeCursor(VersionedBTree* btree,
 			       r->key.toString().c_str());
 			break;
 		}
-		if (cur.get().value.get() != r->value) {
+		Value value = wait(cur.getValue());
+		treeValue = value;
+		if (treeValue != r->value) {
 			++errors;
 			++*pErrorCount;
 			printf("VerifyRangeReverse(@%" PRId64
@@ -7412,7 +7996,7 @@ ACTOR Future<int> verifyRangeBTreeCursor(VersionedBTree* btree,
 			       start.printable().c_str(),
 			       end.printable().c_str(),
 			       cur.get().key.toString().c_str(),
-			       cur.get().value.get().toString().c_str(),
+			       treeValue.toString().c_str(),
 			       r->value.toString().c_str());
 			break;
 		}
@@ -7454,11 +8038,16 @@ ACTOR Future<int> seekAllBTreeCursor(VersionedBTree* btree,
 			debug_printf("Verifying @%" PRId64 " '%s'\n", ver, key.c_str());
 			state Arena arena;
 			wait(cur.seekGTE(RedwoodRecordRef(KeyRef(arena, key))));
-			bool foundKey = cur.isValid() && cur.get().key == key;
-			bool hasValue = foundKey && cur.get().value.present();
+			state bool foundKey = cur.isValid() && cur.get().key == key;
+			state bool hasValue = foundKey && cur.get().value.present();
+			state Value treeValue;
+			if (hasValue) {
+				Value value = wait(cur.getValue());
+				treeValue = value;
+			}
 
 			if (val.present()) {
-				bool valueMatch = hasValue && cur.get().value.get() == val.get();
+				bool valueMatch = hasValue && treeValue == val.get();
 				if (!foundKey || !hasValue || !valueMatch) {
 					++errors;
 					++*pErrorCount;
@@ -7475,7 +8064,7 @@ ACTOR Future<int> seekAllBTreeCursor(VersionedBTree* btree,
 					} else if (!valueMatch) {
 						printf("Verify ERROR: value_incorrect: for '%s' found '%s' expected '%s' @%" PRId64 "\n",
 						       key.c_str(),
-						       cur.get().value.get().toString().c_str(),
+						       treeValue.toString().c_str(),
 						       val.get().c_str(),
 						       ver);
 					}
@@ -7485,7 +8074,7 @@ ACTOR Future<int> seekAllBTreeCursor(VersionedBTree* btree,
 				++*pErrorCount;
 				printf("Verify ERROR: cleared_key_found: '%s' -> '%s' @%" PRId64 "\n",
 				       key.c_str(),
-				       cur.get().value.get().toString().c_str(),
+				       treeValue.toString().c_str(),
 				       ver);
 			}
 		}
@@ -8844,6 +9433,8 @@ TEST_CASE("/redwood/correctness/btree") {
 	    params.getDouble("clearSingleKeyProbability").orDefault(deterministicRandom()->random01());
 	state double clearPostSetProbability =
 	    params.getDouble("clearPostSetProbability").orDefault(deterministicRandom()->random01() * .1);
+	state double sortedRangeProbability =
+	    params.getDouble("sortedRangeProbability").orDefault(deterministicRandom()->random01());
 	state double coldStartProbability =
 	    params.getDouble("coldStartProbability").orDefault(pagerMemoryOnly ? 0 : (deterministicRandom()->random01()));
 	state double advanceOldVersionProbability =
@@ -8860,6 +9451,10 @@ TEST_CASE("/redwood/correctness/btree") {
 	state int maxVerificationMapEntries = params.getInt("maxVerificationMapEntries").orDefault(300e3);
 	state int concurrentExtentReads =
 	    params.getInt("concurrentExtentReads").orDefault(SERVER_KNOBS->REDWOOD_EXTENT_CONCURRENT_READS);
+	state int valueSeparationThreshold = params.getInt("valueSeparationThreshold")
+	                                         .orDefault(deterministicRandom()->coinflip()
+	                                                        ? 0
+	                                                        : deterministicRandom()->randomInt(1, pageSize * 2));
 
 	printf("\n");
 	printf("targetPageOps: %" PRId64 "\n", targetPageOps);
@@ -8874,12 +9469,14 @@ TEST_CASE("/redwood/correctness/btree") {
 	printf("clearProbability: %f\n", clearProbability);
 	printf("clearSingleKeyProbability: %f\n", clearSingleKeyProbability);
 	printf("clearPostSetProbability: %f\n", clearPostSetProbability);
+	printf("sortedRangeProbability: %f\n", sortedRangeProbability);
 	printf("coldStartProbability: %f\n", coldStartProbability);
 	printf("advanceOldVersionProbability: %f\n", advanceOldVersionProbability);
 	printf("cacheSizeBytes: %s\n", cacheSizeBytes == 0 ? "default" : format("%" PRId64, cacheSizeBytes).c_str());
 	printf("versionIncrement: %" PRId64 "\n", versionIncrement);
 	printf("remapCleanupWindow: %" PRId64 "\n", remapCleanupWindow);
 	printf("maxVerificationMapEntries: %d\n", maxVerificationMapEntries);
+	printf("valueSeparationThreshold: %d\n", valueSeparationThreshold);
 	printf("\n");
 
 	printf("Deleting existing test data...\n");
@@ -8888,7 +9485,8 @@ TEST_CASE("/redwood/correctness/btree") {
 	printf("Initializing...\n");
 	pager = new DWALPager(
 	    pageSize, extentSize, fileName, cacheSizeBytes, remapCleanupWindow, concurrentExtentReads, pagerMemoryOnly);
-	state VersionedBTree* btree = new VersionedBTree(pager, fileName);
+	state VersionedBTree* btree =
+	    new VersionedBTree(pager, fileName, SERVER_KNOBS->REDWOOD_PAGE_BUILD_THREADS, valueSeparationThreshold);
 	wait(btree->init());
 
 	state std::map<std::pair<std::string, Version>, Optional<std::string>> written;
@@ -8985,7 +9583,43 @@ TEST_CASE("/redwood/correctness/btree") {
 				}
 			}
 
-			btree->clear(range);
+			// Sometimes replace the cleared range's contents with sorted records instead of just clearing it
+			if (deterministicRandom()->random01() < sortedRangeProbability) {
+				std::set<Key> sortedKeys;
+				int count = deterministicRandom()->randomInt(0, 100);
+				for (int i = 0; i < count; ++i) {
+					// Keys starting with the range begin, including the begin key itself, are in the range if they
+					// are less than the range end
+					Key k = range.begin.withSuffix(
+					    deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(0, 5)));
+					if (k < range.end) {
+						sortedKeys.insert(k);
+					}
+				}
+
+				Standalone<VectorRef<KeyValueRef>> kvs;
+				for (auto& k : sortedKeys) {
+					KeyValue kv = randomKV(0, maxValueSize);
+					kvs.push_back_deep(kvs.arena(), KeyValueRef(k, kv.value));
+					debug_printf("      Mutation:  Set '%s' -> '%s' @%" PRId64 " [sorted range]\n",
+					             k.toString().c_str(),
+					             kv.value.toString().c_str(),
+					             version);
+
+					++sets;
+					keyBytesInserted += k.size();
+					valueBytesInserted += kv.value.size();
+					mutationBytes += (k.size() + kv.value.size());
+					mutationBytesThisCommit += (k.size() + kv.value.size());
+
+					written[std::make_pair(k.toString(), version)] = kv.value.toString();
+					keys.insert(k);
+				}
+
+				btree->setSortedRange(range, kvs);
+			} else {
+				btree->clear(range);
+			}
 
 			// Sometimes set the range start after the clear
 			if (deterministicRandom()->random01() < clearPostSetProbability) {
@@ -9095,7 +9729,8 @@ TEST_CASE("/redwood/correctness/btree") {
 				printf("Reopening btree from disk.\n");
 				IPager2* pager = new DWALPager(
 				    pageSize, extentSize, fileName, cacheSizeBytes, remapCleanupWindow, concurrentExtentReads);
-				btree = new VersionedBTree(pager, fileName);
+				btree = new VersionedBTree(
+				    pager, fileName, SERVER_KNOBS->REDWOOD_PAGE_BUILD_THREADS, valueSeparationThreshold);
 				wait(btree->init());
 
 				Version v = btree->getLatestVersion();
@@ -9137,7 +9772,9 @@ TEST_CASE("/redwood/correctness/btree") {
 	btree->close();
 	wait(closedFuture);
 	btree = new VersionedBTree(new DWALPager(pageSize, extentSize, fileName, cacheSizeBytes, 0, concurrentExtentReads),
-	                           fileName);
+	                           fileName,
+	                           SERVER_KNOBS->REDWOOD_PAGE_BUILD_THREADS,
+	                           valueSeparationThreshold);
 	wait(btree->init());
 
 	wait(btree->clearAllAndCheckSanity());
@@ -9438,6 +10075,7 @@ TEST_CASE(":/redwood/performance/set") {
 	state int scanPrefetchBytes = params.getInt("scanPrefetchBytes").orDefault(0);
 	state bool pagerMemoryOnly = params.getInt("pagerMemoryOnly").orDefault(0);
 	state bool traceMetrics = params.getInt("traceMetrics").orDefault(0);
+	state int pageBuildThreads = params.getInt("pageBuildThreads").orDefault(SERVER_KNOBS->REDWOOD_PAGE_BUILD_THREADS);
 
 	printf("pagerMemoryOnly: %d\n", pagerMemoryOnly);
 	printf("pageSize: %d\n", pageSize);
@@ -9464,6 +10102,7 @@ TEST_CASE(":/redwood/performance/set") {
 	printf("fileName: %s\n", fileName.c_str());
 	printf("openExisting: %d\n", openExisting);
 	printf("insertRecords: %d\n", insertRecords);
+	printf("pageBuildThreads: %d\n", pageBuildThreads);
 
 	// If using stdout for metrics, prevent trace event metrics logger from starting
 	if (!traceMetrics) {
@@ -9478,7 +10117,7 @@ TEST_CASE(":/redwood/performance/set") {
 
 	DWALPager* pager = new DWALPager(
 	    pageSize, extentSize, fileName, pageCacheBytes, remapCleanupWindow, concurrentExtentReads, pagerMemoryOnly);
-	state VersionedBTree* btree = new VersionedBTree(pager, fileName);
+	state VersionedBTree* btree = new VersionedBTree(pager, fileName, pageBuildThreads);
 	wait(btree->init());
 	printf("Initialized.  StorageBytes=%s\n", btree->getStorageBytes().toString().c_str());
 
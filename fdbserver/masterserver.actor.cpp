@@ -1171,7 +1171,20 @@ ACTOR Future<Void> getVersion(Reference<MasterData> self, GetCommitVersionReques
 
 			bool maxVersionGap = self->version - rep.prevVersion == SERVER_KNOBS->MAX_READ_TRANSACTION_LIFE_VERSIONS;
 			TEST(maxVersionGap); // Maximum possible version gap
-			self->lastVersionTime = t1;
+			// lastVersionTime is ahead of now() while a version lease is outstanding
+			self->lastVersionTime = std::max(self->lastVersionTime, t1);
+
+			if (SERVER_KNOBS->COMMIT_VERSION_LEASE_VERSIONS > 0) {
+				// Lease the next versions to the proxy, which assigns them to its own batches until the lease expires
+				// at the time the master would otherwise have reached leaseEnd. Other proxies get versions after it.
+				TEST(true); // Commit version lease granted
+				rep.leaseEnd = self->version + SERVER_KNOBS->COMMIT_VERSION_LEASE_VERSIONS;
+				self->lastVersionTime +=
+				    SERVER_KNOBS->COMMIT_VERSION_LEASE_VERSIONS / double(SERVER_KNOBS->VERSIONS_PER_SECOND);
+				rep.leaseDuration = self->lastVersionTime - t1;
+				rep.version = self->version;
+				self->version = rep.leaseEnd;
+			}
 
 			if (self->resolverNeedingChanges.count(req.requestingProxy)) {
 				rep.resolverChanges = self->resolverChanges.get();
@@ -1183,7 +1196,9 @@ ACTOR Future<Void> getVersion(Reference<MasterData> self, GetCommitVersionReques
 			}
 		}
 
-		rep.version = self->version;
+		if (rep.leaseEnd == invalidVersion) {
+			rep.version = self->version;
+		}
 		rep.requestNum = req.requestNum;
 
 		proxyItr->second.replies.erase(proxyItr->second.replies.begin(),
@@ -187,6 +187,8 @@ struct StorageServerDisk {
 
 	void writeMutation(MutationRef mutation);
 	void writeKeyValue(KeyValueRef kv);
+	void writeSortedRange(KeyRangeRef keys, VectorRef<KeyValueRef> kvs, const Arena& arena);
+	bool canWriteSortedRange() const { return storage->canSetSortedRange(); }
 	void clearRange(KeyRangeRef keys);
 
 	Future<Void> getError() { return storage->getError(); }
@@ -204,9 +206,30 @@ struct StorageServerDisk {
 	Future<RangeResult> readRange(KeyRangeRef keys, int rowLimit = 1 << 30, int byteLimit = 1 << 30) {
 		return storage->readRange(keys, rowLimit, byteLimit);
 	}
+	Future<std::vector<Optional<Value>>> readValuePrefixes(std::vector<std::pair<KeyRef, int>> const& keys) {
+		return storage->readValuePrefixes(keys);
+	}
+	Future<std::vector<RangeResult>> readRanges(std::vector<KeyRangeRef> const& ranges, int rowLimit = 1 << 30) {
+		return storage->readRanges(ranges, rowLimit);
+	}
+	Reference<IKeyValueCursor> openCursor() { return storage->openCursor(); }
+
+	bool canRetainSnapshots() const { return storage->canRetainSnapshots(); }
+	void setCommitVersion(Version version, Version oldestRetainedVersion) {
+		storage->setCommitVersion(version, oldestRetainedVersion);
+	}
+	bool retainsSnapshot(Version version) const { return storage->retainsSnapshot(version); }
+	Future<Optional<Value>> readValueAt(KeyRef key, Version version, Optional<UID> debugID = Optional<UID>()) {
+		return storage->readValueAt(key, version, debugID);
+	}
+	Future<RangeResult> readRangeAt(KeyRangeRef keys, Version version, int rowLimit, int byteLimit) {
+		return storage->readRangeAt(keys, version, rowLimit, byteLimit);
+	}
 
 	KeyValueStoreType getKeyValueStoreType() const { return storage->getType(); }
 	StorageBytes getStorageBytes() const { return storage->getStorageBytes(); }
+	int64_t getPendingCompactionBytes() const { return storage->getPendingCompactionBytes(); }
+	Optional<KeyValueStoreEngineStats> getEngineStats() const { return storage->getEngineStats(); }
 	std::tuple<size_t, size_t, size_t> getSize() const { return storage->getSize(); }
 
 private:
@@ -586,6 +609,12 @@ public:
 	CoalescedKeyRangeMap<Version> newestDirtyVersion; // Similar to newestAvailableVersion, but includes (only) keys
 	                                                  // that were only partly available (due to cancelled fetchKeys)
 
+	// readableSinceVersion[k]
+	//   == latestVersion  -> k is not readable from retained snapshots
+	//   == v              -> k has been continuously available since v, so retained snapshots at versions >= v
+	//   hold all of its data
+	CoalescedKeyRangeMap<Version> readableSinceVersion;
+
 	// The following are in rough order from newest to oldest
 	Version lastTLogVersion, lastVersionWithData, restoredVersion;
 	NotifiedVersion version;
@@ -732,8 +761,9 @@ public:
 
 	struct Counters {
 		CounterCollection cc;
-		Counter allQueries, getKeyQueries, getValueQueries, getRangeQueries, getRangeStreamQueries, finishedQueries,
-		    lowPriorityQueries, rowsQueried, bytesQueried, watchQueries, emptyQueries;
+		Counter allQueries, getKeyQueries, getValueQueries, getRangeQueries, getRangeStreamQueries,
+		    getRangeAggregateQueries, finishedQueries, lowPriorityQueries, rowsQueried, bytesQueried, watchQueries,
+		    emptyQueries;
 
 		// Bytes of the mutations that have been added to the memory of the storage server. When the data is durable
 		// and cleared from the memory, we do not subtract it but add it to bytesDurable.
@@ -766,7 +796,8 @@ public:
 		Counters(StorageServer* self)
 		  : cc("StorageServer", self->thisServerID.toString()), getKeyQueries("GetKeyQueries", cc),
 		    getValueQueries("GetValueQueries", cc), getRangeQueries("GetRangeQueries", cc),
-		    getRangeStreamQueries("GetRangeStreamQueries", cc), allQueries("QueryQueue", cc),
+		    getRangeStreamQueries("GetRangeStreamQueries", cc),
+		    getRangeAggregateQueries("GetRangeAggregateQueries", cc), allQueries("QueryQueue", cc),
 		    finishedQueries("FinishedQueries", cc), lowPriorityQueries("LowPriorityQueries", cc),
 		    rowsQueried("RowsQueried", cc), bytesQueried("BytesQueried", cc), watchQueries("WatchQueries", cc),
 		    emptyQueries("EmptyQueries", cc), bytesInput("BytesInput", cc), bytesDurable("BytesDurable", cc),
@@ -802,6 +833,8 @@ public:
 			specialCounter(cc, "KvstoreSizeTotal", [self]() { return std::get<0>(self->storage.getSize()); });
 			specialCounter(cc, "KvstoreNodeTotal", [self]() { return std::get<1>(self->storage.getSize()); });
 			specialCounter(cc, "KvstoreInlineKey", [self]() { return std::get<2>(self->storage.getSize()); });
+			specialCounter(
+			    cc, "KvstorePendingCompactionBytes", [self]() { return self->storage.getPendingCompactionBytes(); });
 		}
 	} counters;
 
@@ -850,6 +883,7 @@ public:
 
 		newestAvailableVersion.insert(allKeys, invalidVersion);
 		newestDirtyVersion.insert(allKeys, invalidVersion);
+		readableSinceVersion.insert(allKeys, latestVersion);
 		addShard(ShardInfo::newNotAssigned(allKeys));
 
 		cx = openDBOnServer(db, TaskPriority::DefaultEndpoint, LockAware::True);
@@ -1194,6 +1228,16 @@ Future<Version> waitForVersion(StorageServer* data, Version version, SpanID span
 	return waitForVersionActor(data, version, spanContext);
 }
 
+// Like waitForVersion(), but also accepts a version older than the versioned data if the storage engine retains the
+// snapshot it made durable at exactly that version (see STORAGE_SNAPSHOT_RETENTION_VERSIONS)
+Future<Version> waitForVersionOrRetainedSnapshot(StorageServer* data, Version version, SpanID spanContext) {
+	if (version > 0 && version != latestVersion && version < data->oldestVersion.get() &&
+	    data->storage.retainsSnapshot(version)) {
+		return version;
+	}
+	return waitForVersion(data, version, spanContext);
+}
+
 ACTOR Future<Version> waitForVersionNoTooOld(StorageServer* data, Version version) {
 	// This could become an Actor transparently, but for now it just does the lookup
 	if (version == latestVersion)
@@ -1235,7 +1279,7 @@ ACTOR Future<Void> getValueQ(StorageServer* data, GetValueRequest req) {
 			                      "getValueQ.DoRead"); //.detail("TaskID", g_network->getCurrentTask());
 
 		state Optional<Value> v;
-		state Version version = wait(waitForVersion(data, req.version, req.spanContext));
+		state Version version = wait(waitForVersionOrRetainedSnapshot(data, req.version, req.spanContext));
 		if (req.debugID.present())
 			g_traceBatch.addEvent("GetValueDebug",
 			                      req.debugID.get().first(),
@@ -1249,20 +1293,32 @@ ACTOR Future<Void> getValueQ(StorageServer* data, GetValueRequest req) {
 		}
 
 		state int path = 0;
-		auto i = data->data().at(version).lastLessOrEqual(req.key);
-		if (i && i->isValue() && i.key() == req.key) {
-			v = (Value)i->getValue();
-			path = 1;
-		} else if (!i || !i->isClearTo() || i->getEndKey() <= req.key) {
-			path = 2;
-			Optional<Value> vv = wait(data->storage.readValue(req.key, req.debugID));
-			// Validate that while we were reading the data we didn't lose the version or shard
-			if (version < data->storageVersion()) {
-				TEST(true); // transaction_too_old after readValue
+		if (version < data->oldestVersion.get()) {
+			// Older than the versioned data, so read the snapshot the storage engine retained at this version
+			if (data->readableSinceVersion[req.key] > version) {
+				TEST(true); // Key not available in retained snapshot
 				throw transaction_too_old();
 			}
+			path = 2;
+			Optional<Value> vv = wait(data->storage.readValueAt(req.key, version, req.debugID));
 			data->checkChangeCounter(changeCounter, req.key);
 			v = vv;
+		} else {
+			auto i = data->data().at(version).lastLessOrEqual(req.key);
+			if (i && i->isValue() && i.key() == req.key) {
+				v = (Value)i->getValue();
+				path = 1;
+			} else if (!i || !i->isClearTo() || i->getEndKey() <= req.key) {
+				path = 2;
+				Optional<Value> vv = wait(data->storage.readValue(req.key, req.debugID));
+				// Validate that while we were reading the data we didn't lose the version or shard
+				if (version < data->storageVersion()) {
+					TEST(true); // transaction_too_old after readValue
+					throw transaction_too_old();
+				}
+				data->checkChangeCounter(changeCounter, req.key);
+				v = vv;
+			}
 		}
 
 		DEBUG_MUTATION("ShardGetValue",
@@ -1594,14 +1650,62 @@ void merge(Arena& arena,
 	}
 }
 
-// If limit>=0, it returns the first rows in the range (sorted ascending), otherwise the last rows (sorted descending).
-// readRange has O(|result|) + O(log |data|) cost
-ACTOR Future<GetKeyValuesReply> readRange(StorageServer* data,
-                                          Version version,
-                                          KeyRange range,
-                                          int limit,
-                                          int* pLimitBytes,
-                                          SpanID parentSpan) {
+// readRange() for a version older than the versioned data, from the snapshot the storage engine retained at it
+ACTOR Future<GetKeyValuesReply> readRetainedSnapshotRange(StorageServer* data,
+                                                          Version version,
+                                                          KeyRange range,
+                                                          int limit,
+                                                          int* pLimitBytes) {
+	for (auto r : data->readableSinceVersion.intersectingRanges(range)) {
+		if (r.value() > version) {
+			TEST(true); // Range not available in retained snapshot
+			throw transaction_too_old();
+		}
+	}
+
+	RangeResult atVersion = wait(data->storage.readRangeAt(range, version, limit, *pLimitBytes));
+	ASSERT(atVersion.size() <= std::abs(limit));
+
+	GetKeyValuesReply result;
+	result.arena.dependsOn(atVersion.arena());
+	result.data = atVersion;
+	for (auto const& kv : atVersion) {
+		*pLimitBytes -= sizeof(KeyValueRef) + kv.expectedSize();
+	}
+	limit += limit >= 0 ? -atVersion.size() : atVersion.size();
+	result.more = atVersion.more || limit == 0 || *pLimitBytes <= 0;
+	result.version = version;
+	return result;
+}
+
+// Reads storage for a series of readRange() calls, such as those of a range stream, with one storage engine cursor, so
+// that a read continuing where the last one ended doesn't seek again.  The cursor may read any commit which ended since
+// it was opened, so it is reopened once the durable version changes, since the versioned data merged with what it
+// reads then no longer holds the mutations that were made durable.
+class StorageRangeCursor {
+public:
+	Future<RangeResult> readRange(StorageServer* data, KeyRangeRef keys, int rowLimit, int byteLimit) {
+		if (!cursor || data->durableVersion.get() != durableVersion) {
+			cursor = data->storage.openCursor();
+			durableVersion = data->durableVersion.get();
+		}
+		return cursor->readRange(keys, rowLimit, byteLimit);
+	}
+
+private:
+	Reference<IKeyValueCursor> cursor;
+	Version durableVersion = invalidVersion;
+};
+
+// readRange() for a version within the versioned data, merging it with the data in storage, which is read with cursor
+// if it is given
+ACTOR Future<GetKeyValuesReply> readVersionedRange(StorageServer* data,
+                                                   Version version,
+                                                   KeyRange range,
+                                                   int limit,
+                                                   int* pLimitBytes,
+                                                   SpanID parentSpan,
+                                                   StorageRangeCursor* cursor) {
 	state GetKeyValuesReply result;
 	state StorageServer::VersionedData::ViewAtVersion view = data->data().at(version);
 	state StorageServer::VersionedData::iterator vCurrent = view.end();
@@ -1665,7 +1769,8 @@ ACTOR Future<GetKeyValuesReply> readRange(StorageServer* data,
 			// Read the data on disk up to vCurrent (or the end of the range)
 			readEnd = vCurrent ? std::min(vCurrent.key(), range.end) : range.end;
 			RangeResult atStorageVersion =
-			    wait(data->storage.readRange(KeyRangeRef(readBegin, readEnd), limit, *pLimitBytes));
+			    wait(cursor ? cursor->readRange(data, KeyRangeRef(readBegin, readEnd), limit, *pLimitBytes)
+			                : data->storage.readRange(KeyRangeRef(readBegin, readEnd), limit, *pLimitBytes));
 
 			ASSERT(atStorageVersion.size() <= limit);
 			if (data->storageVersion() > version)
@@ -1746,7 +1851,8 @@ ACTOR Future<GetKeyValuesReply> readRange(StorageServer* data,
 			readBegin = vCurrent ? std::max(vCurrent->isClearTo() ? vCurrent->getEndKey() : vCurrent.key(), range.begin)
 			                     : range.begin;
 			RangeResult atStorageVersion =
-			    wait(data->storage.readRange(KeyRangeRef(readBegin, readEnd), limit, *pLimitBytes));
+			    wait(cursor ? cursor->readRange(data, KeyRangeRef(readBegin, readEnd), limit, *pLimitBytes)
+			                : data->storage.readRange(KeyRangeRef(readBegin, readEnd), limit, *pLimitBytes));
 
 			ASSERT(atStorageVersion.size() <= -limit);
 			if (data->storageVersion() > version)
@@ -1793,6 +1899,21 @@ ACTOR Future<GetKeyValuesReply> readRange(StorageServer* data,
 	return result;
 }
 
+// If limit>=0, it returns the first rows in the range (sorted ascending), otherwise the last rows (sorted descending).
+// readRange has O(|result|) + O(log |data|) cost
+Future<GetKeyValuesReply> readRange(StorageServer* data,
+                                    Version version,
+                                    KeyRange range,
+                                    int limit,
+                                    int* pLimitBytes,
+                                    SpanID parentSpan,
+                                    StorageRangeCursor* cursor = nullptr) {
+	if (version < data->oldestVersion.get()) {
+		return readRetainedSnapshotRange(data, version, range, limit, pLimitBytes);
+	}
+	return readVersionedRange(data, version, range, limit, pLimitBytes, parentSpan, cursor);
+}
+
 // bool selectorInRange( KeySelectorRef const& sel, KeyRangeRef const& range ) {
 // Returns true if the given range suffices to at least begin to resolve the given KeySelectorRef
 //	return sel.getKey() >= range.begin && (sel.isBackward() ? sel.getKey() <= range.end : sel.getKey() < range.end);
@@ -1816,7 +1937,8 @@ ACTOR Future<Key> findKey(StorageServer* data,
 // shard, then it is possible to get stuck looping here
 {
 	ASSERT(version != latestVersion);
-	ASSERT(selectorInRange(sel, range) && version >= data->oldestVersion.get());
+	ASSERT(selectorInRange(sel, range) &&
+	       (version >= data->oldestVersion.get() || data->storage.retainsSnapshot(version)));
 
 	// Count forward or backward distance items, skipping the first one if it == key and skipEqualKey
 	state bool forward = sel.offset > 0; // If forward, result >= sel.getKey(); else result <= sel.getKey()
@@ -1933,7 +2055,7 @@ ACTOR Future<Void> getKeyValuesQ(StorageServer* data, GetKeyValuesRequest req)
 	try {
 		if (req.debugID.present())
 			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValues.Before");
-		state Version version = wait(waitForVersion(data, req.version, span.context));
+		state Version version = wait(waitForVersionOrRetainedSnapshot(data, req.version, span.context));
 
 		state uint64_t changeCounter = data->shardChangeCounter;
 		//		try {
@@ -2079,6 +2201,8 @@ ACTOR Future<Void> getKeyValuesStreamQ(StorageServer* data, GetKeyValuesStreamRe
 {
 	state Span span("SS:getKeyValuesStream"_loc, { req.spanContext });
 	state int64_t resultSize = 0;
+	// Each batch of the stream continues reading storage where the last one ended
+	state StorageRangeCursor cursor;
 
 	req.reply.setByteLimit(SERVER_KNOBS->RANGESTREAM_LIMIT_BYTES);
 	++data->counters.getRangeStreamQueries;
@@ -2099,7 +2223,7 @@ ACTOR Future<Void> getKeyValuesStreamQ(StorageServer* data, GetKeyValuesStreamRe
 		if (req.debugID.present())
 			g_traceBatch.addEvent(
 			    "TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesStream.Before");
-		state Version version = wait(waitForVersion(data, req.version, span.context));
+		state Version version = wait(waitForVersionOrRetainedSnapshot(data, req.version, span.context));
 
 		state uint64_t changeCounter = data->shardChangeCounter;
 		//		try {
@@ -2168,13 +2292,13 @@ ACTOR Future<Void> getKeyValuesStreamQ(StorageServer* data, GetKeyValuesStreamRe
 			loop {
 				wait(req.reply.onReady());
 
-				if (version < data->oldestVersion.get()) {
+				if (version < data->oldestVersion.get() && !data->storage.retainsSnapshot(version)) {
 					throw transaction_too_old();
 				}
 
 				state int byteLimit = CLIENT_KNOBS->REPLY_BYTE_LIMIT;
-				GetKeyValuesReply _r =
-				    wait(readRange(data, version, KeyRangeRef(begin, end), req.limit, &byteLimit, span.context));
+				GetKeyValuesReply _r = wait(
+				    readRange(data, version, KeyRangeRef(begin, end), req.limit, &byteLimit, span.context, &cursor));
 				GetKeyValuesStreamReply r(_r);
 
 				if (req.debugID.present())
@@ -2253,6 +2377,111 @@ ACTOR Future<Void> getKeyValuesStreamQ(StorageServer* data, GetKeyValuesStreamRe
 	return Void();
 }
 
+// Throws a wrong_shard_server if the keys in the request are not all in one shard of this server
+ACTOR Future<Void> getRangeAggregateQ(StorageServer* data, GetRangeAggregateRequest req) {
+	state Span span("SS:getRangeAggregate"_loc, { req.spanContext });
+	state int64_t resultSize = 0;
+
+	++data->counters.getRangeAggregateQueries;
+	++data->counters.allQueries;
+	++data->readQueueSizeMetric;
+	data->maxQueryQueue = std::max<int>(
+	    data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
+
+	// Active load balancing runs at a very high priority (to obtain accurate queue lengths)
+	// so we need to downgrade here
+	wait(data->getQueryDelay());
+
+	try {
+		if (req.debugID.present())
+			g_traceBatch.addEvent(
+			    "TransactionDebug", req.debugID.get().first(), "storageserver.getRangeAggregate.Before");
+		state Version version = wait(waitForVersion(data, req.version, span.context));
+
+		state uint64_t changeCounter = data->shardChangeCounter;
+		state KeyRange shard = getShardKeyRange(data, firstGreaterOrEqual(req.keys.begin));
+		if (req.keys.end > shard.end) {
+			throw wrong_shard_server();
+		}
+
+		state GetRangeAggregateReply reply;
+		state KeyRange remaining = req.keys;
+		state int64_t scannedBytes = 0;
+		reply.version = version;
+		while (!remaining.empty()) {
+			if (version < data->oldestVersion.get()) {
+				throw transaction_too_old();
+			}
+
+			state int byteLimit = CLIENT_KNOBS->REPLY_BYTE_LIMIT;
+			GetKeyValuesReply r =
+			    wait(readRange(data, version, remaining, CLIENT_KNOBS->TOO_MANY, &byteLimit, span.context));
+			data->checkChangeCounter(changeCounter, req.keys);
+
+			for (auto const& kv : r.data) {
+				KeyRef group =
+				    req.groupTupleElements > 0
+				        ? rangeAggregateGroup(kv.key, req.groupPrefixLength, req.groupTupleElements)
+				        : KeyRef();
+				// Keys with a common prefix are adjacent, so a group only continues the last one
+				if (reply.groups.empty() || reply.groups.back().group != group) {
+					reply.groups.push_back(reply.arena, RangeAggregateRef(KeyRef(reply.arena, group)));
+				}
+				reply.groups.back().add(kv);
+				scannedBytes += kv.expectedSize();
+			}
+			data->counters.rowsQueried += r.data.size();
+
+			if (r.data.size() && SERVER_KNOBS->READ_SAMPLING_ENABLED) {
+				// Like a range read, the cost is billed to the first and last keys read
+				int64_t bytesReadPerKSecond =
+				    std::max<int64_t>(CLIENT_KNOBS->REPLY_BYTE_LIMIT - byteLimit, SERVER_KNOBS->EMPTY_READ_PENALTY) / 2;
+				data->metrics.notifyBytesReadPerKSecond(r.data[0].key, bytesReadPerKSecond);
+				data->metrics.notifyBytesReadPerKSecond(r.data.back().key, bytesReadPerKSecond);
+			}
+
+			if (!r.more) {
+				break;
+			}
+			ASSERT(r.data.size());
+			remaining = KeyRangeRef(keyAfter(r.data.back().key), remaining.end);
+			if (scannedBytes >= SERVER_KNOBS->RANGE_AGGREGATE_SCAN_BYTES ||
+			    reply.groups.size() >= SERVER_KNOBS->RANGE_AGGREGATE_GROUP_LIMIT) {
+				reply.more = true;
+				reply.readThrough = KeyRef(reply.arena, remaining.begin);
+				break;
+			}
+			wait(delay(0, TaskPriority::DefaultEndpoint));
+		}
+
+		if (req.debugID.present())
+			g_traceBatch.addEvent(
+			    "TransactionDebug", req.debugID.get().first(), "storageserver.getRangeAggregate.AfterReadRange");
+
+		reply.penalty = data->getPenalty();
+		req.reply.send(reply);
+
+		resultSize = scannedBytes;
+		data->counters.bytesQueried += resultSize;
+		if (reply.groups.empty()) {
+			++data->counters.emptyQueries;
+		}
+	} catch (Error& e) {
+		if (!canReplyWith(e))
+			throw;
+		data->sendErrorWithPenalty(req.reply, e, data->getPenalty());
+	}
+
+	data->transactionTagCounter.addRequest(req.tags, resultSize);
+	++data->counters.finishedQueries;
+	--data->readQueueSizeMetric;
+
+	double duration = g_network->timer() - req.requestTime();
+	data->counters.readLatencySample.addMeasurement(duration);
+
+	return Void();
+}
+
 ACTOR Future<Void> getKeyQ(StorageServer* data, GetKeyRequest req) {
 	state Span span("SS:getKey"_loc, { req.spanContext });
 	state int64_t resultSize = 0;
@@ -2341,6 +2570,7 @@ void getQueuingMetrics(StorageServer* self, StorageQueuingMetricsRequest const&
 	reply.bytesDurable = self->counters.bytesDurable.getValue();
 
 	reply.storageBytes = self->storage.getStorageBytes();
+	reply.pendingCompactionBytes = self->storage.getPendingCompactionBytes();
 	reply.localRateLimit = self->currentRate();
 
 	reply.version = self->version.get();
@@ -2369,22 +2599,37 @@ void getQueuingMetrics(StorageServer* self, StorageQueuingMetricsRequest const&
 ACTOR Future<Void> doEagerReads(StorageServer* data, UpdateEagerReadInfo* eager) {
 	eager->finishKeyBegin();
 
-	vector<Future<Key>> keyEnd(eager->keyBegin.size());
-	for (int i = 0; i < keyEnd.size(); i++)
-		keyEnd[i] = data->storage.readNextKeyInclusive(eager->keyBegin[i]);
+	// The reads are issued in batches of STORAGE_EAGER_READS_BATCH_SIZE, which the storage engine can serve together,
+	// while the batches of a large update can still be served in parallel
+	int batchSize = SERVER_KNOBS->STORAGE_EAGER_READS_BATCH_SIZE;
 
-	state Future<vector<Key>> futureKeyEnds = getAll(keyEnd);
+	// The end of each cleared range is extended to the first key at or after it
+	vector<Future<vector<RangeResult>>> keyEnd;
+	for (int i = 0; i < eager->keyBegin.size(); i += batchSize) {
+		vector<KeyRangeRef> ranges;
+		for (int j = i; j < std::min<int>(i + batchSize, eager->keyBegin.size()); j++)
+			ranges.emplace_back(eager->keyBegin[j], allKeys.end);
+		keyEnd.push_back(data->storage.readRanges(ranges, 1));
+	}
+
+	state Future<vector<vector<RangeResult>>> futureKeyEnds = getAll(keyEnd);
 
-	vector<Future<Optional<Value>>> value(eager->keys.size());
-	for (int i = 0; i < value.size(); i++)
-		value[i] = data->storage.readValuePrefix(eager->keys[i].first, eager->keys[i].second);
+	vector<Future<vector<Optional<Value>>>> value;
+	for (int i = 0; i < eager->keys.size(); i += batchSize) {
+		auto batchEnd = eager->keys.begin() + std::min<int>(i + batchSize, eager->keys.size());
+		value.push_back(
+		    data->storage.readValuePrefixes(vector<std::pair<KeyRef, int>>(eager->keys.begin() + i, batchEnd)));
+	}
 
-	state Future<vector<Optional<Value>>> futureValues = getAll(value);
-	state vector<Key> keyEndVal = wait(futureKeyEnds);
-	vector<Optional<Value>> optionalValues = wait(futureValues);
+	state Future<vector<vector<Optional<Value>>>> futureValues = getAll(value);
+	state vector<vector<RangeResult>> keyEndBatches = wait(futureKeyEnds);
+	vector<vector<Optional<Value>>> valueBatches = wait(futureValues);
 
-	eager->keyEnd = keyEndVal;
-	eager->value = optionalValues;
+	for (auto const& batch : keyEndBatches)
+		for (auto const& r : batch)
+			eager->keyEnd.push_back(r.size() ? Key(r[0].key, r.arena()) : allKeys.end);
+	for (auto& batch : valueBatches)
+		eager->value.insert(eager->value.end(), batch.begin(), batch.end());
 
 	return Void();
 }
@@ -2933,11 +3178,22 @@ ACTOR Future<Void> fetchKeys(StorageServer* data, AddingShard* shard) {
 
 					metricReporter.addFetchedBytes(expectedBlockSize, this_block.size());
 
-					// Write this_block to storage
+					ASSERT(this_block.readThrough.present() || this_block.size());
+					state Key blockEnd = this_block.readThrough.present() ? this_block.readThrough.get()
+					                                                      : keyAfter(this_block.end()[-1].key);
+
+					// Write this_block to storage.  It holds all of the data in [nfk, blockEnd), and any data the
+					// range previously had in storage has already been cleared.  Stores which cannot write it as a
+					// whole get one key at a time, so that a large block does not hold up the storage server.
 					state KeyValueRef* kvItr = this_block.begin();
-					for (; kvItr != this_block.end(); ++kvItr) {
-						data->storage.writeKeyValue(*kvItr);
+					if (data->storage.canWriteSortedRange()) {
+						data->storage.writeSortedRange(KeyRangeRef(nfk, blockEnd), this_block, this_block.arena());
 						wait(yield());
+					} else {
+						for (; kvItr != this_block.end(); ++kvItr) {
+							data->storage.writeKeyValue(*kvItr);
+							wait(yield());
+						}
 					}
 
 					kvItr = this_block.begin();
@@ -2946,9 +3202,7 @@ ACTOR Future<Void> fetchKeys(StorageServer* data, AddingShard* shard) {
 						wait(yield());
 					}
 
-					ASSERT(this_block.readThrough.present() || this_block.size());
-					nfk = this_block.readThrough.present() ? this_block.readThrough.get()
-					                                       : keyAfter(this_block.end()[-1].key);
+					nfk = blockEnd;
 					this_block = RangeResult();
 
 					data->fetchKeysBytesBudget -= expectedBlockSize;
@@ -3112,6 +3366,7 @@ ACTOR Future<Void> fetchKeys(StorageServer* data, AddingShard* shard) {
 		       data->shards[shard->keys.begin]->keys ==
 		           shard->keys); // We aren't changing whether the shard is assigned
 		data->newestAvailableVersion.insert(shard->keys, latestVersion);
+		data->readableSinceVersion.insert(shard->keys, shard->transferredVersion);
 		shard->readWrite.send(Void());
 		data->addShard(ShardInfo::newReadWrite(shard->keys, data)); // invalidates shard!
 		coalesceShards(data, keys);
@@ -3269,6 +3524,7 @@ void changeServerKeys(StorageServer* data,
 	// adding/transferred shard is cancelled
 	auto vr = data->newestAvailableVersion.intersectingRanges(keys);
 	std::vector<std::pair<KeyRange, Version>> changeNewestAvailable;
+	std::vector<std::pair<KeyRange, Version>> changeReadableSince;
 	std::vector<KeyRange> removeRanges;
 	for (auto r = vr.begin(); r != vr.end(); ++r) {
 		KeyRangeRef range = keys & r->range();
@@ -3288,12 +3544,14 @@ void changeServerKeys(StorageServer* data,
 				changeNewestAvailable.emplace_back(range, version);
 				removeRanges.push_back(range);
 			}
+			changeReadableSince.emplace_back(range, latestVersion);
 			data->addShard(ShardInfo::newNotAssigned(range));
 			data->watches.triggerRange(range.begin, range.end);
 		} else if (!dataAvailable) {
 			// SOMEDAY: Avoid restarting adding/transferred shards
 			if (version == 0) { // bypass fetchkeys; shard is known empty at version 0
 				changeNewestAvailable.emplace_back(range, latestVersion);
+				changeReadableSince.emplace_back(range, 0);
 				data->addShard(ShardInfo::newReadWrite(range, data));
 				setAvailableStatus(data, range, true);
 			} else {
@@ -3310,6 +3568,8 @@ void changeServerKeys(StorageServer* data,
 	// above)
 	for (auto r = changeNewestAvailable.begin(); r != changeNewestAvailable.end(); ++r)
 		data->newestAvailableVersion.insert(r->first, r->second);
+	for (auto r = changeReadableSince.begin(); r != changeReadableSince.end(); ++r)
+		data->readableSinceVersion.insert(r->first, r->second);
 
 	if (!nowAssigned)
 		data->metrics.notifyNotReadable(keys);
@@ -3992,6 +4252,15 @@ ACTOR Future<Void> updateStorage(StorageServer* data) {
 		state Version desiredVersion = data->desiredOldestVersion.get();
 		state int64_t bytesLeft = SERVER_KNOBS->STORAGE_COMMIT_BYTES;
 
+		// Commit exactly at each multiple of RETAINED_SNAPSHOT_INTERVAL_VERSIONS so that every storage server retains
+		// snapshots at the same versions, which are the ones clients read at with READ_RETAINED_SNAPSHOT
+		state bool retainSnapshots =
+		    SERVER_KNOBS->STORAGE_SNAPSHOT_RETENTION_VERSIONS > 0 && data->storage.canRetainSnapshots();
+		if (retainSnapshots) {
+			Version interval = CLIENT_KNOBS->RETAINED_SNAPSHOT_INTERVAL_VERSIONS;
+			desiredVersion = std::min(desiredVersion, (startOldestVersion / interval + 1) * interval);
+		}
+
 		// Write mutations to storage until we reach the desiredVersion or have written too much (bytesleft)
 		state double beforeStorageUpdates = now();
 		loop {
@@ -4011,6 +4280,10 @@ ACTOR Future<Void> updateStorage(StorageServer* data) {
 		// Set the new durable version as part of the outstanding change set, before commit
 		if (startOldestVersion != newOldestVersion)
 			data->storage.makeVersionDurable(newOldestVersion);
+		if (retainSnapshots && newOldestVersion % CLIENT_KNOBS->RETAINED_SNAPSHOT_INTERVAL_VERSIONS == 0) {
+			data->storage.setCommitVersion(newOldestVersion,
+			                               newOldestVersion - SERVER_KNOBS->STORAGE_SNAPSHOT_RETENTION_VERSIONS);
+		}
 		data->storageUpdatesDurableLatencyHistogram->sampleSeconds(now() - beforeStorageUpdates);
 
 		debug_advanceMaxCommittedVersion(data->thisServerID, newOldestVersion);
@@ -4144,6 +4417,10 @@ void StorageServerDisk::writeKeyValue(KeyValueRef kv) {
 	storage->set(kv);
 }
 
+void StorageServerDisk::writeSortedRange(KeyRangeRef keys, VectorRef<KeyValueRef> kvs, const Arena& arena) {
+	storage->setSortedRange(keys, kvs, &arena);
+}
+
 void StorageServerDisk::writeMutation(MutationRef mutation) {
 	// FIXME: DEBUG_MUTATION(debugContext, debugVersion, *m);
 	if (mutation.type == MutationRef::SetValue) {
@@ -4392,6 +4669,7 @@ ACTOR Future<bool> restoreDurableState(StorageServer* data, IKeyValueStore* stor
 		/*if(nowAvailable)
 		  TraceEvent("AvailableShard", data->thisServerID).detail("RangeBegin", keys.begin).detail("RangeEnd", keys.end);*/
 		data->newestAvailableVersion.insert(keys, nowAvailable ? latestVersion : invalidVersion);
+		data->readableSinceVersion.insert(keys, nowAvailable ? version : latestVersion);
 		wait(yield());
 	}
 
@@ -4552,6 +4830,21 @@ void StorageServer::byteSampleApplyClear(KeyRangeRef range, Version ver) {
 	}
 }
 
+// Stops sending the changes to the metrics of keys to the stream change
+void removeWaitMetrics(StorageServerMetrics* self, KeyRangeRef keys, PromiseStream<StorageMetrics> const& change) {
+	auto rs = self->waitMetricsMap.modify(keys);
+	for (auto i = rs.begin(); i != rs.end(); ++i) {
+		auto& x = i->value();
+		for (int j = 0; j < x.size(); j++) {
+			if (x[j] == change) {
+				swapAndPop(&x, j);
+				break;
+			}
+		}
+	}
+	self->waitMetricsMap.coalesce(keys);
+}
+
 ACTOR Future<Void> waitMetrics(StorageServerMetrics* self, WaitMetricsRequest req, Future<Void> timeout) {
 	state PromiseStream<StorageMetrics> change;
 	state StorageMetrics metrics = self->getMetrics(req.keys);
@@ -4621,17 +4914,7 @@ ACTOR Future<Void> waitMetrics(StorageServerMetrics* self, WaitMetricsRequest re
 		wait(delay(0)); // prevent iterator invalidation of functions sending changes
 	}
 
-	auto rs = self->waitMetricsMap.modify(req.keys);
-	for (auto i = rs.begin(); i != rs.end(); ++i) {
-		auto& x = i->value();
-		for (int j = 0; j < x.size(); j++) {
-			if (x[j] == change) {
-				swapAndPop(&x, j);
-				break;
-			}
-		}
-	}
-	self->waitMetricsMap.coalesce(req.keys);
+	removeWaitMetrics(self, req.keys, change);
 
 	if (error.code() != error_code_success) {
 		if (error.code() != error_code_wrong_shard_server)
@@ -4647,6 +4930,95 @@ Future<Void> StorageServerMetrics::waitMetrics(WaitMetricsRequest req, Future<Vo
 	return ::waitMetrics(this, req, delay);
 }
 
+// Changes to any of the ranges are only known to have happened to one of them, so rather than keeping a running total
+// for each range as waitMetrics() does, the metrics of all the ranges are recomputed after coalescing changes for a
+// short delay
+ACTOR Future<Void> waitMetricsBatch(StorageServer* data, WaitMetricsBatchRequest req, Future<Void> timeout) {
+	state StorageServerMetrics* self = &data->metrics;
+	state PromiseStream<StorageMetrics> change;
+	state std::vector<KeyRange> registered;
+	state Error error = success();
+	state int i;
+
+	loop {
+		WaitMetricsBatchReply reply;
+		for (int r = 0; r < req.keys.size(); r++) {
+			if (!data->isReadable(req.keys[r])) {
+				reply.notReadable.push_back(r);
+				continue;
+			}
+			StorageMetrics metrics = self->getMetrics(req.keys[r]);
+			if (!req.min[r].allLessOrEqual(metrics) || !metrics.allLessOrEqual(req.max[r])) {
+				reply.changed.push_back(r);
+				reply.metrics.push_back(metrics);
+			}
+		}
+
+		if (!reply.changed.empty() || !reply.notReadable.empty()) {
+			TEST(registered.empty()); // WaitMetricsBatch return quickly
+			TEST(!registered.empty()); // WaitMetricsBatch return delayed
+			req.reply.send(reply);
+			break;
+		}
+		if (timeout.isReady()) {
+			TEST(true); // WaitMetricsBatch return on timeout
+			if (deterministicRandom()->random01() < SERVER_KNOBS->WAIT_METRICS_WRONG_SHARD_CHANCE) {
+				req.reply.sendError(wrong_shard_server());
+			} else {
+				req.reply.send(reply);
+			}
+			break;
+		}
+
+		if (registered.empty()) {
+			for (auto const& keys : req.keys) {
+				auto rs = self->waitMetricsMap.modify(keys);
+				for (auto r = rs.begin(); r != rs.end(); ++r)
+					r->value().push_back(change);
+				registered.push_back(keys);
+			}
+		}
+
+		try {
+			choose {
+				when(StorageMetrics c = waitNext(change.getFuture())) {
+					wait(delay(SERVER_KNOBS->WAIT_METRICS_BATCH_DELAY));
+					while (change.getFuture().isReady()) {
+						change.getFuture().pop();
+					}
+				}
+				when(wait(timeout)) {}
+			}
+		} catch (Error& e) {
+			if (e.code() == error_code_actor_cancelled)
+				throw; // This is only cancelled when the main loop had exited...no need in this case to clean up self
+			if (e.code() != error_code_wrong_shard_server) {
+				error = e;
+				break;
+			}
+			// A range became unreadable, which is reported on the next pass. The stream holds the error, so changes
+			// are watched with a new one.
+			TEST(true); // WaitMetricsBatch range became unreadable
+			wait(delay(0)); // prevent iterator invalidation of functions sending changes
+			for (i = 0; i < registered.size(); i++) {
+				removeWaitMetrics(self, registered[i], change);
+			}
+			registered.clear();
+			change = PromiseStream<StorageMetrics>();
+		}
+	}
+
+	wait(delay(0)); // prevent iterator invalidation of functions sending changes
+	for (i = 0; i < registered.size(); i++) {
+		removeWaitMetrics(self, registered[i], change);
+	}
+
+	if (error.code() != error_code_success) {
+		throw error;
+	}
+	return Void();
+}
+
 #ifndef __INTEL_COMPILER
 #pragma endregion
 #endif
@@ -4675,6 +5047,11 @@ ACTOR Future<Void> metricsCore(StorageServer* self, StorageServerInterface ssi)
 		                               te.detail("KvstoreBytesAvailable", sb.available);
 		                               te.detail("KvstoreBytesTotal", sb.total);
 		                               te.detail("KvstoreBytesTemp", sb.temp);
+		                               if (auto engineStats = self->storage.getEngineStats(); engineStats.present()) {
+			                               te.detail("KvstoreBlockCacheHitRate", engineStats.get().blockCacheHitRate);
+			                               te.detail("KvstoreStallMicros", engineStats.get().stallMicros);
+			                               te.detail("KvstoreL0Files", engineStats.get().l0Files);
+		                               }
 		                               if (self->isTss()) {
 			                               te.detail("TSSPairID", self->tssPairID);
 			                               te.detail("TSSJointID",
@@ -4699,6 +5076,9 @@ ACTOR Future<Void> metricsCore(StorageServer* self, StorageServerInterface ssi)
 					    self->metrics.waitMetrics(req, delayJittered(SERVER_KNOBS->STORAGE_METRIC_TIMEOUT)));
 				}
 			}
+			when(WaitMetricsBatchRequest req = waitNext(ssi.waitMetricsBatch.getFuture())) {
+				self->actors.add(waitMetricsBatch(self, req, delayJittered(SERVER_KNOBS->STORAGE_METRIC_TIMEOUT)));
+			}
 			when(SplitMetricsRequest req = waitNext(ssi.splitMetrics.getFuture())) {
 				if (!self->isReadable(req.keys)) {
 					TEST(true); // splitMetrics immediate wrong_shard_server()
@@ -4709,8 +5089,15 @@ ACTOR Future<Void> metricsCore(StorageServer* self, StorageServerInterface ssi)
 			}
 			when(GetStorageMetricsRequest req = waitNext(ssi.getStorageMetrics.getFuture())) {
 				StorageBytes sb = self->storage.getStorageBytes();
-				self->metrics.getStorageMetrics(
-				    req, sb, self->counters.bytesInput.getRate(), self->versionLag, self->lastUpdate);
+				// cpuUsage is a constant in simulation, where it would hide the other load metrics from data
+				// distribution
+				self->metrics.getStorageMetrics(req,
+				                                sb,
+				                                self->counters.bytesInput.getRate(),
+				                                self->versionLag,
+				                                self->lastUpdate,
+				                                g_network->isSimulated() ? 0.0 : self->cpuUsage,
+				                                self->counters.allQueries.getRate());
 			}
 			when(ReadHotSubRangeRequest req = waitNext(ssi.getReadHotRanges.getFuture())) {
 				if (!self->isReadable(req.keys)) {
@@ -4807,6 +5194,16 @@ ACTOR Future<Void> serveGetKeyValuesStreamRequests(StorageServer* self,
 	}
 }
 
+ACTOR Future<Void> serveGetRangeAggregateRequests(StorageServer* self,
+                                                  FutureStream<GetRangeAggregateRequest> getRangeAggregate) {
+	loop {
+		GetRangeAggregateRequest req = waitNext(getRangeAggregate);
+		// Warning: This code is executed at extremely high priority (TaskPriority::LoadBalancedEndpoint), so downgrade
+		// before doing real work
+		self->actors.add(self->readGuard(req, getRangeAggregateQ));
+	}
+}
+
 ACTOR Future<Void> serveGetKeyRequests(StorageServer* self, FutureStream<GetKeyRequest> getKey) {
 	loop {
 		GetKeyRequest req = waitNext(getKey);
@@ -4967,6 +5364,7 @@ ACTOR Future<Void> storageServerCore(StorageServer* self, StorageServerInterface
 	self->actors.add(serveGetValueRequests(self, ssi.getValue.getFuture()));
 	self->actors.add(serveGetKeyValuesRequests(self, ssi.getKeyValues.getFuture()));
 	self->actors.add(serveGetKeyValuesStreamRequests(self, ssi.getKeyValuesStream.getFuture()));
+	self->actors.add(serveGetRangeAggregateRequests(self, ssi.getRangeAggregate.getFuture()));
 	self->actors.add(serveGetKeyRequests(self, ssi.getKey.getFuture()));
 	self->actors.add(serveWatchValueRequests(self, ssi.watchValue.getFuture()));
 	self->actors.add(traceRole(Role::STORAGE_SERVER, ssi.id()));
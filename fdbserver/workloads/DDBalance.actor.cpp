@@ -19,7 +19,9 @@
  */
 
 #include "fdbrpc/ContinuousSample.h"
+#include "fdbclient/IKnobCollection.h"
 #include "fdbclient/NativeAPI.actor.h"
+#include "fdbserver/QuietDatabase.h"
 #include "fdbserver/TesterInterface.actor.h"
 #include "fdbserver/workloads/workloads.actor.h"
 #include "flow/actorcompiler.h" // This must be the last #include.
@@ -30,12 +32,22 @@ struct DDBalanceWorkload : TestWorkload {
 	double testDuration, warmingDelay, transactionsPerSecond;
 	bool discardEdgeMeasurements;
 
+	// Readers of a small set of hot keys, whose load data distribution should spread over storage servers
+	int hotReadersPerClient, hotKeyCount, hotValueBytes;
+	double hotReadsPerSecond;
+	// Turns on the data distribution features which move read load, and fails the test unless they reduce the read
+	// load imbalance
+	bool balanceReads;
+	// The most loaded storage server's read bandwidth relative to the average, early on and near the end of the test
+	double readLoadImbalanceStart = 0, readLoadImbalanceEnd = 0;
+
 	vector<Future<Void>> clients;
-	PerfIntCounter bin_shifts, operations, retries;
+	PerfIntCounter bin_shifts, operations, retries, hotReads;
 	ContinuousSample<double> latencies;
 
 	DDBalanceWorkload(WorkloadContext const& wcx)
-	  : TestWorkload(wcx), latencies(2000), bin_shifts("Bin_Shifts"), operations("Operations"), retries("Retries") {
+	  : TestWorkload(wcx), latencies(2000), bin_shifts("Bin_Shifts"), operations("Operations"), retries("Retries"),
+	    hotReads("HotReads") {
 		testDuration = getOption(options, LiteralStringRef("testDuration"), 10.0);
 		binCount = getOption(options, LiteralStringRef("binCount"), 1000);
 		writesPerTransaction = getOption(options, LiteralStringRef("writesPerTransaction"), 1);
@@ -48,6 +60,13 @@ struct DDBalanceWorkload : TestWorkload {
 		transactionsPerSecond =
 		    getOption(options, LiteralStringRef("transactionsPerSecond"), 5000.0) / (clientCount * moversPerClient);
 
+		hotReadersPerClient = getOption(options, LiteralStringRef("hotReadersPerClient"), 0);
+		hotKeyCount = std::max(getOption(options, LiteralStringRef("hotKeyCount"), 100), 1);
+		hotValueBytes = getOption(options, LiteralStringRef("hotValueBytes"), 1000);
+		hotReadsPerSecond = getOption(options, LiteralStringRef("hotReadsPerSecond"), 1000.0) /
+		                    std::max(clientCount * hotReadersPerClient, 1);
+		balanceReads = getOption(options, LiteralStringRef("balanceReads"), false);
+
 		nodesPerActor = nodes / (actorsPerClient * clientCount);
 
 		currentbin = deterministicRandom()->randomInt(0, binCount);
@@ -55,13 +74,25 @@ struct DDBalanceWorkload : TestWorkload {
 
 	std::string description() const override { return "DDBalance"; }
 
-	Future<Void> setup(Database const& cx) override { return ddbalanceSetup(cx, this); }
+	Future<Void> setup(Database const& cx) override {
+		if (balanceReads && g_network->isSimulated()) {
+			IKnobCollection::getMutableGlobalKnobCollection().setKnob("dd_load_rebalance",
+			                                                          KnobValueRef::create(bool{ true }));
+			IKnobCollection::getMutableGlobalKnobCollection().setKnob("dd_split_read_hot_shards",
+			                                                          KnobValueRef::create(bool{ true }));
+		}
+		return ddbalanceSetup(cx, this);
+	}
 
 	Future<Void> start(Database const& cx) override { return _start(cx, this); }
 
 	ACTOR Future<Void> _start(Database cx, DDBalanceWorkload* self) {
 		for (int c = 0; c < self->moversPerClient; c++)
 			self->clients.push_back(timeout(self->ddBalanceMover(cx, self, c), self->testDuration, Void()));
+		for (int c = 0; c < self->hotReadersPerClient; c++)
+			self->clients.push_back(timeout(self->hotReader(cx, self), self->testDuration, Void()));
+		if (self->hotReadersPerClient && !self->clientId)
+			self->clients.push_back(self->readLoadMonitor(cx, self));
 		wait(waitForAll(self->clients));
 		return Void();
 	}
@@ -72,7 +103,56 @@ struct DDBalanceWorkload : TestWorkload {
 			if (clients[i].isError())
 				ok = false;
 		clients.clear();
-		return ok;
+		if (!ok || clientId || !balanceReads) {
+			return ok;
+		}
+		// An imbalance this low means that the hot reads were spread over every storage server from the start, e.g.
+		// because there is only a single team
+		bool balanced = readLoadImbalanceEnd < readLoadImbalanceStart || readLoadImbalanceStart < 1.2;
+		TraceEvent(balanced ? SevInfo : SevError, "DDBalanceReadLoadCheck")
+		    .detail("ImbalanceStart", readLoadImbalanceStart)
+		    .detail("ImbalanceEnd", readLoadImbalanceEnd);
+		return balanced;
+	}
+
+	// Measures how unevenly the hot reads are spread over the storage servers, once the hot reads have been running
+	// for a while and again before they stop
+	ACTOR Future<Void> readLoadMonitor(Database cx, DDBalanceWorkload* self) {
+		wait(delay(self->testDuration * 0.125));
+		double start = wait(measureReadLoad(cx));
+		self->readLoadImbalanceStart = start;
+		wait(delay(self->testDuration * 0.75));
+		double end = wait(measureReadLoad(cx));
+		self->readLoadImbalanceEnd = end;
+		return Void();
+	}
+
+	// Returns the most loaded storage server's read bandwidth relative to the average
+	ACTOR static Future<double> measureReadLoad(Database cx) {
+		state vector<StorageServerInterface> storageServers = wait(getStorageServers(cx));
+		state std::vector<Future<ErrorOr<GetStorageMetricsReply>>> replies;
+		for (auto const& ssi : storageServers) {
+			replies.push_back(ssi.getStorageMetrics.tryGetReply(GetStorageMetricsRequest()));
+		}
+		wait(waitForAll(replies));
+
+		double total = 0, most = 0;
+		int count = 0;
+		for (auto const& reply : replies) {
+			if (reply.get().present()) {
+				double readLoad = reply.get().get().load.bytesReadPerKSecond;
+				total += readLoad;
+				most = std::max(most, readLoad);
+				count++;
+			}
+		}
+		double imbalance = total > 0 ? most * count / total : 0;
+		TraceEvent("DDBalanceReadLoad")
+		    .detail("StorageServers", count)
+		    .detail("MaxBytesReadPerKSecond", most)
+		    .detail("TotalBytesReadPerKSecond", total)
+		    .detail("Imbalance", imbalance);
+		return imbalance;
 	}
 
 	void getMetrics(vector<PerfMetric>& m) override {
@@ -81,6 +161,11 @@ struct DDBalanceWorkload : TestWorkload {
 		m.push_back(operations.getMetric());
 		m.push_back(retries.getMetric());
 		m.push_back(bin_shifts.getMetric());
+		if (hotReadersPerClient) {
+			m.push_back(hotReads.getMetric());
+			m.push_back(PerfMetric("Read Load Imbalance Start", readLoadImbalanceStart, false));
+			m.push_back(PerfMetric("Read Load Imbalance End", readLoadImbalanceEnd, false));
+		}
 		m.push_back(PerfMetric("Mean Latency (ms)", 1000 * latencies.mean(), true));
 		m.push_back(PerfMetric("Median Latency (ms, averaged)", 1000 * latencies.median(), true));
 		m.push_back(PerfMetric("90% Latency (ms, averaged)", 1000 * latencies.percentile(0.90), true));
@@ -93,6 +178,9 @@ struct DDBalanceWorkload : TestWorkload {
 
 	Value value(int n) { return doubleToTestKey(n); }
 
+	// Sorts after the keys of every bin
+	Key hotKey(int n) { return StringRef(format("hot/%08x", n)); }
+
 	ACTOR Future<Void> setKeyIfNotPresent(Transaction* tr, Key key, Value val) {
 		Optional<Value> f = wait(tr->get(key));
 		if (!f.present())
@@ -138,6 +226,10 @@ struct DDBalanceWorkload : TestWorkload {
 			wait(waitForAll(fs));
 		}
 
+		if (self->hotReadersPerClient && !self->clientId) {
+			wait(self->hotKeysSetup(cx, self));
+		}
+
 		if (self->warmingDelay > 0) {
 			wait(timeout(databaseWarmer(cx), self->warmingDelay, Void()));
 		}
@@ -145,6 +237,45 @@ struct DDBalanceWorkload : TestWorkload {
 		return Void();
 	}
 
+	ACTOR Future<Void> hotKeysSetup(Database cx, DDBalanceWorkload* self) {
+		state Transaction tr(cx);
+		state int n = 0;
+		while (n < self->hotKeyCount) {
+			loop {
+				try {
+					for (int i = n; i < std::min(n + 100, self->hotKeyCount); i++) {
+						tr.set(self->hotKey(i), Value(std::string(self->hotValueBytes, 'h')));
+					}
+					wait(tr.commit());
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+				}
+			}
+			tr.reset();
+			n += 100;
+		}
+		return Void();
+	}
+
+	ACTOR Future<Void> hotReader(Database cx, DDBalanceWorkload* self) {
+		state double lastTime = now();
+		loop {
+			wait(poisson(&lastTime, 1.0 / self->hotReadsPerSecond));
+			state Transaction tr(cx);
+			loop {
+				try {
+					Optional<Value> v =
+					    wait(tr.get(self->hotKey(deterministicRandom()->randomInt(0, self->hotKeyCount))));
+					++self->hotReads;
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+				}
+			}
+		}
+	}
+
 	bool shouldRecord(double clientBegin) {
 		double n = now();
 		return !discardEdgeMeasurements ||
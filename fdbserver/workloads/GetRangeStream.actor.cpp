@@ -30,12 +30,19 @@ struct GetRangeStream : TestWorkload {
 	Key begin;
 	Key end;
 	bool printKVPairs;
+	// Instead of measuring throughput, repeatedly checks for testDuration seconds that streaming the range returns
+	// what getRange() does at the same version
+	bool compareToGetRange;
+	double testDuration;
+	bool mismatch = false;
 
 	GetRangeStream(WorkloadContext const& wcx) : TestWorkload(wcx), bytesRead("BytesRead") {
 		useGetRange = getOption(options, LiteralStringRef("useGetRange"), false);
 		begin = getOption(options, LiteralStringRef("begin"), normalKeys.begin);
 		end = getOption(options, LiteralStringRef("end"), normalKeys.end);
 		printKVPairs = getOption(options, LiteralStringRef("printKVPairs"), false);
+		compareToGetRange = getOption(options, LiteralStringRef("compareToGetRange"), false);
+		testDuration = getOption(options, LiteralStringRef("testDuration"), 10.0);
 	}
 
 	std::string description() const override { return "GetRangeStreamWorkload"; }
@@ -43,10 +50,16 @@ struct GetRangeStream : TestWorkload {
 	Future<Void> setup(Database const& cx) override { return Void(); }
 
 	Future<Void> start(Database const& cx) override {
-		return clientId != 0 ? Void() : useGetRange ? fdbClientGetRange(cx, this) : fdbClientStream(cx, this);
+		if (clientId != 0) {
+			return Void();
+		}
+		if (compareToGetRange) {
+			return compareStreamToGetRange(cx, this);
+		}
+		return useGetRange ? fdbClientGetRange(cx, this) : fdbClientStream(cx, this);
 	}
 
-	Future<bool> check(Database const& cx) override { return true; }
+	Future<bool> check(Database const& cx) override { return !mismatch; }
 
 	void getMetrics(vector<PerfMetric>& m) override { m.push_back(bytesRead.getMetric()); }
 
@@ -123,6 +136,57 @@ struct GetRangeStream : TestWorkload {
 		}
 		return Void();
 	}
+
+	ACTOR static Future<Void> compareStreamToGetRange(Database db, GetRangeStream* self) {
+		state double testEnd = now() + self->testDuration;
+		state int comparisons = 0;
+		state Transaction tx(db);
+		while (now() < testEnd) {
+			state PromiseStream<Standalone<RangeResultRef>> results;
+			state RangeResult streamed;
+			try {
+				state Future<Void> stream = tx.getRangeStream(results,
+				                                              KeySelector(firstGreaterOrEqual(self->begin)),
+				                                              KeySelector(firstGreaterOrEqual(self->end)),
+				                                              GetRangeLimits());
+				try {
+					loop {
+						Standalone<RangeResultRef> range = waitNext(results.getFuture());
+						streamed.append_deep(streamed.arena(), range.begin(), range.size());
+						self->bytesRead += range.expectedSize();
+					}
+				} catch (Error& e) {
+					if (e.code() != error_code_end_of_stream) {
+						throw;
+					}
+				}
+				RangeResult read = wait(tx.getRange(KeyRangeRef(self->begin, self->end), CLIENT_KNOBS->TOO_MANY));
+				ASSERT(!read.more);
+
+				int i = 0;
+				while (i < std::min(read.size(), streamed.size()) && read[i] == streamed[i]) {
+					++i;
+				}
+				if (i != read.size() || i != streamed.size()) {
+					TraceEvent(SevError, "GetRangeStreamMismatch")
+					    .detail("ReadVersion", tx.getReadVersion().get())
+					    .detail("Rows", read.size())
+					    .detail("StreamedRows", streamed.size())
+					    .detail("FirstDifference", i)
+					    .detail("Key", i < read.size() ? read[i].key : KeyRef())
+					    .detail("StreamedKey", i < streamed.size() ? streamed[i].key : KeyRef());
+					self->mismatch = true;
+					return Void();
+				}
+				++comparisons;
+				tx.reset();
+			} catch (Error& e) {
+				wait(tx.onError(e));
+			}
+		}
+		TraceEvent("GetRangeStreamCompared").detail("Comparisons", comparisons);
+		return Void();
+	}
 };
 
 WorkloadFactory<GetRangeStream> GetRangeStreamWorkloadFactory("GetRangeStream");
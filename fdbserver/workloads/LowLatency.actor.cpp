@@ -32,6 +32,7 @@ struct LowLatencyWorkload : TestWorkload {
 	double maxGRVLatency;
 	double maxCommitLatency;
 	double checkDelay;
+	double commitBatchTargetLatency;
 	PerfIntCounter operations, retries;
 	bool testWrites;
 	Key testKey;
@@ -45,6 +46,7 @@ struct LowLatencyWorkload : TestWorkload {
 		checkDelay = getOption(options, LiteralStringRef("checkDelay"), 1.0);
 		testWrites = getOption(options, LiteralStringRef("testWrites"), true);
 		testKey = getOption(options, LiteralStringRef("testKey"), LiteralStringRef("testKey"));
+		commitBatchTargetLatency = getOption(options, LiteralStringRef("commitBatchTargetLatency"), 0.0);
 	}
 
 	std::string description() const override { return "LowLatency"; }
@@ -55,6 +57,11 @@ struct LowLatencyWorkload : TestWorkload {
 			                                                          KnobValueRef::create(double{ 5.0 }));
 			IKnobCollection::getMutableGlobalKnobCollection().setKnob("max_delay_cc_worst_fit_candidacy_seconds",
 			                                                          KnobValueRef::create(double{ 10.0 }));
+			if (commitBatchTargetLatency > 0) {
+				IKnobCollection::getMutableGlobalKnobCollection().setKnob(
+				    "commit_transaction_batch_target_latency",
+				    KnobValueRef::create(double{ commitBatchTargetLatency }));
+			}
 		}
 		return Void();
 	}
@@ -30,6 +30,11 @@
 
 struct MoveKeysWorkload : TestWorkload {
 	bool enabled;
+	bool subscribeLocationCache;
+	// Checks that the moves are pushed to the location cache of a client which subscribes to location changes
+	bool checkLocationPushes;
+	Optional<Database> subscriber;
+	int movesChecked = 0, locationPushesSeen = 0;
 	double testDuration, meanDelay;
 	double maxKeyspace;
 	DatabaseConfiguration configuration;
@@ -39,10 +44,63 @@ struct MoveKeysWorkload : TestWorkload {
 		meanDelay = getOption(options, LiteralStringRef("meanDelay"), 0.05);
 		testDuration = getOption(options, LiteralStringRef("testDuration"), 10.0);
 		maxKeyspace = getOption(options, LiteralStringRef("maxKeyspace"), 0.1);
+		subscribeLocationCache =
+		    getOption(options, LiteralStringRef("subscribeLocationCache"), deterministicRandom()->coinflip());
+		checkLocationPushes = getOption(options, LiteralStringRef("checkLocationPushes"), false);
 	}
 
 	std::string description() const override { return "MoveKeysWorkload"; }
-	Future<Void> setup(Database const& cx) override { return Void(); }
+	Future<Void> setup(Database const& cx) override {
+		// Lets the other workloads of this client follow the shards moved here through the location cache subscription
+		if (subscribeLocationCache) {
+			cx->setOption(FDBDatabaseOptions::LOCATION_CACHE_SUBSCRIBE, Optional<StringRef>());
+		}
+		if (enabled && checkLocationPushes) {
+			return subscriberSetup(cx, this);
+		}
+		return Void();
+	}
+
+	// The subscriber never reads from storage servers, so the only way its cached locations can follow the moves is
+	// through pushed location changes
+	ACTOR Future<Void> subscriberSetup(Database cx, MoveKeysWorkload* self) {
+		self->subscriber = Database::createDatabase(cx->getConnectionFile(), -1);
+		self->subscriber.get()->setOption(FDBDatabaseOptions::LOCATION_CACHE_SUBSCRIBE, Optional<StringRef>());
+		state Transaction tr(self->subscriber.get());
+		wait(tr.warmRange(self->subscriber.get(), normalKeys));
+		return Void();
+	}
+
+	// The sorted IDs of the storage servers the subscriber has cached for the key, or none if it is not cached
+	vector<UID> subscriberLocation(KeyRef key) const {
+		vector<UID> servers;
+		auto location = subscriber.get()->getCachedLocation(key).second;
+		if (location) {
+			for (int s = 0; s < location->size(); s++) {
+				servers.push_back(location->getId(s));
+			}
+			std::sort(servers.begin(), servers.end());
+		}
+		return servers;
+	}
+
+	ACTOR Future<Void> checkLocationPush(MoveKeysWorkload* self, Key key, vector<UID> team) {
+		state double start = now();
+		++self->movesChecked;
+		loop {
+			if (self->subscriberLocation(key) == team) {
+				TEST(true); // Shard move pushed to a subscribed location cache
+				++self->locationPushesSeen;
+				return Void();
+			}
+			if (now() - start > 5.0) {
+				// e.g. because the subscription was reset, or the cache entry was evicted
+				TraceEvent("RMKLocationPushNotSeen").detail("Key", key).detail("Team", describe(team));
+				return Void();
+			}
+			wait(delay(0.1));
+		}
+	}
 	Future<Void> start(Database const& cx) override { return _start(cx, this); }
 
 	ACTOR Future<Void> _start(Database cx, MoveKeysWorkload* self) {
@@ -75,9 +133,22 @@ struct MoveKeysWorkload : TestWorkload {
 
 	double getCheckTimeout() const override { return testDuration / 2 + 1; }
 	Future<bool> check(Database const& cx) override {
-		return tag(delay(testDuration / 2), true);
+		// Some moves may legitimately not be seen, e.g. when another move of the same keys overtakes them, but at least
+		// one must be
+		bool ok = !subscriber.present() || movesChecked == 0 || locationPushesSeen > 0;
+		if (subscriber.present()) {
+			TraceEvent(ok ? SevInfo : SevError, "RMKLocationPushes")
+			    .detail("MovesChecked", movesChecked)
+			    .detail("PushesSeen", locationPushesSeen);
+		}
+		return tag(delay(testDuration / 2), ok);
 	} // Give the database time to recover from our damage
-	void getMetrics(vector<PerfMetric>& m) override {}
+	void getMetrics(vector<PerfMetric>& m) override {
+		if (subscriber.present()) {
+			m.push_back(PerfMetric("Moves Checked", movesChecked, false));
+			m.push_back(PerfMetric("Location Pushes Seen", locationPushesSeen, false));
+		}
+	}
 
 	KeyRange getRandomKeys() const {
 		double len = deterministicRandom()->random01() * this->maxKeyspace;
@@ -124,10 +195,14 @@ struct MoveKeysWorkload : TestWorkload {
 		for (int s = 0; s < destinationTeam.size(); s++)
 			desc +=
 			    format("%s (%llx),", destinationTeam[s].address().toString().c_str(), destinationTeam[s].id().first());
-		vector<UID> destinationTeamIDs;
+		state vector<UID> destinationTeamIDs;
 		destinationTeamIDs.reserve(destinationTeam.size());
 		for (int s = 0; s < destinationTeam.size(); s++)
 			destinationTeamIDs.push_back(destinationTeam[s].id());
+		std::sort(destinationTeamIDs.begin(), destinationTeamIDs.end());
+		// A move can only be seen to be pushed if the subscriber has a different location cached beforehand
+		state bool checkPush = self->subscriber.present() && !self->subscriberLocation(keys.begin).empty() &&
+		                       self->subscriberLocation(keys.begin) != destinationTeamIDs;
 
 		TraceEvent(relocateShardInterval.begin())
 		    .detail("KeyBegin", printable(keys.begin))
@@ -151,6 +226,9 @@ struct MoveKeysWorkload : TestWorkload {
 			              relocateShardInterval.pairID,
 			              &ddEnabledState));
 			TraceEvent(relocateShardInterval.end()).detail("Result", "Success");
+			if (checkPush) {
+				wait(self->checkLocationPush(self, keys.begin, destinationTeamIDs));
+			}
 			return Void();
 		} catch (Error& e) {
 			TraceEvent(relocateShardInterval.end(), self->dbInfo->get().master.id()).error(e, true);
@@ -0,0 +1,183 @@
+/*
+ * RangeAggregate.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2021 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbclient/NativeAPI.actor.h"
+#include "fdbclient/Tuple.h"
+#include "fdbserver/TesterInterface.actor.h"
+#include "fdbserver/workloads/workloads.actor.h"
+#include "flow/actorcompiler.h" // This must be the last #include.
+
+// Compares range aggregates computed by the storage servers with the same aggregates computed from a range read at
+// the same version, while the data is being modified
+struct RangeAggregateWorkload : TestWorkload {
+	int nodeCount, groupCount;
+	double testDuration;
+	Key prefix;
+	bool passed = true;
+
+	RangeAggregateWorkload(WorkloadContext const& wcx) : TestWorkload(wcx) {
+		nodeCount = getOption(options, LiteralStringRef("nodeCount"), 1000);
+		groupCount = getOption(options, LiteralStringRef("groupCount"), 10);
+		testDuration = getOption(options, LiteralStringRef("testDuration"), 10.0);
+		prefix = getOption(options, LiteralStringRef("prefix"), LiteralStringRef("rangeAggregate/"));
+	}
+
+	std::string description() const override { return "RangeAggregate"; }
+
+	Future<Void> setup(Database const& cx) override { return clientId ? Void() : _setup(cx, this); }
+
+	Future<Void> start(Database const& cx) override {
+		if (clientId) {
+			return Void();
+		}
+		return timeout(writer(cx, this) && verifier(cx, this), testDuration, Void());
+	}
+
+	Future<bool> check(Database const& cx) override { return passed; }
+
+	void getMetrics(vector<PerfMetric>& m) override {}
+
+	Key keyFor(int node) const {
+		return prefix.withSuffix(Tuple().append(format("group%d", node % groupCount)).append(node).pack());
+	}
+
+	Key randomKey() const { return keyFor(deterministicRandom()->randomInt(0, nodeCount)); }
+
+	// Mostly little-endian integers of various sizes, as atomic ADD writes them, and some longer values
+	static Value randomValue() {
+		if (deterministicRandom()->random01() < 0.8) {
+			int64_t v = deterministicRandom()->randomInt64(std::numeric_limits<int64_t>::min(),
+			                                              std::numeric_limits<int64_t>::max());
+			return Value(StringRef((const uint8_t*)&v, deterministicRandom()->randomInt(0, sizeof(v) + 1)));
+		}
+		return Value(deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(9, 100)));
+	}
+
+	ACTOR static Future<Void> _setup(Database cx, RangeAggregateWorkload* self) {
+		state int node = 0;
+		while (node < self->nodeCount) {
+			state Transaction tr(cx);
+			loop {
+				try {
+					for (int i = node; i < std::min(node + 100, self->nodeCount); i++) {
+						tr.set(self->keyFor(i), randomValue());
+					}
+					wait(tr.commit());
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+				}
+			}
+			node += 100;
+		}
+		return Void();
+	}
+
+	ACTOR static Future<Void> writer(Database cx, RangeAggregateWorkload* self) {
+		loop {
+			state Transaction tr(cx);
+			loop {
+				try {
+					double r = deterministicRandom()->random01();
+					if (r < 0.1) {
+						tr.clear(self->randomKey());
+					} else if (r < 0.5) {
+						int64_t v = deterministicRandom()->randomInt(-1000, 1000);
+						tr.atomicOp(self->randomKey(), StringRef((const uint8_t*)&v, sizeof(v)), MutationRef::AddValue);
+					} else {
+						tr.set(self->randomKey(), randomValue());
+					}
+					wait(tr.commit());
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+				}
+			}
+			wait(delay(deterministicRandom()->random01() * 0.01));
+		}
+	}
+
+	ACTOR static Future<Standalone<VectorRef<RangeAggregateRef>>> expectedAggregates(Transaction* tr,
+	                                                                                 RangeAggregateWorkload* self,
+	                                                                                 KeyRange keys,
+	                                                                                 int groupTupleElements) {
+		state Standalone<VectorRef<RangeAggregateRef>> expected;
+		if (groupTupleElements <= 0) {
+			expected.push_back(expected.arena(), RangeAggregateRef());
+		}
+		loop {
+			RangeResult kvs = wait(tr->getRange(keys, CLIENT_KNOBS->TOO_MANY, Snapshot::True));
+			for (auto const& kv : kvs) {
+				KeyRef group = groupTupleElements > 0
+				                   ? rangeAggregateGroup(kv.key, self->prefix.size(), groupTupleElements)
+				                   : KeyRef();
+				if (expected.empty() || expected.back().group != group) {
+					expected.push_back_deep(expected.arena(), RangeAggregateRef(group));
+				}
+				expected.back().add(kv);
+			}
+			if (!kvs.more) {
+				return expected;
+			}
+			keys = KeyRangeRef(keyAfter(kvs.back().key), keys.end);
+		}
+	}
+
+	ACTOR static Future<Void> verifier(Database cx, RangeAggregateWorkload* self) {
+		loop {
+			state Transaction tr(cx);
+			state KeyRange keys = prefixRange(self->prefix);
+			if (deterministicRandom()->coinflip()) {
+				Key a = self->randomKey(), b = self->randomKey();
+				keys = KeyRangeRef(std::min(a, b), std::max(a, b));
+			}
+			state int groupTupleElements = deterministicRandom()->randomInt(0, 3);
+			loop {
+				try {
+					state Standalone<VectorRef<RangeAggregateRef>> aggregates =
+					    wait(tr.getRangeAggregate(keys, self->prefix.size(), groupTupleElements, Snapshot::True));
+					Standalone<VectorRef<RangeAggregateRef>> expected =
+					    wait(expectedAggregates(&tr, self, keys, groupTupleElements));
+					if (aggregates != expected) {
+						TraceEvent ev(SevError, "RangeAggregateMismatch");
+						ev.detail("Begin", keys.begin)
+						    .detail("End", keys.end)
+						    .detail("GroupTupleElements", groupTupleElements)
+						    .detail("Groups", aggregates.size())
+						    .detail("ExpectedGroups", expected.size());
+						for (int i = 0; i < std::min(aggregates.size(), expected.size()); i++) {
+							if (aggregates[i] != expected[i]) {
+								ev.detail("Aggregate", aggregates[i].toString())
+								    .detail("Expected", expected[i].toString());
+								break;
+							}
+						}
+						self->passed = false;
+					}
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+				}
+			}
+		}
+	}
+};
+
+WorkloadFactory<RangeAggregateWorkload> RangeAggregateWorkloadFactory("RangeAggregate");
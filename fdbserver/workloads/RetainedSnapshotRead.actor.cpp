@@ -0,0 +1,164 @@
+/*
+ * RetainedSnapshotRead.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2021 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbclient/NativeAPI.actor.h"
+#include "fdbserver/TesterInterface.actor.h"
+#include "fdbserver/workloads/workloads.actor.h"
+#include "flow/actorcompiler.h" // This must be the last #include.
+
+// Reads a range with READ_RETAINED_SNAPSHOT and reads it again at the same version after a delay that is usually
+// longer than the MVCC window, while the data is being modified.  The second read must either return the same
+// result or fail with transaction_too_old, which is expected when storage servers do not retain snapshots.
+struct RetainedSnapshotReadWorkload : TestWorkload {
+	int nodeCount;
+	double testDuration, maxRereadDelay;
+	Key prefix;
+	bool passed = true;
+	PerfIntCounter oldReads, expiredReads;
+
+	RetainedSnapshotReadWorkload(WorkloadContext const& wcx)
+	  : TestWorkload(wcx), oldReads("OldReads"), expiredReads("ExpiredReads") {
+		nodeCount = getOption(options, LiteralStringRef("nodeCount"), 1000);
+		testDuration = getOption(options, LiteralStringRef("testDuration"), 30.0);
+		maxRereadDelay = getOption(options, LiteralStringRef("maxRereadDelay"), 15.0);
+		prefix = getOption(options, LiteralStringRef("prefix"), LiteralStringRef("retainedSnapshot/"));
+	}
+
+	std::string description() const override { return "RetainedSnapshotRead"; }
+
+	Future<Void> setup(Database const& cx) override { return clientId ? Void() : _setup(cx, this); }
+
+	Future<Void> start(Database const& cx) override {
+		if (clientId) {
+			return Void();
+		}
+		return timeout(writer(cx, this) && reader(cx, this), testDuration, Void());
+	}
+
+	Future<bool> check(Database const& cx) override { return passed; }
+
+	void getMetrics(vector<PerfMetric>& m) override {
+		m.push_back(oldReads.getMetric());
+		m.push_back(expiredReads.getMetric());
+	}
+
+	Key keyFor(int node) const { return prefix.withSuffix(format("%08d", node)); }
+
+	Key randomKey() const { return keyFor(deterministicRandom()->randomInt(0, nodeCount)); }
+
+	static Value randomValue() {
+		return Value(deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(1, 100)));
+	}
+
+	ACTOR static Future<Void> _setup(Database cx, RetainedSnapshotReadWorkload* self) {
+		state int node = 0;
+		while (node < self->nodeCount) {
+			state Transaction tr(cx);
+			loop {
+				try {
+					for (int i = node; i < std::min(node + 100, self->nodeCount); i++) {
+						tr.set(self->keyFor(i), randomValue());
+					}
+					wait(tr.commit());
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+				}
+			}
+			node += 100;
+		}
+		return Void();
+	}
+
+	ACTOR static Future<Void> writer(Database cx, RetainedSnapshotReadWorkload* self) {
+		loop {
+			state Transaction tr(cx);
+			loop {
+				try {
+					if (deterministicRandom()->random01() < 0.1) {
+						tr.clear(self->randomKey());
+					} else {
+						tr.set(self->randomKey(), randomValue());
+					}
+					wait(tr.commit());
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+				}
+			}
+			wait(delay(deterministicRandom()->random01() * 0.01));
+		}
+	}
+
+	ACTOR static Future<RangeResult> readAll(Transaction* tr, RetainedSnapshotReadWorkload* self) {
+		tr->setOption(FDBTransactionOptions::READ_RETAINED_SNAPSHOT);
+		RangeResult result = wait(tr->getRange(prefixRange(self->prefix), CLIENT_KNOBS->TOO_MANY));
+		ASSERT(!result.more);
+		return result;
+	}
+
+	ACTOR static Future<Void> reader(Database cx, RetainedSnapshotReadWorkload* self) {
+		loop {
+			state Transaction tr(cx);
+			state Version version;
+			state RangeResult expected;
+			loop {
+				try {
+					RangeResult r = wait(readAll(&tr, self));
+					expected = r;
+					Version v = wait(tr.getReadVersion());
+					version = v;
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+				}
+			}
+
+			state double rereadDelay = deterministicRandom()->random01() * self->maxRereadDelay;
+			wait(delay(rereadDelay));
+
+			loop {
+				tr = Transaction(cx);
+				tr.setVersion(version);
+				try {
+					RangeResult r = wait(readAll(&tr, self));
+					if (r != expected) {
+						TraceEvent(SevError, "RetainedSnapshotReadMismatch")
+						    .detail("Version", version)
+						    .detail("Delay", rereadDelay)
+						    .detail("Rows", r.size())
+						    .detail("ExpectedRows", expected.size());
+						self->passed = false;
+					}
+					++self->oldReads;
+					break;
+				} catch (Error& e) {
+					if (e.code() == error_code_transaction_too_old) {
+						++self->expiredReads;
+						break;
+					}
+					wait(tr.onError(e));
+				}
+			}
+		}
+	}
+};
+
+WorkloadFactory<RetainedSnapshotReadWorkload> RetainedSnapshotReadWorkloadFactory("RetainedSnapshotRead");
@@ -0,0 +1,160 @@
+/*
+ * SpilledTLogCatchUp.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2021 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbrpc/simulator.h"
+#include "fdbclient/ManagementAPI.actor.h"
+#include "fdbclient/NativeAPI.actor.h"
+#include "fdbserver/TesterInterface.actor.h"
+#include "fdbserver/workloads/workloads.actor.h"
+#include "flow/actorcompiler.h" // This must be the last #include.
+
+// Cuts a storage server off while data is written to it, so that its TLogs spill the data, and then measures how fast
+// the storage server catches up, for comparing the spill types (log_spill:=2 spills by reference, log_spill:=3 into
+// per-tag segments). The TLogs only spill the data once they hold TLOG_SPILL_THRESHOLD bytes, so comparisons should
+// be run with a low threshold, e.g. --knob_tlog_spill_threshold=0.
+struct SpilledTLogCatchUpWorkload : TestWorkload {
+	bool enabled;
+	int logSpill;
+	double lagDuration, catchUpTimeout, transactionsPerSecond;
+	int writesPerTransaction, valueBytes;
+	Key keyPrefix;
+
+	int64_t bytesLagged = 0;
+	double catchUpTime = 0;
+
+	SpilledTLogCatchUpWorkload(WorkloadContext const& wcx) : TestWorkload(wcx) {
+		enabled = !clientId && g_network->isSimulated(); // only do this on the "first" client
+		logSpill = getOption(options, LiteralStringRef("logSpill"), (int)TLogSpillType::SEGMENT);
+		lagDuration = getOption(options, LiteralStringRef("lagDuration"), 30.0);
+		catchUpTimeout = getOption(options, LiteralStringRef("catchUpTimeout"), 300.0);
+		transactionsPerSecond = getOption(options, LiteralStringRef("transactionsPerSecond"), 50.0);
+		writesPerTransaction = getOption(options, LiteralStringRef("writesPerTransaction"), 10);
+		valueBytes = getOption(options, LiteralStringRef("valueBytes"), 1000);
+		keyPrefix = getOption(options, LiteralStringRef("keyPrefix"), LiteralStringRef("spilledTLogCatchUp/"));
+	}
+
+	std::string description() const override { return "SpilledTLogCatchUp"; }
+
+	Future<Void> setup(Database const& cx) override { return enabled ? _setup(cx, this) : Future<Void>(Void()); }
+
+	ACTOR Future<Void> _setup(Database cx, SpilledTLogCatchUpWorkload* self) {
+		// The same TLog version for every spill type, so that only the spill type differs
+		state std::string config =
+		    format("log_version:=%d log_spill:=%d", (int)TLogVersion::MAX_SUPPORTED, self->logSpill);
+		ConfigurationResult result = wait(changeConfig(cx, config, true));
+		TraceEvent("SpilledTLogCatchUpConfigured").detail("Config", config).detail("Result", (int)result);
+		return Void();
+	}
+
+	Future<Void> start(Database const& cx) override { return enabled ? _start(cx, this) : Future<Void>(Void()); }
+
+	ACTOR Future<Void> _start(Database cx, SpilledTLogCatchUpWorkload* self) {
+		// Keeps data distribution from moving the lagging storage server's shards away
+		state int oldMode = wait(setDDMode(cx, 0));
+		state StorageServerInterface ssi = wait(getStorageServer(cx, self->keyPrefix));
+
+		TraceEvent("SpilledTLogCatchUpLagging").detail("StorageServer", ssi.id()).detail("Address", ssi.address());
+		g_simulator.clogInterface(ssi.address().ip, self->lagDuration, ClogAll);
+		wait(timeout(self->writer(cx, self), self->lagDuration, Void()));
+
+		state Version target = wait(getReadVersion(cx));
+		state double start = now();
+		loop {
+			ErrorOr<StorageQueuingMetricsReply> metrics =
+			    wait(ssi.getQueuingMetrics.tryGetReply(StorageQueuingMetricsRequest()));
+			if (metrics.present() && metrics.get().version >= target) {
+				self->catchUpTime = now() - start;
+				break;
+			}
+			if (now() - start > self->catchUpTimeout) {
+				TraceEvent(SevWarnAlways, "SpilledTLogCatchUpTimedOut").detail("StorageServer", ssi.id());
+				break;
+			}
+			wait(delay(0.1));
+		}
+		TraceEvent("SpilledTLogCatchUp")
+		    .detail("LogSpill", self->logSpill)
+		    .detail("BytesLagged", self->bytesLagged)
+		    .detail("CatchUpSeconds", self->catchUpTime);
+
+		wait(success(setDDMode(cx, oldMode)));
+		return Void();
+	}
+
+	// The first storage server the client reads the key from
+	ACTOR static Future<StorageServerInterface> getStorageServer(Database cx, Key key) {
+		state Transaction tr(cx);
+		loop {
+			try {
+				wait(success(tr.get(key)));
+				return cx->getCachedLocation(key).second->getInterface(0);
+			} catch (Error& e) {
+				wait(tr.onError(e));
+			}
+		}
+	}
+
+	ACTOR static Future<Version> getReadVersion(Database cx) {
+		state Transaction tr(cx);
+		loop {
+			try {
+				Version v = wait(tr.getReadVersion());
+				return v;
+			} catch (Error& e) {
+				wait(tr.onError(e));
+			}
+		}
+	}
+
+	ACTOR Future<Void> writer(Database cx, SpilledTLogCatchUpWorkload* self) {
+		state double lastTime = now();
+		loop {
+			wait(poisson(&lastTime, 1.0 / self->transactionsPerSecond));
+			state Transaction tr(cx);
+			loop {
+				state int64_t bytes = 0;
+				try {
+					for (int i = 0; i < self->writesPerTransaction; i++) {
+						Key key = self->keyPrefix.withSuffix(deterministicRandom()->randomUniqueID().toString());
+						tr.set(key, Value(deterministicRandom()->randomAlphaNumeric(self->valueBytes)));
+						bytes += key.size() + self->valueBytes;
+					}
+					wait(tr.commit());
+					self->bytesLagged += bytes;
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+				}
+			}
+		}
+	}
+
+	Future<bool> check(Database const& cx) override { return true; }
+
+	void getMetrics(vector<PerfMetric>& m) override {
+		if (enabled) {
+			m.push_back(PerfMetric("Bytes Lagged", bytesLagged, false));
+			m.push_back(PerfMetric("Catch-up Seconds", catchUpTime, false));
+			m.push_back(PerfMetric("Catch-up Bytes/sec", catchUpTime > 0 ? bytesLagged / catchUpTime : 0, false));
+		}
+	}
+};
+
+WorkloadFactory<SpilledTLogCatchUpWorkload> SpilledTLogCatchUpWorkloadFactory("SpilledTLogCatchUp");
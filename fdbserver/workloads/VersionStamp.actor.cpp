@@ -41,6 +41,7 @@ struct VersionStampWorkload : TestWorkload {
 	std::map<Key, std::vector<std::pair<Version, Standalone<StringRef>>>> versionStampKey_commit;
 	int apiVersion;
 	bool soleOwnerOfMetadataVersionKey;
+	bool coalesceCommits;
 
 	VersionStampWorkload(WorkloadContext const& wcx) : TestWorkload(wcx) {
 		testDuration = getOption(options, LiteralStringRef("testDuration"), 60.0);
@@ -53,11 +54,18 @@ struct VersionStampWorkload : TestWorkload {
 		vsValuePrefix = LiteralStringRef("V_").withPrefix(prefix);
 		validateExtraDB = getOption(options, LiteralStringRef("validateExtraDB"), false);
 		soleOwnerOfMetadataVersionKey = getOption(options, LiteralStringRef("soleOwnerOfMetadataVersionKey"), false);
+		coalesceCommits = getOption(options, LiteralStringRef("coalesceCommits"), deterministicRandom()->coinflip());
 	}
 
 	std::string description() const override { return "VersionStamp"; }
 
-	Future<Void> setup(Database const& cx) override { return Void(); }
+	Future<Void> setup(Database const& cx) override {
+		// The versionstamp writes are blind, so they are all eligible for commit coalescing
+		if (coalesceCommits) {
+			cx->setOption(FDBDatabaseOptions::COMMIT_COALESCING_ENABLE, Optional<StringRef>());
+		}
+		return Void();
+	}
 
 	Future<Void> start(Database const& cx) override {
 		// Versionstamp behavior changed starting with API version 520, so
@@ -0,0 +1,109 @@
+/*
+ * BenchConflictSet.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2021 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include "fdbclient/CommitTransaction.h"
+#include "fdbserver/ConflictSet.h"
+#include "flow/Arena.h"
+#include "flow/IRandom.h"
+#include "flow/Platform.h"
+
+// Number of batches whose writes are kept in the conflict set, like the resolver's MVCC window
+static constexpr int VERSION_WINDOW = 50;
+// Number of distinct pre-generated batches cycled through by the benchmark
+static constexpr int BATCH_POOL_SIZE = 64;
+
+// A 16 byte key holding i in big endian after sharedPrefix bytes that every key has in common, so keys are ordered like
+// the integers
+static KeyRef conflictKey(Arena& arena, int sharedPrefix, uint32_t i) {
+	uint8_t* key = new (arena) uint8_t[16];
+	memset(key, '.', 16);
+	uint32_t be = bigEndian32(i);
+	memcpy(key + sharedPrefix, &be, sizeof(be));
+	return KeyRef(key, 16);
+}
+
+static Standalone<VectorRef<CommitTransactionRef>> randomBatch(int transactions, int sharedPrefix) {
+	Standalone<VectorRef<CommitTransactionRef>> batch;
+	Arena& arena = batch.arena();
+	for (int t = 0; t < transactions; t++) {
+		CommitTransactionRef tr;
+		for (int w = 0; w < 2; w++) {
+			uint32_t key = deterministicRandom()->randomInt(0, 20000000);
+			KeyRangeRef range(conflictKey(arena, sharedPrefix, key),
+			                  conflictKey(arena, sharedPrefix, key + 1 + deterministicRandom()->randomInt(0, 10)));
+			if (w == 0) {
+				tr.read_conflict_ranges.push_back(arena, range);
+			} else {
+				tr.write_conflict_ranges.push_back(arena, range);
+			}
+		}
+		batch.push_back(arena, tr);
+	}
+	return batch;
+}
+
+// Benchmarks resolving batches of state.range(0) transactions with one read and one write conflict range each, whose
+// keys share their first state.range(1) bytes. This is the workload of the former skipListTest() harness. Reports the
+// memory held by the conflict set as well as throughput.
+static void bench_conflict_set(benchmark::State& state) {
+	int transactions = state.range(0);
+	int sharedPrefix = state.range(1);
+	std::vector<Standalone<VectorRef<CommitTransactionRef>>> batches;
+	for (int i = 0; i < BATCH_POOL_SIZE; i++) {
+		batches.push_back(randomBatch(transactions, sharedPrefix));
+	}
+
+	ConflictSet* cs = newConflictSet();
+	Version version = VERSION_WINDOW;
+	std::vector<int> nonConflicting;
+	int64_t peakMemory = 0;
+	while (state.KeepRunning()) {
+		ConflictBatch batch(cs);
+		for (auto& tr : batches[version % BATCH_POOL_SIZE]) {
+			tr.read_snapshot = version - 1;
+			batch.addTransaction(tr);
+		}
+		nonConflicting.clear();
+		batch.detectConflicts(version, version - VERSION_WINDOW, nonConflicting);
+		benchmark::DoNotOptimize(nonConflicting.data());
+		++version;
+		peakMemory = std::max(peakMemory, getConflictSetMemoryUsage(cs));
+	}
+	int64_t memory = getConflictSetMemoryUsage(cs);
+	destroyConflictSet(cs);
+
+	state.SetItemsProcessed(transactions * static_cast<long>(state.iterations()));
+	state.counters["ConflictChecks"] =
+	    benchmark::Counter(double(transactions) * state.iterations(), benchmark::Counter::kIsRate);
+	// Bytes allocated for the conflict set's nodes at the end of the run and at its peak
+	state.counters["MemoryBytes"] = memory;
+	state.counters["PeakMemoryBytes"] = peakMemory;
+}
+
+BENCHMARK(bench_conflict_set)
+    ->Args({ 100, 0 })
+    ->Args({ 100, 8 })
+    ->Args({ 1000, 0 })
+    ->Args({ 1000, 8 })
+    ->Args({ 5000, 0 })
+    ->Args({ 5000, 8 })
+    ->ArgNames({ "transactions", "sharedPrefix" });
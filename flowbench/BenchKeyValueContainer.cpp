@@ -0,0 +1,130 @@
+/*
+ * BenchKeyValueContainer.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2021 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include "fdbclient/FDBTypes.h"
+#include "fdbserver/IKeyValueContainer.h"
+#include "fdbserver/PackedKeyValueContainer.h"
+#include "fdbserver/RadixTree.h"
+#include "flow/Arena.h"
+#include "flow/IRandom.h"
+
+#include <algorithm>
+#include <numeric>
+
+static constexpr int VALUE_BYTES = 16;
+static constexpr int LOOKUPS = 1000;
+
+// Keys that look like a table's rows, so that neighboring keys share most of their bytes
+static Standalone<VectorRef<KeyRef>> rowKeys(int entries) {
+	Standalone<VectorRef<KeyRef>> keys;
+	keys.reserve(keys.arena(), entries);
+	for (int i = 0; i < entries; i++) {
+		keys.push_back_deep(keys.arena(), StringRef(format("/table/%010d/field", i * 7)));
+	}
+	return keys;
+}
+
+// The keys in a random order, so that inserting them doesn't only append
+static std::vector<int> shuffledOrder(int entries) {
+	std::vector<int> order(entries);
+	std::iota(order.begin(), order.end(), 0);
+	for (int i = entries - 1; i > 0; i--) {
+		std::swap(order[i], order[deterministicRandom()->randomInt(0, i + 1)]);
+	}
+	return order;
+}
+
+template <class Container>
+static void populate(Container& data, const VectorRef<KeyRef>& keys, const std::vector<int>& order) {
+	uint8_t value[VALUE_BYTES];
+	memset(value, 'v', VALUE_BYTES);
+	for (int i : order) {
+		data.insert(keys[i], StringRef(value, VALUE_BYTES));
+	}
+}
+
+// Benchmarks looking up random keys in a container of state.range(0) pairs inserted in a random order, and reports the
+// memory the container uses for each pair
+template <class Container>
+static void bench_kv_container_lookup(benchmark::State& state) {
+	int entries = state.range(0);
+	Standalone<VectorRef<KeyRef>> keys = rowKeys(entries);
+	Container data;
+	populate(data, keys, shuffledOrder(entries));
+
+	std::vector<KeyRef> lookups;
+	for (int i = 0; i < LOOKUPS; i++) {
+		lookups.push_back(keys[deterministicRandom()->randomInt(0, entries)]);
+	}
+	uint8_t keyBuffer[64];
+	while (state.KeepRunning()) {
+		for (auto const& key : lookups) {
+			auto it = data.lower_bound(key);
+			benchmark::DoNotOptimize(it.getKey(keyBuffer));
+			benchmark::DoNotOptimize(it.getValue());
+		}
+	}
+
+	state.SetItemsProcessed(LOOKUPS * static_cast<long>(state.iterations()));
+	state.counters["BytesPerEntry"] = static_cast<double>(data.sumTo(data.end())) / entries;
+}
+
+// Benchmarks inserting state.range(0) pairs into an empty container, in a random order if state.range(1) is set and in
+// key order otherwise
+template <class Container>
+static void bench_kv_container_insert(benchmark::State& state) {
+	int entries = state.range(0);
+	Standalone<VectorRef<KeyRef>> keys = rowKeys(entries);
+	std::vector<int> order = shuffledOrder(entries);
+	if (!state.range(1)) {
+		std::sort(order.begin(), order.end());
+	}
+
+	while (state.KeepRunning()) {
+		Container data;
+		populate(data, keys, order);
+		benchmark::DoNotOptimize(data.sumTo(data.end()));
+	}
+
+	state.SetItemsProcessed(entries * static_cast<long>(state.iterations()));
+}
+
+static void lookupArgs(benchmark::internal::Benchmark* b) {
+	for (int entries : { 10000, 1000000 }) {
+		b->Args({ entries });
+	}
+	b->ArgNames({ "entries" });
+}
+
+static void insertArgs(benchmark::internal::Benchmark* b) {
+	for (int shuffled : { 0, 1 }) {
+		b->Args({ 100000, shuffled });
+	}
+	b->ArgNames({ "entries", "shuffled" });
+}
+
+BENCHMARK_TEMPLATE(bench_kv_container_lookup, IKeyValueContainer)->Apply(lookupArgs);
+BENCHMARK_TEMPLATE(bench_kv_container_lookup, radix_tree)->Apply(lookupArgs);
+BENCHMARK_TEMPLATE(bench_kv_container_lookup, PackedKeyValueContainer)->Apply(lookupArgs);
+BENCHMARK_TEMPLATE(bench_kv_container_insert, IKeyValueContainer)->Apply(insertArgs);
+BENCHMARK_TEMPLATE(bench_kv_container_insert, radix_tree)->Apply(insertArgs);
+BENCHMARK_TEMPLATE(bench_kv_container_insert, PackedKeyValueContainer)->Apply(insertArgs);
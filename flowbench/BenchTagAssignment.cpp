@@ -0,0 +1,140 @@
+/*
+ * BenchTagAssignment.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2021 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include "fdbclient/FDBTypes.h"
+#include "fdbclient/KeyRangeMap.h"
+#include "fdbclient/StorageServerInterface.h"
+#include "flow/Arena.h"
+#include "flow/IRandom.h"
+#include "flow/Platform.h"
+
+#include <numeric>
+
+static constexpr int STORAGE_SERVERS = 100;
+static constexpr int REPLICAS = 3;
+// Number of distinct pre-generated batches cycled through by the benchmark
+static constexpr int BATCH_POOL_SIZE = 16;
+
+// A 16 byte key holding i in big endian, so keys are ordered like the integers
+static KeyRef numberedKey(Arena& arena, uint32_t i) {
+	uint8_t* key = new (arena) uint8_t[16];
+	memset(key, '.', 16);
+	uint32_t be = bigEndian32(i);
+	memcpy(key, &be, sizeof(be));
+	return KeyRef(key, 16);
+}
+
+// A shard map like the commit proxy's keyInfo, with the key space split evenly into the given number of shards, each
+// on REPLICAS random storage servers
+static void populateShards(KeyRangeMap<ServerCacheInfo>& keyInfo, int shards) {
+	std::vector<Reference<StorageInfo>> servers;
+	for (int i = 0; i < STORAGE_SERVERS; i++) {
+		servers.push_back(makeReference<StorageInfo>());
+		servers.back()->tag = Tag(tagLocalityUpgraded, i);
+	}
+	Arena arena;
+	uint32_t shardSize = std::numeric_limits<uint32_t>::max() / shards;
+	for (int s = 0; s < shards; s++) {
+		ServerCacheInfo info;
+		for (int r = 0; r < REPLICAS; r++) {
+			info.src_info.push_back(servers[deterministicRandom()->randomInt(0, servers.size())]);
+		}
+		KeyRef begin = s ? numberedKey(arena, s * shardSize) : KeyRef();
+		KeyRef end = s + 1 < shards ? numberedKey(arena, (s + 1) * shardSize) : allKeys.end;
+		keyInfo.insert(KeyRangeRef(begin, end), info);
+	}
+}
+
+// Generates the keys of a batch of single key mutations.  A hotFraction of the mutations write to keys in a hot range
+// of 1/1000 of the key space, like a workload writing mostly to recent keys; the rest are uniformly random.
+static Standalone<VectorRef<KeyRef>> randomBatch(int mutations, double hotFraction) {
+	Standalone<VectorRef<KeyRef>> batch;
+	uint32_t hotBegin = deterministicRandom()->randomUInt32();
+	uint32_t hotSize = std::numeric_limits<uint32_t>::max() / 1000;
+	for (int i = 0; i < mutations; i++) {
+		uint32_t k = deterministicRandom()->random01() < hotFraction
+		                 ? hotBegin + deterministicRandom()->randomInt(0, hotSize)
+		                 : deterministicRandom()->randomUInt32();
+		batch.push_back(batch.arena(), numberedKey(batch.arena(), k));
+	}
+	return batch;
+}
+
+// Benchmarks finding the tags of each mutation in batches of state.range(0) mutations over state.range(1) shards, of
+// which state.range(2) percent are in a hot range.  The sorted variant sorts each batch by key and sweeps the shard map
+// once, as the commit proxy does, instead of searching the map for each mutation.
+template <bool sorted>
+static void bench_tag_assignment(benchmark::State& state) {
+	int mutations = state.range(0);
+	KeyRangeMap<ServerCacheInfo> keyInfo;
+	populateShards(keyInfo, state.range(1));
+	std::vector<Standalone<VectorRef<KeyRef>>> batches;
+	for (int i = 0; i < BATCH_POOL_SIZE; i++) {
+		batches.push_back(randomBatch(mutations, state.range(2) / 100.0));
+	}
+
+	std::vector<KeyRef> keys;
+	std::vector<int> order;
+	std::vector<ServerCacheInfo*> shards;
+	std::vector<Tag> tags;
+	int64_t batchNum = 0;
+	while (state.KeepRunning()) {
+		auto const& batch = batches[batchNum++ % BATCH_POOL_SIZE];
+		if (sorted) {
+			keys.assign(batch.begin(), batch.end());
+			order.resize(keys.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(order.begin(), order.end(), [&keys](int a, int b) { return keys[a] < keys[b]; });
+			keyInfo.lookupSorted(keys, order, shards);
+			for (auto shard : shards) {
+				shard->populateTags();
+				tags.insert(tags.end(), shard->tags.begin(), shard->tags.end());
+				benchmark::DoNotOptimize(tags.data());
+				tags.clear();
+			}
+		} else {
+			for (auto const& key : batch) {
+				auto& shard = keyInfo.rangeContaining(key).value();
+				shard.populateTags();
+				tags.insert(tags.end(), shard.tags.begin(), shard.tags.end());
+				benchmark::DoNotOptimize(tags.data());
+				tags.clear();
+			}
+		}
+	}
+
+	state.SetItemsProcessed(mutations * static_cast<long>(state.iterations()));
+}
+
+static void tagAssignmentArgs(benchmark::internal::Benchmark* b) {
+	for (int mutations : { 1000, 10000, 100000 }) {
+		for (int shards : { 100, 10000 }) {
+			for (int hotPercent : { 0, 90 }) {
+				b->Args({ mutations, shards, hotPercent });
+			}
+		}
+	}
+	b->ArgNames({ "mutations", "shards", "hotPercent" });
+}
+
+BENCHMARK_TEMPLATE(bench_tag_assignment, false)->Apply(tagAssignmentArgs);
+BENCHMARK_TEMPLATE(bench_tag_assignment, true)->Apply(tagAssignmentArgs);
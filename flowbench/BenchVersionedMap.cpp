@@ -0,0 +1,150 @@
+/*
+ * BenchVersionedMap.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2021 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include "fdbclient/BTreeVersionedMap.h"
+#include "fdbclient/FDBTypes.h"
+#include "fdbclient/VersionedMap.h"
+#include "flow/Arena.h"
+#include "flow/IRandom.h"
+
+#include <unordered_set>
+
+using PTreeMap = VersionedMap<KeyRef, ValueOrClearToRef>;
+using BTreeMap = BTreeVersionedMap<KeyRef, ValueOrClearToRef>;
+
+static constexpr int KEY_COUNT = 1 << 16;
+// Number of versions kept in the map, like the storage server's MVCC window
+static constexpr int VERSION_WINDOW = 100;
+
+static Standalone<VectorRef<KeyRef>> randomKeys(int count) {
+	Standalone<VectorRef<KeyRef>> keys;
+	keys.reserve(keys.arena(), count);
+	for (int i = 0; i < count; i++) {
+		keys.push_back(keys.arena(), KeyRef(keys.arena(), deterministicRandom()->randomUniqueID().toString()));
+	}
+	return keys;
+}
+
+// Bytes of nodes reachable from any version of the map, as allocated by FastAllocator
+static int64_t nodeBytes(PTreeMap const& map) {
+	std::unordered_set<PTreeMap::PTreeT const*> seen;
+	std::vector<PTreeMap::PTreeT const*> stack;
+	for (auto const& root : map.roots) {
+		if (root.second)
+			stack.push_back(root.second.getPtr());
+	}
+	while (!stack.empty()) {
+		auto n = stack.back();
+		stack.pop_back();
+		if (!seen.insert(n).second)
+			continue;
+		for (int c = 0; c < 3; c++) {
+			if (n->pointer[c])
+				stack.push_back(n->pointer[c].getPtr());
+		}
+	}
+	return seen.size() * int64_t(nextFastAllocatedSize(sizeof(PTreeMap::PTreeT)));
+}
+
+static int64_t nodeBytes(BTreeMap const& map) {
+	std::unordered_set<BTreeMap::NodeT const*> seen;
+	std::vector<BTreeMap::NodeT const*> stack;
+	int64_t bytes = 0;
+	for (auto const& root : map.roots) {
+		if (root.second)
+			stack.push_back(root.second.getPtr());
+	}
+	while (!stack.empty()) {
+		auto n = stack.back();
+		stack.pop_back();
+		if (!seen.insert(n).second)
+			continue;
+		if (n->isLeaf()) {
+			bytes += nextFastAllocatedSize(sizeof(BTreeMap::LeafT));
+		} else {
+			bytes += nextFastAllocatedSize(sizeof(BTreeMap::InteriorT));
+			auto in = BTreeVersionedMapImpl::asInterior(n);
+			for (int i = 0; i < in->count; i++)
+				stack.push_back(in->children[i].getPtr());
+		}
+	}
+	return bytes;
+}
+
+template <class Map>
+static void populate(Map& map, Standalone<VectorRef<KeyRef>> const& keys, ValueRef value) {
+	map.createNewVersion(1);
+	for (auto const& k : keys) {
+		map.insert(k, ValueOrClearToRef::value(value));
+	}
+}
+
+// Benchmarks overwriting random existing keys, with state.range(0) mutations per version and the last VERSION_WINDOW
+// versions retained.  Reports the node memory retained per mutation in the window.
+template <class Map>
+static void bench_versioned_map_insert(benchmark::State& state) {
+	int mutationsPerVersion = state.range(0);
+	auto keys = randomKeys(KEY_COUNT);
+	Value value = makeString(16);
+	Map map;
+	populate(map, keys, value);
+	int64_t baseBytes = nodeBytes(map);
+
+	Version v = 1;
+	while (state.KeepRunning()) {
+		map.createNewVersion(++v);
+		for (int i = 0; i < mutationsPerVersion; i++) {
+			map.insert(keys[deterministicRandom()->randomInt(0, keys.size())], ValueOrClearToRef::value(value));
+		}
+		if (v > VERSION_WINDOW) {
+			map.forgetVersionsBefore(v - VERSION_WINDOW);
+		}
+	}
+
+	state.SetItemsProcessed(mutationsPerVersion * static_cast<long>(state.iterations()));
+	int64_t windowMutations = int64_t(mutationsPerVersion) * std::min<int64_t>(v - 1, VERSION_WINDOW);
+	state.counters["BytesPerMutation"] = double(nodeBytes(map) - baseBytes) / std::max<int64_t>(windowMutations, 1);
+}
+
+// Benchmarks reading state.range(0) consecutive entries from a random key, as the storage server's readRange does
+template <class Map>
+static void bench_versioned_map_range(benchmark::State& state) {
+	int rangeSize = state.range(0);
+	auto keys = randomKeys(KEY_COUNT);
+	Value value = makeString(16);
+	Map map;
+	populate(map, keys, value);
+	auto view = map.atLatest();
+
+	while (state.KeepRunning()) {
+		auto i = view.lower_bound(keys[deterministicRandom()->randomInt(0, keys.size())]);
+		for (int n = 0; i && n < rangeSize; ++n, ++i) {
+			benchmark::DoNotOptimize(i->getValue());
+		}
+	}
+	state.SetItemsProcessed(rangeSize * static_cast<long>(state.iterations()));
+}
+
+BENCHMARK_TEMPLATE(bench_versioned_map_insert, PTreeMap)->RangeMultiplier(16)->Range(1, 1 << 12);
+BENCHMARK_TEMPLATE(bench_versioned_map_insert, BTreeMap)->RangeMultiplier(16)->Range(1, 1 << 12);
+BENCHMARK_TEMPLATE(bench_versioned_map_range, PTreeMap)->RangeMultiplier(10)->Range(1, 1000);
+BENCHMARK_TEMPLATE(bench_versioned_map_range, BTreeMap)->RangeMultiplier(10)->Range(1, 1000);